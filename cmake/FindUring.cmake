@@ -0,0 +1,25 @@
+find_path(URING_ROOT_DIR
+    NAMES include/liburing.h
+)
+
+find_library(URING_LIBRARIES
+    NAMES uring
+    HINTS ${URING_ROOT_DIR}/lib
+)
+
+find_path(URING_INCLUDE_DIR
+    NAMES liburing.h
+    HINTS ${URING_ROOT_DIR}/include
+)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(Uring DEFAULT_MSG
+    URING_LIBRARIES
+    URING_INCLUDE_DIR
+)
+
+mark_as_advanced(
+    URING_ROOT_DIR
+    URING_LIBRARIES
+    URING_INCLUDE_DIR
+)
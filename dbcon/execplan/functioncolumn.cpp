@@ -43,6 +43,7 @@ using namespace boost;
 #include "funcexp.h"
 #include "functor_export.h"
 #include "functor_str.h"
+#include "functor_bool.h"
 using namespace funcexp;
 
 #ifdef _MSC_VER
@@ -95,6 +96,10 @@ FunctionColumn::FunctionColumn( const FunctionColumn& rhs, const uint32_t sessio
     }
 
     fAlias = rhs.alias();
+
+    // don't share the functor rhs owns
+    if (rhs.fDynamicFunctor)
+        setDynamicFunctor();
 }
 
 FunctionColumn::~FunctionColumn()
@@ -307,7 +312,12 @@ void FunctionColumn::unserialize(messageqcpp::ByteStream& b)
     fFunctor = funcExp->getFunctor(fFunctionName);
     fFunctor->timeZone(fTimeZone);
     fFunctor->fix(*this);
+    setDynamicFunctor();
+}
 
+// The functors keeping state for one column get an instance of their own
+void FunctionColumn::setDynamicFunctor()
+{
     // @bug 3506. Special treatment for rand() function. reset the seed
     Func_rand* rand = dynamic_cast<Func_rand*>(fFunctor);
     if (rand)
@@ -320,6 +330,11 @@ void FunctionColumn::unserialize(messageqcpp::ByteStream& b)
     Func_decode* decode = dynamic_cast<Func_decode*>(fFunctor);
     if (decode)
         fFunctor = fDynamicFunctor = new Func_decode();
+
+    // Func_regexp keeps the compiled pattern of the column
+    Func_regexp* regexp = dynamic_cast<Func_regexp*>(fFunctor);
+    if (regexp)
+        fFunctor = fDynamicFunctor = new Func_regexp();
 }
 
 bool FunctionColumn::operator==(const FunctionColumn& t) const
@@ -314,6 +314,8 @@ public:
         fFunctor = functor;
     }
 private:
+    void setDynamicFunctor();
+
     funcexp::FunctionParm fFunctionParms;
     funcexp::Func* fFunctor;   /// functor to execute this function
     funcexp::Func* fDynamicFunctor = NULL; // for rand encode decode
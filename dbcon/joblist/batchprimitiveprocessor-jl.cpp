@@ -1042,6 +1042,9 @@ void BatchPrimitiveProcessorJL::createBPP(ByteStream& bs) const
     if (wideColumnsWidths)
         flags |= HAS_WIDE_COLUMNS;
 
+    if (ot == ROW_GROUP && !bloomFilters.empty())
+        flags |= HAS_BLOOM_FILTERS;
+
     bs << flags;
 
     if (wideColumnsWidths)
@@ -1079,6 +1082,17 @@ void BatchPrimitiveProcessorJL::createBPP(ByteStream& bs) const
         }
         else
             bs << (uint8_t) 0;
+
+        if (flags & HAS_BLOOM_FILTERS)
+        {
+            bs << (uint32_t) bloomFilters.size();
+
+            for (i = 0; i < bloomFilters.size(); i++)
+            {
+                bs << bloomFilterColumns[i];
+                bloomFilters[i]->serialize(bs);
+            }
+        }
     }
 
     /* if HAS_JOINER, send the init params */
@@ -1744,6 +1758,13 @@ void BatchPrimitiveProcessorJL::setJoinFERG(const RowGroup& rg)
     joinFERG = rg;
 }
 
+void BatchPrimitiveProcessorJL::addBloomFilter(uint32_t col,
+        const boost::shared_ptr<joiner::BloomFilter>& filter)
+{
+    bloomFilterColumns.push_back(col);
+    bloomFilters.push_back(filter);
+}
+
 void BatchPrimitiveProcessorJL::abortProcessing(ByteStream* bs)
 {
     ISMPacketHeader ism;
@@ -231,6 +231,9 @@ public:
                      const rowgroup::RowGroup& output);
     void setJoinFERG(const rowgroup::RowGroup& rg);
 
+    /* Bloom filters on join keys, applied right after the filter steps */
+    void addBloomFilter(uint32_t col, const boost::shared_ptr<joiner::BloomFilter>& filter);
+
     /* This fcn determines whether or not the containing TBPS obj will process results
     from a join or put the RG data right in the output datalist. */
     bool pmSendsFinalResult() const
@@ -352,6 +355,10 @@ private:
     rowgroup::RowGroup fe1Input, fe2Output;
     rowgroup::RowGroup joinFERG;
 
+    /* Bloom filters, bloomFilterColumns[i] is the key column of bloomFilters[i] in projectionRG */
+    std::vector<uint32_t> bloomFilterColumns;
+    std::vector<boost::shared_ptr<joiner::BloomFilter> > bloomFilters;
+
     mutable boost::scoped_array<rowgroup::RowGroup> primprocRG;   // the format of the data received from PrimProc
     uint32_t threadCount;
 
@@ -407,7 +407,8 @@ Error:
     for (map_tok = fSessionMessages.begin(); map_tok != fSessionMessages.end(); ++map_tok)
     {
         map_tok->second->queue.clear();
-        (void)atomicops::atomicInc(&map_tok->second->unackedWork[0]);
+        (void)atomicops::atomicAdd<int64_t>(&map_tok->second->unackedBytes[0],
+                                            (int64_t) sbs->lengthWithHdrOverhead());
         map_tok->second->queue.push(sbs);
     }
     lk.unlock();
@@ -467,7 +468,6 @@ void DistributedEngineComm::addQueue(uint32_t key, bool sendACKs)
 
     mqe->queue = StepMsgQueue(lock, cond);
     mqe->sendACKs = sendACKs;
-    mqe->throttled = false;
 
     boost::mutex::scoped_lock lk ( fMlock );
     b = fSessionMessages.insert(pair<uint32_t, boost::shared_ptr<MQE> >(key, mqe)).second;
@@ -529,14 +529,9 @@ void DistributedEngineComm::read(uint32_t key, SBS& bs)
 
     if (bs && mqe->sendACKs)
     {
-        boost::mutex::scoped_lock lk(ackLock);
-
-        if (mqe->throttled && !mqe->hasBigMsgs && queueSize.size <= disableThreshold)
-            setFlowControl(false, key, mqe);
-
         vector<SBS> v;
         v.push_back(bs);
-        sendAcks(key, v, mqe, queueSize.size);
+        returnCredits(key, v, mqe, queueSize.size);
     }
 
     if (!bs)
@@ -567,14 +562,9 @@ const ByteStream DistributedEngineComm::read(uint32_t key)
 
     if (sbs && mqe->sendACKs)
     {
-        boost::mutex::scoped_lock lk(ackLock);
-
-        if (mqe->throttled && !mqe->hasBigMsgs && queueSize.size <= disableThreshold)
-            setFlowControl(false, key, mqe);
-
         vector<SBS> v;
         v.push_back(sbs);
-        sendAcks(key, v, mqe, queueSize.size);
+        returnCredits(key, v, mqe, queueSize.size);
     }
 
     if (!sbs)
@@ -603,10 +593,7 @@ void DistributedEngineComm::read_all(uint32_t key, vector<SBS>& v)
     mqe->queue.pop_all(v);
 
     if (mqe->sendACKs)
-    {
-        boost::mutex::scoped_lock lk(ackLock);
-        sendAcks(key, v, mqe, 0);
-    }
+        returnCredits(key, v, mqe, 0);
 }
 
 void DistributedEngineComm::read_some(uint32_t key, uint32_t divisor, vector<SBS>& v,
@@ -635,212 +622,112 @@ void DistributedEngineComm::read_some(uint32_t key, uint32_t divisor, vector<SBS
 
     if (mqe->sendACKs)
     {
-        boost::mutex::scoped_lock lk(ackLock);
-
-        if (mqe->throttled && !mqe->hasBigMsgs && queueSize.size <= disableThreshold)
-            setFlowControl(false, key, mqe);
-
-        sendAcks(key, v, mqe, queueSize.size);
+        returnCredits(key, v, mqe, queueSize.size);
 
+        // the queue is holding on to a good part of what the PMs may send
         if (flowControlOn)
-            *flowControlOn = mqe->throttled;
+            *flowControlOn = (queueSize.size >= mqe->creditWindow * mqe->pmCount / 2);
     }
 }
 
-void DistributedEngineComm::sendAcks(uint32_t uniqueID, const vector<SBS>& msgs,
-                                     boost::shared_ptr<MQE> mqe, size_t queueSize)
+boost::shared_ptr<DistributedEngineComm::MQE> DistributedEngineComm::findQueue(uint32_t key)
 {
-    ISMPacketHeader* ism;
-    uint32_t l_msgCount = msgs.size();
-
-    /* If the current queue size > target, do nothing.
-     * If the original queue size > target, ACK the msgs below the target.
-     */
-    if (!mqe->throttled || queueSize >= mqe->targetQueueSize)
-    {
-        /* no acks will be sent, but update unackedwork to keep the #s accurate */
-        uint16_t numack = 0;
-        uint32_t sockidx = 0;
-
-        while (l_msgCount > 0)
-        {
-            nextPMToACK(mqe, l_msgCount, &sockidx, &numack);
-            idbassert(numack <= l_msgCount);
-            l_msgCount -= numack;
-        }
-
-        return;
-    }
-
-    size_t totalMsgSize = 0;
-
-    for (uint32_t i = 0; i < msgs.size(); i++)
-        totalMsgSize += msgs[i]->lengthWithHdrOverhead();
-
-    if (queueSize + totalMsgSize > mqe->targetQueueSize)
-    {
-        /* update unackedwork for the overage that will never be acked */
-        int64_t overage = queueSize + totalMsgSize - mqe->targetQueueSize;
-        uint16_t numack = 0;
-        uint32_t sockidx = 0;
-        uint32_t msgsToIgnore;
-
-        for (msgsToIgnore = 0; overage >= 0; msgsToIgnore++)
-            overage -= msgs[msgsToIgnore]->lengthWithHdrOverhead();
-
-        if (overage < 0)
-            msgsToIgnore--;
+    boost::mutex::scoped_lock lk(fMlock);
+    MessageQueueMap::iterator map_tok = fSessionMessages.find(key);
 
-        l_msgCount = msgs.size() - msgsToIgnore;  // this num gets acked
+    if (map_tok == fSessionMessages.end())
+        return boost::shared_ptr<MQE>();
 
-        while (msgsToIgnore > 0)
-        {
-            nextPMToACK(mqe, msgsToIgnore, &sockidx, &numack);
-            idbassert(numack <= msgsToIgnore);
-            msgsToIgnore -= numack;
-        }
-    }
+    return map_tok->second;
+}
 
-    if (l_msgCount > 0)
-    {
-        ByteStream msg(sizeof(ISMPacketHeader));
-        uint16_t* toAck;
-        vector<bool> pmAcked(pmCount, false);
+uint64_t DistributedEngineComm::readerWakeups(uint32_t key)
+{
+    boost::shared_ptr<MQE> mqe = findQueue(key);
 
-        ism = (ISMPacketHeader*) msg.getInputPtr();
-        // The only var checked by ReadThread is the Command var.  The others
-        // are wasted space.  We hijack the Size, & Flags fields for the
-        // params to the ACK msg.
+    return (mqe ? mqe->queue.wakeups() : 0);
+}
 
-        ism->Interleave = uniqueID;
-        ism->Command = BATCH_PRIMITIVE_ACK;
-        toAck = &ism->Size;
+void DistributedEngineComm::waitForData(uint32_t key, uint64_t wakeups, uint32_t timeoutMs)
+{
+    boost::shared_ptr<MQE> mqe = findQueue(key);
 
-        msg.advanceInputPtr(sizeof(ISMPacketHeader));
+    if (mqe)
+        mqe->queue.waitForData(wakeups, boost::posix_time::milliseconds(timeoutMs));
+}
 
-        while (l_msgCount > 0)
-        {
-            /* could have to send up to pmCount ACKs */
-            uint32_t sockIndex = 0;
-
-            /* This will reset the ACK field in the Bytestream directly, and nothing
-             * else needs to change if multiple msgs are sent. */
-            nextPMToACK(mqe, l_msgCount, &sockIndex, toAck);
-            idbassert(*toAck <= l_msgCount);
-            l_msgCount -= *toAck;
-            pmAcked[sockIndex] = true;
-            writeToClient(sockIndex, msg);
-        }
+void DistributedEngineComm::wakeReaders(uint32_t key)
+{
+    boost::shared_ptr<MQE> mqe = findQueue(key);
 
-        // @bug4436, when no more unacked work, send an ack to all PMs that haven't been acked.
-        // This is apply to the big message case only.  For small messages, the flow control is
-        // disabled when the queue size is below the disableThreshold.
-        if (mqe->hasBigMsgs)
-        {
-            uint64_t totalUnackedWork = 0;
+    if (mqe)
+        mqe->queue.wakeReaders();
+}
 
-            for (uint32_t i = 0; i < pmCount; i++)
-                totalUnackedWork += mqe->unackedWork[i];
+uint64_t DistributedEngineComm::initialCredit(uint32_t uniqueID)
+{
+    boost::shared_ptr<MQE> mqe = findQueue(uniqueID);
 
-            if (totalUnackedWork == 0)
-            {
-                *toAck = 1;
+    // steps that don't send ACKs can't give credit back
+    if (!mqe || !mqe->sendACKs)
+        return (uint64_t) - 1;
 
-                for (uint32_t i = 0; i < pmCount; i++)
-                {
-                    if (!pmAcked[i])
-                        writeToClient(i, msg);
-                }
-            }
-        }
-    }
+    return mqe->creditWindow;
 }
 
-void DistributedEngineComm::nextPMToACK(boost::shared_ptr<MQE> mqe, uint32_t maxAck,
-                                        uint32_t* sockIndex, uint16_t* numToAck)
+void DistributedEngineComm::returnCredits(uint32_t uniqueID, const vector<SBS>& msgs,
+                                          boost::shared_ptr<MQE> mqe, size_t queueSize)
 {
-    uint32_t i;
-    uint32_t& nextIndex = mqe->ackSocketIndex;
-
-    /* Other threads can be touching mqe->unackedWork at the same time, but because of
-     * the locking env, mqe->unackedWork can only grow; whatever gets latched in this fcn
-     * is a safe minimum at the point of use. */
+    boost::mutex::scoped_lock lk(ackLock);
 
-    if (mqe->unackedWork[nextIndex] >= maxAck)
-    {
-        (void)atomicops::atomicSub(&mqe->unackedWork[nextIndex], maxAck);
-        *sockIndex = nextIndex;
-        //FIXME: we're going to truncate here from 32 to 16 bits. Hopefully this will always fit...
-        *numToAck = maxAck;
-
-        if (pmCount > 0)
-            nextIndex = (nextIndex + 1) % pmCount;
+    for (uint32_t i = 0; i < msgs.size(); i++)
+        mqe->consumedBytes += msgs[i]->lengthWithHdrOverhead();
 
+    /* ACK in batches of 1/8th of the window, or everything once the queue is empty
+     * so no PM is left waiting for credit while nothing is being read. */
+    if (mqe->consumedBytes == 0 || (mqe->consumedBytes < mqe->creditWindow / 8 && queueSize > 0))
         return;
-    }
-    else
-    {
-        for (i = 0; i < pmCount; i++)
-        {
-            uint32_t curVal = mqe->unackedWork[nextIndex];
-            uint32_t unackedWork = (curVal > maxAck ? maxAck : curVal);
 
-            if (unackedWork > 0)
-            {
-                (void)atomicops::atomicSub(&mqe->unackedWork[nextIndex], unackedWork);
-                *sockIndex = nextIndex;
-                *numToAck = unackedWork;
+    /* The msgs don't say which PM sent them.  Whatever PM is owed the most gets
+     * the credit first; by the time the queue drains, every PM is paid back. */
+    while (mqe->consumedBytes > 0)
+    {
+        uint32_t pm = 0;
 
-                if (pmCount > 0)
-                    nextIndex = (nextIndex + 1) % pmCount;
+        for (uint32_t i = 1; i < mqe->pmCount; i++)
+            if (mqe->unackedBytes[i] > mqe->unackedBytes[pm])
+                pm = i;
 
-                return;
-            }
+        int64_t owed = mqe->unackedBytes[pm];
 
-            if (pmCount > 0)
-                nextIndex = (nextIndex + 1) % pmCount;
+        if (owed <= 0)
+        {
+            // only a msg from a PM that left can get here
+            mqe->consumedBytes = 0;
+            break;
         }
 
-        cerr << "DEC::nextPMToACK(): Couldn't find a PM to ACK! ";
-
-        for (i = 0; i < pmCount; i++)
-            cerr << mqe->unackedWork[i] << " ";
-
-        cerr << " max: " << maxAck;
-        cerr << endl;
-        //make sure the returned vars are legitimate
-        *sockIndex = nextIndex;
-        *numToAck = maxAck / pmCount;
-
-        if (pmCount > 0)
-            nextIndex = (nextIndex + 1) % pmCount;
-
-        return;
+        uint64_t credit = ((uint64_t) owed < mqe->consumedBytes ? (uint64_t) owed : mqe->consumedBytes);
+        (void)atomicops::atomicSub<int64_t>(&mqe->unackedBytes[pm], (int64_t) credit);
+        mqe->consumedBytes -= credit;
+        sendCredit(uniqueID, pm, credit);
     }
 }
 
-void DistributedEngineComm::setFlowControl(bool enabled, uint32_t uniqueID, boost::shared_ptr<MQE> mqe)
+void DistributedEngineComm::sendCredit(uint32_t uniqueID, uint32_t pmIndex, uint64_t bytes)
 {
-    mqe->throttled = enabled;
-    ByteStream msg(sizeof(ISMPacketHeader));
+    ByteStream msg(sizeof(ISMPacketHeader) + sizeof(uint64_t));
     ISMPacketHeader* ism = (ISMPacketHeader*) msg.getInputPtr();
 
+    // The only var checked by ReadThread is the Command var.  The credit
+    // follows the header.
+    memset((void*) ism, 0, sizeof(ISMPacketHeader));
     ism->Interleave = uniqueID;
     ism->Command = BATCH_PRIMITIVE_ACK;
-    ism->Size = (enabled ? 0 : -1);
-
-#ifdef VALGRIND
-    /* XXXPAT: For testing in valgrind, init the vars that don't get used */
-    ism->Flags = 0;
-    ism->Type = 0;
-    ism->MsgCount = 0;
-    ism->Status = 0;
-#endif
 
     msg.advanceInputPtr(sizeof(ISMPacketHeader));
-
-    for (uint32_t i = 0; i < mqe->pmCount; i++)
-        writeToClient(i, msg);
+    msg << bytes;
+    writeToClient(pmIndex, msg);
 }
 
 void DistributedEngineComm::write(uint32_t senderID, ByteStream& msg)
@@ -854,8 +741,8 @@ void DistributedEngineComm::write(uint32_t senderID, ByteStream& msg)
         switch (ism->Command)
         {
             case BATCH_PRIMITIVE_CREATE:
-                /* Disable flow control initially */
-                msg << (uint32_t) - 1;
+                /* How many bytes each PM may send before it waits for an ACK */
+                msg << initialCredit(senderID);
 		    /* FALLTHRU */
 
             case BATCH_PRIMITIVE_DESTROY:
@@ -945,38 +832,17 @@ void DistributedEngineComm::addDataToOutput(SBS sbs, uint32_t connIndex, Stats*
     mqe = map_tok->second;
     lk.unlock();
 
-    if (pmCount > 0)
-    {
-        (void)atomicops::atomicInc(&mqe->unackedWork[connIndex % pmCount]);
-    }
+    // counted before it can be read so the credit given back never exceeds it
+    if (mqe->pmCount > 0)
+        (void)atomicops::atomicAdd<int64_t>(&mqe->unackedBytes[connIndex % mqe->pmCount],
+                                            (int64_t) sbs->lengthWithHdrOverhead());
 
-    TSQSize_t queueSize = mqe->queue.push(sbs);
-
-    if (mqe->sendACKs)
-    {
-        boost::mutex::scoped_lock lk(ackLock);
-        uint64_t msgSize = sbs->lengthWithHdrOverhead();
-
-        if (!mqe->throttled && msgSize > (targetRecvQueueSize / 2))
-            doHasBigMsgs(mqe, (300 * 1024 * 1024 > 3 * msgSize ?
-                               300 * 1024 * 1024 : 3 * msgSize)); //buffer at least 3 big msgs
-
-        if (!mqe->throttled && queueSize.size >= mqe->targetQueueSize)
-            setFlowControl(true, uniqueId, mqe);
-    }
+    mqe->queue.push(sbs);
 
     if (stats)
         mqe->stats.dataRecvd(stats->dataRecvd());
 }
 
-void DistributedEngineComm::doHasBigMsgs(boost::shared_ptr<MQE> mqe, uint64_t targetSize)
-{
-    mqe->hasBigMsgs = true;
-
-    if (mqe->targetQueueSize < targetSize)
-        mqe->targetQueueSize = targetSize;
-}
-
 int DistributedEngineComm::writeToClient(size_t aPMIndex, const ByteStream& bs, uint32_t senderUniqueID, bool doInterleaving)
 {
     boost::mutex::scoped_lock lk(fMlock, boost::defer_lock_t());
@@ -1030,7 +896,8 @@ int DistributedEngineComm::writeToClient(size_t aPMIndex, const ByteStream& bs,
         for (map_tok = fSessionMessages.begin(); map_tok != fSessionMessages.end(); ++map_tok)
         {
             map_tok->second->queue.clear();
-            (void)atomicops::atomicInc(&map_tok->second->unackedWork[0]);
+            (void)atomicops::atomicAdd<int64_t>(&map_tok->second->unackedBytes[0],
+                                                (int64_t) sbs->lengthWithHdrOverhead());
             map_tok->second->queue.push(sbs);
         }
 
@@ -1118,11 +985,12 @@ Stats DistributedEngineComm::getNetworkStats(uint32_t uniqueID)
 }
 
 DistributedEngineComm::MQE::MQE(const uint32_t pCount, const uint32_t initialInterleaverValue)
-    : ackSocketIndex(0), pmCount(pCount), hasBigMsgs(false), targetQueueSize(targetRecvQueueSize)
+    : pmCount(pCount), sendACKs(false),
+      creditWindow(targetRecvQueueSize / (pCount > 0 ? pCount : 1)), consumedBytes(0)
 {
-    unackedWork.reset(new volatile uint32_t[pmCount]);
+    unackedBytes.reset(new volatile int64_t[pmCount]);
     interleaver.reset(new uint32_t[pmCount]);
-    memset((void*) unackedWork.get(), 0, pmCount * sizeof(uint32_t));
+    memset((void*) unackedBytes.get(), 0, pmCount * sizeof(int64_t));
     uint32_t interleaverValue = initialInterleaverValue;
     initialConnectionId = initialInterleaverValue;
     for (size_t pmId = 0; pmId < pmCount; ++pmId)
@@ -132,10 +132,26 @@ public:
      */
     EXPORT void read_all(uint32_t key, std::vector<messageqcpp::SBS>& v);
 
-    /** reads queuesize/divisor msgs */
+    /** reads queuesize/divisor msgs
+     *
+     * @param flowControlOn set to true when the msgs are arriving faster than they are read
+     */
     EXPORT void read_some(uint32_t key, uint32_t divisor, std::vector<messageqcpp::SBS>& v,
                           bool* flowControlOn = NULL);
 
+    /** @brief the number of wakeReaders() calls made for the queue so far */
+    EXPORT uint64_t readerWakeups(uint32_t key);
+
+    /** @brief wait for a primitive response to arrive
+     *
+     * Returns when the queue for key has a msg, wakeReaders(key) was called since
+     * readerWakeups(key) returned wakeups, or after timeoutMs.
+     */
+    EXPORT void waitForData(uint32_t key, uint64_t wakeups, uint32_t timeoutMs);
+
+    /** @brief cause all readers blocked in waitForData() on the queue to return */
+    EXPORT void wakeReaders(uint32_t key);
+
     /** @brief Write a primitive message
      *
      * Writes a primitive message to a primitive server. Msg needs to conatin an ISMPacketHeader. The
@@ -223,24 +239,21 @@ private:
                                      const uint32_t DECConnectionsPerQuery);
         messageqcpp::Stats stats;
         StepMsgQueue queue;
-        uint32_t ackSocketIndex;
-        boost::scoped_array<volatile uint32_t> unackedWork;
+        // bytes each PM has sent that haven't been given back to it as credit
+        boost::scoped_array<volatile int64_t> unackedBytes;
         boost::scoped_array<uint32_t> interleaver;
         uint32_t initialConnectionId;
         uint32_t pmCount;
         // non-BPP primitives don't do ACKs
         bool sendACKs;
 
-        // This var will allow us to toggle flow control for BPP instances when
-        // the UM is keeping up.  Send -1 as the ACK value to disable flow control
-        // on the PM side, positive value to reenable it.  Not yet impl'd on the UM side.
-        bool throttled;
-
-        // This var signifies that the PM can return msgs big enough to keep toggling
-        // FC on and off.  We force FC on in that case and maintain a larger buffer.
-        bool hasBigMsgs;
+        // The PMs send as many bytes as they have credit for.  Each starts with
+        // creditWindow bytes, and the bytes read off the queue are given back
+        // once there are enough of them to be worth an ACK.
+        uint64_t creditWindow;
 
-        uint64_t targetQueueSize;
+        // bytes read off the queue that haven't been given back yet
+        uint64_t consumedBytes;
     };
 
     //The mapping of session ids to StepMsgQueueLists
@@ -288,16 +301,14 @@ private:
     // send-side throttling vars
     uint64_t throttleThreshold;
     static const uint32_t targetRecvQueueSize = 50000000;
-    static const uint32_t disableThreshold = 10000000;
     uint32_t tbpsThreadCount;
     uint32_t fDECConnectionsPerQuery;
 
-    void sendAcks(uint32_t uniqueID, const std::vector<messageqcpp::SBS>& msgs,
-                  boost::shared_ptr<MQE> mqe, size_t qSize);
-    void nextPMToACK(boost::shared_ptr<MQE> mqe, uint32_t maxAck, uint32_t* sockIndex,
-                     uint16_t* numToAck);
-    void setFlowControl(bool enable, uint32_t uniqueID, boost::shared_ptr<MQE> mqe);
-    void doHasBigMsgs(boost::shared_ptr<MQE> mqe, uint64_t targetSize);
+    boost::shared_ptr<MQE> findQueue(uint32_t key);
+    uint64_t initialCredit(uint32_t uniqueID);
+    void returnCredits(uint32_t uniqueID, const std::vector<messageqcpp::SBS>& msgs,
+                       boost::shared_ptr<MQE> mqe, size_t qSize);
+    void sendCredit(uint32_t uniqueID, uint32_t pmIndex, uint64_t bytes);
     boost::mutex ackLock;
 
 };
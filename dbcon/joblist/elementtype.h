@@ -264,6 +264,7 @@ extern std::ostream& operator<<(std::ostream& out, const TupleType& rhs);
 //#include "bandeddl.h"
 //#include "wsdl.h"
 #include "fifo.h"
+#include "ringbufferdl.h"
 //#include "bucketdl.h"
 //#include "constantdatalist.h"
 //#include "swsdl.h"
@@ -349,7 +350,7 @@ typedef DataList<StringElementType> StrDataList;
 // */
 //typedef BucketDL<TupleType> TupleBucketDataList;
 
-typedef FIFO<rowgroup::RGData> RowGroupDL;
+typedef RingBufferDL<rowgroup::RGData> RowGroupDL;
 
 }
 
@@ -21,31 +21,59 @@
 #include <iostream>
 //#define NDEBUG
 #include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
 #include <string>
+#include <sstream>
+#include <unistd.h>
 using namespace std;
 
 #include <boost/shared_array.hpp>
+#include <boost/scoped_array.hpp>
 using namespace boost;
 
 #include "errorids.h"
 #include "exceptclasses.h"
+#include "idberrorinfo.h"
 using namespace logging;
 
 #include "rowgroup.h"
 using namespace rowgroup;
 
+#include "bytestream.h"
+using namespace messageqcpp;
+
 #include "jlf_common.h"
 #include "limitedorderby.h"
 
 using namespace ordering;
 
+namespace
+{
+
+void throwRunFileError(const char* what, const string& filename, int saveErrno = 0)
+{
+    ostringstream os;
+    os << what << " " << filename;
+
+    if (saveErrno != 0)
+        os << ": " << strerror(saveErrno);
+
+    throw IDBExcept(IDBErrorInfo::instance()->errorMsg(ERR_ORDERBY_FILE_IO_ERROR, os.str()),
+                    ERR_ORDERBY_FILE_IO_ERROR);
+}
+
+}
+
 namespace joblist
 {
 
 const uint64_t LimitedOrderBy::fMaxUncommited = 102400; // 100KiB - make it configurable?
 
 // LimitedOrderBy class implementation
-LimitedOrderBy::LimitedOrderBy() : fStart(0), fCount(-1), fUncommitedMemory(0)
+LimitedOrderBy::LimitedOrderBy() : fStart(0), fCount(-1), fUncommitedMemory(0),
+    fDiskBased(false), fSpillPending(false), fBaseMemSize(0)
 {
     fRule.fIdbCompare = this;
 }
@@ -53,6 +81,9 @@ LimitedOrderBy::LimitedOrderBy() : fStart(0), fCount(-1), fUncommitedMemory(0)
 
 LimitedOrderBy::~LimitedOrderBy()
 {
+    // runs left behind by a cancelled or failed query
+    for (vector<string>::iterator i = fRunFiles.begin(); i != fRunFiles.end(); i++)
+        unlink(i->c_str());
 }
 
 
@@ -96,6 +127,39 @@ void LimitedOrderBy::initialize(const RowGroup& rg, const JobInfo& jobInfo, bool
     }
 
     IdbOrderBy::initialize(rg);
+    fBaseMemSize = fMemSize;
+}
+
+
+void LimitedOrderBy::enableDiskBased(const string& prefix, uint32_t compressionType)
+{
+    fDiskBased = true;
+    fSpillPrefix = prefix;
+
+    if (compressionType != 0)
+        fCompressor.reset(compress::getCompressInterfaceByType(compressionType));
+}
+
+
+// In disk-based mode running out of memory only marks the rows for spilling,
+// processRow() writes them out once the current row is in place.  Spilling
+// beats waiting for memory, so getMemory() doesn't retry then.
+void LimitedOrderBy::chargeMemory(uint64_t size)
+{
+    fMemSize += size;
+
+    if (!fRm->getMemory(size, fSessionMemLimit, !fDiskBased))
+    {
+        if (fDiskBased)
+        {
+            fSpillPending = true;
+            return;
+        }
+
+        cerr << IDBErrorInfo::instance()->errorMsg(fErrorCode) << " @"
+             << __FILE__ << ":" << __LINE__;
+        throw IDBExcept(fErrorCode);
+    }
 }
 
 // This must return a proper number of key columns and
@@ -127,13 +191,7 @@ void LimitedOrderBy::processRow(const rowgroup::Row& row)
         fUncommitedMemory += memSizeInc;
         if (fUncommitedMemory >= fMaxUncommited)
         {
-            fMemSize += fUncommitedMemory;
-            if (!fRm->getMemory(fUncommitedMemory, fSessionMemLimit))
-            {
-                cerr << IDBErrorInfo::instance()->errorMsg(fErrorCode) << " @"
-                     << __FILE__ << ":" << __LINE__;
-                throw IDBExcept(fErrorCode);
-            }
+            chargeMemory(fUncommitedMemory);
             fUncommitedMemory = 0;
         }
 
@@ -147,21 +205,15 @@ void LimitedOrderBy::processRow(const rowgroup::Row& row)
         if (fRowGroup.getRowCount() >= fRowsPerRG)
         {
             fDataQueue.push(fData);
-            uint64_t newSize = fRowGroup.getSizeWithStrings() - fRowGroup.getHeaderSize();
-            fMemSize += newSize;
-
-            if (!fRm->getMemory(newSize, fSessionMemLimit))
-            {
-                cerr << IDBErrorInfo::instance()->errorMsg(fErrorCode)
-                     << " @" << __FILE__ << ":" << __LINE__;
-                throw IDBExcept(fErrorCode);
-            }
-
+            chargeMemory(fRowGroup.getSizeWithStrings() - fRowGroup.getHeaderSize());
             fData.reinit(fRowGroup, fRowsPerRG);
             fRowGroup.setData(&fData);
             fRowGroup.resetRowGroup(0);
             fRowGroup.getRow(0, &fRow0);
         }
+
+        if (fSpillPending)
+            spillRun();
     }
 
     else if (fOrderByCond.size() > 0 && fRule.less(row.getPointer(), fOrderByQueue.top().fData))
@@ -190,16 +242,17 @@ void LimitedOrderBy::finalize()
 {
     if (fUncommitedMemory > 0)
     {
-        fMemSize += fUncommitedMemory;
-        if (!fRm->getMemory(fUncommitedMemory, fSessionMemLimit))
-        {
-            cerr << IDBErrorInfo::instance()->errorMsg(fErrorCode) << " @"
-                 << __FILE__ << ":" << __LINE__;
-            throw IDBExcept(fErrorCode);
-        }
+        chargeMemory(fUncommitedMemory);
         fUncommitedMemory = 0;
     }
 
+    // the merge of the runs delivers the rows, what is left joins them
+    if (spilled() || fSpillPending)
+    {
+        spillRun();
+        return;
+    }
+
     queue<RGData> tempQueue;
     if (fRowGroup.getRowCount() > 0)
         fDataQueue.push(fData);
@@ -293,6 +346,389 @@ void LimitedOrderBy::finalize()
 }
 
 
+/*
+ * Pops the queue into a sorted run file.  The queue hands out the last row
+ * first, so the rows are collected backwards and written in sort order.
+ * The file has the disk join record layout.
+ */
+void LimitedOrderBy::spillRun()
+{
+    fSpillPending = false;
+
+    if (fOrderByQueue.size() > 0)
+    {
+        vector<Row::Pointer> rows(fOrderByQueue.size());
+
+        for (uint64_t i = rows.size(); i > 0; i--)
+        {
+            rows[i - 1] = fOrderByQueue.top().fData;
+            fOrderByQueue.pop();
+        }
+
+        ostringstream os;
+        os << fSpillPrefix << fRunFiles.size();
+        fRunFiles.push_back(os.str());
+        SortedRunWriter writer(fRunFiles.back(), fRowGroup, fCompressor.get());
+
+        for (uint64_t i = 0; i < rows.size(); i++)
+        {
+            row1.setData(rows[i]);
+            writer.write(row1);
+        }
+
+        writer.flush();
+    }
+
+    // keep the buffer allocated by initialize(), the rest goes back
+    queue<RGData>().swap(fDataQueue);
+    fData.reinit(fRowGroup, fRowsPerRG);
+    fRowGroup.setData(&fData);
+    fRowGroup.resetRowGroup(0);
+    fRowGroup.getRow(0, &fRow0);
+    fRm->returnMemory(fMemSize - fBaseMemSize, fSessionMemLimit);
+    fMemSize = fBaseMemSize;
+    fUncommitedMemory = 0;
+}
+
+
+SortedRunWriter::SortedRunWriter(const string& filename, const RowGroup& rg,
+                                 compress::CompressInterface* compressor) :
+    fFilename(filename),
+    fFile(filename.c_str(), ios::binary | ios::out | ios::trunc),
+    fCompressor(compressor),
+    fRowGroup(rg)
+{
+    if (!fFile)
+        throwRunFileError("could not open (write access)", fFilename, errno);
+
+    fData.reinit(fRowGroup, rowgroup::rgCommonSize);
+    fRowGroup.setData(&fData);
+    fRowGroup.resetRowGroup(0);
+    fRowGroup.initRow(&fRow);
+    fRowGroup.getRow(0, &fRow);
+}
+
+
+void SortedRunWriter::write(const Row& row)
+{
+    copyRow(row, &fRow);
+    fRowGroup.incRowCount();
+    fRow.nextRow();
+
+    if (fRowGroup.getRowCount() >= (uint64_t) rowgroup::rgCommonSize)
+        flush();
+}
+
+
+void SortedRunWriter::flush()
+{
+    if (fRowGroup.getRowCount() == 0)
+        return;
+
+    ByteStream bs;
+    fRowGroup.serializeRGData(bs);
+    size_t len = bs.length();
+
+    if (!fCompressor)
+    {
+        fFile.write((char*) &len, sizeof(len));
+        fFile.write((char*) bs.buf(), len);
+    }
+    else
+    {
+        size_t actualSize = fCompressor->maxCompressedSize(len);
+        scoped_array<char> compressed(new char[actualSize]);
+
+        if (fCompressor->compress((char*) bs.buf(), len, compressed.get(), &actualSize) !=
+                compress::CompressInterface::ERR_OK)
+            throwRunFileError("could not compress", fFilename);
+
+        fFile.write((char*) &actualSize, sizeof(actualSize));
+        fFile.write((char*) &len, sizeof(len));
+        fFile.write(compressed.get(), actualSize);
+    }
+
+    if (!fFile.flush())
+        throwRunFileError("could not write", fFilename, errno);
+
+    fData.reinit(fRowGroup, rowgroup::rgCommonSize);
+    fRowGroup.setData(&fData);
+    fRowGroup.resetRowGroup(0);
+    fRowGroup.getRow(0, &fRow);
+}
+
+
+SortedRun::SortedRun(const string& filename, const RowGroup& rg,
+                     compress::CompressInterface* compressor) :
+    fFilename(filename),
+    fFile(filename.c_str(), ios::binary | ios::in),
+    fCompressor(compressor),
+    fRowGroup(rg),
+    fRowIdx(0)
+{
+    if (!fFile)
+        throwRunFileError("could not open (read access)", fFilename, errno);
+
+    fRowGroup.initRow(&fRow);
+}
+
+
+SortedRun::~SortedRun()
+{
+    fFile.close();
+    unlink(fFilename.c_str());
+}
+
+
+bool SortedRun::next()
+{
+    if (fRowIdx > 0 && fRowIdx < fRowGroup.getRowCount())
+    {
+        fRow.nextRow();
+        fRowIdx++;
+        return true;
+    }
+
+    // runs have no empty RowGroups
+    if (!readRowGroup())
+        return false;
+
+    fRowGroup.getRow(0, &fRow);
+    fRowIdx = 1;
+    return true;
+}
+
+
+bool SortedRun::readRowGroup()
+{
+    size_t len;
+
+    if (!fFile.read((char*) &len, sizeof(len)))
+    {
+        if (!fFile.eof())
+            throwRunFileError("could not read", fFilename, errno);
+
+        // the run is read, free the disk space now
+        fFile.close();
+        unlink(fFilename.c_str());
+        fData = RGData();
+        return false;
+    }
+
+    ByteStream bs;
+
+    if (!fCompressor)
+    {
+        bs.needAtLeast(len);
+        fFile.read((char*) bs.getInputPtr(), len);
+        bs.advanceInputPtr(len);
+    }
+    else
+    {
+        size_t uncompressedSize = 0;
+        fFile.read((char*) &uncompressedSize, sizeof(uncompressedSize));
+        scoped_array<char> buf(new char[len]);
+
+        if (!fFile.read(buf.get(), len))
+            throwRunFileError("could not read", fFilename, errno);
+
+        size_t outLen = uncompressedSize;
+        bs.needAtLeast(uncompressedSize);
+
+        if (fCompressor->uncompress(buf.get(), len, (char*) bs.getInputPtr(), &outLen) !=
+                compress::CompressInterface::ERR_OK || outLen != uncompressedSize)
+            throwRunFileError("could not uncompress", fFilename);
+
+        bs.advanceInputPtr(uncompressedSize);
+    }
+
+    if (!fFile)
+        throwRunFileError("could not read", fFilename, errno);
+
+    fData.deserialize(bs);
+    fRowGroup.setData(&fData);
+    return true;
+}
+
+
+// A finished run loses to everything, the initial entries (fRuns.size()) win
+// against everything so that each adjust() settles one of them.
+bool SortedRunMerger::beats(uint64_t a, uint64_t b)
+{
+    if (a == fRuns.size())
+        return true;
+
+    if (b == fRuns.size() || fDone[a])
+        return false;
+
+    if (fDone[b])
+        return true;
+
+    return fRule.less(fRuns[a]->getRow().getPointer(), fRuns[b]->getRow().getPointer());
+}
+
+
+void SortedRunMerger::adjust(uint64_t run)
+{
+    for (uint64_t t = (run + fRuns.size()) / 2; t > 0; t /= 2)
+    {
+        if (beats(fTree[t], run))
+            std::swap(run, fTree[t]);
+    }
+
+    fTree[0] = run;
+}
+
+
+bool SortedRunMerger::next()
+{
+    if (fRuns.empty())
+        return false;
+
+    if (!fStarted)
+    {
+        fStarted = true;
+        fDone.resize(fRuns.size());
+
+        for (uint64_t i = 0; i < fRuns.size(); i++)
+            fDone[i] = !fRuns[i]->next();
+
+        fTree.assign(fRuns.size(), fRuns.size());
+
+        for (uint64_t i = fRuns.size(); i > 0; i--)
+            adjust(i - 1);
+    }
+    else
+    {
+        uint64_t winner = fTree[0];
+        fDone[winner] = !fRuns[winner]->next();
+        adjust(winner);
+    }
+
+    return !fDone[fTree[0]];
+}
+
+
+MultiPassMerger::MultiPassMerger(const vector<LimitedOrderBy*>& orderByList, const RowGroup& rg,
+                                 uint64_t limitStart, uint64_t limitCount, uint64_t maxFanIn) :
+    fRule(orderByList[0]->getRule()),
+    fRowGroup(rg),
+    fCompressor(orderByList[0]->getCompressor()),   // the instances are set up alike
+    fRm(orderByList[0]->getResourceManager()),
+    fSessionMemLimit(orderByList[0]->getSessionMemLimit()),
+    fMemSize(0),
+    fLimitStart(limitStart),
+    fLimitCount(limitCount),
+    fReturned(0),
+    fPasses(0)
+{
+    maxFanIn = std::max<uint64_t>(maxFanIn, 2);
+    vector<string> runs;
+
+    for (uint64_t i = 0; i < orderByList.size(); i++)
+    {
+        // the rows still in memory make the last run
+        orderByList[i]->spillRun();
+        const vector<string>& files = orderByList[i]->getRunFiles();
+        runs.insert(runs.end(), files.begin(), files.end());
+    }
+
+    // a RowGroup for each run read at once, and one for the intermediate run written
+    uint64_t buffers = std::min<uint64_t>(runs.size(), maxFanIn) + (runs.size() > maxFanIn ? 1 : 0);
+    chargeMemory(buffers * fRowGroup.getSizeWithStrings(rowgroup::rgCommonSize));
+
+    while (runs.size() > maxFanIn)
+    {
+        vector<string> merged;
+
+        for (uint64_t begin = 0; begin < runs.size(); begin += maxFanIn)
+        {
+            uint64_t end = std::min<uint64_t>(begin + maxFanIn, runs.size());
+
+            if (end - begin == 1)
+            {
+                merged.push_back(runs[begin]);
+                continue;
+            }
+
+            ostringstream os;
+            os << orderByList[0]->getSpillPrefix() << "m" << fPasses << "-" << merged.size();
+            fTempFiles.push_back(os.str());
+            merged.push_back(os.str());
+
+            SortedRunMerger merger(fRule);
+            openRuns(merger, runs, begin, end);
+            SortedRunWriter writer(merged.back(), fRowGroup, fCompressor);
+
+            while (merger.next())
+                writer.write(merger.getRow());
+
+            writer.flush();
+        }
+
+        runs.swap(merged);
+        fPasses++;
+    }
+
+    fMerger.reset(new SortedRunMerger(fRule));
+    openRuns(*fMerger, runs, 0, runs.size());
+}
+
+
+MultiPassMerger::~MultiPassMerger()
+{
+    fMerger.reset();
+
+    // intermediate runs left behind by a failed pass
+    for (vector<string>::iterator i = fTempFiles.begin(); i != fTempFiles.end(); i++)
+        unlink(i->c_str());
+
+    if (fMemSize > 0)
+        fRm->returnMemory(fMemSize, fSessionMemLimit);
+}
+
+
+void MultiPassMerger::openRuns(SortedRunMerger& merger, const vector<string>& runs,
+                               uint64_t begin, uint64_t end)
+{
+    for (uint64_t i = begin; i < end; i++)
+        merger.addRun(boost::shared_ptr<SortedRun>(new SortedRun(runs[i], fRowGroup, fCompressor)));
+}
+
+
+// fMemSize counts what getMemory() failed to get too, the destructor returns it
+void MultiPassMerger::chargeMemory(uint64_t size)
+{
+    fMemSize += size;
+
+    if (!fRm->getMemory(size, fSessionMemLimit))
+    {
+        cerr << IDBErrorInfo::instance()->errorMsg(ERR_LIMIT_TOO_BIG) << " @"
+             << __FILE__ << ":" << __LINE__;
+        throw IDBExcept(ERR_LIMIT_TOO_BIG);
+    }
+}
+
+
+bool MultiPassMerger::next()
+{
+    while (fReturned < fLimitCount && fMerger->next())
+    {
+        // OFFSET processing
+        if (fLimitStart > 0)
+        {
+            fLimitStart--;
+            continue;
+        }
+
+        fReturned++;
+        return true;
+    }
+
+    return false;
+}
+
+
 const string LimitedOrderBy::toString() const
 {
     ostringstream oss;
@@ -24,7 +24,12 @@
 #define LIMITED_ORDER_BY_H
 
 #include <string>
+#include <vector>
+#include <fstream>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
 #include "rowgroup.h"
+#include "idbcompress.h"
 #include "../../utils/windowfunction/idborderby.h"
 
 
@@ -60,11 +65,197 @@ public:
 
     void finalize();
 
+    /** @brief Spill sorted runs to prefix + N instead of failing with
+     *  ERR_LIMIT_TOO_BIG when the memory limit is hit.
+     */
+    void enableDiskBased(const std::string& prefix, uint32_t compressionType);
+
+    /** @brief Write the rows held in memory to a new sorted run and
+     *  give their memory back.
+     */
+    void spillRun();
+
+    bool spilled() const
+    {
+        return !fRunFiles.empty();
+    }
+    const std::vector<std::string>& getRunFiles() const
+    {
+        return fRunFiles;
+    }
+    compress::CompressInterface* getCompressor() const
+    {
+        return fCompressor.get();
+    }
+    const std::string& getSpillPrefix() const
+    {
+        return fSpillPrefix;
+    }
+    joblist::ResourceManager* getResourceManager() const
+    {
+        return fRm;
+    }
+    boost::shared_ptr<int64_t> getSessionMemLimit() const
+    {
+        return fSessionMemLimit;
+    }
+
 protected:
+    void chargeMemory(uint64_t size);
+
     uint64_t              fStart;
     uint64_t              fCount;
     uint64_t              fUncommitedMemory;
     static const uint64_t fMaxUncommited;
+
+    // disk-based mode
+    bool                  fDiskBased;
+    bool                  fSpillPending;
+    uint64_t              fBaseMemSize;
+    std::string           fSpillPrefix;
+    std::vector<std::string> fRunFiles;
+    boost::shared_ptr<compress::CompressInterface> fCompressor;
+};
+
+
+// Writes a sorted run a RowGroup at a time.  Each RowGroup is stored as its
+// length and its serialized RGData or, with a compressor, as the compressed
+// length, the uncompressed length and the compressed RGData.
+class SortedRunWriter
+{
+public:
+    SortedRunWriter(const std::string& filename, const rowgroup::RowGroup& rg,
+                    compress::CompressInterface* compressor);
+
+    void write(const rowgroup::Row& row);
+
+    // writes out the rows still buffered
+    void flush();
+
+private:
+    SortedRunWriter(const SortedRunWriter&);
+    SortedRunWriter& operator=(const SortedRunWriter&);
+
+    std::string                  fFilename;
+    std::fstream                 fFile;
+    compress::CompressInterface* fCompressor;
+    rowgroup::RowGroup           fRowGroup;
+    rowgroup::RGData             fData;
+    rowgroup::Row                fRow;
+};
+
+
+// Reads a sorted run written by SortedRunWriter one RowGroup at a time.
+class SortedRun
+{
+public:
+    SortedRun(const std::string& filename, const rowgroup::RowGroup& rg,
+              compress::CompressInterface* compressor);
+    ~SortedRun();
+
+    // moves to the next row, false at the end of the run
+    bool next();
+
+    const rowgroup::Row& getRow() const
+    {
+        return fRow;
+    }
+
+private:
+    SortedRun(const SortedRun&);
+    SortedRun& operator=(const SortedRun&);
+
+    bool readRowGroup();
+
+    std::string                  fFilename;
+    std::fstream                 fFile;
+    compress::CompressInterface* fCompressor;
+    rowgroup::RowGroup           fRowGroup;
+    rowgroup::RGData             fData;
+    rowgroup::Row                fRow;
+    uint64_t                     fRowIdx;
+};
+
+
+// k-way merge of sorted runs.  The loser tree costs log2(k) compares per row.
+class SortedRunMerger
+{
+public:
+    SortedRunMerger(ordering::CompareRule& rule) : fRule(rule), fStarted(false) {}
+
+    void addRun(const boost::shared_ptr<SortedRun>& run)
+    {
+        fRuns.push_back(run);
+    }
+
+    // moves to the next row in sort order, false when all the runs are read
+    bool next();
+
+    const rowgroup::Row& getRow() const
+    {
+        return fRuns[fTree[0]]->getRow();
+    }
+
+private:
+    bool beats(uint64_t a, uint64_t b);
+    void adjust(uint64_t run);
+
+    ordering::CompareRule&                    fRule;
+    std::vector<boost::shared_ptr<SortedRun> > fRuns;
+    std::vector<bool>                         fDone;
+    std::vector<uint64_t>                     fTree;   // losers, the winner at 0
+    bool                                      fStarted;
+};
+
+
+// Merges all the sorted runs of the LimitedOrderBy instances and applies
+// OFFSET and LIMIT.  At most maxFanIn runs are read at once; while there are
+// more, groups of them are first merged into intermediate runs.  The RowGroup
+// buffers of the merge are charged to the ResourceManager of the first
+// instance, ERR_LIMIT_TOO_BIG when they don't fit.
+class MultiPassMerger
+{
+public:
+    static const uint64_t MAX_FAN_IN = 64;
+
+    MultiPassMerger(const std::vector<LimitedOrderBy*>& orderByList, const rowgroup::RowGroup& rg,
+                    uint64_t limitStart, uint64_t limitCount, uint64_t maxFanIn = MAX_FAN_IN);
+    ~MultiPassMerger();
+
+    // moves to the next row to return, false after the last one
+    bool next();
+
+    const rowgroup::Row& getRow() const
+    {
+        return fMerger->getRow();
+    }
+
+    // the number of intermediate merge passes
+    uint64_t passes() const
+    {
+        return fPasses;
+    }
+
+private:
+    MultiPassMerger(const MultiPassMerger&);
+    MultiPassMerger& operator=(const MultiPassMerger&);
+
+    void openRuns(SortedRunMerger& merger, const std::vector<std::string>& runs,
+                  uint64_t begin, uint64_t end);
+    void chargeMemory(uint64_t size);
+
+    ordering::CompareRule&                    fRule;
+    rowgroup::RowGroup                        fRowGroup;
+    compress::CompressInterface*              fCompressor;
+    joblist::ResourceManager*                 fRm;
+    boost::shared_ptr<int64_t>                fSessionMemLimit;
+    uint64_t                                  fMemSize;
+    uint64_t                                  fLimitStart;
+    uint64_t                                  fLimitCount;
+    uint64_t                                  fReturned;
+    uint64_t                                  fPasses;
+    std::vector<std::string>                  fTempFiles;
+    boost::scoped_ptr<SortedRunMerger>        fMerger;
 };
 
 
@@ -64,6 +64,7 @@
 #include "resourcemanager.h"
 #include "joiner.h"
 #include "tuplejoiner.h"
+#include "bloomfilter.h"
 #include "rowgroup.h"
 #include "rowaggregation.h"
 #include "funcexpwrapper.h"
@@ -1330,6 +1331,12 @@ public:
     void addCPPredicates(uint32_t OID, const std::vector<int128_t>& vals, bool isRange,
                          bool isSmallSideWideDecimal);
 
+    /* Interface for adding a Bloom filter on the key column of a join.  The PM drops
+     * the rows whose value of column col (an index into the projected RowGroup) isn't
+     * in the filter.  Like addCPPredicates(), every filter has to pass.
+     */
+    void addBloomFilter(uint32_t col, const boost::shared_ptr<joiner::BloomFilter>& filter);
+
     /* semijoin adds */
     void setJoinFERG(const rowgroup::RowGroup& rg);
 
@@ -38,6 +38,7 @@ using namespace boost;
 #include "cgroupconfigurator.h"
 #include "liboamcpp.h"
 #include "secrets.h"
+#include "idbcompress.h"
 
 using namespace config;
 
@@ -57,6 +58,7 @@ const string ResourceManager::fExtentMapStr("ExtentMap");
 //const string ResourceManager::fBatchInsertStr("BatchInsert");
 const string ResourceManager::fOrderByLimitStr("OrderByLimit");
 const string ResourceManager::fRowAggregationStr("RowAggregation");
+const string ResourceManager::fWindowFunctionStr("WindowFunction");
 
 ResourceManager* ResourceManager::fInstance = NULL;
 boost::mutex mx;
@@ -249,7 +251,7 @@ ResourceManager::ResourceManager(bool runningInExeMgr) :
         fAggNumRowGroups = fConfig->uFromText(nr);
 
     // window function
-    string wt = fConfig->getConfig("WindowFunction", "WorkThreads");
+    string wt = fConfig->getConfig(fWindowFunctionStr, "WorkThreads");
 
     if (wt.empty())
         fWindowFunctionThreads = numCores();
@@ -267,6 +269,12 @@ ResourceManager::ResourceManager(bool runningInExeMgr) :
     fAllowedDiskAggregation = getBoolVal(fRowAggregationStr,
                                          "AllowDiskBasedAggregation",
                                          defaultAllowDiskAggregation);
+    fAllowedDiskWindowFunction = getBoolVal(fWindowFunctionStr,
+                                            "AllowDiskBasedWindowFunction",
+                                            defaultAllowDiskWindowFunction);
+    fAllowedDiskOrderBy = getBoolVal(fOrderByLimitStr,
+                                     "AllowDiskBasedOrderBy",
+                                     defaultAllowDiskOrderBy);
     if (!load_encryption_keys())
     {
         Logger log;
@@ -292,6 +300,20 @@ int ResourceManager::getEmPriority() const
     return val;
 }
 
+uint32_t ResourceManager::getTempFileCompressionType(const string& codec)
+{
+    if (codec == "N" || codec == "n")
+        return 0;
+
+    // anything else is Snappy, the default of the disk aggregation
+    uint32_t type = (codec == "LZ4" ? 3 : 2);
+
+    if (!compress::CompressInterface::isCompressionAvail(type))
+        return 0;
+
+    return type;
+}
+
 void ResourceManager::addHJPmMaxSmallSideMap(uint32_t sessionID, uint64_t mem)
 {
     if (fHJPmMaxMemorySmallSideSessionMap.addSession(sessionID, mem,
@@ -120,6 +120,9 @@ const uint64_t defaultRowsPerBatch  = 10000;
 /* HJ CP feedback, see bug #1465 */
 const uint32_t defaultHjCPUniqueLimit = 100;
 
+/* HJ Bloom filter feedback, the largest small side that gets a filter */
+const uint64_t defaultHjBloomFilterMaxKeys = 4 * 1024 * 1024;
+
 // Order By and Limit
 const uint64_t defaultOrderByLimitMaxMemory = 1 * 1024 * 1024 * 1024ULL;
 
@@ -128,6 +131,13 @@ const uint64_t defaultDECThrottleThreshold = 200000000;  // ~200 MB
 const uint8_t defaultUseCpimport = 1;
 
 const bool defaultAllowDiskAggregation = false;
+const std::string defaultAggregationTempFileCompression = "Snappy";
+
+const bool defaultAllowDiskWindowFunction = false;
+const std::string defaultWindowFunctionTempFileCompression = "LZ4";
+
+const bool defaultAllowDiskOrderBy = false;
+const std::string defaultOrderByTempFileCompression = "LZ4";
 
 /** @brief ResourceManager
  *	Returns requested values from Config
@@ -185,6 +195,37 @@ public:
         return fAllowedDiskAggregation;
     }
 
+    // the codec of the temp files of the disk-based modes, "Snappy", "LZ4" or "N"
+    // for none, see getTempFileCompressionType()
+    std::string getAggregationTempFileCompression() const
+    {
+        return getStringVal(fRowAggregationStr, "TempFileCompression", defaultAggregationTempFileCompression);
+    }
+
+    bool        getAllowDiskWindowFunction() const
+    {
+        return fAllowedDiskWindowFunction;
+    }
+    std::string getWindowFunctionTempFileCompression() const
+    {
+        return getStringVal(fWindowFunctionStr, "TempFileCompression", defaultWindowFunctionTempFileCompression);
+    }
+
+    bool        getAllowDiskOrderBy() const
+    {
+        return fAllowedDiskOrderBy;
+    }
+    std::string getOrderByTempFileCompression() const
+    {
+        return getStringVal(fOrderByLimitStr, "TempFileCompression", defaultOrderByTempFileCompression);
+    }
+
+    /** @brief the compression type of a TempFileCompression setting
+     *
+     * @return 2 for Snappy, 3 for "LZ4" and 0 for "N" or a codec this build doesn't have
+     */
+    EXPORT static uint32_t getTempFileCompressionType(const std::string& codec);
+
     uint64_t    getDECConnectionsPerQuery() const
     {
         return fDECConnectionsPerQuery;
@@ -210,6 +251,10 @@ public:
     {
         return getUintVal(fHashJoinStr, "CPUniqueLimit", defaultHjCPUniqueLimit);
     }
+    uint64_t	getHjBloomFilterMaxKeys() const
+    {
+        return getIntVal(fHashJoinStr, "BloomFilterMaxKeys", defaultHjBloomFilterMaxKeys);
+    }
     uint64_t	getPMJoinMemLimit() const
     {
         return pmJoinMemLimit;
@@ -589,6 +634,7 @@ private:
     /*static	const*/ std::string fBatchInsertStr;
     static	const std::string fOrderByLimitStr;
     static      const std::string fRowAggregationStr;
+    static      const std::string fWindowFunctionStr;
     config::Config* fConfig;
     static ResourceManager* fInstance;
     uint32_t fTraceFlags;
@@ -621,6 +667,8 @@ private:
     bool isExeMgr;
     bool fUseHdfs;
     bool fAllowedDiskAggregation{false};
+    bool fAllowedDiskWindowFunction{false};
+    bool fAllowedDiskOrderBy{false};
     uint64_t fDECConnectionsPerQuery;
 };
 
@@ -0,0 +1,533 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+/** @file */
+
+#ifndef RINGBUFFERDL_H__
+#define RINGBUFFERDL_H__
+
+#include <stdint.h>
+#include <climits>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <stdexcept>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "exceptclasses.h"
+#include "datalistimpl.h"
+
+namespace joblist
+{
+
+/** @brief What the threads of a RingBufferDL wait on
+ *
+ * wait() spins on the condition for a while, then sleeps on a futex until a
+ * notify().  notify() is a fence and a load unless some thread is asleep.
+ */
+class RingBufferEvent
+{
+public:
+    RingBufferEvent() : fSeq(0), fSleepers(0) { }
+
+    template<typename Condition>
+    void wait(Condition ready)
+    {
+        for (uint32_t i = 0; i < SPIN_COUNT; i++)
+        {
+            if (ready())
+                return;
+
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+
+        while (true)
+        {
+            uint32_t seq = fSeq.load(std::memory_order_acquire);
+            fSleepers.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (ready())
+            {
+                fSleepers.fetch_sub(1);
+                return;
+            }
+
+            sleep(seq);
+            fSleepers.fetch_sub(1);
+        }
+    }
+
+    void notify()
+    {
+        // pairs with the fence in wait(), a sleeper either sees the change or gets woken
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (fSleepers.load(std::memory_order_relaxed) > 0)
+        {
+            fSeq.fetch_add(1);
+#ifdef __linux__
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&fSeq), FUTEX_WAKE_PRIVATE, INT_MAX,
+                    NULL, NULL, 0);
+#endif
+        }
+    }
+
+private:
+    static const uint32_t SPIN_COUNT = 2000;
+
+    void sleep(uint32_t seq)
+    {
+#ifdef __linux__
+        // returns right away if a notify() came after seq was read
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&fSeq), FUTEX_WAIT_PRIVATE, seq,
+                NULL, NULL, 0);
+#else
+        usleep(100);
+#endif
+    }
+
+    std::atomic<uint32_t> fSeq;
+    std::atomic<uint32_t> fSleepers;
+};
+
+/** @brief class RingBufferDL
+ *
+ * A bounded datalist with the interface and the semantics of FIFO: one
+ * producer, or several that serialize their inserts, and any number of
+ * consumers that each see every element.  Instead of two buffers swapped
+ * under the datalist mutex, the elements go through a ring; the producer
+ * and every consumer own a position in it, published with atomics, so
+ * insert() and next() take no lock.  A thread that finds the ring full or
+ * empty spins a little, then sleeps on a futex.
+ *
+ * blockedWriteCount() and blockedReadCount() count the inserts and reads
+ * that had to wait.
+ */
+template<typename element_t>
+class RingBufferDL : public DataListImpl<std::vector<element_t>, element_t>
+{
+private:
+    typedef DataListImpl<std::vector<element_t>, element_t> base;
+
+public:
+    enum ElementMode
+    {
+        RID_ONLY,
+        RID_VALUE
+    };
+
+    RingBufferDL(uint32_t numConsumers, uint32_t maxElements);
+    virtual ~RingBufferDL();
+
+    /* DataList<element_t> interface */
+    inline void insert(const element_t& e);
+    inline void insert(const std::vector<element_t>& v);
+    inline bool next(uint64_t it, element_t* e);
+    uint64_t getIterator();
+    void endOfInput();
+    void setMultipleProducers(bool b);
+
+    /* Use this insert() to detect when insertion fills up the ring.    */
+    /* When this happens, call waitTillReadyForInserts() before resuming*/
+    /* with more inserts.                                               */
+    inline void insert(const element_t& e,
+                       bool& bufferFullBlocked, bool& consumptionStarted);
+    inline void waitTillReadyForInserts();
+    inline bool isOutputBlocked() const;
+
+    void OID(execplan::CalpontSystemCatalog::OID oid)
+    {
+        base::OID(oid);
+    }
+    execplan::CalpontSystemCatalog::OID OID() const
+    {
+        return base::OID();
+    }
+
+    inline void dropToken() { };
+    inline void dropToken(uint32_t) { };
+
+    // Counters of the inserts and reads that found the ring full or empty
+    uint64_t blockedWriteCount() const
+    {
+        return fBlockedWrites.load(std::memory_order_relaxed);
+    }
+    uint64_t blockedReadCount() const
+    {
+        return fBlockedReads.load(std::memory_order_relaxed);
+    }
+
+    void setNumConsumers(uint32_t nc);
+
+    void inOrder(bool order)
+    {
+        fInOrder = order;
+    }
+    bool inOrder() const
+    {
+        return fInOrder;
+    }
+
+    void totalSize(const uint64_t totSize)
+    {
+        fTotSize = totSize;
+    }
+    uint64_t totalSize()
+    {
+        return fTotSize;
+    }
+
+    void maxElements(uint64_t max);
+    uint64_t maxElements()
+    {
+        return fMaxElements;
+    }
+
+    void setElementMode(uint32_t mode)
+    {
+        fElementMode = mode;
+    }
+    uint32_t getElementMode() const
+    {
+        return fElementMode;
+    }
+
+    void setTotalFileCounts(uint64_t numFiles, uint64_t numBytes)
+    {
+        fNumFiles = numFiles;
+        fNumBytes = numBytes;
+    }
+    void totalFileCounts(uint64_t& numFiles, uint64_t& numBytes) const
+    {
+        numFiles = fNumFiles;
+        numBytes = fNumBytes;
+    }
+
+    // returns true if there might be more data to read,
+    // false if there is no more data.  Similar to next(), but
+    // does not return data.
+    bool more(uint64_t id);
+
+private:
+    // a consumer's position, padded to keep the others off its cache line
+    struct Consumer
+    {
+        std::atomic<uint64_t> pos;
+        bool finished;
+        char pad[64 - sizeof(uint64_t) - sizeof(bool)];
+    };
+
+    RingBufferDL& operator=(const RingBufferDL&);
+    RingBufferDL(const RingBufferDL&);
+    RingBufferDL();
+
+    void allocate();
+    void resetConsumers(uint32_t nc);
+    uint64_t slowestConsumer() const;
+    bool hasRoom(uint64_t head)
+    {
+        if (head - fTail < fCapacity)
+            return true;
+
+        fTail = slowestConsumer();
+        return head - fTail < fCapacity;
+    }
+    void consumerFinished(uint64_t id);
+
+    element_t* fBuffer;
+    uint64_t fCapacity;     // a power of 2 >= fMaxElements
+    uint64_t fMask;
+    Consumer* fConsumers;
+
+    char fPad[64];          // keeps what the consumers read off the line of fHead
+    std::atomic<uint64_t> fHead;    // number of elements inserted
+    uint64_t fTail;         // the producer's last look at the slowest consumer
+    std::atomic<bool> fEndOfInput;
+    std::atomic<bool> fConsumptionStarted;
+    std::atomic<uint32_t> fFinishedCount;
+    RingBufferEvent fProducerEvent;     // consumers made room
+    RingBufferEvent fConsumerEvent;     // the producer added elements
+
+    uint64_t fMaxElements;
+    uint64_t fTotSize;
+    bool     fInOrder;
+    uint32_t fElementMode;
+    uint64_t fNumFiles;
+    uint64_t fNumBytes;
+
+    std::atomic<uint64_t> fBlockedWrites;
+    std::atomic<uint64_t> fBlockedReads;
+};
+
+template<typename element_t>
+RingBufferDL<element_t>::RingBufferDL(uint32_t con, uint32_t max) :
+    base(con), fBuffer(0), fConsumers(0), fHead(0), fTail(0), fEndOfInput(false),
+    fConsumptionStarted(false), fFinishedCount(0), fMaxElements(max), fTotSize(0),
+    fInOrder(false), fElementMode(RID_ONLY), fNumFiles(0), fNumBytes(0), fBlockedWrites(0),
+    fBlockedReads(0)
+{
+    maxElements(max);
+    resetConsumers(con);
+}
+
+template<typename element_t>
+RingBufferDL<element_t>::RingBufferDL()
+{
+    throw std::logic_error("don't use RingBufferDL()");
+}
+
+template<typename element_t>
+RingBufferDL<element_t>::RingBufferDL(const RingBufferDL<element_t>& f)
+{
+    throw std::logic_error("don't use RingBufferDL(RingBufferDL &)");
+}
+
+template<typename element_t>
+RingBufferDL<element_t>& RingBufferDL<element_t>::operator=(const RingBufferDL<element_t>& f)
+{
+    throw std::logic_error("don't use RingBufferDL:: =");
+}
+
+template<typename element_t>
+RingBufferDL<element_t>::~RingBufferDL()
+{
+    delete [] fBuffer;
+    delete [] fConsumers;
+}
+
+template<typename element_t>
+void RingBufferDL<element_t>::allocate()
+{
+    fBuffer = new element_t[fCapacity];
+}
+
+template<typename element_t>
+void RingBufferDL<element_t>::resetConsumers(uint32_t nc)
+{
+    delete [] fConsumers;
+    fConsumers = new Consumer[nc];
+
+    for (uint32_t i = 0; i < nc; i++)
+    {
+        fConsumers[i].pos.store(0, std::memory_order_relaxed);
+        fConsumers[i].finished = false;
+    }
+}
+
+template<typename element_t>
+uint64_t RingBufferDL<element_t>::slowestConsumer() const
+{
+    uint64_t ret = fHead.load(std::memory_order_relaxed);
+
+    // acquire: a consumer is done copying an element before its position passes it
+    for (uint64_t i = 0; i < base::numConsumers; i++)
+        ret = std::min(ret, fConsumers[i].pos.load(std::memory_order_acquire));
+
+    return ret;
+}
+
+template<typename element_t>
+inline void RingBufferDL<element_t>::insert(const element_t& e)
+{
+    uint64_t head = fHead.load(std::memory_order_relaxed);
+
+    if (!fBuffer)
+        allocate();
+
+    if (!hasRoom(head))
+    {
+        fBlockedWrites.fetch_add(1, std::memory_order_relaxed);
+        fProducerEvent.wait([&]()
+        {
+            return hasRoom(head);
+        });
+    }
+
+    fBuffer[head & fMask] = e;
+    fHead.store(head + 1, std::memory_order_release);
+    fTotSize++;
+    fConsumerEvent.notify();
+}
+
+// version of insert that will report, rather than wait, when the ring is full
+template<typename element_t>
+inline void RingBufferDL<element_t>::insert(const element_t& e,
+        bool& bufferFullBlocked, bool& consumptionStarted)
+{
+    insert(e);
+    consumptionStarted = fConsumptionStarted.load(std::memory_order_relaxed);
+    bufferFullBlocked = isOutputBlocked();
+}
+
+template<typename element_t>
+inline void RingBufferDL<element_t>::waitTillReadyForInserts()
+{
+    uint64_t head = fHead.load(std::memory_order_relaxed);
+
+    if (!hasRoom(head))
+    {
+        fBlockedWrites.fetch_add(1, std::memory_order_relaxed);
+        fProducerEvent.wait([&]()
+        {
+            return hasRoom(head);
+        });
+    }
+}
+
+template<typename element_t>
+inline bool RingBufferDL<element_t>::isOutputBlocked() const
+{
+    return fHead.load(std::memory_order_relaxed) - slowestConsumer() >= fCapacity;
+}
+
+template<typename element_t>
+inline void RingBufferDL<element_t>::insert(const std::vector<element_t>& e)
+{
+    typename std::vector<element_t>::const_iterator it = e.begin();
+    typename std::vector<element_t>::const_iterator end = e.end();
+
+    while (it != end)
+    {
+        insert(*it);
+        ++it;
+    }
+}
+
+template<typename element_t>
+void RingBufferDL<element_t>::consumerFinished(uint64_t id)
+{
+    if (fConsumers[id].finished)
+        return;
+
+    fConsumers[id].finished = true;
+
+    // the last consumer out frees the ring, like FIFO does
+    if (fFinishedCount.fetch_add(1) + 1 == base::numConsumers)
+    {
+        delete [] fBuffer;
+        fBuffer = 0;
+    }
+}
+
+template<typename element_t>
+inline bool RingBufferDL<element_t>::next(uint64_t id, element_t* out)
+{
+    Consumer& c = fConsumers[id];
+    uint64_t pos = c.pos.load(std::memory_order_relaxed);
+
+    fConsumptionStarted.store(true, std::memory_order_relaxed);
+
+    if (pos == fHead.load(std::memory_order_acquire))
+    {
+        // endOfInput() is published after the last element
+        if (fEndOfInput.load(std::memory_order_acquire) &&
+                pos == fHead.load(std::memory_order_acquire))
+        {
+            consumerFinished(id);
+            return false;
+        }
+
+        fBlockedReads.fetch_add(1, std::memory_order_relaxed);
+        fConsumerEvent.wait([&]()
+        {
+            return pos != fHead.load(std::memory_order_acquire) ||
+                   fEndOfInput.load(std::memory_order_acquire);
+        });
+
+        if (pos == fHead.load(std::memory_order_acquire))
+        {
+            consumerFinished(id);
+            return false;
+        }
+    }
+
+    // a lone consumer can take the element, which frees its memory right away
+    if (base::numConsumers == 1)
+        *out = std::move(fBuffer[pos & fMask]);
+    else
+        *out = fBuffer[pos & fMask];
+
+    c.pos.store(pos + 1, std::memory_order_release);
+    fProducerEvent.notify();
+    return true;
+}
+
+template<typename element_t>
+bool RingBufferDL<element_t>::more(uint64_t id)
+{
+    return !(fEndOfInput.load(std::memory_order_acquire) &&
+             fConsumers[id].pos.load(std::memory_order_relaxed) == fHead.load(std::memory_order_acquire));
+}
+
+template<typename element_t>
+void RingBufferDL<element_t>::endOfInput()
+{
+    boost::mutex::scoped_lock scoped(base::mutex);
+
+    base::endOfInput();
+    fEndOfInput.store(true, std::memory_order_release);
+    fConsumerEvent.notify();
+}
+
+template<typename element_t>
+uint64_t RingBufferDL<element_t>::getIterator()
+{
+    boost::mutex::scoped_lock scoped(base::mutex);
+    return base::getIterator();
+}
+
+template<typename element_t>
+void RingBufferDL<element_t>::setMultipleProducers(bool b)
+{
+    if (b)
+        throw std::logic_error("RingBufferDL: setMultipleProducers() doesn't work yet");
+}
+
+template<typename element_t>
+void RingBufferDL<element_t>::setNumConsumers(uint32_t nc)
+{
+    base::setNumConsumers(nc);
+    resetConsumers(nc);
+}
+
+template<typename element_t>
+void RingBufferDL<element_t>::maxElements(uint64_t max)
+{
+    if (fHead.load(std::memory_order_relaxed) != 0)
+        throw std::logic_error("RingBufferDL::maxElements(): the ring is in use");
+
+    fMaxElements = max;
+
+    for (fCapacity = 1; fCapacity < std::max<uint64_t>(max, 1); fCapacity <<= 1)
+        ;
+
+    fMask = fCapacity - 1;
+    delete [] fBuffer;
+    fBuffer = 0;
+}
+
+}   // namespace
+
+#endif
+// vim:ts=4 sw=4:
@@ -29,6 +29,8 @@
 #include "brmtypes.h"
 #include "dataconvert.h"
 #include "configcpp.h"
+#include "nullvaluemanip.h"
+#include "statistics.h"
 
 #define ROW_EST_DEBUG 0
 #if ROW_EST_DEBUG
@@ -532,6 +534,155 @@ float RowEstimator::estimateRowReturnFactor(const BRM::EMEntry& emEntry,
     return factor;
 }
 
+// Estimate the percentage of rows of the whole column that will be returned for a filter such as
+// "col1 < 100 or col1 > 10000" from the histogram, distinct count, null fraction and most common
+// values ANALYZE TABLE collected.  Returns a negative number if the statistics can't tell.
+float RowEstimator::estimateRowReturnFactor(const statistics::ColumnStatistics& stats,
+        const messageqcpp::ByteStream* bs,
+        const uint16_t NOPS,
+        const execplan::CalpontSystemCatalog::ColType& ct,
+        const uint8_t BOP)
+{
+    if (stats.rowCount == 0 || ct.isWideDecimalType())
+        return -1.0;
+
+    bool bIsUnsigned = datatypes::isUnsigned(ct.colDataType);
+    const int64_t nullValue = (bIsUnsigned ? (int64_t) utils::getNullValue(ct.colDataType, ct.colWidth)
+                               : utils::getSignedNullValue(ct.colDataType, ct.colWidth));
+    const double nonNullFraction = 1.0 - stats.nullFraction();
+    float factor = 1.0;
+    double tempFactor;
+    int length = bs->length(), pos = 0;
+    const char* msgDataPtr = (const char*) bs->buf();
+    int64_t value = 0;
+    bool firstQualifyingOrCondition = true;
+    uint16_t comparisonLimit = (NOPS <= fMaxComparisons) ? NOPS : fMaxComparisons;
+
+    for (int i = 0; i < comparisonLimit; i++)
+    {
+        pos += ct.colWidth + 2;  // predicate + op + lcf
+
+        if (pos > length)
+            return factor;
+
+        char op = *msgDataPtr++;
+        msgDataPtr++;   // lcf
+
+        switch (ct.colWidth)
+        {
+            case 1:
+                value = (bIsUnsigned ? (int64_t) *(uint8_t*)msgDataPtr : *(int8_t*)msgDataPtr);
+                break;
+
+            case 2:
+                value = (bIsUnsigned ? (int64_t) *(uint16_t*)msgDataPtr : *(int16_t*)msgDataPtr);
+                break;
+
+            case 4:
+                value = (bIsUnsigned ? (int64_t) *(uint32_t*)msgDataPtr : *(int32_t*)msgDataPtr);
+                break;
+
+            default:
+                value = *(int64_t*)msgDataPtr;
+                break;
+        }
+
+        msgDataPtr += ct.colWidth;
+        // The histogram gives the ranges, the other columns only have the distinct count.
+        bool isNull = stats.hasHistogram() && value == nullValue;
+
+        switch (op)
+        {
+            case COMPARE_EQ:
+                if (isNull)
+                    tempFactor = stats.nullFraction();
+                else
+                    tempFactor = (stats.hasHistogram() ? stats.equalFraction(value) : stats.averageEqualFraction());
+
+                break;
+
+            case COMPARE_NE:
+                if (isNull)
+                    tempFactor = nonNullFraction;
+                else
+                    tempFactor = nonNullFraction -
+                                 (stats.hasHistogram() ? stats.equalFraction(value) : stats.averageEqualFraction());
+
+                break;
+
+            case COMPARE_LT:
+            case COMPARE_NGE:
+                if (!stats.hasHistogram())
+                    return -1.0;
+
+                tempFactor = stats.lessFraction(value, false);
+                break;
+
+            case COMPARE_LE:
+            case COMPARE_NGT:
+                if (!stats.hasHistogram())
+                    return -1.0;
+
+                tempFactor = stats.lessFraction(value, true);
+                break;
+
+            case COMPARE_GT:
+            case COMPARE_NLE:
+                if (!stats.hasHistogram())
+                    return -1.0;
+
+                tempFactor = nonNullFraction - stats.lessFraction(value, true);
+                break;
+
+            case COMPARE_GE:
+            case COMPARE_NLT:
+                if (!stats.hasHistogram())
+                    return -1.0;
+
+                tempFactor = nonNullFraction - stats.lessFraction(value, false);
+                break;
+
+            default:
+                return -1.0;
+        }
+
+        if (tempFactor < 0.0)
+            tempFactor = 0.0;
+
+#if ROW_EST_DEBUG
+        cout << "  Val-" << value << ", StatsOperatorFactor-" << tempFactor << endl;
+#endif
+
+        if (BOP == BOP_AND)
+        {
+            factor *= tempFactor;
+        }
+        else if (BOP == BOP_OR)
+        {
+            if (firstQualifyingOrCondition)
+            {
+                factor = tempFactor;
+                firstQualifyingOrCondition = false;
+            }
+            else
+            {
+                factor += tempFactor;
+            }
+        }
+        else
+        {
+            factor = tempFactor;
+        }
+    }
+
+    if (factor > 1.0)
+    {
+        factor = 1.0;
+    }
+
+    return factor;
+}
+
 // This function returns the estimated row count for the entire TupleBPS.  It samples the last 20 (configurable) extents to
 // calculate the estimate.
 uint64_t RowEstimator::estimateRows(const vector<ColumnCommandJL*>& cpColVec,
@@ -571,6 +722,35 @@ uint64_t RowEstimator::estimateRows(const vector<ColumnCommandJL*>& cpColVec,
     hwm = extents.back().HWM;   // extents is sorted by "global" fbo
     rowsInLastExtent = ((hwm + 1) * fBlockSize / colCmd->getColType().colWidth) % fRowsPerExtent;
 
+    // The columns ANALYZE TABLE collected statistics for get a factor for the whole column
+    // instead of one per extent.
+    vector<bool> useStats(cpColVec.size(), false);
+    float statsFactor = 1.0;
+    bool haveStats = false;
+    statistics::StatisticsManager* statisticsManager = statistics::StatisticsManager::instance();
+
+    for (uint32_t j = 0; j < cpColVec.size(); j++)
+    {
+        std::shared_ptr<const statistics::ColumnStatistics> columnStats =
+            statisticsManager->getColumnStatistics(cpColVec[j]->getOID());
+
+        if (!columnStats)
+            continue;
+
+        tempFactor = estimateRowReturnFactor(*columnStats,
+                                             &(cpColVec[j]->getFilterString()),
+                                             cpColVec[j]->getFilterCount(),
+                                             cpColVec[j]->getColType(),
+                                             cpColVec[j]->getBOP());
+
+        if (tempFactor >= 0.0)
+        {
+            useStats[j] = true;
+            haveStats = true;
+            statsFactor *= tempFactor;
+        }
+    }
+
     // Sum up the total number of scanned rows.
     int32_t idx = scanFlags.size() - 1;
 
@@ -589,6 +769,9 @@ uint64_t RowEstimator::estimateRows(const vector<ColumnCommandJL*>& cpColVec,
 
             for (uint32_t j = 0; j < cpColVec.size(); j++)
             {
+                if (useStats[j])
+                    continue;
+
                 colCmd = cpColVec[j];
                 //RowEstimator rowEstimator;
 #if ROW_EST_DEBUG
@@ -657,6 +840,22 @@ uint64_t RowEstimator::estimateRows(const vector<ColumnCommandJL*>& cpColVec,
         estimatedRowCount = uint64_t(ceil(factor * totalRowsToBeScanned));
     }
 
+    // All the rows matching the column statistics are in the extents casual partitioning
+    // kept, so the factor for the whole column is scaled up to the rows scanned.
+    if (haveStats && totalRowsToBeScanned > 0)
+    {
+        uint64_t totalRows = (uint64_t) fRowsPerExtent * (scanFlags.size() - 1) + rowsInLastExtent;
+        double scannedFactor = (double) statsFactor * totalRows / totalRowsToBeScanned;
+
+        if (scannedFactor > 1.0)
+            scannedFactor = 1.0;
+
+        estimatedRowCount = uint64_t(ceil(scannedFactor * estimatedRowCount));
+
+        if (estimatedRowCount == 0)
+            estimatedRowCount = 1;
+    }
+
 #if ROW_EST_DEBUG
     cout << "Oid-" << oid << ", TotalEstimatedRows-" << estimatedRowCount << endl;
     stopwatch.stop("estimateRows");
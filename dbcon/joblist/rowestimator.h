@@ -34,6 +34,7 @@
 #include <iostream>
 #include <vector>
 #include "brm.h"
+#include "statistics.h"
 
 namespace joblist
 {
@@ -130,6 +131,22 @@ private:
                                   const uint8_t BOP,
                                   const uint32_t& rowsInExtent);
 
+    /** @brief returns a factor between 0 and 1 for the estimate of rows of the whole column that
+    *          will qualify the given operation(s), or a negative number if the statistics
+    *          ANALYZE TABLE collected for the column can't tell.
+    *
+    * @param stats        The column statistics.
+    * @param msgDataPtr   The filter string.
+    * @param ct	      The column type.
+    * @param BOP	      The binary operator for the filter predicates.
+    *
+    */
+    float estimateRowReturnFactor(const statistics::ColumnStatistics& stats,
+                                  const messageqcpp::ByteStream* msgDataPtr,
+                                  const uint16_t NOPS,
+                                  const execplan::CalpontSystemCatalog::ColType& ct,
+                                  const uint8_t BOP);
+
     // Configurables read from Columnstore.xml - future.
     uint32_t fExtentsToSample;
     uint32_t fIntDistinctAdjust;
@@ -27,6 +27,7 @@
 #include <queue>
 #include <stdexcept>
 #include <boost/thread.hpp>
+#include <boost/thread/thread_time.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/shared_array.hpp>
 
@@ -65,7 +66,7 @@ public:
      * @warning this class takes ownership of the passed-in pointers.
      */
     ThreadSafeQueue(boost::mutex* pimplLock = 0, boost::condition* pimplCond = 0) :
-        fShutdown(false), bytes(0), zeroCount(0)
+        fShutdown(false), bytes(0), zeroCount(0), fWakeups(0)
     {
         fPimplLock.reset(pimplLock);
         fPimplCond.reset(pimplCond);
@@ -272,6 +273,51 @@ public:
         pop_some(1, t);
     }
 
+    /** @brief the number of wakeReaders() calls so far
+     *
+     * A reader takes this before it decides to wait for data and passes it to
+     * waitForData(), so a wakeReaders() call in between isn't missed.
+     */
+    uint64_t wakeups() const
+    {
+        if (fPimplLock == 0)
+            throw std::runtime_error("TSQ: wakeups(): no sync!");
+
+        boost::mutex::scoped_lock lk(*fPimplLock);
+        return fWakeups;
+    }
+
+    /** @brief wait for something to be pushed
+     *
+     * Returns when the queue isn't empty, it's shut down, wakeReaders() was called
+     * since wakeups() returned seen, or the timeout passed.
+     */
+    void waitForData(uint64_t seen, const boost::posix_time::time_duration& timeout)
+    {
+        if (fPimplLock == 0 || fPimplCond == 0)
+            throw std::runtime_error("TSQ: waitForData(): no sync!");
+
+        boost::system_time deadline = boost::get_system_time() + timeout;
+        boost::mutex::scoped_lock lk(*fPimplLock);
+
+        while (fImpl.empty() && !fShutdown && fWakeups == seen)
+        {
+            if (!fPimplCond->timed_wait(lk, deadline))
+                break;
+        }
+    }
+
+    /** @brief cause all readers blocked in waitForData() to return */
+    void wakeReaders()
+    {
+        if (fPimplLock == 0 || fPimplCond == 0)
+            throw std::runtime_error("TSQ: wakeReaders(): no sync!");
+
+        boost::mutex::scoped_lock lk(*fPimplLock);
+        fWakeups++;
+        fPimplCond->notify_all();
+    }
+
     /** @brief is the queue empty
      *
      */
@@ -347,6 +393,7 @@ private:
     size_t bytes;
 #endif
     uint32_t zeroCount;   // counts the # of times read_some returned 0
+    uint64_t fWakeups;    // counts the wakeReaders() calls
 };
 
 }
@@ -86,6 +86,8 @@ namespace
 const uint32_t LOGICAL_EXTENT_CONVERTER = 10;  		// 10 + 13.  13 to convert to logical blocks,
 // 10 to convert to groups of 1024 logical blocks
 const uint32_t DEFAULT_EXTENTS_PER_SEG_FILE = 2;
+// how long a receive thread waits for a msg before it checks for a cancel
+const uint32_t RECV_WAIT_TIMEOUT_MS = 100;
 
 }
 
@@ -1880,6 +1882,10 @@ abort:
     boost::unique_lock<boost::mutex> tplLock(tplMutex);
     finishedSending = true;
     condvar.notify_all();
+
+    if (fDec && msgsSent == msgsRecvd)
+        fDec->wakeReaders(uniqueID);
+
     tplLock.unlock();
 }
 
@@ -2128,6 +2134,10 @@ void TupleBPS::receiveMultiPrimitiveMessages(uint32_t threadID)
                     ++msgsRecvd;
             }
 
+            // the other receive threads may be waiting for msgs that won't come
+            if (size > 0 && finishedSending && msgsSent == msgsRecvd)
+                fDec->wakeReaders(uniqueID);
+
             //@Bug 1424,1298
 
             if (sendWaiting && ((msgsSent - msgsRecvd) <=
@@ -2149,8 +2159,12 @@ void TupleBPS::receiveMultiPrimitiveMessages(uint32_t threadID)
 
             if (size == 0)
             {
+                /* Wait for the next msg.  The wakeup count is taken under tplLock,
+                so the thread that receives the last msg or the abort can't wake
+                the readers before this one starts waiting. */
+                uint64_t wakeups = fDec->readerWakeups(uniqueID);
                 tplLock.unlock();
-                usleep(2000 * fNumThreads);
+                fDec->waitForData(uniqueID, wakeups, RECV_WAIT_TIMEOUT_MS);
                 tplLock.lock();
                 continue;
             }
@@ -2575,7 +2589,7 @@ out:
     {
         struct timeval tvbuf;
         gettimeofday(&tvbuf, 0);
-        FIFO<boost::shared_array<uint8_t> >* pFifo = 0;
+        RowGroupDL* pFifo = 0;
         uint64_t totalBlockedReadCount  = 0;
         uint64_t totalBlockedWriteCount = 0;
 
@@ -2584,8 +2598,7 @@ out:
 
         for (size_t iDataList = 0; iDataList < inDlCnt; iDataList++)
         {
-            pFifo = dynamic_cast<FIFO<boost::shared_array<uint8_t> > *>(
-                        fInputJobStepAssociation.outAt(iDataList)->rowGroupDL());
+            pFifo = fInputJobStepAssociation.outAt(iDataList)->rowGroupDL();
 
             if (pFifo)
             {
@@ -2598,7 +2611,7 @@ out:
 
         for (size_t iDataList = 0; iDataList < outDlCnt; iDataList++)
         {
-            pFifo = dynamic_cast<FIFO<boost::shared_array<uint8_t> > *>(dlp);
+            pFifo = dlp;
 
             if (pFifo)
             {
@@ -3209,6 +3222,14 @@ void TupleBPS::setJoinFERG(const RowGroup& rg)
     fBPP->setJoinFERG(rg);
 }
 
+void TupleBPS::addBloomFilter(uint32_t col, const boost::shared_ptr<joiner::BloomFilter>& filter)
+{
+    if (fOid < 3000)
+        return;
+
+    fBPP->addBloomFilter(col, filter);
+}
+
 void TupleBPS::addCPPredicates(uint32_t OID, const vector<int128_t>& vals, bool isRange,
                                bool isSmallSideWideDecimal)
 {
@@ -3383,6 +3404,7 @@ void TupleBPS::abort_nolock()
 
         BPPIsAllocated = false;
         fDec->shutdownQueue(uniqueID);
+        fDec->wakeReaders(uniqueID);
     }
 
     condvarWakeupProducer.notify_all();
@@ -58,6 +58,8 @@ using namespace utils;
 #include "querytele.h"
 using namespace querytele;
 
+#include "configcpp.h"
+
 #include "funcexp.h"
 #include "jobstep.h"
 #include "jlf_common.h"
@@ -174,6 +176,22 @@ void TupleAnnexStep::initialize(const RowGroup& rgIn, const JobInfo& jobInfo)
     uint64_t id = 1;
     fRowGroupIn = rgIn;
     fRowGroupIn.initRow(&fRowIn);
+
+    // Sorted runs go to disk when the memory limit is hit.  DISTINCT has to
+    // see all the rows at once, so it keeps failing with ERR_LIMIT_TOO_BIG.
+    bool diskBased = fOrderBy && !fDistinct && jobInfo.rm->getAllowDiskOrderBy();
+    string spillPrefix;
+    uint32_t compression = 0;
+
+    if (diskBased)
+    {
+        config::Config* config = config::Config::makeConfig();
+        spillPrefix = config->getTempFileDir(config::Config::TempDirPurpose::OrderBy) +
+                      "Columnstore-ob-data-" + uuids::to_string(fStepUuid) + "-";
+        compression = ResourceManager::getTempFileCompressionType(
+                          jobInfo.rm->getOrderByTempFileCompression());
+    }
+
     if(fParallelOp && fOrderBy)
     {
         fOrderByList.resize(fMaxThreads+1);
@@ -183,6 +201,13 @@ void TupleAnnexStep::initialize(const RowGroup& rgIn, const JobInfo& jobInfo)
             fOrderByList[id] = new LimitedOrderBy();
             fOrderByList[id]->distinct(fDistinct);
             fOrderByList[id]->initialize(rgIn, jobInfo, false, true);
+
+            if (diskBased)
+            {
+                ostringstream os;
+                os << spillPrefix << id << "-";
+                fOrderByList[id]->enableDiskBased(os.str(), compression);
+            }
         }
     }
     else
@@ -191,6 +216,9 @@ void TupleAnnexStep::initialize(const RowGroup& rgIn, const JobInfo& jobInfo)
         {
             fOrderBy->distinct(fDistinct);
             fOrderBy->initialize(rgIn, jobInfo);
+
+            if (diskBased)
+                fOrderBy->enableDiskBased(spillPrefix, compression);
         }
     }
 
@@ -648,7 +676,11 @@ void TupleAnnexStep::executeWithOrderBy()
 
         fOrderBy->finalize();
 
-        if (!cancelled())
+        if (!cancelled() && fOrderBy->spilled())
+        {
+            mergeSortedRuns(vector<LimitedOrderBy*>(1, fOrderBy));
+        }
+        else if (!cancelled())
         {
             while (fOrderBy->getData(rgDataIn))
             {
@@ -1107,6 +1139,94 @@ void TupleAnnexStep::finalizeParallelOrderBy()
     }
 }
 
+/*
+    The m() is used instead of finalizeParallelOrderBy() when
+    any of the thread's LimitedOrderBy instances has spilled
+    sorted runs to disk. Every thread writes what it still holds
+    as one more run and the runs are merged into outputDL.
+*/
+void TupleAnnexStep::finalizeParallelOrderByOnDisk()
+{
+    utils::setThreadName("TASwParOrdDisk");
+
+    try
+    {
+        mergeSortedRuns(vector<LimitedOrderBy*>(fOrderByList.begin() + 1, fOrderByList.end()));
+    }
+    catch (...)
+    {
+        handleException(std::current_exception(),
+                        logging::ERR_IN_PROCESS,
+                        logging::ERR_ALWAYS_CRITICAL,
+                        "TupleAnnexStep::finalizeParallelOrderByOnDisk()");
+    }
+
+    fOutputDL->endOfInput();
+
+    StepTeleStats sts;
+    sts.query_uuid = fQueryUuid;
+    sts.step_uuid = fStepUuid;
+    sts.msg_type = StepTeleStats::ST_SUMMARY;
+    sts.total_units_of_work = sts.units_of_work_completed = 1;
+    sts.rows = fRowsReturned;
+    postStepSummaryTele(sts);
+
+    if (traceOn())
+    {
+        if (dlTimes.FirstReadTime().tv_sec == 0)
+            dlTimes.setFirstReadTime();
+
+        dlTimes.setLastReadTime();
+        dlTimes.setEndOfInputTime();
+        printCalTrace();
+    }
+}
+
+/*
+    The m() merges the sorted runs of the LimitedOrderBy
+    instances, MultiPassMerger::MAX_FAN_IN runs at a time,
+    applies OFFSET and LIMIT and streams rgCommonSize RowGroups
+    into outputDL. The runs hold one RowGroup each in memory
+    at a time.
+    !!!The method doesn't set Row::baseRid
+*/
+void TupleAnnexStep::mergeSortedRuns(const vector<LimitedOrderBy*>& orderByList)
+{
+    MultiPassMerger merger(orderByList, fRowGroupIn, fLimitStart, fLimitCount);
+
+    RGData rgDataOut(fRowGroupOut, rowgroup::rgCommonSize);
+    fRowGroupOut.setData(&rgDataOut);
+    fRowGroupOut.resetRowGroup(0);
+    fRowGroupOut.getRow(0, &fRowOut);
+
+    while (!cancelled() && merger.next())
+    {
+        if (fConstant)
+            fConstant->fillInConstants(merger.getRow(), fRowOut);
+        else
+            copyRow(merger.getRow(), &fRowOut);
+
+        fRowGroupOut.incRowCount();
+        fRowOut.nextRow();
+
+        if (fRowGroupOut.getRowCount() == rowgroup::rgCommonSize)
+        {
+            fRowsReturned += fRowGroupOut.getRowCount();
+            fOutputDL->insert(rgDataOut);
+            rgDataOut.reinit(fRowGroupOut, rowgroup::rgCommonSize);
+            fRowGroupOut.setData(&rgDataOut);
+            fRowGroupOut.resetRowGroup(0);
+            fRowGroupOut.getRow(0, &fRowOut);
+        }
+    }
+
+    if (fRowGroupOut.getRowCount() > 0)
+    {
+        fRowsReturned += fRowGroupOut.getRowCount();
+        fOutputDL->insert(rgDataOut);
+    }
+}
+
 void TupleAnnexStep::executeParallelOrderBy(uint64_t id)
 {
     utils::setThreadName("TASwParOrd");
@@ -1188,10 +1308,19 @@ void TupleAnnexStep::executeParallelOrderBy(uint64_t id)
     if (fFinishedThreads == fMaxThreads)
     {
         fParallelFinalizeMutex.unlock();
+        bool spilled = false;
+
+        for (uint64_t i = 1; i <= fMaxThreads; i++)
+            spilled = spilled || fOrderByList[i]->spilled();
+
         if(fDistinct)
         {
             finalizeParallelOrderByDistinct();
         }
+        else if (spilled)
+        {
+            finalizeParallelOrderByOnDisk();
+        }
         else
         {
             finalizeParallelOrderBy();
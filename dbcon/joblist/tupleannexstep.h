@@ -116,6 +116,8 @@ protected:
     void printCalTrace();
     void finalizeParallelOrderBy();
     void finalizeParallelOrderByDistinct();
+    void finalizeParallelOrderByOnDisk();
+    void mergeSortedRuns(const std::vector<LimitedOrderBy*>& orderByList);
 
     // input/output rowgroup and row
     rowgroup::RowGroup      fRowGroupIn;
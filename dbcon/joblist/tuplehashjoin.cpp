@@ -45,6 +45,7 @@ using namespace std;
 #include "errorids.h"
 #include "diskjoinstep.h"
 #include "vlarray.h"
+#include "bloomfilter.h"
 
 using namespace execplan;
 using namespace joiner;
@@ -95,6 +96,7 @@ TupleHashJoinStep::TupleHashJoinStep(const JobInfo& jobInfo) :
 
     pmMemLimit = resourceManager->getHjPmMaxMemorySmallSide(fSessionId);
     uniqueLimit = resourceManager->getHjCPUniqueLimit();
+    bloomFilterMaxKeys = resourceManager->getHjBloomFilterMaxKeys();
 
     fExtendedInfo = "THJS: ";
     joinType = INIT;
@@ -496,6 +498,102 @@ void TupleHashJoinStep::forwardCPData()
     }
 }
 
+namespace
+{
+// The types whose join keys are compared as the 64-bit value of the column
+bool isBloomFilterKeyType(const RowGroup& rg, uint32_t col)
+{
+    switch (rg.getColTypes()[col])
+    {
+        case CalpontSystemCatalog::TINYINT:
+        case CalpontSystemCatalog::SMALLINT:
+        case CalpontSystemCatalog::MEDINT:
+        case CalpontSystemCatalog::INT:
+        case CalpontSystemCatalog::BIGINT:
+        case CalpontSystemCatalog::UTINYINT:
+        case CalpontSystemCatalog::USMALLINT:
+        case CalpontSystemCatalog::UMEDINT:
+        case CalpontSystemCatalog::UINT:
+        case CalpontSystemCatalog::UBIGINT:
+        case CalpontSystemCatalog::DATE:
+        case CalpontSystemCatalog::DATETIME:
+        case CalpontSystemCatalog::TIMESTAMP:
+        case CalpontSystemCatalog::TIME:
+            return true;
+
+        case CalpontSystemCatalog::DECIMAL:
+        case CalpontSystemCatalog::UDECIMAL:
+            return rg.getColumnWidth(col) <= 8;
+
+        default:
+            return false;
+    }
+}
+}
+
+/* Build a Bloom filter on the keys of each small side and give it to the large side
+   BPS, which applies it on the PM before projecting the other columns.  Same
+   exclusions as forwardCPData(), plus the joins that compare anything other than
+   the 64-bit value of a single key column, or that need the NULLs. */
+void TupleHashJoinStep::forwardBloomFilters()
+{
+    uint32_t i, j;
+
+    if (largeBPS == NULL || bloomFilterMaxKeys == 0)
+        return;
+
+    for (i = 0; i < joiners.size(); i++)
+    {
+        if (joiners[i]->antiJoin() || joiners[i]->largeOuterJoin() ||
+                (joiners[i]->getJoinType() & MATCHNULLS) ||
+                joiners[i]->isTypelessJoin() || joiners[i]->hasFEFilter())
+            continue;
+
+        uint32_t smallKey = joiners[i]->getSmallKeyColumns()[0];
+        uint32_t largeKey = joiners[i]->getLargeKeyColumns()[0];
+
+        if (fFunctionJoinKeys.find(largeRG.getKeys()[largeKey]) != fFunctionJoinKeys.end())
+            continue;
+
+        if (!isBloomFilterKeyType(smallRGs[i], smallKey) || !isBloomFilterKeyType(largeRG, largeKey))
+            continue;
+
+        RowGroup smallRG = smallRGs[i];
+        uint64_t keyCount = 0;
+
+        for (j = 0; j < rgData[i].size(); j++)
+        {
+            smallRG.setData(&rgData[i][j]);
+            keyCount += smallRG.getRowCount();
+        }
+
+        if (keyCount > bloomFilterMaxKeys)
+            continue;
+
+        boost::shared_ptr<BloomFilter> filter(new BloomFilter(keyCount));
+        Row r;
+        smallRG.initRow(&r);
+        bool isUnsigned = smallRG.isUnsigned(smallKey);
+
+        for (j = 0; j < rgData[i].size(); j++)
+        {
+            smallRG.setData(&rgData[i][j]);
+            smallRG.getRow(0, &r);
+
+            for (uint32_t k = 0; k < smallRG.getRowCount(); k++, r.nextRow())
+            {
+                // a NULL key matches nothing
+                if (r.isNullValue(smallKey))
+                    continue;
+
+                filter->insert(isUnsigned ? r.getUintField(smallKey) : (uint64_t) r.getIntField(smallKey));
+            }
+        }
+
+        largeBPS->addBloomFilter(largeKey, filter);
+    }
+}
+
 void TupleHashJoinStep::djsRelayFcn()
 {
     /*
@@ -855,7 +953,10 @@ void TupleHashJoinStep::hjRunner()
 
     // todo: forwardCPData needs to grab data from djs
     if (!djs)
+    {
         forwardCPData(); 	// this fcn has its own exclusion list
+        forwardBloomFilters();
+    }
 
     // decide if perform aggregation on PM
     if (dynamic_cast<TupleAggregateStep*>(fDeliveryStep.get()) != NULL && largeBPS)
@@ -502,6 +502,10 @@ private:
     void forwardCPData();
     uint32_t uniqueLimit;
 
+    /* Bloom filter forwarding */
+    void forwardBloomFilters();
+    uint64_t bloomFilterMaxKeys;
+
     /* UM Join support.  Most of this code is ported from the UM join code in tuple-bps.cpp.
      * They should be kept in sync as much as possible. */
     struct JoinRunner
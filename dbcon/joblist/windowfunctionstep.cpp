@@ -21,6 +21,9 @@
 
 //#define NDEBUG
 #include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
 #include <sstream>
 #include <iomanip>
 using namespace std;
@@ -28,6 +31,8 @@ using namespace std;
 #include <boost/algorithm/string.hpp>  //  to_upper_copy
 #include <boost/shared_ptr.hpp>
 #include <boost/shared_array.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
 #include <boost/uuid/uuid_io.hpp>
 using namespace boost;
@@ -67,6 +72,11 @@ using namespace rowgroup;
 
 using namespace ordering;
 
+#include "hasher.h"
+#include "idbcompress.h"
+#include "bytestream.h"
+using namespace messageqcpp;
+
 #include "funcexp.h"
 using namespace funcexp;
 
@@ -84,6 +94,31 @@ using namespace joblist;
 namespace
 {
 
+// disk-based mode: the number of spill files, and the rows buffered for each between writes
+const uint64_t SPILL_BUCKETS = 64;
+const uint64_t SPILL_BUFFER_ROWS = 1024;
+
+
+void resetSpillBuffer(RowGroup& rg, RGData& rgData)
+{
+    rgData.reinit(rg, SPILL_BUFFER_ROWS);
+    rg.setData(&rgData);
+    rg.resetRowGroup(0);
+}
+
+
+void throwSpillFileError(const char* what, const string& filename, int saveErrno = 0)
+{
+    ostringstream os;
+    os << what << " " << filename;
+
+    if (saveErrno != 0)
+        os << ": " << strerror(saveErrno);
+
+    throw IDBExcept(IDBErrorInfo::instance()->errorMsg(ERR_WF_FILE_IO_ERROR, os.str()),
+                    ERR_WF_FILE_IO_ERROR);
+}
+
 
 uint64_t getColumnIndex(const SRCP& c, const map<uint64_t, uint64_t>& m, JobInfo& jobInfo)
 {
@@ -151,10 +186,13 @@ WindowFunctionStep::WindowFunctionStep(const JobInfo& jobInfo) :
     fOutputIterator(-1),
     fFunctionCount(0),
     fTotalThreads(1),
+    fPartitionThreads(1),
     fNextIndex(0),
     fMemUsage(0),
     fRm(jobInfo.rm),
-    fSessionMemLimit(jobInfo.umMemLimit)
+    fSessionMemLimit(jobInfo.umMemLimit),
+    fSpillBytes(0),
+    fSpillBufferMem(0)
 {
     fTotalThreads = fRm->windowFunctionThreads();
     fExtendedInfo = "WFS: ";
@@ -166,6 +204,16 @@ WindowFunctionStep::~WindowFunctionStep()
 {
     if (fMemUsage > 0)
         fRm->returnMemory(fMemUsage, fSessionMemLimit);
+
+    if (fSpillBufferMem > 0)
+        fRm->returnMemory(fSpillBufferMem, fSessionMemLimit);
+
+    // left behind by an error or a cancel
+    for (vector<string>::iterator i = fSpillFiles.begin(); i != fSpillFiles.end(); i++)
+    {
+        boost::system::error_code ec;
+        boost::filesystem::remove(*i, ec);
+    }
 }
 
 
@@ -631,6 +679,9 @@ void WindowFunctionStep::initialize(const RowGroup& rg, JobInfo& jobInfo)
     int64_t wfsUpdateStringTable = 0;
     int64_t wfsUserFunctionCount = 0;
 
+    // the partition columns shared by all the functions
+    vector<uint64_t> spillIdx;
+
     for (RetColsVector::iterator i = jobInfo.windowCols.begin(); i < jobInfo.windowCols.end(); i++)
     {
         bool isUDAF = false;
@@ -709,6 +760,23 @@ void WindowFunctionStep::initialize(const RowGroup& rg, JobInfo& jobInfo)
         boost::shared_ptr<OrderByData> orderbys(new OrderByData(sorts, rg));
         boost::shared_ptr<EqualCompData> peers(new EqualCompData(peerIdx, rg));
 
+        if (fFunctionCount == 0)
+        {
+            spillIdx = eqIdx;
+        }
+        else
+        {
+            vector<uint64_t> common;
+
+            for (uint64_t k = 0; k < spillIdx.size(); k++)
+            {
+                if (find(eqIdx.begin(), eqIdx.end(), spillIdx[k]) != eqIdx.end())
+                    common.push_back(spillIdx[k]);
+            }
+
+            spillIdx.swap(common);
+        }
+
         // column type for functor templates
         int ct = 0;
 
@@ -880,13 +948,30 @@ void WindowFunctionStep::initialize(const RowGroup& rg, JobInfo& jobInfo)
     if (jobInfo.trace)
         cout << "delivered RG: " << fRowGroupDelivered.toString() << endl << endl;
 
-    if (wfsUpdateStringTable > 1)
+    // functions computed on several threads, or one function whose partitions are
+    if (wfsUpdateStringTable > 1 || (wfsUpdateStringTable > 0 && fTotalThreads > 1))
         fUseSSMutex = true;
 
     if (wfsUserFunctionCount > 1)
         fUseUFMutex = true;
 
     fRowGroupOut = fRowGroupDelivered;
+
+    // Disk-based mode spills the rows by a partition column all the functions have, so
+    // a partition lands in one file and the files can be computed one at a time.  The
+    // query order by and the dml output work on the whole data set, and UDAnF user data
+    // is left in memory.
+    if (fRm->getAllowDiskWindowFunction() && !spillIdx.empty() && fIsSelect &&
+            fQueryOrderBy.get() == NULL && wfsUserFunctionCount == 0)
+    {
+        fSpillKey.reset(new EqualCompData(spillIdx, rg));
+
+        uint32_t compression = ResourceManager::getTempFileCompressionType(
+                                   fRm->getWindowFunctionTempFileCompression());
+
+        if (compression != 0)
+            fCompressor.reset(compress::getCompressInterfaceByType(compression));
+    }
 }
 
 
@@ -915,14 +1000,28 @@ void WindowFunctionStep::execute()
             fRowGroupIn.getRow(0, &row);
             uint64_t rowCnt = fRowGroupIn.getRowCount();
 
-            if (rowCnt > 0)
+            if (rowCnt > 0 && !fSpillFiles.empty())
+            {
+                spillRowGroup(rgData);
+                fRowsReturned += rowCnt;
+            }
+            else if (rowCnt > 0)
             {
                 fInRowGroupData.push_back(rgData);
                 uint64_t memAdd = fRowGroupIn.getSizeWithStrings() + rowCnt * sizeof(RowPosition);
                 fMemUsage += memAdd;
 
-                if (fRm->getMemory(memAdd, fSessionMemLimit) == false)
-                    throw IDBExcept(ERR_WF_DATA_SET_TOO_BIG);
+                // no need to wait for memory when the rows can go to disk
+                if (fRm->getMemory(memAdd, fSessionMemLimit, fSpillKey.get() == NULL) == false)
+                {
+                    if (fSpillKey.get() == NULL)
+                        throw IDBExcept(ERR_WF_DATA_SET_TOO_BIG);
+
+                    startSpilling();
+                    fRowsReturned += rowCnt;
+                    more = fInputDL->next(fInputIterator, &rgData);
+                    continue;
+                }
 
                 for (uint64_t j = 0; j < rowCnt; ++j)
                 {
@@ -959,7 +1058,7 @@ void WindowFunctionStep::execute()
         dlTimes.setLastReadTime();
 
     // no need for the window function if aborted or result set is empty.
-    if (cancelled() || fRows.size() == 0)
+    if (cancelled() || (fRows.size() == 0 && fSpillFiles.empty()))
     {
         while (more)
             more = fInputDL->next(fInputIterator, &rgData);
@@ -983,33 +1082,10 @@ void WindowFunctionStep::execute()
     // got something to work on
     try
     {
-        if (fFunctionCount == 1)
-        {
-            doFunction();
-        }
+        if (fSpillFiles.empty())
+            computeFunctions();
         else
-        {
-            if (fTotalThreads > fFunctionCount)
-                fTotalThreads = fFunctionCount;
-
-            fFunctionThreads.clear();
-            fFunctionThreads.reserve(fTotalThreads);
-
-            for (uint64_t i = 0; i < fTotalThreads && !cancelled(); i++)
-                fFunctionThreads.push_back(jobstepThreadPool.invoke(WFunction(this)));
-
-            // If cancelled, not all threads are started.
-            jobstepThreadPool.join(fFunctionThreads);
-        }
-
-        if (!(cancelled()))
-        {
-            if (fIsSelect)
-                doPostProcessForSelect();
-            else
-                doPostProcessForDml();
-        }
-
+            processSpilledBuckets();
     }
     catch (...)
     {
@@ -1036,6 +1112,270 @@ void WindowFunctionStep::execute()
 }
 
 
+void WindowFunctionStep::computeFunctions()
+{
+    // the threads left over by the functions go to their partitions
+    fPartitionThreads = max(fTotalThreads / fFunctionCount, (uint64_t) 1);
+    fNextIndex = 0;
+
+    if (fFunctionCount == 1)
+    {
+        doFunction();
+    }
+    else
+    {
+        // computeFunctions() runs once per spilled bucket, keep fTotalThreads
+        uint64_t threads = min(fTotalThreads, fFunctionCount);
+
+        fFunctionThreads.clear();
+        fFunctionThreads.reserve(threads);
+
+        for (uint64_t i = 0; i < threads && !cancelled(); i++)
+            fFunctionThreads.push_back(jobstepThreadPool.invoke(WFunction(this)));
+
+        // If cancelled, not all threads are started.
+        jobstepThreadPool.join(fFunctionThreads);
+    }
+
+    if (!(cancelled()))
+    {
+        if (fIsSelect)
+            doPostProcessForSelect();
+        else
+            doPostProcessForDml();
+    }
+}
+
+
+void WindowFunctionStep::startSpilling()
+{
+    config::Config* config = config::Config::makeConfig();
+    string prefix = config->getTempFileDir(config::Config::TempDirPurpose::WindowFunctions) +
+                    "Columnstore-wf-data-" + boost::uuids::to_string(fStepUuid) + "-";
+    RowGroup spillRG(fRowGroupIn);
+
+    fSpillFiles.reserve(SPILL_BUCKETS);
+    fSpillBuffers.resize(SPILL_BUCKETS);
+
+    for (uint64_t b = 0; b < SPILL_BUCKETS; b++)
+    {
+        ostringstream os;
+        os << prefix << b;
+        fSpillFiles.push_back(os.str());
+        resetSpillBuffer(spillRG, fSpillBuffers[b]);
+    }
+
+    // what is in memory goes first, then the data is given back
+    for (vector<RGData>::iterator i = fInRowGroupData.begin(); i != fInRowGroupData.end(); i++)
+        spillRowGroup(*i);
+
+    vector<RGData>().swap(fInRowGroupData);
+    vector<RowPosition>().swap(fRows);
+    releaseMemory();
+
+    // the write buffers stay until processSpilledBuckets(), charged apart from
+    // fMemUsage which is given back after every bucket
+    fSpillBufferMem = spillRG.getSizeWithStrings(SPILL_BUFFER_ROWS) * SPILL_BUCKETS;
+
+    if (fRm->getMemory(fSpillBufferMem, fSessionMemLimit) == false)
+        throw IDBExcept(ERR_WF_DATA_SET_TOO_BIG);
+}
+
+
+void WindowFunctionStep::spillRowGroup(RGData& rgData)
+{
+    RowGroup spillRG(fRowGroupIn);
+    Row row, spillRow;
+    fRowGroupIn.initRow(&row);
+    spillRG.initRow(&spillRow);
+    fRowGroupIn.setData(&rgData);
+    fRowGroupIn.getRow(0, &row);
+    uint64_t rowCnt = fRowGroupIn.getRowCount();
+
+    for (uint64_t j = 0; j < rowCnt; j++, row.nextRow())
+    {
+        // mixed again, the partitions of a file are hashed to threads by the same hash
+        uint64_t b = utils::fmix(fSpillKey->hash(row)) % fSpillFiles.size();
+        spillRG.setData(&fSpillBuffers[b]);
+        uint64_t n = spillRG.getRowCount();
+        spillRG.getRow(n, &spillRow);
+        copyRow(row, &spillRow);
+        spillRG.setRowCount(++n);
+
+        if (n == SPILL_BUFFER_ROWS)
+        {
+            writeSpillBuffer(b);
+            resetSpillBuffer(spillRG, fSpillBuffers[b]);
+        }
+    }
+}
+
+
+void WindowFunctionStep::writeSpillBuffer(uint64_t bucket)
+{
+    RowGroup spillRG(fRowGroupIn);
+    spillRG.setData(&fSpillBuffers[bucket]);
+
+    if (spillRG.getRowCount() == 0)
+        return;
+
+    ByteStream bs;
+    spillRG.serializeRGData(bs);
+
+    // same record layout as the disk join files
+    const string& filename = fSpillFiles[bucket];
+    fstream fs(filename.c_str(), ios::binary | ios::out | ios::app);
+
+    if (!fs)
+        throwSpillFileError("could not open (write access)", filename, errno);
+
+    size_t len = bs.length();
+
+    if (!fCompressor)
+    {
+        fs.write((char*) &len, sizeof(len));
+        fs.write((char*) bs.buf(), len);
+        fSpillBytes += sizeof(len) + len;
+    }
+    else
+    {
+        size_t actualSize = fCompressor->maxCompressedSize(len);
+        boost::scoped_array<char> compressed(new char[actualSize]);
+
+        if (fCompressor->compress((char*) bs.buf(), len, compressed.get(), &actualSize) !=
+                compress::CompressInterface::ERR_OK)
+            throwSpillFileError("could not compress", filename);
+
+        fs.write((char*) &actualSize, sizeof(actualSize));
+        fs.write((char*) &len, sizeof(len));
+        fs.write(compressed.get(), actualSize);
+        fSpillBytes += sizeof(actualSize) + sizeof(len) + actualSize;
+    }
+
+    if (!fs)
+        throwSpillFileError("could not write", filename, errno);
+}
+
+
+void WindowFunctionStep::loadSpilledBucket(uint64_t bucket)
+{
+    const string& filename = fSpillFiles[bucket];
+
+    // no row was hashed to this one
+    if (!boost::filesystem::exists(filename))
+        return;
+
+    fstream fs(filename.c_str(), ios::binary | ios::in);
+
+    if (!fs)
+        throwSpillFileError("could not open (read access)", filename, errno);
+
+    uint64_t i = 0; // for RowGroup index in the fInRowGroupData
+    size_t len;
+
+    while (fs.read((char*) &len, sizeof(len)))
+    {
+        ByteStream bs;
+
+        if (!fCompressor)
+        {
+            bs.needAtLeast(len);
+            fs.read((char*) bs.getInputPtr(), len);
+            bs.advanceInputPtr(len);
+        }
+        else
+        {
+            size_t uncompressedSize = 0;
+            fs.read((char*) &uncompressedSize, sizeof(uncompressedSize));
+            boost::scoped_array<char> buf(new char[len]);
+
+            if (!fs.read(buf.get(), len))
+                throwSpillFileError("could not read", filename, errno);
+
+            size_t outLen = uncompressedSize;
+            bs.needAtLeast(uncompressedSize);
+
+            if (fCompressor->uncompress(buf.get(), len, (char*) bs.getInputPtr(), &outLen) !=
+                    compress::CompressInterface::ERR_OK || outLen != uncompressedSize)
+                throwSpillFileError("could not uncompress", filename);
+
+            bs.advanceInputPtr(uncompressedSize);
+        }
+
+        if (!fs)
+            throwSpillFileError("could not read", filename, errno);
+
+        RGData rgData;
+        rgData.deserialize(bs);
+        fRowGroupIn.setData(&rgData);
+        uint64_t rowCnt = fRowGroupIn.getRowCount();
+        uint64_t memAdd = fRowGroupIn.getSizeWithStrings() + rowCnt * sizeof(RowPosition);
+        fMemUsage += memAdd;
+
+        // the partitions in a file still have to fit in memory
+        if (fRm->getMemory(memAdd, fSessionMemLimit) == false)
+            throw IDBExcept(ERR_WF_DATA_SET_TOO_BIG);
+
+        //@bug6065, make StringStore::storeString() thread safe, default to false.
+        rgData.useStoreStringMutex(fUseSSMutex);
+        rgData.useUserDataMutex(fUseUFMutex);
+        fInRowGroupData.push_back(rgData);
+
+        for (uint64_t j = 0; j < rowCnt; ++j)
+            fRows.push_back(RowPosition(i, j));
+
+        i++;
+    }
+
+    if (!fs.eof())
+        throwSpillFileError("could not read", filename, errno);
+
+    fs.close();
+    boost::filesystem::remove(filename);
+}
+
+
+void WindowFunctionStep::processSpilledBuckets()
+{
+    for (uint64_t b = 0; b < fSpillBuffers.size(); b++)
+        writeSpillBuffer(b);
+
+    vector<RGData>().swap(fSpillBuffers);
+    fRm->returnMemory(fSpillBufferMem, fSessionMemLimit);
+    fSpillBufferMem = 0;
+
+    if (traceOn())
+        cout << "WindowFunctionStep spilled " << fSpillBytes << " bytes to "
+             << fSpillFiles.size() << " files" << endl;
+
+    // the limit carries over from one file to the next, see doPostProcessForSelect()
+    for (uint64_t b = 0; b < fSpillFiles.size() && fQueryLimitCount > 0 && !cancelled(); b++)
+    {
+        loadSpilledBucket(b);
+
+        if (fRows.size() > 0)
+            computeFunctions();
+
+        vector<RGData>().swap(fInRowGroupData);
+        vector<RowPosition>().swap(fRows);
+
+        for (uint64_t k = 0; k < fFunctionCount; k++)
+            fFunctions[k]->fRowData.reset();
+
+        releaseMemory();
+    }
+}
+
+
+void WindowFunctionStep::releaseMemory()
+{
+    if (fMemUsage > 0)
+        fRm->returnMemory(fMemUsage, fSessionMemLimit);
+
+    fMemUsage = 0;
+}
+
+
 uint64_t WindowFunctionStep::nextFunctionIndex()
 {
     uint64_t idx = atomicInc(&fNextIndex);
@@ -1091,6 +1431,16 @@ void WindowFunctionStep::doPostProcessForSelect()
     end = (end < rowsLeft) ? end : rowsLeft;
     rowsLeft = (end > begin) ? (end - begin) : 0;
 
+    // in disk-based mode the next file continues where these rows leave off
+    if (!fSpillFiles.empty())
+    {
+        int64_t rowCnt = rowData.size();
+        fQueryLimitStart = (begin > rowCnt) ? (begin - rowCnt) : 0;
+
+        if (fQueryLimitCount != (uint64_t) - 1)
+            fQueryLimitCount -= rowsLeft;
+    }
+
     if (fQueryOrderBy.get() != NULL)
         sort(rowData.begin(), rowData.size());
 
@@ -28,6 +28,12 @@
 #include "windowfunctioncolumn.h"
 #include "threadnaming.h"
 
+namespace compress
+{
+// forward reference
+class CompressInterface;
+};
+
 namespace execplan
 {
 // forward reference
@@ -109,6 +115,22 @@ public:
     {
         return fRows;
     }
+    // threads a window function can split its partitions between
+    uint64_t partitionThreads() const
+    {
+        return fPartitionThreads;
+    }
+
+    // disk-based mode, for the tests
+    uint64_t getSpillBytes() const
+    {
+        return fSpillBytes;
+    }
+    const compress::CompressInterface* getCompressor() const
+    {
+        return fCompressor.get();
+    }
+
     // for string table
     rowgroup::Row::Pointer getPointer(RowPosition& pos)
     {
@@ -129,6 +151,15 @@ private:
     void doFunction();
     void doPostProcessForSelect();
     void doPostProcessForDml();
+    void computeFunctions();
+
+    // disk-based mode, see execute()
+    void startSpilling();
+    void spillRowGroup(rowgroup::RGData&);
+    void writeSpillBuffer(uint64_t bucket);
+    void loadSpilledBucket(uint64_t bucket);
+    void processSpilledBuckets();
+    void releaseMemory();
 
     uint64_t nextFunctionIndex();
 
@@ -206,6 +237,7 @@ private:
     std::vector<boost::shared_ptr<windowfunction::WindowFunction> > fFunctions;
     uint64_t                         fFunctionCount;
     uint64_t                         fTotalThreads;
+    uint64_t                         fPartitionThreads;
 #ifdef _MSC_VER
     volatile LONG                    fNextIndex;
 #else
@@ -223,6 +255,14 @@ private:
     ResourceManager*                 fRm;
     boost::shared_ptr<int64_t>		 fSessionMemLimit;
 
+    // for disk-based mode, the rows are spilled by the partition columns all functions share
+    boost::shared_ptr<ordering::EqualCompData> fSpillKey;
+    std::vector<std::string>         fSpillFiles;
+    std::vector<rowgroup::RGData>    fSpillBuffers;
+    boost::shared_ptr<compress::CompressInterface> fCompressor;
+    uint64_t                         fSpillBytes;
+    uint64_t                         fSpillBufferMem;
+
     friend class windowfunction::WindowFunction;
 };
 
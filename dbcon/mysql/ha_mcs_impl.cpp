@@ -143,6 +143,7 @@ using namespace funcexp;
 #include "ha_mcs_sysvars.h"
 
 #include "ha_mcs_datatype.h"
+#include "ha_mcs_recordbatch.h"
 #include "statistics.h"
 #include "ha_mcs_logging.h"
 
@@ -326,17 +327,6 @@ int fetchNextRow(uchar* buf, cal_table_info& ti, cal_connection_info* ci, bool h
 
     if (sm_stat == sm::STATUS_OK)
     {
-        Field** f;
-        f = ti.msTablePtr->field;
-
-        //set all fields to null in null col bitmap
-        if (!handler_flag)
-            memset(buf, -1, ti.msTablePtr->s->null_bytes);
-        else
-        {
-            memset(ti.msTablePtr->null_flags, -1, ti.msTablePtr->s->null_bytes);
-        }
-
         std::vector<CalpontSystemCatalog::ColType>& colTypes = ti.tpl_scan_ctx->ctp;
 
         RowGroup* rowGroup = ti.tpl_scan_ctx->rowGroup;
@@ -363,72 +353,63 @@ int fetchNextRow(uchar* buf, cal_table_info& ti, cal_connection_info* ci, bool h
             }
         }
 
-        rowgroup::Row row;
-        rowGroup->initRow(&row);
-        rowGroup->getRow(ti.tpl_scan_ctx->rowsreturned, &row);
-        int s;
-
-        for (int p = 0; p < num_attr; p++, f++)
+        // get coltype if not there yet
+        if (num_attr > 0 && colTypes[0].colWidth == 0)
         {
-            //This col is going to be written
-            bitmap_set_bit(ti.msTablePtr->write_set, (*f)->field_index);
-
-            // get coltype if not there yet
-            if (colTypes[0].colWidth == 0)
+            for (short c = 0; c < num_attr; c++)
             {
-                for (short c = 0; c < num_attr; c++)
-                {
-                    colTypes[c].colPosition = c;
-                    colTypes[c].colWidth = rowGroup->getColumnWidth(c);
-                    colTypes[c].colDataType = rowGroup->getColTypes()[c];
-                    colTypes[c].columnOID = rowGroup->getOIDs()[c];
-                    colTypes[c].scale = rowGroup->getScale()[c];
-                    colTypes[c].precision = rowGroup->getPrecision()[c];
-                }
+                colTypes[c].colPosition = c;
+                colTypes[c].colWidth = rowGroup->getColumnWidth(c);
+                colTypes[c].colDataType = rowGroup->getColTypes()[c];
+                colTypes[c].columnOID = rowGroup->getOIDs()[c];
+                colTypes[c].scale = rowGroup->getScale()[c];
+                colTypes[c].precision = rowGroup->getPrecision()[c];
             }
+        }
 
-            CalpontSystemCatalog::ColType colType(colTypes[p]);
+        // the fields point into record[0], the rows are converted into it a
+        // batch of records at a time
+        if (handler_flag || buf == ti.msTablePtr->record[0])
+        {
+            if (!ti.recordBatch || !ti.recordBatch->isFor(ti.msTablePtr, ti.tpl_scan_ctx))
+                ti.recordBatch.reset(new RecordBatch(ti.msTablePtr, ti.tpl_scan_ctx));
 
-            // table mode handling
-            if (ti.tpl_scan_ctx->traceFlags & execplan::CalpontSelectExecutionPlan::TRACE_TUPLE_OFF)
-            {
-                if (colType.colPosition == -1) // not projected by tuplejoblist
-                    continue;
-                else
-                    s = colType.colPosition;
-            }
-            else
-            {
-                s = p;
-            }
+            ti.recordBatch->fetchRow();
+        }
+        else
+        {
+            Field** f;
+            f = ti.msTablePtr->field;
+
+            //set all fields to null in null col bitmap
+            memset(buf, -1, ti.msTablePtr->s->null_bytes);
 
-            // precision == -16 is borrowed as skip null check indicator for bit ops.
-            if (row.isNullValue(s) && colType.precision != -16)
+            rowgroup::Row row;
+            rowGroup->initRow(&row);
+            rowGroup->getRow(ti.tpl_scan_ctx->rowsreturned, &row);
+            int s;
+
+            for (int p = 0; p < num_attr; p++, f++)
             {
-                // @2835. Handle empty string and null confusion. store empty string for string column
-                if (colType.colDataType == CalpontSystemCatalog::CHAR ||
-                        colType.colDataType == CalpontSystemCatalog::VARCHAR ||
-                        colType.colDataType == CalpontSystemCatalog::VARBINARY)
+                //This col is going to be written
+                bitmap_set_bit(ti.msTablePtr->write_set, (*f)->field_index);
+
+                const CalpontSystemCatalog::ColType& colType = colTypes[p];
+
+                // table mode handling
+                if (ti.tpl_scan_ctx->traceFlags & execplan::CalpontSelectExecutionPlan::TRACE_TUPLE_OFF)
                 {
-                    (*f)->store("", 0, (*f)->charset());
+                    if (colType.colPosition == -1) // not projected by tuplejoblist
+                        continue;
+                    else
+                        s = colType.colPosition;
+                }
+                else
+                {
+                    s = p;
                 }
 
-                continue;
-            }
-
-            const datatypes::TypeHandler *h= colType.typeHandler();
-            if (!h)
-            {
-              idbassert(0);
-              (*f)->reset();
-              (*f)->set_null();
-            }
-            else
-            {
-              // fetch and store data
-              (*f)->set_notnull();
-              datatypes::StoreFieldMariaDB mf(*f, colType);
-              h->storeValueToField(row, s, &mf);
+                storeFieldValue(*f, row, s, colType);
             }
         }
 
@@ -448,6 +429,7 @@ int fetchNextRow(uchar* buf, cal_table_info& ti, cal_connection_info* ci, bool h
         IDEBUG( cerr << "fetchNextRow done for table " << ti.msTablePtr->s->table_name.str << " rows = " << ti.c << endl );
         ti.c = 0;
         ti.moreRows = false;
+        ti.recordBatch.reset();
         rc = HA_ERR_END_OF_FILE;
     }
     else if (sm_stat == sm::CALPONT_INTERNAL_ERROR)
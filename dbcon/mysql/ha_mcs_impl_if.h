@@ -71,6 +71,7 @@ namespace cal_impl_if
 {
 class SubQuery;
 class View;
+class RecordBatch;
 
 struct JoinInfo
 {
@@ -221,6 +222,7 @@ struct cal_table_info
     gp_walk_info* condInfo;
     execplan::SCSEP csep;
     bool moreRows; //are there more rows to consume (b/c of limit)
+    boost::shared_ptr<RecordBatch> recordBatch; // records converted ahead of fetchNextRow()
 };
 
 struct cal_group_info
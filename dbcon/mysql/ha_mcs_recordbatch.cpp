@@ -0,0 +1,449 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <my_config.h>
+#include <string.h>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+#include "idb_mysql.h"
+#include "ha_mcs_impl_if.h"
+#include "ha_mcs_sysvars.h"
+
+#include "calpontselectexecutionplan.h"
+#include "dataconvert.h"
+#include "mcs_datatype.h"
+#include "nullvaluemanip.h"
+#include "rowgroup.h"
+#include "sm.h"
+using namespace std;
+using namespace execplan;
+using namespace dataconvert;
+using namespace rowgroup;
+
+#include "ha_mcs_datatype.h"
+#include "ha_mcs_recordbatch.h"
+
+namespace
+{
+
+// the record images converted at once, the rest of the RowGroup waits for the next batch
+const size_t RECORD_BATCH_SIZE = 1024 * 1024;
+
+// points a field at another record image for as long as it lives
+class MovedField
+{
+public:
+    MovedField(Field* field, my_ptrdiff_t diff) : fField(field), fDiff(diff)
+    {
+        fField->move_field_offset(fDiff);
+    }
+    ~MovedField()
+    {
+        fField->move_field_offset(-fDiff);
+    }
+
+private:
+    Field* fField;
+    my_ptrdiff_t fDiff;
+};
+
+}
+
+namespace cal_impl_if
+{
+
+void storeFieldValue(Field* field, Row& row, int pos, const CalpontSystemCatalog::ColType& colType)
+{
+    // precision == -16 is borrowed as skip null check indicator for bit ops.
+    if (row.isNullValue(pos) && colType.precision != -16)
+    {
+        // @2835. Handle empty string and null confusion. store empty string for string column
+        if (colType.colDataType == CalpontSystemCatalog::CHAR ||
+                colType.colDataType == CalpontSystemCatalog::VARCHAR ||
+                colType.colDataType == CalpontSystemCatalog::VARBINARY)
+        {
+            field->store("", 0, field->charset());
+        }
+
+        return;
+    }
+
+    const datatypes::TypeHandler* h = colType.typeHandler();
+
+    if (!h)
+    {
+        idbassert(0);
+        field->reset();
+        field->set_null();
+    }
+    else
+    {
+        // fetch and store data
+        field->set_notnull();
+        datatypes::StoreFieldMariaDB mf(field, colType);
+        h->storeValueToField(row, pos, &mf);
+    }
+}
+
+RecordBatch::RecordBatch(TABLE* table, const sm::sp_cpsm_tplsch_t& scanCtx) :
+    fTable(table),
+    fScanCtx(scanCtx),
+    fHasOnFetchColumns(false),
+    fRecLength(table->s->reclength),
+    fFirstRow(0),
+    fRowCount(0)
+{
+    const RowGroup& rowGroup = *scanCtx->rowGroup;
+    const vector<CalpontSystemCatalog::ColType>& colTypes = scanCtx->ctp;
+    bool tableMode = (scanCtx->traceFlags & CalpontSelectExecutionPlan::TRACE_TUPLE_OFF);
+    uint32_t fieldCount = table->s->fields;
+
+    fColumns.resize(fieldCount);
+
+    for (uint32_t p = 0; p < fieldCount; p++)
+    {
+        Column& c = fColumns[p];
+
+        c.field = table->field[p];
+        c.colTypeIndex = p;
+        // table mode mysql expects all columns of the table, colPosition is the column
+        // in the rowgroup or -1 if it's not projected
+        c.rgPos = (tableMode ? colTypes[p].colPosition : p);
+        c.checkNull = (colTypes[p].precision != -16);
+        c.nullValue = 0;
+        c.offset = c.field->ptr - table->record[0];
+
+        if (c.field->null_ptr)
+        {
+            c.nullOffset = c.field->null_ptr - table->record[0];
+            c.nullBit = c.field->null_bit;
+        }
+        else
+        {
+            c.nullOffset = -1;
+            c.nullBit = 0;
+        }
+
+        if (c.rgPos == -1)
+        {
+            c.conversion = SKIP;
+            continue;
+        }
+
+        c.conversion = pickConversion(c.field, colTypes[p], rowGroup, c.rgPos);
+
+        if (c.conversion == STORE_ON_FETCH)
+            fHasOnFetchColumns = true;
+        else if (c.conversion != STORE_FIELD)
+            c.nullValue = utils::getNullValue(rowGroup.getColTypes()[c.rgPos],
+                                              rowGroup.getColumnWidth(c.rgPos));
+    }
+}
+
+/* The direct conversions need the RowGroup column and the field to agree on the
+   representation, and the field to take any value the column can hold as is. */
+RecordBatch::Conversion RecordBatch::pickConversion(Field* field,
+        const CalpontSystemCatalog::ColType& colType, const RowGroup& rowGroup, uint32_t rgPos)
+{
+    CalpontSystemCatalog::ColDataType type = rowGroup.getColTypes()[rgPos];
+    uint32_t width = rowGroup.getColumnWidth(rgPos);
+    bool isUnsigned = (dynamic_cast<Field_num*>(field) != NULL &&
+                       static_cast<Field_num*>(field)->unsigned_flag);
+
+    // a field that keeps its value outside of the record is good for one row only
+    if ((field->flags & BLOB_FLAG) && colType.colDataType != CalpontSystemCatalog::BLOB &&
+            colType.colDataType != CalpontSystemCatalog::TEXT)
+        return STORE_ON_FETCH;
+
+    if (colType.colDataType != type)
+        return STORE_FIELD;
+
+    // a DATE field is 3 bytes, the column 4
+    if (type == CalpontSystemCatalog::DATE)
+        return (field->real_type() == MYSQL_TYPE_NEWDATE ? STORE_DATE : STORE_FIELD);
+
+    if (field->pack_length() != width)
+        return STORE_FIELD;
+
+    switch (type)
+    {
+        case CalpontSystemCatalog::TINYINT:
+        case CalpontSystemCatalog::UTINYINT:
+            if (field->real_type() == MYSQL_TYPE_TINY &&
+                    isUnsigned == (type == CalpontSystemCatalog::UTINYINT))
+                return STORE_INT8;
+
+            break;
+
+        case CalpontSystemCatalog::SMALLINT:
+        case CalpontSystemCatalog::USMALLINT:
+            if (field->real_type() == MYSQL_TYPE_SHORT &&
+                    isUnsigned == (type == CalpontSystemCatalog::USMALLINT))
+                return STORE_INT16;
+
+            break;
+
+        case CalpontSystemCatalog::INT:
+        case CalpontSystemCatalog::UINT:
+            if (field->real_type() == MYSQL_TYPE_LONG &&
+                    isUnsigned == (type == CalpontSystemCatalog::UINT))
+                return STORE_INT32;
+
+            break;
+
+        case CalpontSystemCatalog::BIGINT:
+        case CalpontSystemCatalog::UBIGINT:
+            if (field->real_type() == MYSQL_TYPE_LONGLONG &&
+                    isUnsigned == (type == CalpontSystemCatalog::UBIGINT))
+                return STORE_INT64;
+
+            break;
+
+        // Field_real::store() rounds to the declared decimals and clips
+        // negative values of unsigned fields
+        case CalpontSystemCatalog::FLOAT:
+            if (field->real_type() == MYSQL_TYPE_FLOAT && !isUnsigned &&
+                    field->decimals() == NOT_FIXED_DEC)
+                return STORE_FLOAT;
+
+            break;
+
+        case CalpontSystemCatalog::DOUBLE:
+            if (field->real_type() == MYSQL_TYPE_DOUBLE && !isUnsigned &&
+                    field->decimals() == NOT_FIXED_DEC)
+                return STORE_DOUBLE;
+
+            break;
+
+        default:
+            break;
+    }
+
+    return STORE_FIELD;
+}
+
+void RecordBatch::fetchRow()
+{
+    sm::sp_cpsm_tplsch_t scanCtx = fScanCtx.lock();
+    uint64_t row = scanCtx->rowsreturned;
+
+    // rowsreturned starts over with every RowGroup
+    if (row == 0 || row < fFirstRow || row >= fFirstRow + fRowCount)
+        convert(row);
+
+    memcpy(fTable->record[0], record(row - fFirstRow), fRecLength);
+
+    if (fHasOnFetchColumns)
+    {
+        Row r;
+        scanCtx->rowGroup->initRow(&r);
+        scanCtx->rowGroup->getRow(row, &r);
+
+        for (uint32_t i = 0; i < fColumns.size(); i++)
+            if (fColumns[i].conversion == STORE_ON_FETCH)
+                storeFieldValue(fColumns[i].field, r, fColumns[i].rgPos,
+                                scanCtx->ctp[fColumns[i].colTypeIndex]);
+    }
+}
+
+void RecordBatch::convert(uint64_t firstRow)
+{
+    sm::sp_cpsm_tplsch_t scanCtx = fScanCtx.lock();
+    RowGroup* rowGroup = scanCtx->rowGroup;
+    uint32_t nullFlagsOffset = fTable->null_flags - fTable->record[0];
+    uint32_t i;
+    Row row;
+
+    fFirstRow = firstRow;
+    fRowCount = min<uint64_t>(rowGroup->getRowCount() - firstRow,
+                              max<uint64_t>(1, RECORD_BATCH_SIZE / fRecLength));
+    fRecords.resize((size_t) fRowCount * fRecLength);
+
+    // every image starts with all of its fields NULL
+    for (i = 0; i < fRowCount; i++)
+    {
+        memcpy(record(i), fTable->s->default_values, fRecLength);
+        memset(record(i) + nullFlagsOffset, -1, fTable->s->null_bytes);
+    }
+
+    rowGroup->initRow(&row);
+
+    for (vector<Column>::const_iterator c = fColumns.begin(); c != fColumns.end(); ++c)
+    {
+        //This col is going to be written
+        bitmap_set_bit(fTable->write_set, c->field->field_index);
+
+        if (c->conversion == SKIP || c->conversion == STORE_ON_FETCH)
+            continue;
+
+        rowGroup->getRow(firstRow, &row);
+
+        switch (c->conversion)
+        {
+            case STORE_INT8:
+                storeIntColumn<uint8_t>(*c, row);
+                break;
+
+            case STORE_INT16:
+                storeIntColumn<uint16_t>(*c, row);
+                break;
+
+            case STORE_INT32:
+                storeIntColumn<uint32_t>(*c, row);
+                break;
+
+            case STORE_INT64:
+                storeIntColumn<uint64_t>(*c, row);
+                break;
+
+            case STORE_FLOAT:
+                storeFloatColumn(*c, row);
+                break;
+
+            case STORE_DOUBLE:
+                storeDoubleColumn(*c, row);
+                break;
+
+            case STORE_DATE:
+                storeDateColumn(*c, row);
+                break;
+
+            default:
+                storeFieldColumn(*c, row);
+                break;
+        }
+    }
+}
+
+// MariaDB integers are little endian like the RowGroup ones, the bits are copied as they are
+template<typename T>
+void RecordBatch::storeIntColumn(const Column& c, Row& row)
+{
+    T nullValue = static_cast<T>(c.nullValue);
+
+    for (uint32_t i = 0; i < fRowCount; i++, row.nextRow())
+    {
+        T val = static_cast<T>(row.getUintField<sizeof(T)>(c.rgPos));
+
+        if (c.checkNull && val == nullValue)
+            continue;
+
+        uchar* rec = record(i);
+        setNotNull(c, rec);
+        memcpy(rec + c.offset, &val, sizeof(T));
+    }
+}
+
+void RecordBatch::storeFloatColumn(const Column& c, Row& row)
+{
+    uint32_t nullValue = static_cast<uint32_t>(c.nullValue);
+
+    for (uint32_t i = 0; i < fRowCount; i++, row.nextRow())
+    {
+        if (c.checkNull && row.getUintField<4>(c.rgPos) == nullValue)
+            continue;
+
+        uchar* rec = record(i);
+        float val = row.getFloatField(c.rgPos);
+
+        // infinity is stored as NULL, leave the odd values to StoreFieldMariaDB
+        if (!std::isfinite(val))
+        {
+            storeField(c, row, rec);
+            continue;
+        }
+
+        // Field_float::store() turns -0 into 0
+        if (val == 0)
+            val = 0;
+
+        setNotNull(c, rec);
+        float4store(rec + c.offset, val);
+    }
+}
+
+void RecordBatch::storeDoubleColumn(const Column& c, Row& row)
+{
+    for (uint32_t i = 0; i < fRowCount; i++, row.nextRow())
+    {
+        if (c.checkNull && row.getUintField<8>(c.rgPos) == c.nullValue)
+            continue;
+
+        uchar* rec = record(i);
+        double val = row.getDoubleField(c.rgPos);
+
+        if (!std::isfinite(val))
+        {
+            storeField(c, row, rec);
+            continue;
+        }
+
+        // -0 stays -0, see StoreFieldMariaDB::store_double()
+        setNotNull(c, rec);
+        float8store(rec + c.offset, val);
+    }
+}
+
+void RecordBatch::storeDateColumn(const Column& c, Row& row)
+{
+    uint32_t nullValue = static_cast<uint32_t>(c.nullValue);
+
+    for (uint32_t i = 0; i < fRowCount; i++, row.nextRow())
+    {
+        uint32_t val = row.getUintField<4>(c.rgPos);
+
+        if (c.checkNull && val == nullValue)
+            continue;
+
+        uchar* rec = record(i);
+        uint32_t day = (val >> 6) & 0x3f;
+        uint32_t month = (val >> 12) & 0xf;
+        uint32_t year = val >> 16;
+
+        // zero and invalid dates (Feb 30, Feb 29 off a leap year) depend on
+        // the sql_mode, let the field decide
+        if (day == 0 || month == 0 || month > 12 || year > 9999 ||
+                day > dataconvert::getDaysInMonth(month, year))
+        {
+            storeField(c, row, rec);
+            continue;
+        }
+
+        // Field_newdate's 3 byte format
+        setNotNull(c, rec);
+        int3store(rec + c.offset, day | (month << 5) | (year << 9));
+    }
+}
+
+void RecordBatch::storeFieldColumn(const Column& c, Row& row)
+{
+    for (uint32_t i = 0; i < fRowCount; i++, row.nextRow())
+        storeField(c, row, record(i));
+}
+
+void RecordBatch::storeField(const Column& c, Row& row, uchar* rec)
+{
+    sm::sp_cpsm_tplsch_t scanCtx = fScanCtx.lock();
+    MovedField moved(c.field, rec - fTable->record[0]);
+
+    storeFieldValue(c.field, row, c.rgPos, scanCtx->ctp[c.colTypeIndex]);
+}
+
+}
+// vim:ts=4 sw=4:
@@ -0,0 +1,133 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#ifndef HA_MCS_RECORDBATCH_H__
+#define HA_MCS_RECORDBATCH_H__
+
+#include <stdint.h>
+#include <vector>
+#include <boost/weak_ptr.hpp>
+
+#include "idb_mysql.h"
+#include "calpontsystemcatalog.h"
+#include "rowgroup.h"
+#include "sm.h"
+
+namespace cal_impl_if
+{
+
+/** @brief Stores the value of a RowGroup column into a MariaDB field
+ *
+ * This is the conversion fetchNextRow() used to do for every column of every
+ * row.  A NULL value leaves the field NULL.
+ */
+void storeFieldValue(Field* field, rowgroup::Row& row, int pos,
+                     const execplan::CalpontSystemCatalog::ColType& colType);
+
+/** @brief Converts the rows of a scan into MariaDB records a column at a time
+ *
+ * fetchNextRow() hands the server one record per call.  Instead of converting
+ * every field of that record on the spot, a RecordBatch converts a range of
+ * rows of the current RowGroup into an array of record images, one column after
+ * the other, and fetchNextRow() copies the image of the next row.
+ *
+ * The mapping from the fields of the table to the RowGroup columns and the
+ * conversion used for each are worked out once per scan.  Integers, FLOAT,
+ * DOUBLE and DATE columns whose field has the same representation are written
+ * straight into the record images in loops specialized by type.  The other
+ * columns go through their TypeHandler with the field moved over each image.
+ * The few fields that keep their value outside of the record, like a TEXT field
+ * filled from a VARCHAR column, are still converted when their row is fetched.
+ */
+class RecordBatch
+{
+public:
+    RecordBatch(TABLE* table, const sm::sp_cpsm_tplsch_t& scanCtx);
+
+    /** @brief Returns true if this batch converts the rows of scanCtx for table */
+    bool isFor(const TABLE* table, const sm::sp_cpsm_tplsch_t& scanCtx) const
+    {
+        return fTable == table && fScanCtx.lock() == scanCtx;
+    }
+
+    /** @brief Puts the record of the current row of the scan into record[0] */
+    void fetchRow();
+
+private:
+    enum Conversion
+    {
+        SKIP,       // not projected by the job list
+        STORE_INT8,
+        STORE_INT16,
+        STORE_INT32,
+        STORE_INT64,
+        STORE_FLOAT,
+        STORE_DOUBLE,
+        STORE_DATE,
+        STORE_FIELD,    // TypeHandler, into the record images
+        STORE_ON_FETCH  // TypeHandler, into record[0] when the row is fetched
+    };
+
+    struct Column
+    {
+        Field* field;
+        uint32_t colTypeIndex;  // in the scan's ctp
+        int rgPos;              // column in the RowGroup
+        Conversion conversion;
+        bool checkNull;
+        uint64_t nullValue;     // the RowGroup null of the STORE_* columns
+        uint32_t offset;        // of the field in the record
+        int32_t nullOffset;     // of the null byte in the record, -1 if the field is NOT NULL
+        uint8_t nullBit;
+    };
+
+    static Conversion pickConversion(Field* field, const execplan::CalpontSystemCatalog::ColType& colType,
+                                     const rowgroup::RowGroup& rowGroup, uint32_t rgPos);
+    void convert(uint64_t firstRow);
+
+    template<typename T>
+    void storeIntColumn(const Column& c, rowgroup::Row& row);
+    void storeFloatColumn(const Column& c, rowgroup::Row& row);
+    void storeDoubleColumn(const Column& c, rowgroup::Row& row);
+    void storeDateColumn(const Column& c, rowgroup::Row& row);
+    void storeFieldColumn(const Column& c, rowgroup::Row& row);
+    void storeField(const Column& c, rowgroup::Row& row, uchar* record);
+
+    uchar* record(uint32_t i)
+    {
+        return &fRecords[(size_t) i * fRecLength];
+    }
+    void setNotNull(const Column& c, uchar* record)
+    {
+        if (c.nullOffset >= 0)
+            record[c.nullOffset] &= ~c.nullBit;
+    }
+
+    TABLE* fTable;
+    boost::weak_ptr<sm::cpsm_tplsch_t> fScanCtx;
+    std::vector<Column> fColumns;
+    bool fHasOnFetchColumns;
+    uint32_t fRecLength;
+    std::vector<uchar> fRecords;
+    uint64_t fFirstRow;     // the RowGroup row of the first record image
+    uint32_t fRowCount;     // number of record images
+};
+
+}
+
+#endif
+// vim:ts=4 sw=4:
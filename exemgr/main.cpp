@@ -654,19 +654,36 @@ private:
         jl->doQuery();
 
         FEMsgHandler msgHandler(jl, &fIos);
+        auto* statisticsManager = statistics::StatisticsManager::instance();
+        auto outRG = (static_cast<joblist::TupleJobList*>(jl.get()))->getOutputRowGroup();
+        statistics::ColumnStatisticsCollector columnStatsCollector(outRG);
+        rowgroup::RGData rgData;
+        uint64_t rowCount = 0;
+        uint32_t bandRowCount;
 
+        // Key types come from the first `RowGroup`, column statistics from all of them.
         msgHandler.start();
-        auto rowCount = jl->projectTable(100, bs);
+        while ((bandRowCount = jl->projectTable(100, bs)) > 0)
+        {
+            rgData.deserialize(bs);
+            outRG.setData(&rgData);
+
+            if (rowCount == 0)
+                statisticsManager->analyzeColumnKeyTypes(outRG, caep.traceOn());
+
+            columnStatsCollector.add(outRG);
+            rowCount += bandRowCount;
+        }
         msgHandler.stop();
 
-        auto outRG = (static_cast<joblist::TupleJobList*>(jl.get()))->getOutputRowGroup();
+        if (jl->status() != 0)
+            throw std::runtime_error(jl->errMsg());
 
         if (caep.traceOn())
             std::cout << "Row count " << rowCount << std::endl;
 
-        // Process `RowGroup`, increase an epoch and save statistics to the file.
-        auto* statisticsManager = statistics::StatisticsManager::instance();
-        statisticsManager->analyzeColumnKeyTypes(outRG, caep.traceOn());
+        // Increase an epoch and save statistics to the file.
+        statisticsManager->setColumnStatistics(columnStatsCollector.finish(), caep.traceOn());
         statisticsManager->incEpoch();
         statisticsManager->saveToFile();
 
@@ -1610,6 +1627,16 @@ void cleanTempDir()
           "RowAggregation",
           "AllowDiskBasedAggregation",
           TempDirPurpose::Aggregates
+      },
+      {
+          "WindowFunction",
+          "AllowDiskBasedWindowFunction",
+          TempDirPurpose::WindowFunctions
+      },
+      {
+          "OrderByLimit",
+          "AllowDiskBasedOrderBy",
+          TempDirPurpose::OrderBy
       }
   };
   const auto config = config::Config::makeConfig();
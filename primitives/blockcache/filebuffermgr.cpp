@@ -32,6 +32,9 @@
 //#define NDEBUG
 #include <cassert>
 #include <limits>
+#include <algorithm>
+#include <cstring>
+#include <new>
 #include <boost/thread.hpp>
 
 #ifndef _MSC_VER
@@ -55,6 +58,8 @@ extern uint32_t gSession;
 namespace dbbc
 {
 const uint32_t gReportingFrequencyMin(32768);
+// the blocks held by one compressed chunk
+const uint32_t gChunkBlocks((4 * 1024 * 1024) / BLOCK_SIZE);
 
 FileBufferMgr::FileBufferMgr(const uint32_t numBlcks, const uint32_t blkSz, const uint32_t deleteBlocks)
     : fMaxNumBlocks(numBlcks),
@@ -66,11 +71,25 @@ FileBufferMgr::FileBufferMgr(const uint32_t numBlcks, const uint32_t blkSz, cons
       fFBPool(),
       fDeleteBlocks(deleteBlocks),
       fEmptyPoolSlots(),
+      fChunkBytes(0),
+      fMaxChunkBytes(0),
       fReportFrequency(0)
 {
     fFBPool.reserve(numBlcks);
     fConfig = Config::makeConfig();
     setReportingFrequency(0);
+
+    // CompressedCacheSize is split between the NumCaches caches like the block budget
+    string val = fConfig->getConfig("DBBC", "CompressedCacheSize");
+
+    if (val.length() > 0)
+    {
+        int64_t numCaches = Config::fromText(fConfig->getConfig("DBBC", "NumCaches"));
+        int64_t bytes = Config::fromText(val);
+
+        if (bytes > 0)
+            fMaxChunkBytes = bytes / std::max<int64_t>(numCaches, 1);
+    }
 #ifdef _MSC_VER
     fLog.open("C:/Calpont/log/trace/bc", ios_base::app | ios_base::ate);
 #else
@@ -118,6 +137,13 @@ void FileBufferMgr::flushCache()
     }
     fCacheSize = 0;
 
+    {
+        boost::mutex::scoped_lock cmpLk(fCmpLock);
+        fChunkMap.clear();
+        fChunkList.clear();
+        fChunkBytes = 0;
+    }
+
     // the block pool should not be freed in the above block to allow us
     // to continue doing concurrent unprotected-but-"safe" memcpys
     // from that memory
@@ -134,6 +160,8 @@ void FileBufferMgr::flushOne(const BRM::LBID_t lbid, const BRM::VER_t ver)
     //similar in function to depleteCache()
     boost::mutex::scoped_lock lk(fWLock);
 
+    flushChunks(lbid, lbid);
+
     filebuffer_uset_iter_t iter = fbSet.find(HashObject_t(lbid, ver, 0));
 
     if (iter != fbSet.end())
@@ -171,6 +199,7 @@ void FileBufferMgr::flushMany(const LbidAtVer* laVptr, uint32_t cnt)
     {
         lbid = static_cast<BRM::LBID_t>(laVptr->LBID);
         ver = static_cast<BRM::VER_t>(laVptr->Ver);
+        flushChunks(lbid, lbid);
         iter = fbSet.find(HashObject_t(lbid, ver, 0));
 
         if (iter != fbSet.end())
@@ -212,6 +241,9 @@ void FileBufferMgr::flushManyAllversion(const LBID_t* laVptr, uint32_t cnt)
         fLog << endl;
     }
 
+    for (uint32_t i = 0; i < cnt; i++)
+        flushChunks(laVptr[i], laVptr[i]);
+
     if (fCacheSize == 0 || cnt == 0)
         return;
 
@@ -267,7 +299,7 @@ void FileBufferMgr::flushOIDs(const uint32_t* oids, uint32_t count)
 
     boost::mutex::scoped_lock lk(fWLock);
 
-    if (fCacheSize == 0 || count == 0)
+    if ((fCacheSize == 0 && !chunksCached()) || count == 0)
         return;
 
     /* Index the cache by LBID */
@@ -292,6 +324,8 @@ void FileBufferMgr::flushOIDs(const uint32_t* oids, uint32_t count)
             EMEntry& range = extents[currentExtent];
             LBID_t lastLBID = range.range.start + (range.range.size * 1024);
 
+            flushChunks(range.range.start, lastLBID - 1);
+
             for (currentLBID = range.range.start; currentLBID < lastLBID;
                     currentLBID++)
             {
@@ -342,7 +376,7 @@ void FileBufferMgr::flushPartition(const vector<OID_t>& oids, const set<BRM::Log
         fLog << endl;
     }
 
-    if (fCacheSize == 0 || oids.size() == 0 || partitions.size() == 0)
+    if ((fCacheSize == 0 && !chunksCached()) || oids.size() == 0 || partitions.size() == 0)
         return;
 
     /* Index the cache by LBID */
@@ -372,6 +406,8 @@ void FileBufferMgr::flushPartition(const vector<OID_t>& oids, const set<BRM::Log
 
             LBID_t lastLBID = range.range.start + (range.range.size * 1024);
 
+            flushChunks(range.range.start, lastLBID - 1);
+
             for (currentLBID = range.range.start; currentLBID < lastLBID; currentLBID++)
             {
                 itList = byLBID.equal_range(currentLBID);
@@ -408,9 +444,11 @@ FileBuffer* FileBufferMgr::findPtr(const HashObject_t& keyFb)
         FileBuffer* fb = &(fFBPool[it->poolIdx]);
         fFBPool[it->poolIdx].listLoc()->hits++;
         fbList.splice( fbList.begin(), fbList, (fFBPool[it->poolIdx]).listLoc() );
+        Stats::cacheHits(UNCOMPRESSED_TIER);
         return fb;
     }
 
+    Stats::cacheMisses(UNCOMPRESSED_TIER);
     return NULL;
 }
 
@@ -431,6 +469,11 @@ bool FileBufferMgr::find(const HashObject_t& keyFb, FileBuffer& fb)
         ret = true;
     }
 
+    if (ret)
+        Stats::cacheHits(UNCOMPRESSED_TIER);
+    else
+        Stats::cacheMisses(UNCOMPRESSED_TIER);
+
     return ret;
 }
 
@@ -476,6 +519,11 @@ bool FileBufferMgr::find(const HashObject_t& keyFb, void* bufferPtr)
         ret = true;
     }
 
+    if (ret)
+        Stats::cacheHits(UNCOMPRESSED_TIER);
+    else
+        Stats::cacheMisses(UNCOMPRESSED_TIER);
+
     return ret;
 }
 
@@ -553,6 +601,8 @@ uint32_t FileBufferMgr::bulkFind(const BRM::LBID_t* lbids, const BRM::VER_t* ver
         it[i].filebuffer_uset_iter_t::~filebuffer_uset_iter_t();
     }
 
+    Stats::cacheHits(UNCOMPRESSED_TIER, ret);
+    Stats::cacheMisses(UNCOMPRESSED_TIER, count - ret);
     return ret;
 }
 
@@ -660,6 +710,7 @@ int FileBufferMgr::insert(const BRM::LBID_t lbid, const BRM::VER_t ver, const ui
 
         fbList.pop_back();
         fCacheSize--;
+        Stats::cacheEvictions(UNCOMPRESSED_TIER);
         depleteCache();
         ret = 1;
     }
@@ -725,6 +776,7 @@ void FileBufferMgr::depleteCache()
 
         fbList.pop_back();
         fCacheSize--;
+        Stats::cacheEvictions(UNCOMPRESSED_TIER);
     }
 }
 
@@ -761,6 +813,7 @@ void FileBufferMgr::updateLRU(const FBData_t& f)
         fbList.splice(fbList.begin(), fbList, last);
         fbdata = f;
         fCacheSize--;
+        Stats::cacheEvictions(UNCOMPRESSED_TIER);
         //cout << "booted an entry\n";
     }
     else
@@ -862,5 +915,101 @@ int FileBufferMgr::bulkInsert(const vector<CacheInsert_t>& ops)
     return ret;
 }
 
+// The compressed tier keeps chunks exactly as they are stored in the segment
+// files, so a budget holds several times the blocks the uncompressed tier would.
+// A hit saves the read; the chunk is still decompressed into the block tier.
+bool FileBufferMgr::findChunk(const LBID_t lbid, const uint64_t offset, const uint32_t size, char* buf)
+{
+    if (fMaxChunkBytes == 0)
+        return false;
+
+    boost::shared_array<char> data;
+
+    {
+        boost::mutex::scoped_lock lk(fCmpLock);
+        chunk_map_t::iterator it = fChunkMap.find(lbid);
+
+        if (it != fChunkMap.end())
+        {
+            if (it->second->offset == offset && it->second->size == size)
+            {
+                fChunkList.splice(fChunkList.begin(), fChunkList, it->second);
+                data = it->second->data;
+            }
+            else
+                eraseChunk(it);		// the chunk has been rewritten since
+        }
+    }
+
+    if (!data)
+    {
+        Stats::cacheMisses(COMPRESSED_TIER);
+        return false;
+    }
+
+    // the array can't be freed under us, so the copy is done unlocked
+    memcpy(buf, data.get(), size);
+    Stats::cacheHits(COMPRESSED_TIER);
+    return true;
+}
+
+void FileBufferMgr::insertChunk(const LBID_t lbid, const uint64_t offset, const uint32_t size, const char* data)
+{
+    // a chunk that would age out most of the tier isn't worth keeping
+    if (size == 0 || size > fMaxChunkBytes / 4)
+        return;
+
+    boost::shared_array<char> copy(new (nothrow) char[size]);
+
+    if (!copy)
+        return;
+
+    memcpy(copy.get(), data, size);
+
+    boost::mutex::scoped_lock lk(fCmpLock);
+    chunk_map_t::iterator it = fChunkMap.find(lbid);
+
+    if (it != fChunkMap.end())
+        eraseChunk(it);
+
+    while (!fChunkList.empty() && fChunkBytes + size > fMaxChunkBytes)
+    {
+        eraseChunk(fChunkMap.find(fChunkList.back().lbid));
+        Stats::cacheEvictions(COMPRESSED_TIER);
+    }
+
+    fChunkList.push_front(CompressedChunk(lbid, offset, size));
+    fChunkList.front().data = copy;
+    fChunkMap[lbid] = fChunkList.begin();
+    fChunkBytes += size;
+}
+
+void FileBufferMgr::flushChunks(const LBID_t first, const LBID_t last)
+{
+    boost::mutex::scoped_lock lk(fCmpLock);
+
+    if (fChunkMap.empty())
+        return;
+
+    // the first chunk that may hold block 'first'
+    chunk_map_t::iterator it = fChunkMap.upper_bound(first - gChunkBlocks);
+
+    while (it != fChunkMap.end() && it->first <= last)
+        eraseChunk(it++);
+}
+
+bool FileBufferMgr::chunksCached() const
+{
+    boost::mutex::scoped_lock lk(fCmpLock);
+    return !fChunkMap.empty();
+}
+
+// the caller holds fCmpLock
+void FileBufferMgr::eraseChunk(chunk_map_t::iterator it)
+{
+    fChunkBytes -= it->second->size;
+    fChunkList.erase(it->second);
+    fChunkMap.erase(it);
+}
 
 }
@@ -33,7 +33,10 @@
 #include <unordered_set>
 #endif
 #include <boost/thread.hpp>
+#include <boost/shared_array.hpp>
 #include <deque>
+#include <list>
+#include <map>
 
 #include "primitivemsg.h"
 #include "blocksize.h"
@@ -73,6 +76,21 @@ struct CacheInsert_t
     const uint8_t* data;
 };
 
+/**
+ * @brief a compressed chunk kept in the compressed tier of the cache
+ *
+ * A chunk is found by the LBID of its first block and is only used while
+ * the compression header still places it at offset with the same size.
+ **/
+struct CompressedChunk
+{
+    CompressedChunk(BRM::LBID_t l, uint64_t o, uint32_t s) : lbid(l), offset(o), size(s) { }
+    BRM::LBID_t lbid;
+    uint64_t offset;
+    uint32_t size;
+    boost::shared_array<char> data;
+};
+
 typedef FileBufferIndex HashObject_t;
 
 class bcHasher
@@ -110,6 +128,9 @@ public:
 
     typedef std::deque<uint32_t> emptylist_t;
 
+    typedef std::list<CompressedChunk> chunk_list_t;
+    typedef std::map<BRM::LBID_t, chunk_list_t::iterator> chunk_map_t;
+
     /**
      * @brief ctor. Set max buffer size to numBlcks and block buffer size to blckSz
      **/
@@ -185,6 +206,26 @@ public:
     uint32_t bulkFind(const BRM::LBID_t* lbids, const BRM::VER_t* vers, uint8_t** buffers,
                       bool* wasCached, uint32_t blockCount);
 
+    /**
+     * @brief copy the compressed chunk starting at lbid into buf if it is cached at offset/size
+     **/
+    bool findChunk(const BRM::LBID_t lbid, const uint64_t offset, const uint32_t size, char* buf);
+
+    /**
+     * @brief add a compressed chunk to the compressed tier, aging out the lru chunks
+     **/
+    void insertChunk(const BRM::LBID_t lbid, const uint64_t offset, const uint32_t size, const char* data);
+
+    /**
+     * @brief drop the compressed chunks holding any of the blocks [first, last]
+     **/
+    void flushChunks(const BRM::LBID_t first, const BRM::LBID_t last);
+
+    uint64_t maxChunkCacheSize() const
+    {
+        return fMaxChunkBytes;
+    }
+
     uint32_t maxCacheSize() const
     {
         return fMaxNumBlocks;
@@ -223,7 +264,16 @@ private:
     uint32_t fDeleteBlocks;
     emptylist_t fEmptyPoolSlots;	//keep track of FBPool slots that can be reused
 
+    // the compressed tier, with its own lock; fCmpLock is never held while taking fWLock
+    mutable boost::mutex fCmpLock;
+    chunk_list_t fChunkList;
+    chunk_map_t fChunkMap;
+    uint64_t fChunkBytes;
+    uint64_t fMaxChunkBytes;	// 0 disables the compressed tier
+
     void depleteCache();
+    bool chunksCached() const;
+    void eraseChunk(chunk_map_t::iterator it);
     uint64_t fBlksLoaded; // number of blocks inserted into cache
     uint64_t fBlksNotUsed; // number of blocks inserted and not used
     uint64_t fReportFrequency; // how many blocks are read between reports
@@ -0,0 +1,267 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include "mcsconfig.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stddef.h>
+#include <iostream>
+#include <sys/uio.h>
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "ioengine.h"
+
+using namespace std;
+
+namespace
+{
+const size_t pageSize = 4096;
+}
+
+namespace dbbc
+{
+
+IOEngine::IOEngine(uint32_t depth, size_t bufferSize) :
+    fDepth(depth),
+    fBufferSize((bufferSize + pageSize - 1) & ~(pageSize - 1)),
+    fBuffers(depth),
+    fState(depth, SLOT_FREE),
+    fResult(depth, 0)
+{
+    // one allocation for all the slots, page aligned so that the reads
+    // may go through O_DIRECT file descriptors
+    fRealBuffer.reset(new char[fDepth * fBufferSize + pageSize]);
+    char* base = fRealBuffer.get();
+    base += (pageSize - ((ptrdiff_t) base % pageSize)) % pageSize;
+
+    for (uint32_t i = 0; i < fDepth; i++)
+        fBuffers[i] = base + i * fBufferSize;
+}
+
+void IOEngine::drain()
+{
+    for (uint32_t i = 0; i < fDepth; i++)
+    {
+        if (fState[i] != SLOT_FREE)
+            wait(i);
+    }
+}
+
+#ifdef HAVE_LIBURING
+namespace
+{
+
+class UringIOEngine : public IOEngine
+{
+public:
+    UringIOEngine(uint32_t depth, size_t bufferSize);
+    ~UringIOEngine();
+
+    bool init();
+
+    bool queue(int fd, uint64_t offset, uint32_t length, uint32_t slot);
+    bool submit();
+    ssize_t wait(uint32_t slot);
+
+private:
+    struct io_uring fRing;
+    bool fRingInitialized;
+    // the slot buffers are registered with the kernel, reads use the
+    // fixed buffer opcode and skip the per-I/O page pinning
+    bool fFixedBuffers;
+    bool fFailed;
+    uint32_t fQueued;
+};
+
+UringIOEngine::UringIOEngine(uint32_t depth, size_t bufferSize) :
+    IOEngine(depth, bufferSize),
+    fRingInitialized(false),
+    fFixedBuffers(false),
+    fFailed(false),
+    fQueued(0)
+{
+}
+
+UringIOEngine::~UringIOEngine()
+{
+    if (fRingInitialized)
+    {
+        drain();
+        io_uring_queue_exit(&fRing);
+    }
+}
+
+bool UringIOEngine::init()
+{
+    int rc = io_uring_queue_init(fDepth, &fRing, 0);
+
+    if (rc < 0)
+    {
+        cerr << "IOEngine: io_uring_queue_init failed: " << strerror(-rc) <<
+             "; using synchronous reads" << endl;
+        return false;
+    }
+
+    fRingInitialized = true;
+
+    vector<struct iovec> iov(fDepth);
+
+    for (uint32_t i = 0; i < fDepth; i++)
+    {
+        iov[i].iov_base = fBuffers[i];
+        iov[i].iov_len = fBufferSize;
+    }
+
+    // Registration pins the buffers and counts against RLIMIT_MEMLOCK.
+    // Plain reads into the same buffers still work if it is refused.
+    fFixedBuffers = (io_uring_register_buffers(&fRing, &iov[0], fDepth) == 0);
+    return true;
+}
+
+bool UringIOEngine::queue(int fd, uint64_t offset, uint32_t length, uint32_t slot)
+{
+    if (fFailed || fd < 0 || slot >= fDepth || length > fBufferSize ||
+            fState[slot] != SLOT_FREE)
+        return false;
+
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&fRing);
+
+    if (sqe == NULL)
+        return false;
+
+    if (fFixedBuffers)
+        io_uring_prep_read_fixed(sqe, fd, fBuffers[slot], length, offset, slot);
+    else
+        io_uring_prep_read(sqe, fd, fBuffers[slot], length, offset);
+
+    io_uring_sqe_set_data(sqe, (void*)(uintptr_t) slot);
+    fState[slot] = SLOT_QUEUED;
+    fQueued++;
+    return true;
+}
+
+bool UringIOEngine::submit()
+{
+    if (fQueued == 0)
+        return true;
+
+    int rc;
+
+    do
+    {
+        rc = io_uring_submit(&fRing);
+    }
+    while (rc == -EINTR);
+
+    if (rc < 0)
+    {
+        // The queued entries stay in the ring and are never submitted;
+        // their slots report the error and the caller reads with pread().
+        cerr << "IOEngine: io_uring_submit failed: " << strerror(-rc) <<
+             "; using synchronous reads" << endl;
+        fFailed = true;
+
+        for (uint32_t i = 0; i < fDepth; i++)
+        {
+            if (fState[i] == SLOT_QUEUED)
+            {
+                fState[i] = SLOT_DONE;
+                fResult[i] = rc;
+            }
+        }
+
+        fQueued = 0;
+        return false;
+    }
+
+    for (uint32_t i = 0; i < fDepth; i++)
+    {
+        if (fState[i] == SLOT_QUEUED)
+            fState[i] = SLOT_SUBMITTED;
+    }
+
+    fQueued = 0;
+    return true;
+}
+
+ssize_t UringIOEngine::wait(uint32_t slot)
+{
+    if (slot >= fDepth || fState[slot] == SLOT_FREE)
+        return 0;
+
+    if (fState[slot] == SLOT_QUEUED)
+        submit();
+
+    while (fState[slot] == SLOT_SUBMITTED)
+    {
+        struct io_uring_cqe* cqe;
+        int rc = io_uring_wait_cqe(&fRing, &cqe);
+
+        if (rc == -EINTR)
+            continue;
+
+        if (rc < 0)
+        {
+            fState[slot] = SLOT_FREE;
+            return rc;
+        }
+
+        uint32_t done = (uint32_t)(uintptr_t) io_uring_cqe_get_data(cqe);
+
+        if (done < fDepth)
+        {
+            fState[done] = SLOT_DONE;
+            fResult[done] = cqe->res;
+        }
+
+        io_uring_cqe_seen(&fRing, cqe);
+    }
+
+    fState[slot] = SLOT_FREE;
+    return fResult[slot];
+}
+
+}
+#endif
+
+IOEngine* IOEngine::makeIOEngine(const string& name, uint32_t depth, size_t bufferSize)
+{
+    if (depth < 2 || bufferSize == 0)
+        return NULL;
+
+    if (name == "uring")
+    {
+#ifdef HAVE_LIBURING
+        UringIOEngine* engine = new UringIOEngine(depth, bufferSize);
+
+        if (engine->init())
+            return engine;
+
+        delete engine;
+#else
+        cerr << "IOEngine: built without io_uring support; using synchronous reads" << endl;
+#endif
+    }
+
+    return NULL;
+}
+
+}
+// vim:ts=4 sw=4:
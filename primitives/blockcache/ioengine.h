@@ -0,0 +1,102 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#ifndef IOENGINE_H
+#define IOENGINE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+#include <boost/scoped_array.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace dbbc
+{
+
+/**
+ * An IOEngine keeps several reads of one thr_popper thread in flight at once.
+ *
+ * The engine owns depth() page aligned buffers ("slots") of bufferSize() bytes.
+ * A caller queues reads into free slots, hands the whole batch to the kernel
+ * with submit() and later collects each slot with wait().  A slot may be
+ * reused once wait() returned for it.  The synchronous pread() path in
+ * thr_popper is used whenever no engine is configured or available.
+ */
+class IOEngine : private boost::noncopyable
+{
+public:
+    virtual ~IOEngine() { }
+
+    /** Queue a read of length bytes at offset of fd into buffer(slot).
+     *  Nothing is sent to the kernel until submit().  Returns false if the
+     *  read can't be queued; the caller should fall back to pread().
+     */
+    virtual bool queue(int fd, uint64_t offset, uint32_t length, uint32_t slot) = 0;
+
+    /** Send every queued read to the kernel with one call.  Returns false on error. */
+    virtual bool submit() = 0;
+
+    /** Block until the read into slot has finished.  Returns the number of
+     *  bytes read or -errno.  Returns 0 if nothing is outstanding on slot.
+     */
+    virtual ssize_t wait(uint32_t slot) = 0;
+
+    /** Wait for every outstanding read, e.g. before a request is abandoned. */
+    void drain();
+
+    uint32_t depth() const
+    {
+        return fDepth;
+    }
+    size_t bufferSize() const
+    {
+        return fBufferSize;
+    }
+    char* buffer(uint32_t slot)
+    {
+        return fBuffers[slot];
+    }
+
+    /** Build the engine named by name ("uring" or "pread").  Returns NULL
+     *  for "pread", for unknown names and when the engine can't be set up
+     *  on this host, so that the caller keeps its synchronous path.
+     */
+    static IOEngine* makeIOEngine(const std::string& name, uint32_t depth, size_t bufferSize);
+
+protected:
+    IOEngine(uint32_t depth, size_t bufferSize);
+
+    enum SlotState
+    {
+        SLOT_FREE,
+        SLOT_QUEUED,
+        SLOT_SUBMITTED,
+        SLOT_DONE
+    };
+
+    uint32_t fDepth;
+    size_t fBufferSize;
+    boost::scoped_array<char> fRealBuffer;
+    std::vector<char*> fBuffers;
+    std::vector<SlotState> fState;
+    std::vector<ssize_t> fResult;
+};
+
+}
+#endif
+// vim:ts=4 sw=4:
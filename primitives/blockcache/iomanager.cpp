@@ -65,6 +65,7 @@
 #include <errno.h>
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/thread.hpp>
 #include <boost/thread/condition.hpp>
 #ifdef _MSC_VER
@@ -93,6 +94,7 @@ using namespace logging;
 #include "rwlock_local.h"
 
 #include "iomanager.h"
+#include "ioengine.h"
 #include "liboamcpp.h"
 
 #include "idbcompress.h"
@@ -135,6 +137,7 @@ const std::string boldStop = "\033[0;39m";
 
 const uint32_t MAX_OPEN_FILES = 16384;
 const uint32_t DECREASE_OPEN_FILES = 4096;
+const uint32_t IO_QUEUE_DEPTH = 4;
 
 void timespec_sub(const struct timespec& tv1,
                   const struct timespec& tv2,
@@ -423,6 +426,7 @@ void* thr_popper(ioManager* arg)
     uint32_t blocksRequested = 0;
     ssize_t i;
     char* alignedbuff = 0;
+    char* readBuf = 0;
     boost::scoped_array<char> realbuff;
     pthread_t threadId = 0;
     ostringstream iomLogFileName;
@@ -474,6 +478,13 @@ void* thr_popper(ioManager* arg)
     uint8_t* uCmpBuf = 0;
     uCmpBuf = new uint8_t[4 * 1024 * 1024 + 4];
 
+    // Multi-chunk reads of uncompressed files keep up to IOQueueDepth chunks
+    // in flight through the async engine, so the device works on the next
+    // chunks while this thread does the VSS lookups and cache inserts.
+    boost::scoped_ptr<IOEngine> ioEngine(
+        IOEngine::makeIOEngine(iom->IOEngineName(), iom->IOQueueDepth(),
+                               iom->blocksPerRead * BLOCK_SIZE));
+
     for ( ; ; )
     {
         if (copyLocked)
@@ -803,11 +814,52 @@ void* thr_popper(ioManager* arg)
         if (blocksRequested % iom->blocksPerRead)
             jend++;
 
+        // chunks [0, nextAsyncChunk) have been queued on the async engine
+        int asyncFd = -1;
+        uint32_t nextAsyncChunk = 0;
+
+        if (ioEngine && jend > 1 && !fdit->second->isCompressed())
+            asyncFd = fp->nativeHandle();
+
         for (j = 0; j < jend; j++)
         {
+            bool asyncPending = false;
+            readBuf = alignedbuff;
+
+            if (asyncFd >= 0)
+            {
+                // top up the queue; the slot of chunk j + depth - 1 was freed by chunk j - 1
+                uint32_t queued = 0;
+
+                for ( ; nextAsyncChunk < jend && nextAsyncChunk < j + ioEngine->depth(); nextAsyncChunk++)
+                {
+                    uint64_t chunkOffset = longSeekOffset +
+                                           (uint64_t)(nextAsyncChunk - j) * iom->blocksPerRead * BLOCK_SIZE;
+                    uint32_t chunkBlocks = std::min(dlen - (nextAsyncChunk - j) * iom->blocksPerRead,
+                                                    iom->blocksPerRead);
+
+                    if (!ioEngine->queue(asyncFd, chunkOffset, chunkBlocks * BLOCK_SIZE,
+                                         nextAsyncChunk % ioEngine->depth()))
+                        break;
+
+                    queued++;
+                }
+
+                if (queued > 0)
+                    ioEngine->submit();
+
+                if (j < nextAsyncChunk)
+                {
+                    asyncPending = true;
+                    readBuf = ioEngine->buffer(j % ioEngine->depth());
+                }
+            }
 
             int decompRetryCount = 0;
             int retryReadHeadersCount = 0;
+            // the compressed tier knows a chunk by the LBID of its first block
+            const BRM::LBID_t chunkLBID = lbid - cmpOffFact.rem / BLOCK_SIZE;
+            bool chunkFromDisk = false;
 
 decompRetry:
             blocksThisRead = std::min(dlen, iom->blocksPerRead);
@@ -905,7 +957,16 @@ retryReadHeaders:
                         break;
                     }
 
-                    i = fp->pread(&alignedbuff[0], fdit->second->ptrList[idx].first, fdit->second->ptrList[idx].second );
+                    // a request that bypasses the cache doesn't take from it either
+                    chunkFromDisk = !useCache ||
+                                    !fbm->findChunk(chunkLBID, fdit->second->ptrList[idx].first,
+                                                    fdit->second->ptrList[idx].second, &alignedbuff[0]);
+
+                    if (chunkFromDisk)
+                        i = fp->pread(&alignedbuff[0], fdit->second->ptrList[idx].first, fdit->second->ptrList[idx].second );
+                    else
+                        i = fdit->second->ptrList[idx].second;
+
 #ifdef IDB_COMP_POC_DEBUG
                     {
                         boost::mutex::scoped_lock lk(primitiveprocessor::compDebugMutex);
@@ -947,16 +1008,28 @@ retryReadHeaders:
                         }
                     }
 
-                    compressedBytesRead += i; // @Bug 3149.
+                    if (chunkFromDisk)
+                        compressedBytesRead += i; // @Bug 3149.
+
                     i = readSize;
                 }
                 else
                 {
-                    i = fp->pread(&alignedbuff[acc], longSeekOffset, readSize - acc);
+                    i = -1;
+
+                    if (asyncPending)
+                    {
+                        // A failed or short async read is retried or finished with pread
+                        asyncPending = false;
+                        i = ioEngine->wait(j % ioEngine->depth());
+                    }
+
+                    if (i <= 0)
+                        i = fp->pread(&readBuf[acc], longSeekOffset, readSize - acc);
 #ifdef IDB_COMP_POC_DEBUG
                     {
                         boost::mutex::scoped_lock lk(primitiveprocessor::compDebugMutex);
-                        cout << "pread1.2(" << fp << ", 0x" << hex << (ptrdiff_t)&alignedbuff[acc] << dec << ", " << (readSize - acc) <<
+                        cout << "pread1.2(" << fp << ", 0x" << hex << (ptrdiff_t)&readBuf[acc] << dec << ", " << (readSize - acc) <<
                              ", " << longSeekOffset << ") = " << i << ' ' << cmpOffFact.quot << ' ' << cmpOffFact.rem << endl;
                     }
 #endif
@@ -1070,6 +1143,9 @@ retryReadHeaders:
 #ifdef IDB_COMP_POC_DEBUG
                         boost::mutex::scoped_lock lk(primitiveprocessor::compDebugMutex);
 #endif
+                        // don't let the retry find the same bytes again
+                        if (!chunkFromDisk)
+                            fbm->flushChunks(chunkLBID, chunkLBID);
 
                         if (++decompRetryCount < 30)
                         {
@@ -1105,6 +1181,11 @@ retryReadHeaders:
                         break;
                     }
 
+                    // only chunks that decompressed go into the compressed tier
+                    if (chunkFromDisk && useCache)
+                        fbm->insertChunk(chunkLBID, fdit->second->ptrList[cmpOffFact.quot].first,
+                                         fdit->second->ptrList[cmpOffFact.quot].second, &alignedbuff[0]);
+
                     //FIXME: why doesn't this work??? (See later for why)
                     //ptr = &uCmpBuf[cmpOffFact.rem];
                     memcpy(ptr, &uCmpBuf[cmpOffFact.rem], blocksThisRead * BLOCK_SIZE);
@@ -1171,7 +1252,7 @@ retryReadHeaders:
                         }
 #endif
                         cacheInsertOps.push_back(CacheInsert_t(lbids[i], versions[i], (uint8_t*)
-                                                               &alignedbuff[i * BLOCK_SIZE]));
+                                                               &readBuf[i * BLOCK_SIZE]));
                     }
                 }
 
@@ -1186,6 +1267,10 @@ retryReadHeaders:
 
         } // for (j...
 
+        // nothing may still be reading into the slots or from fp once inUse drops
+        if (asyncFd >= 0)
+            ioEngine->drain();
+
         fdMapMutex.lock();
 
         if (fdit->second.get())
@@ -1359,6 +1444,20 @@ ioManager::ioManager(FileBufferMgr& fbm,
 #endif
     }
 
+    fIOEngineName = fConfig->getConfig("DBBC", "IOEngine");
+
+    if (fIOEngineName.empty())
+        fIOEngineName = "pread";
+
+    val = fConfig->getConfig("DBBC", "IOQueueDepth");
+    temp = 0;
+    fIOQueueDepth = IO_QUEUE_DEPTH;
+
+    if (val.length() > 0) temp = static_cast<int>(Config::fromText(val));
+
+    if (temp > 1)
+        fIOQueueDepth = std::min(temp, 64);
+
     fThreadCount = thrCount;
     go();
 }
@@ -115,6 +115,18 @@ public:
         return fFDCacheTrace;
     }
 
+    // Name of the asynchronous read engine each reader thread builds ("pread" for none)
+    const std::string& IOEngineName() const
+    {
+        return fIOEngineName;
+    }
+
+    // Number of reads a reader thread keeps in flight when an async engine is used
+    uint32_t IOQueueDepth() const
+    {
+        return fIOQueueDepth;
+    }
+
     void handleBlockReadError ( fileRequest* fr,
                                 const std::string& errMsg, bool* copyLocked, int errorCode = fileRequest::FAILED );
 
@@ -153,6 +165,8 @@ private:
     uint32_t fDecreaseOpenFilesCount;
     bool fFDCacheTrace;
     std::ofstream fFDTraceFile;
+    std::string fIOEngineName;
+    uint32_t fIOQueueDepth;
 };
 
 // @bug2631, for remount filesystem by loadBlock() in primitiveserver
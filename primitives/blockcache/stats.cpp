@@ -33,6 +33,7 @@ typedef int pthread_t;
 #include <cassert>
 #include <csignal>
 #include <fstream>
+#include <atomic>
 using namespace std;
 
 #include <boost/thread.hpp>
@@ -182,6 +183,17 @@ TraceFileMap_t traceFileMap;
 //map mutex
 boost::mutex traceFileMapMutex;
 
+struct TierCounters
+{
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> evictions;
+};
+
+// zero initialized as statics
+TierCounters tierCounters[dbbc::CACHE_TIER_COUNT];
+const char* tierNames[dbbc::CACHE_TIER_COUNT] = { "uncompressed", "compressed" };
+
 class StatMon
 {
 public:
@@ -290,5 +302,31 @@ void Stats::markEvent(const uint64_t lbid, const pthread_t thdid, const uint32_t
     iter->second.log(lbid2oid(lbid), lbid, thdid, event);
 }
 
+void Stats::cacheHits(const CacheTier tier, const uint64_t count)
+{
+    tierCounters[tier].hits.fetch_add(count, std::memory_order_relaxed);
+}
+
+void Stats::cacheMisses(const CacheTier tier, const uint64_t count)
+{
+    tierCounters[tier].misses.fetch_add(count, std::memory_order_relaxed);
+}
+
+void Stats::cacheEvictions(const CacheTier tier, const uint64_t count)
+{
+    tierCounters[tier].evictions.fetch_add(count, std::memory_order_relaxed);
 }
 
+ostream& Stats::formatCacheStats(ostream& os)
+{
+    for (uint32_t i = 0; i < CACHE_TIER_COUNT; i++)
+    {
+        os << tierNames[i] << " tier: hits " << tierCounters[i].hits.load(std::memory_order_relaxed)
+           << " misses " << tierCounters[i].misses.load(std::memory_order_relaxed)
+           << " evictions " << tierCounters[i].evictions.load(std::memory_order_relaxed) << endl;
+    }
+
+    return os;
+}
+
+}
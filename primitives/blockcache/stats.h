@@ -39,6 +39,14 @@ typedef int pthread_t;
 namespace dbbc
 {
 
+/** @brief the tiers of the block cache Stats counts hits, misses and evictions for */
+enum CacheTier
+{
+    UNCOMPRESSED_TIER,	// 8KB blocks
+    COMPRESSED_TIER,	// compressed chunks as read from the segment files
+    CACHE_TIER_COUNT
+};
+
 class Stats
 {
 public:
@@ -49,6 +57,12 @@ public:
     void touchedLBID(uint64_t lbid, pthread_t thdid, uint32_t session = 0);
     void markEvent(const uint64_t lbid, const pthread_t thdid, const uint32_t session, const char event);
 
+    /** @brief per tier counters, summed over all the block caches of the process */
+    static void cacheHits(const CacheTier tier, const uint64_t count = 1);
+    static void cacheMisses(const CacheTier tier, const uint64_t count = 1);
+    static void cacheEvictions(const CacheTier tier, const uint64_t count = 1);
+    static std::ostream& formatCacheStats(std::ostream& os);
+
     inline BRM::OID_t lbid2oid(uint64_t lbid)
     {
         BRM::OID_t oid;
@@ -38,6 +38,8 @@ using namespace boost;
 #include "primproc.h"
 #include "dataconvert.h"
 #include "mcs_decimal.h"
+#include "simd.h"
+#include "vlarray.h"
 
 using namespace logging;
 using namespace dbbc;
@@ -972,194 +974,584 @@ inline void writeColValue(
     out->NVALS++;   //TODO: Can be computed at the end from *written value
 }
 
-/* WIP
-template <bool WRITE_RID, bool WRITE_DATA, bool IS_NULL_VALUE_MATCHES, typename FILTER_ARRAY_T, typename RID_T, typename T>
-void writeArray(
-    size_t dataSize,
-    const T* dataArray,
-    const RID_T* dataRid,
-    const FILTER_ARRAY_T *filterArray,
-    uint8_t* outbuf,
-    unsigned* written,
-    uint16_t* NVALS,
-    uint8_t* RidFlagsPtr,
-    T NULL_VALUE)
+/*****************************************************************************
+ *** RUN DATA THROUGH A COLUMN FILTER ****************************************
+ *****************************************************************************/
+
+/* "Vertical" processing of the column filter. Input is processed in chunks of
+   VERTICAL_CHUNK_SIZE values:
+   1. load the chunk (gathering it through ridArray if needed), mark EMPTY and NULL
+      values and update Min/Max in the same pass
+   2. process one filter element over the entire chunk before going to the next one,
+      accumulating results in a selection bitmap
+   3. write records, that successfully passed through the filter, to outbuf
+   Steps 1 and 2 work on whole SIMD vectors.  They are compiled for the baseline ISA,
+   SSE4.2 and AVX2, and the best version for the host is picked at runtime.
+*/
+
+// Must be a multiple of the number of bits in a bitmap word and of any vector lane count
+constexpr uint32_t VERTICAL_CHUNK_SIZE = 1024;
+constexpr uint32_t VERTICAL_CHUNK_WORDS = VERTICAL_CHUNK_SIZE / 64;
+
+inline void setSelectionBits(uint64_t* bitmap, uint32_t pos, uint64_t bits)
+{
+    bitmap[pos >> 6] |= bits << (pos & 63);
+}
+
+// Filter element prepared for the vertical processing
+template<typename CT>
+struct VerticalFilterElement
+{
+    uint8_t cop;
+    int8_t constResult;     // 0 or 1 if the result doesn't depend on the column value, -1 otherwise
+    CT value;               // value to compare to
+};
+
+// Everything the vertical filter needs to know about one call of filterColumnData
+template<typename T, typename CT>
+struct VerticalFilterArgs
+{
+    // Source data
+    const T* srcArray;
+    uint32_t srcSize;
+    const RID_T* ridArray;
+    uint32_t ridSize;
+    // Filter description
+    ColumnFilterMode columnFilterMode;
+    uint32_t filterCount;
+    const VerticalFilterElement<CT>* filters;   // for the comparison modes
+    const T* filterValues;                      // for the ONE/NONE_OF_VALUES_IN_ARRAY modes
+    T EMPTY_VALUE;
+    T NULL_VALUE;
+    bool isNullValueMatches;
+    // Output buffer/stats
+    uint8_t outputType;
+    NewColResultHeader* out;
+    unsigned outSize;
+    unsigned* written;
+    // Min/Max search
+    bool ValidMinMax;
+    T* Min;
+    T* Max;
+};
+
+// Vector width used for T: the int128 kernels work on one value at a time
+template<typename T, int VBYTES>
+struct VerticalVectorBytes
 {
-    uint8_t* out = outbuf;
-    uint8_t RidFlags = *RidFlagsPtr;
+    static constexpr int value = sizeof(T) <= sizeof(int64_t) ? VBYTES : 0;
+};
 
-    for (size_t i = 0; i < dataSize; ++i)
+// Kernels of the vertical filter, operating on n values (n is a multiple of LANES).
+// Bitmaps passed in must be cleared by the caller.
+template<typename T, typename CT, int VBYTES>
+struct VerticalKernels
+{
+    using VT = simd::Vec<T, VBYTES>;
+    using VC = simd::Vec<CT, VBYTES>;
+    static constexpr uint32_t LANES = VT::LANES;
+
+    template<uint8_t COP>
+    static MCS_FORCE_INLINE void compareOp(typename VC::mask_type& result,
+                                           const typename VC::type& a, const typename VC::type& b)
     {
-        //TODO: optimize handling of NULL values and flags by avoiding non-predictable jumps
-        if (dataArray[i]==NULL_VALUE? IS_NULL_VALUE_MATCHES : filterArray[i])
+        switch (COP)
         {
-            if (WRITE_RID)
-            {
-                copyValue(out, &dataRid[i], sizeof(RID_T));
-                out += sizeof(RID_T);
+            case COMPARE_LT: result = (a < b); break;
+            case COMPARE_LE: result = (a <= b); break;
+            case COMPARE_GT: result = (a > b); break;
+            case COMPARE_GE: result = (a >= b); break;
+            case COMPARE_NE: result = (a != b); break;
+            default:         result = (a == b); break;
+        }
+    }
 
-                RidFlags |= (1 << (dataRid[i] >> 10)); // set the (row/1024)'th bit
+    // Set bits of non-EMPTY non-NULL values in valid, and of NULL values in nulls.
+    template<bool MINMAX>
+    static MCS_FORCE_INLINE void classify(const T* values, uint32_t n, T EMPTY_VALUE, T NULL_VALUE,
+                                          uint64_t* valid, uint64_t* nulls, T& Min, T& Max)
+    {
+        typename VT::type vEmpty, vNull, vMin, vMax, v;
+        VT::broadcast(vEmpty, EMPTY_VALUE);
+        VT::broadcast(vNull, NULL_VALUE);
+        VT::broadcast(vMin, Min);
+        VT::broadcast(vMax, Max);
+
+        for (uint32_t i = 0; i < n; i += LANES)
+        {
+            VT::load(v, values + i);
+            typename VT::mask_type notEmpty = (v != vEmpty);
+            typename VT::mask_type isNull = (v == vNull);
+            typename VT::mask_type isValid = notEmpty & ~isNull;
+            setSelectionBits(valid, i, simd::movemask(isValid));
+            setSelectionBits(nulls, i, simd::movemask(notEmpty & isNull));
+
+            if (MINMAX)
+            {
+                VT::blend(vMin, isValid & (v < vMin), v);
+                VT::blend(vMax, isValid & (v > vMax), v);
             }
+        }
 
-            if (WRITE_DATA)
+        if (MINMAX)
+        {
+            for (uint32_t l = 0; l < LANES; l++)
             {
-                copyValue(out, &dataArray[i], sizeof(T));
-                out += sizeof(T);
+                if (vMin[l] < Min)
+                    Min = vMin[l];
+
+                if (vMax[l] > Max)
+                    Max = vMax[l];
             }
         }
     }
 
-    // Update number of written values, number of written bytes and out->RidFlags
-    int size1 = (WRITE_RID? sizeof(RID_T) : 0) + (WRITE_DATA? sizeof(T) : 0);
-    *NVALS += (out - outbuf) / size1;
-    *written += out - outbuf;
-    *RidFlagsPtr = RidFlags;
-}
-*/
+    // Set bits of values v for which (v COP filterValue) holds, comparing them as CT.
+    template<uint8_t COP>
+    static MCS_FORCE_INLINE void compare(const T* values, uint32_t n, CT filterValue, uint64_t* bits)
+    {
+        typename VC::type vFilter, v;
+        typename VC::mask_type result;
+        VC::broadcast(vFilter, filterValue);
 
-/*****************************************************************************
- *** RUN DATA THROUGH A COLUMN FILTER ****************************************
- *****************************************************************************/
+        for (uint32_t i = 0; i < n; i += LANES)
+        {
+            VC::load(v, values + i);  // reinterpret bits of T values as CT
+            compareOp<COP>(result, v, vFilter);
+            setSelectionBits(bits, i, simd::movemask(result));
+        }
+    }
+};
 
-/* "Vertical" processing of the column filter:
-   1. load all data into temporary vector
-   2. process one filter element over entire vector before going to a next one
-   3. write records, that succesfully passed through the filter, to outbuf
-*/
-/*
-template<typename T, ENUM_KIND KIND, typename VALTYPE>
-void processArray(
-    // Source data
-    const T* srcArray,
-    size_t srcSize,
-    uint16_t* ridArray,
-    size_t ridSize,                 // Number of values in ridArray
-    // Filter description
-    int BOP,
-    prestored_set_t* filterSet,     // Set of values for simple filters (any of values / none of them)
-    uint32_t filterCount,           // Number of filter elements, each described by one entry in the following arrays:
-    uint8_t* filterCOPs,            //   comparison operation
-    int64_t* filterValues,          //   value to compare to
-    // Output buffer/stats
-    uint8_t* outbuf,                // Pointer to the place for output data
-    unsigned* written,              // Number of written bytes, that we need to update
-    uint16_t* NVALS,                // Number of written values, that we need to update
-    uint8_t* RidFlagsPtr,           // Pointer to out->RidFlags
-    // Processing parameters
-    bool WRITE_RID,
-    bool WRITE_DATA,
-    bool SKIP_EMPTY_VALUES,
-    T EMPTY_VALUE,
-    bool IS_NULL_VALUE_MATCHES,
-    T NULL_VALUE,
-    // Min/Max search
-    bool ValidMinMax,
-    VALTYPE* MinPtr,
-    VALTYPE* MaxPtr)
+template<typename T, typename CT>
+struct VerticalKernels<T, CT, 0>
 {
-    // Alloc temporary arrays
-    size_t inputSize = (ridArray? ridSize : srcSize);
-
-    // Temporary array with data to filter
-    std::vector<T> dataVec(inputSize);
-    auto dataArray = dataVec.data();
-
-    // Temporary array with RIDs of corresponding dataArray elements
-    std::vector<RID_T> dataRidVec(WRITE_RID? inputSize : 0);
-    auto dataRid = dataRidVec.data();
+    static constexpr uint32_t LANES = 1;
 
+    template<uint8_t COP>
+    static MCS_FORCE_INLINE bool compareOp(const CT& a, const CT& b)
+    {
+        switch (COP)
+        {
+            case COMPARE_LT: return a < b;
+            case COMPARE_LE: return a <= b;
+            case COMPARE_GT: return a > b;
+            case COMPARE_GE: return a >= b;
+            case COMPARE_NE: return a != b;
+            default:         return a == b;
+        }
+    }
 
-    // Copy input data into temporary array, opt. storing RIDs, opt. skipping EMPTYs
-    size_t dataSize;  // number of values copied into dataArray
-    if (ridArray != NULL)
+    template<bool MINMAX>
+    static MCS_FORCE_INLINE void classify(const T* values, uint32_t n, T EMPTY_VALUE, T NULL_VALUE,
+                                          uint64_t* valid, uint64_t* nulls, T& Min, T& Max)
     {
-        SKIP_EMPTY_VALUES = true;  // let findMinMaxArray() know that empty values will be skipped
+        for (uint32_t i = 0; i < n; i++)
+        {
+            T v = values[i];
+            bool notEmpty = (v != EMPTY_VALUE);
+            bool isNull = (v == NULL_VALUE);
+            bool isValid = notEmpty && !isNull;
+            setSelectionBits(valid, i, isValid);
+            setSelectionBits(nulls, i, notEmpty && isNull);
+
+            if (MINMAX && isValid)
+            {
+                if (v < Min)
+                    Min = v;
 
-        dataSize = WRITE_RID? readArray<true, true,true>(srcArray, srcSize, dataArray, dataRid, ridArray, ridSize, EMPTY_VALUE)
-                            : readArray<false,true,true>(srcArray, srcSize, dataArray, dataRid, ridArray, ridSize, EMPTY_VALUE);
+                if (v > Max)
+                    Max = v;
+            }
+        }
     }
-    else if (SKIP_EMPTY_VALUES)
+
+    template<uint8_t COP>
+    static MCS_FORCE_INLINE void compare(const T* values, uint32_t n, CT filterValue, uint64_t* bits)
     {
-        dataSize = WRITE_RID? readArray<true, false,true>(srcArray, srcSize, dataArray, dataRid, ridArray, ridSize, EMPTY_VALUE)
-                            : readArray<false,false,true>(srcArray, srcSize, dataArray, dataRid, ridArray, ridSize, EMPTY_VALUE);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            CT v;
+            memcpy(&v, &values[i], sizeof(v));
+            setSelectionBits(bits, i, compareOp<COP>(v, filterValue));
+        }
     }
-    else
+};
+
+// Evaluate one filter element over the chunk
+template<typename T, typename CT, int VBYTES>
+MCS_FORCE_INLINE void applyFilterElement(const VerticalFilterElement<CT>& filter,
+                                         const T* values, uint32_t n, uint64_t* bits)
+{
+    using K = VerticalKernels<T, CT, VBYTES>;
+
+    if (filter.constResult >= 0)
     {
-        dataSize = WRITE_RID? readArray<true, false,false>(srcArray, srcSize, dataArray, dataRid, ridArray, ridSize, EMPTY_VALUE)
-                            : readArray<false,false,false>(srcArray, srcSize, dataArray, dataRid, ridArray, ridSize, EMPTY_VALUE);
+        memset(bits, filter.constResult ? 0xFF : 0, VERTICAL_CHUNK_WORDS * sizeof(uint64_t));
+        return;
     }
 
-    // If required, find Min/Max values of the data
-    if (ValidMinMax)
+    memset(bits, 0, VERTICAL_CHUNK_WORDS * sizeof(uint64_t));
+
+    switch (filter.cop)
     {
-        SKIP_EMPTY_VALUES? findMinMaxArray<true> (dataSize, dataArray, MinPtr, MaxPtr, EMPTY_VALUE, NULL_VALUE)
-                         : findMinMaxArray<false>(dataSize, dataArray, MinPtr, MaxPtr, EMPTY_VALUE, NULL_VALUE);
+        case COMPARE_LT: K::template compare<COMPARE_LT>(values, n, filter.value, bits); break;
+        case COMPARE_LE: K::template compare<COMPARE_LE>(values, n, filter.value, bits); break;
+        case COMPARE_GT: K::template compare<COMPARE_GT>(values, n, filter.value, bits); break;
+        case COMPARE_GE: K::template compare<COMPARE_GE>(values, n, filter.value, bits); break;
+        case COMPARE_NE: K::template compare<COMPARE_NE>(values, n, filter.value, bits); break;
+        case COMPARE_EQ: K::template compare<COMPARE_EQ>(values, n, filter.value, bits); break;
+        default:         idbassert(0);
     }
+}
 
+// Compute the filter result for every value of the chunk into acc
+template<typename T, typename CT, int VBYTES>
+MCS_FORCE_INLINE void applyColumnFilter(const VerticalFilterArgs<T, CT>& args,
+                                        const T* values, uint32_t n, uint64_t* acc)
+{
+    using KRAW = VerticalKernels<T, T, VBYTES>;
+    uint64_t bits[VERTICAL_CHUNK_WORDS];
 
-    // Choose initial filterArray[i] value depending on the operation
-    bool initValue = false;
-    if      (filterCount == 0) {initValue = true;}
-    else if (BOP_NONE == BOP)  {initValue = false;  BOP = BOP_OR;}
-    else if (BOP_OR   == BOP)  {initValue = false;}
-    else if (BOP_XOR  == BOP)  {initValue = false;}
-    else if (BOP_AND  == BOP)  {initValue = true;}
+    switch (args.columnFilterMode)
+    {
+        case ALWAYS_TRUE:
+            memset(acc, 0xFF, VERTICAL_CHUNK_WORDS * sizeof(uint64_t));
+            break;
 
-    // Temporary array accumulating results of filtering for each record
-    std::vector<uint8_t> filterVec(dataSize, initValue);
-    auto filterArray = filterVec.data();
+        case SINGLE_COMPARISON:
+            applyFilterElement<T, CT, VBYTES>(args.filters[0], values, n, acc);
+            break;
 
-    // Real type of column data, may be floating-point (used only for comparisons in the filtering)
-    using FLOAT_T = typename std::conditional<sizeof(T) == 8, double, float>::type;
-    using DATA_T  = typename std::conditional<KIND_FLOAT == KIND, FLOAT_T, T>::type;
-    auto realDataArray = reinterpret_cast<DATA_T*>(dataArray);
+        case ANY_COMPARISON_TRUE:
+        case ALL_COMPARISONS_TRUE:
+        case XOR_COMPARISONS:
+            applyFilterElement<T, CT, VBYTES>(args.filters[0], values, n, acc);
 
+            for (uint32_t argIndex = 1; argIndex < args.filterCount; argIndex++)
+            {
+                applyFilterElement<T, CT, VBYTES>(args.filters[argIndex], values, n, bits);
+
+                for (uint32_t w = 0; w < VERTICAL_CHUNK_WORDS; w++)
+                {
+                    if (args.columnFilterMode == ANY_COMPARISON_TRUE)
+                        acc[w] |= bits[w];
+                    else if (args.columnFilterMode == ALL_COMPARISONS_TRUE)
+                        acc[w] &= bits[w];
+                    else
+                        acc[w] ^= bits[w];
+                }
+            }
 
-    // Evaluate column filter on elements of dataArray and store results into filterArray
-    if (filterSet != NULL  &&  BOP == BOP_OR)
-    {
-        applySetFilter<BOP_OR>(dataSize, dataArray, filterSet, filterArray);
+            break;
+
+        // IN-lists compare bit patterns of the values, just like the row-at-a-time code does
+        case ONE_OF_VALUES_IN_ARRAY:
+            memset(acc, 0, VERTICAL_CHUNK_WORDS * sizeof(uint64_t));
+
+            for (uint32_t argIndex = 0; argIndex < args.filterCount; argIndex++)
+                KRAW::template compare<COMPARE_EQ>(values, n, args.filterValues[argIndex], acc);
+
+            break;
+
+        case NONE_OF_VALUES_IN_ARRAY:
+            memset(acc, 0xFF, VERTICAL_CHUNK_WORDS * sizeof(uint64_t));
+
+            for (uint32_t argIndex = 0; argIndex < args.filterCount; argIndex++)
+            {
+                memset(bits, 0, sizeof(bits));
+                KRAW::template compare<COMPARE_NE>(values, n, args.filterValues[argIndex], bits);
+
+                for (uint32_t w = 0; w < VERTICAL_CHUNK_WORDS; w++)
+                    acc[w] &= bits[w];
+            }
+
+            break;
+
+        default:
+            idbassert(0);
     }
-    else if (filterSet != NULL  &&  BOP == BOP_AND)
+}
+
+// Write RIDs and/or values selected by the bitmap into the output buffer.
+template<bool WRITE_RID, bool WRITE_DATA, bool HAS_RID_ARRAY, typename T>
+inline void writeSelectedValues(
+    const uint64_t* selected,
+    const T* values,            // values of the chunk
+    const RID_T* ridArray,      // maps indexes of the chunk to RIDs if HAS_RID_ARRAY
+    uint32_t chunkStart,        // index of values[0] in the whole input
+    NewColResultHeader* out,
+    unsigned outSize,
+    unsigned* written)
+{
+    constexpr unsigned RECORD_SIZE = (WRITE_RID ? sizeof(RID_T) : 0) + (WRITE_DATA ? sizeof(T) : 0);
+    uint8_t* out8 = reinterpret_cast<uint8_t*>(out) + *written;
+    uint16_t nvals = 0;
+    uint16_t ridFlags = 0;
+
+#ifdef PRIM_DEBUG
+    uint32_t count = 0;
+
+    for (uint32_t w = 0; w < VERTICAL_CHUNK_WORDS; w++)
+        count += __builtin_popcountll(selected[w]);
+
+    if (count * RECORD_SIZE > outSize - *written)
     {
-        applySetFilter<BOP_AND>(dataSize, dataArray, filterSet, filterArray);
+        logIt(35, WRITE_DATA ? 2 : 1);
+        throw logic_error("PrimitiveProcessor::writeSelectedValues(): output buffer is too small");
     }
-    else
+#endif
 
-        for (int i = 0; i < filterCount; ++i)
+    for (uint32_t w = 0; w < VERTICAL_CHUNK_WORDS; w++)
+    {
+        for (uint64_t bits = selected[w]; bits != 0; bits &= bits - 1)
         {
-            DATA_T cmp_value;   // value for comparison, may be floating-point
-            copyValue(&cmp_value, &filterValues[i], sizeof(cmp_value));
+            const uint32_t i = (w << 6) + __builtin_ctzll(bits);
 
-            switch(BOP)
+            if (WRITE_RID)
             {
-                case BOP_AND:  applyFilterElement<BOP_AND>(filterCOPs[i], dataSize, realDataArray, cmp_value, filterArray);  break;
-                case BOP_OR:   applyFilterElement<BOP_OR> (filterCOPs[i], dataSize, realDataArray, cmp_value, filterArray);  break;
-                case BOP_XOR:  applyFilterElement<BOP_XOR>(filterCOPs[i], dataSize, realDataArray, cmp_value, filterArray);  break;
-                default:       idbassert(0);
+                RID_T rid = HAS_RID_ARRAY ? ridArray[chunkStart + i] : chunkStart + i;
+                memcpy(out8, &rid, sizeof(rid));
+                out8 += sizeof(rid);
+                ridFlags |= (1 << (rid >> 9)); // set the (row/512)'th bit
             }
+
+            if (WRITE_DATA)
+            {
+                memcpy(out8, &values[i], sizeof(T));
+                out8 += sizeof(T);
+            }
+
+            nvals++;
         }
     }
 
+    out->NVALS += nvals;
+    out->RidFlags |= ridFlags;
+    *written += nvals * RECORD_SIZE;
+}
 
-    // Copy filtered data and/or their RIDs into output buffer
-    if (WRITE_RID && WRITE_DATA)
+template<bool WRITE_RID, bool WRITE_DATA, typename T>
+inline void writeSelectedValues(
+    const uint64_t* selected,
+    const T* values,
+    const RID_T* ridArray,
+    uint32_t chunkStart,
+    NewColResultHeader* out,
+    unsigned outSize,
+    unsigned* written)
+{
+    if (ridArray)
+        writeSelectedValues<WRITE_RID, WRITE_DATA, true>(selected, values, ridArray, chunkStart, out, outSize, written);
+    else
+        writeSelectedValues<WRITE_RID, WRITE_DATA, false>(selected, values, ridArray, chunkStart, out, outSize, written);
+}
+
+template<typename T, typename CT, int VBYTES>
+MCS_FORCE_INLINE void processArray(const VerticalFilterArgs<T, CT>& args)
+{
+    using K = VerticalKernels<T, CT, VBYTES>;
+    constexpr uint32_t LANES = K::LANES;
+
+    const bool writeRid = (args.outputType & OT_RID) != 0;
+    const bool writeData = (args.outputType & (OT_TOKEN | OT_DATAVALUE)) != 0;
+    const uint32_t inputSize = args.ridArray ? args.ridSize : args.srcSize;
+
+    // Chunk of input data, used when the values must be gathered through ridArray
+    // or padded up to the whole number of vectors
+    alignas(64) T chunkBuf[VERTICAL_CHUNK_SIZE];
+    uint64_t valid[VERTICAL_CHUNK_WORDS];
+    uint64_t nulls[VERTICAL_CHUNK_WORDS];
+    uint64_t selected[VERTICAL_CHUNK_WORDS];
+    T Min = *args.Min;
+    T Max = *args.Max;
+
+    for (uint32_t chunkStart = 0; chunkStart < inputSize; chunkStart += VERTICAL_CHUNK_SIZE)
     {
-        IS_NULL_VALUE_MATCHES? writeArray<true,true,true> (dataSize, dataArray, dataRid, filterArray, outbuf, written, NVALS, RidFlagsPtr, NULL_VALUE)
-                             : writeArray<true,true,false>(dataSize, dataArray, dataRid, filterArray, outbuf, written, NVALS, RidFlagsPtr, NULL_VALUE);
+        const uint32_t n = std::min(VERTICAL_CHUNK_SIZE, inputSize - chunkStart);
+        const uint32_t paddedN = (n + LANES - 1) / LANES * LANES;
+        const T* values = args.srcArray + chunkStart;
+
+        if (args.ridArray)
+        {
+            for (uint32_t i = 0; i < n; i++)
+                chunkBuf[i] = args.srcArray[args.ridArray[chunkStart + i]];
+
+            values = chunkBuf;
+        }
+        else if (paddedN != n)
+        {
+            memcpy(chunkBuf, values, n * sizeof(T));
+            values = chunkBuf;
+        }
+
+        // EMPTY padding never passes the filter and doesn't affect Min/Max
+        for (uint32_t i = n; i < paddedN; i++)
+            chunkBuf[i] = args.EMPTY_VALUE;
+
+        memset(valid, 0, sizeof(valid));
+        memset(nulls, 0, sizeof(nulls));
+
+        if (args.ValidMinMax)
+            K::template classify<true>(values, paddedN, args.EMPTY_VALUE, args.NULL_VALUE, valid, nulls, Min, Max);
+        else
+            K::template classify<false>(values, paddedN, args.EMPTY_VALUE, args.NULL_VALUE, valid, nulls, Min, Max);
+
+        applyColumnFilter<T, CT, VBYTES>(args, values, paddedN, selected);
+
+        for (uint32_t w = 0; w < VERTICAL_CHUNK_WORDS; w++)
+            selected[w] = (selected[w] & valid[w]) | (args.isNullValueMatches ? nulls[w] : 0);
+
+        if (writeRid && writeData)
+            writeSelectedValues<true, true>(selected, values, args.ridArray, chunkStart, args.out, args.outSize, args.written);
+        else if (writeRid)
+            writeSelectedValues<true, false>(selected, values, args.ridArray, chunkStart, args.out, args.outSize, args.written);
+        else if (writeData)
+            writeSelectedValues<false, true>(selected, values, args.ridArray, chunkStart, args.out, args.outSize, args.written);
+        else
+            writeSelectedValues<false, false>(selected, values, args.ridArray, chunkStart, args.out, args.outSize, args.written);
     }
-    else if (WRITE_RID)
+
+    *args.Min = Min;
+    *args.Max = Max;
+}
+
+// Instantiations of processArray for every supported instruction set
+template<typename T, typename CT>
+MCS_TARGET_AVX2 void processArrayAVX2(const VerticalFilterArgs<T, CT>& args)
+{
+    processArray<T, CT, VerticalVectorBytes<T, 32>::value>(args);
+}
+
+template<typename T, typename CT>
+MCS_TARGET_SSE42 void processArraySSE42(const VerticalFilterArgs<T, CT>& args)
+{
+    processArray<T, CT, VerticalVectorBytes<T, 16>::value>(args);
+}
+
+template<typename T, typename CT>
+void processArrayGeneric(const VerticalFilterArgs<T, CT>& args)
+{
+    processArray<T, CT, VerticalVectorBytes<T, 16>::value>(args);
+}
+
+// Prepare the filter for the vertical processing and run it.
+// Returns false, leaving the output untouched, if the filter can be processed only row by row:
+// text columns, set-based filters, reverse byte order flags and LIKE-style comparisons.
+template<typename T, ENUM_KIND KIND, typename FT>
+bool filterColumnDataVertical(
+    simd::SimdLevel simdLevel,
+    NewColRequestHeader* in,
+    NewColResultHeader* out,
+    unsigned outSize,
+    unsigned* written,
+    const uint16_t* ridArray,
+    const uint16_t ridSize,
+    const T* srcArray,
+    const uint32_t srcSize,
+    const ColumnFilterMode columnFilterMode,
+    const uint32_t filterCount,
+    const uint8_t* filterCOPs,
+    const FT* filterValues,
+    const uint8_t* filterRFs,
+    const T EMPTY_VALUE,
+    const T NULL_VALUE,
+    const bool isNullValueMatches,
+    const bool ValidMinMax,
+    T* Min,
+    T* Max)
+{
+    // Real type of column data, may be floating-point (used only for comparisons in the filtering)
+    using FLOAT_T = typename std::conditional<sizeof(T) == 8, double, float>::type;
+    using CT = typename std::conditional<KIND == KIND_FLOAT, FLOAT_T, T>::type;
+
+    if (KIND == KIND_TEXT || simdLevel == simd::SIMD_NONE ||
+        columnFilterMode == ONE_OF_VALUES_IN_SET || columnFilterMode == NONE_OF_VALUES_IN_SET)
+        return false;
+
+    const bool isArrayMode = (columnFilterMode == ONE_OF_VALUES_IN_ARRAY ||
+                              columnFilterMode == NONE_OF_VALUES_IN_ARRAY);
+    utils::VLArray<VerticalFilterElement<CT>, ParsedColumnFilter::noSetFilterThreshold> filters(
+        isArrayMode ? 0 : filterCount);
+    utils::VLArray<T, ParsedColumnFilter::noSetFilterThreshold> arrayValues(isArrayMode ? filterCount : 0);
+
+    for (uint32_t argIndex = 0; argIndex < filterCount; argIndex++)
     {
-        IS_NULL_VALUE_MATCHES? writeArray<true,false,true> (dataSize, dataArray, dataRid, filterArray, outbuf, written, NVALS, RidFlagsPtr, NULL_VALUE)
-                             : writeArray<true,false,false>(dataSize, dataArray, dataRid, filterArray, outbuf, written, NVALS, RidFlagsPtr, NULL_VALUE);
+        if (isArrayMode)
+        {
+            arrayValues[argIndex] = static_cast<T>(filterValues[argIndex]);
+            continue;
+        }
+
+        VerticalFilterElement<CT>& filter = filters[argIndex];
+        filter.cop = filterCOPs[argIndex];
+        filter.constResult = -1;
+
+        if (KIND == KIND_FLOAT)
+        {
+            // Float filter values are stored as bit patterns, see colCompareDispatcherT()
+            memcpy(&filter.value, &filterValues[argIndex], sizeof(filter.value));
+        }
+        else
+        {
+            // Values are compared in the column width, so they must be representable by T
+            T value = static_cast<T>(filterValues[argIndex]);
+
+            if (filterRFs[argIndex] != 0 || static_cast<FT>(value) != filterValues[argIndex])
+                return false;
+
+            memcpy(&filter.value, &value, sizeof(filter.value));
+
+            // Comparison with NULL is false, unless it's COMPARE_NE
+            if (isNullValue<KIND, T>(value, NULL_VALUE) && filter.cop != COMPARE_NE)
+                filter.constResult = 0;
+        }
+
+        if (filter.cop == COMPARE_NIL)
+            filter.constResult = 0;
+        else if (filter.cop != COMPARE_LT && filter.cop != COMPARE_LE &&
+                 filter.cop != COMPARE_GT && filter.cop != COMPARE_GE &&
+                 filter.cop != COMPARE_EQ && filter.cop != COMPARE_NE)
+            return false;
     }
-    else
+
+    VerticalFilterArgs<T, CT> args;
+    args.srcArray = srcArray;
+    args.srcSize = srcSize;
+    args.ridArray = ridArray;
+    args.ridSize = ridSize;
+    args.columnFilterMode = columnFilterMode;
+    args.filterCount = filterCount;
+    args.filters = filters.data();
+    args.filterValues = arrayValues.data();
+    args.EMPTY_VALUE = EMPTY_VALUE;
+    args.NULL_VALUE = NULL_VALUE;
+    args.isNullValueMatches = isNullValueMatches;
+    args.outputType = in->OutputType;
+    args.out = out;
+    args.outSize = outSize;
+    args.written = written;
+    args.ValidMinMax = ValidMinMax;
+    args.Min = Min;
+    args.Max = Max;
+
+    switch (simdLevel)
     {
-        IS_NULL_VALUE_MATCHES? writeArray<false,true,true> (dataSize, dataArray, dataRid, filterArray, outbuf, written, NVALS, RidFlagsPtr, NULL_VALUE)
-                             : writeArray<false,true,false>(dataSize, dataArray, dataRid, filterArray, outbuf, written, NVALS, RidFlagsPtr, NULL_VALUE);
+        case simd::SIMD_AVX2:
+            processArrayAVX2<T, CT>(args);
+            break;
+
+        case simd::SIMD_SSE42:
+            processArraySSE42<T, CT>(args);
+            break;
+
+        default:
+            processArrayGeneric<T, CT>(args);
+            break;
     }
+
+    return true;
 }
-*/
 
 // These two are templates update min/max values in the loop iterating the values in filterColumnData.
 template<ENUM_KIND KIND, typename T,
@@ -1201,7 +1593,8 @@ void filterColumnData(
     const uint16_t ridSize,                // Number of values in ridArray
     int* srcArray16,
     const uint32_t srcSize,
-    boost::shared_ptr<ParsedColumnFilter> parsedColumnFilter)
+    boost::shared_ptr<ParsedColumnFilter> parsedColumnFilter,
+    simd::SimdLevel simdLevel)
 {
     using FT = typename IntegralTypeToFilterType<T>::type;
     using ST = typename IntegralTypeToFilterSetType<T>::type;
@@ -1240,68 +1633,49 @@ void filterColumnData(
     T Min = datatypes::numeric_limits<T>::max();
     T Max = (KIND == KIND_UNSIGNED) ? 0 : datatypes::numeric_limits<T>::min();
 
-/* WIP add vertical processing
-    // If possible, use faster "vertical" filtering approach
-    if (KIND != KIND_TEXT)
-    {
-        bool canUseFastFiltering = true;
-        for (int i = 0; i < filterCount; ++i)
-            if (filterRFs[i] != 0)
-            canUseFastFiltering = false;
+    // If possible, use faster "vertical" filtering approach, otherwise filter row by row
+    bool isFilteredVertically = filterColumnDataVertical<T, KIND, FT>(simdLevel, in, out, outSize, written,
+        ridArray, ridSize, srcArray, srcSize, columnFilterMode, filterCount, filterCOPs, filterValues,
+        filterRFs, EMPTY_VALUE, NULL_VALUE, isNullValueMatches, ValidMinMax, &Min, &Max);
 
-        if (canUseFastFiltering)
-        {
-            processArray<T, KIND, T>(srcArray, srcSize, ridArray, ridSize,
-                         in->BOP, filterSet, filterCount, filterCOPs, filterValues,
-                         reinterpret_cast<uint8_t*>(out) + *written,
-                         written, & out->NVALS, & out->RidFlags,
-                         (outputType & OT_RID) != 0,
-                         (outputType & (OT_TOKEN | OT_DATAVALUE)) != 0,
-                         (outputType & OT_RID) != 0,  //TODO: check correctness of this condition for SKIP_EMPTY_VALUES
-                         EMPTY_VALUE,
-                         isNullValueMatches, NULL_VALUE,
-                         ValidMinMax, &Min, &Max);
-            return;
-        }
-    }
-*/
-
-    // Loop-local variables
-    T curValue = 0;
-    uint16_t rid = 0;
-    bool isEmpty = false;
-
-    // Loop over the column values, storing those matching the filter, and updating the min..max range
-    for (uint32_t i = 0;
-         nextColValue<T, COL_WIDTH>(curValue, &isEmpty,
-                                    &i, &rid,
-                                    srcArray, srcSize, ridArray, ridSize,
-                                    outputType, EMPTY_VALUE); )
+    if (!isFilteredVertically)
     {
-        if (isEmpty)
-            continue;
-        else if (isNullValue<KIND,T>(curValue, NULL_VALUE))
-        {
-            // If NULL values match the filter, write curValue to the output buffer
-            if (isNullValueMatches)
-                writeColValue<T>(outputType, out, outSize, written, rid, srcArray);
-        }
-        else
+        // Loop-local variables
+        T curValue = 0;
+        uint16_t rid = 0;
+        bool isEmpty = false;
+
+        // Loop over the column values, storing those matching the filter, and updating the min..max range
+        for (uint32_t i = 0;
+             nextColValue<T, COL_WIDTH>(curValue, &isEmpty,
+                                        &i, &rid,
+                                        srcArray, srcSize, ridArray, ridSize,
+                                        outputType, EMPTY_VALUE); )
         {
-            // If curValue matches the filter, write it to the output buffer
-            if (matchingColValue<KIND, COL_WIDTH, false>(curValue, columnFilterMode, filterSet, filterCount,
-                                filterCOPs, filterValues, filterRFs, in->colType, NULL_VALUE))
+            if (isEmpty)
+                continue;
+            else if (isNullValue<KIND,T>(curValue, NULL_VALUE))
             {
-                writeColValue<T>(outputType, out, outSize, written, rid, srcArray);
+                // If NULL values match the filter, write curValue to the output buffer
+                if (isNullValueMatches)
+                    writeColValue<T>(outputType, out, outSize, written, rid, srcArray);
+            }
+            else
+            {
+                // If curValue matches the filter, write it to the output buffer
+                if (matchingColValue<KIND, COL_WIDTH, false>(curValue, columnFilterMode, filterSet, filterCount,
+                                    filterCOPs, filterValues, filterRFs, in->colType, NULL_VALUE))
+                {
+                    writeColValue<T>(outputType, out, outSize, written, rid, srcArray);
+                }
+
+                // Update Min and Max if necessary.  EMPTY/NULL values are processed in other branches.
+                if (ValidMinMax)
+                    updateMinMax<KIND>(Min, Max, curValue, in);
             }
-
-            // Update Min and Max if necessary.  EMPTY/NULL values are processed in other branches.
-            if (ValidMinMax)
-                updateMinMax<KIND>(Min, Max, curValue, in);
         }
     }
 
-
     // Write captured Min/Max values to *out
     out->ValidMinMax = ValidMinMax;
     if (ValidMinMax)
@@ -1360,7 +1734,7 @@ void PrimitiveProcessor::scanAndFilterTypeDispatcher(NewColRequestHeader* in,
         uint16_t* ridArray = in->getRIDArrayPtr(W);
         const uint32_t itemsPerBlock = logicalBlockMode ? BLOCK_SIZE
                                                         : BLOCK_SIZE / W;
-        filterColumnData<T, KIND_FLOAT>(in, out, outSize, written, ridArray, ridSize, block, itemsPerBlock, parsedColumnFilter);
+        filterColumnData<T, KIND_FLOAT>(in, out, outSize, written, ridArray, ridSize, block, itemsPerBlock, parsedColumnFilter, fSimdLevel);
         return;
     }
     _scanAndFilterTypeDispatcher<T>(in, out, outSize, written);
@@ -1389,7 +1763,7 @@ void PrimitiveProcessor::scanAndFilterTypeDispatcher(NewColRequestHeader* in,
         uint16_t* ridArray = in->getRIDArrayPtr(W);
         const uint32_t itemsPerBlock = logicalBlockMode ? BLOCK_SIZE
                                                         : BLOCK_SIZE / W;
-        filterColumnData<T, KIND_FLOAT>(in, out, outSize, written, ridArray, ridSize, block, itemsPerBlock, parsedColumnFilter);
+        filterColumnData<T, KIND_FLOAT>(in, out, outSize, written, ridArray, ridSize, block, itemsPerBlock, parsedColumnFilter, fSimdLevel);
         return;
     }
     _scanAndFilterTypeDispatcher<T>(in, out, outSize, written);
@@ -1436,7 +1810,7 @@ void PrimitiveProcessor::_scanAndFilterTypeDispatcher(NewColRequestHeader* in,
     const uint32_t itemsPerBlock = logicalBlockMode ? BLOCK_SIZE
                                                     : BLOCK_SIZE / W;
 
-    filterColumnData<T, KIND_DEFAULT>(in, out, outSize, written, ridArray, ridSize, block, itemsPerBlock, parsedColumnFilter);
+    filterColumnData<T, KIND_DEFAULT>(in, out, outSize, written, ridArray, ridSize, block, itemsPerBlock, parsedColumnFilter, fSimdLevel);
 }
 
 template<typename T,
@@ -1466,17 +1840,17 @@ void PrimitiveProcessor::_scanAndFilterTypeDispatcher(NewColRequestHeader* in,
         dataType == execplan::CalpontSystemCatalog::TEXT) &&
         !isDictTokenScan(in))
     {
-        filterColumnData<T, KIND_TEXT>(in, out, outSize, written, ridArray, ridSize, block, itemsPerBlock, parsedColumnFilter);
+        filterColumnData<T, KIND_TEXT>(in, out, outSize, written, ridArray, ridSize, block, itemsPerBlock, parsedColumnFilter, fSimdLevel);
         return;
     }
 
     if (datatypes::isUnsigned(dataType))
     {
         using UT = typename std::conditional<std::is_unsigned<T>::value || datatypes::is_uint128_t<T>::value, T, typename datatypes::make_unsigned<T>::type>::type;
-        filterColumnData<UT, KIND_UNSIGNED>(in, out, outSize, written, ridArray, ridSize, block, itemsPerBlock, parsedColumnFilter);
+        filterColumnData<UT, KIND_UNSIGNED>(in, out, outSize, written, ridArray, ridSize, block, itemsPerBlock, parsedColumnFilter, fSimdLevel);
         return;
     }
-    filterColumnData<T, KIND_DEFAULT>(in, out, outSize, written, ridArray, ridSize, block, itemsPerBlock, parsedColumnFilter);
+    filterColumnData<T, KIND_DEFAULT>(in, out, outSize, written, ridArray, ridSize, block, itemsPerBlock, parsedColumnFilter, fSimdLevel);
 }
 
 // The entrypoint for block scanning and filtering.
@@ -33,7 +33,8 @@ namespace primitives
 {
 
 PrimitiveProcessor::PrimitiveProcessor(int debugLevel) :
-    fDebugLevel(debugLevel), fStatsPtr(NULL), logicalBlockMode(false)
+    fDebugLevel(debugLevel), fStatsPtr(NULL), logicalBlockMode(false),
+    fSimdLevel(simd::hostSimdLevel())
 {
 
 // 	This does
@@ -52,6 +52,7 @@
 #include "stats.h"
 #include "primproc.h"
 #include "hasher.h"
+#include "simd.h"
 
 class PrimTest;
 
@@ -448,6 +449,16 @@ public:
         logicalBlockMode = b;
     }
 
+    /** @brief Sets the instruction set used by the vectorized column filter
+     *
+     * Defaults to the best one the host supports; SIMD_NONE forces the
+     * row-at-a-time filtering.
+     */
+    inline void setSimdLevel(simd::SimdLevel level)
+    {
+        fSimdLevel = level;
+    }
+
 private:
     PrimitiveProcessor(const PrimitiveProcessor& rhs);
     PrimitiveProcessor& operator=(const PrimitiveProcessor& rhs);
@@ -471,6 +482,7 @@ private:
     int fDebugLevel;
     dbbc::Stats* fStatsPtr; // pointer for pmstats
     bool logicalBlockMode;
+    simd::SimdLevel fSimdLevel;
 
     boost::shared_ptr<ParsedColumnFilter> parsedColumnFilter;
 
@@ -254,6 +254,7 @@ void BatchPrimitiveProcessor::initBPP(ByteStream& bs)
     hasRowGroup = tmp16 & HAS_ROWGROUP;
     getTupleJoinRowGroupData = tmp16 & JOIN_ROWGROUP_DATA;
     bool hasWideColumnsIn = tmp16 & HAS_WIDE_COLUMNS;
+    bool hasBloomFilters = tmp16 & HAS_BLOOM_FILTERS;
 
     // This used to signify that there was input row data from previous jobsteps, and
     // it never quite worked right. No need to fix it or update it; all BPP's have started
@@ -287,6 +288,21 @@ void BatchPrimitiveProcessor::initBPP(ByteStream& bs)
             bs >> *fe2;
             bs >> fe2Output;
         }
+
+        if (hasBloomFilters)
+        {
+            uint32_t bloomFilterCount;
+            bs >> bloomFilterCount;
+            bloomFilterColumns.resize(bloomFilterCount);
+            bloomFilters.resize(bloomFilterCount);
+
+            for (i = 0; i < bloomFilterCount; i++)
+            {
+                bs >> bloomFilterColumns[i];
+                bloomFilters[i].reset(new BloomFilter());
+                bloomFilters[i]->deserialize(bs);
+            }
+        }
     }
 
     if (doJoin)
@@ -358,7 +374,7 @@ void BatchPrimitiveProcessor::initBPP(ByteStream& bs)
                     bs >> largeSideKeyColumns[i];
                     //cout << "large side key is " << largeSideKeyColumns[i] << endl;
                     for (uint j = 0; j < processorThreads; ++j)
-                        tJoiners[i][j].reset(new TJoiner(10, TupleJoiner::hasher()));
+                        tJoiners[i][j].reset(new TJoiner(tJoinerSizes[i] / processorThreads));
                 }
                 else
                 {
@@ -387,7 +403,8 @@ void BatchPrimitiveProcessor::initBPP(ByteStream& bs)
                                                                                 &tlLargeSideKeyColumns[i],
                                                                                 mSmallSideKeyColumnsPtr,
                                                                                 mSmallSideRGPtr);
-                        tlJoiners[i][j].reset(new TLJoiner(10, tlHasher, tlComparator));
+                        tlJoiners[i][j].reset(new TLJoiner(tJoinerSizes[i] / processorThreads,
+                                                           tlHasher, tlComparator));
                     }
                 }
             }
@@ -944,12 +961,27 @@ void BatchPrimitiveProcessor::initProcessor()
                 projectionMap[i] = -1;
         }
 
+        bloomFilterProj.reset(new int[bloomFilters.size()]);
+
+        for (i = 0; i < bloomFilters.size(); i++)
+        {
+            bloomFilterProj[i] = -1;
+
+            for (j = 0; j < projectCount; j++)
+                if (projectionMap[j] == (int) bloomFilterColumns[i])
+                {
+                    bloomFilterProj[i] = j;
+                    break;
+                }
+        }
+
         if (doJoin)
         {
             outputRG.initRow(&oldRow);
             outputRG.initRow(&newRow);
 
             tSmallSideMatches.reset(new MatchedData[joinerCount]);
+            largeKeyProbes.reset(new vector<LargeKeyProbe>[joinerCount]);
             keyColumnProj.reset(new bool[projectCount]);
 
             for (i = 0; i < projectCount; i++)
@@ -1154,7 +1186,11 @@ void BatchPrimitiveProcessor::executeTupleJoin()
 {
     uint32_t newRowCount = 0, i, j;
     vector<uint32_t> matches;
-    uint64_t largeKey;
+
+    // look up the integer join keys of the whole rowgroup first, see probeLargeKeys()
+    for (j = 0; j < joinerCount; j++)
+        if (!typelessJoin[j])
+            probeLargeKeys(j);
 
     outputRG.getRow(0, &oldRow);
     outputRG.getRow(0, &newRow);
@@ -1192,16 +1228,11 @@ void BatchPrimitiveProcessor::executeTupleJoin()
                 //cout << "not typeless join\n";
                 bool isNull;
                 uint32_t colIndex = largeSideKeyColumns[j];
+                const LargeKeyProbe& probe = largeKeyProbes[j][i];
 
-                if (oldRow.isUnsigned(colIndex))
-                    largeKey = oldRow.getUintField(colIndex);
-                else
-                    largeKey = oldRow.getIntField(colIndex);
-                uint bucket = bucketPicker((char *) &largeKey, 8, bpSeed) & ptMask;
-
-                bool joinerIsEmpty = tJoiners[j][bucket]->empty() ? true : false; 
+                bool joinerIsEmpty = tJoiners[j][probe.bucket]->empty() ? true : false;
 
-                found = (tJoiners[j][bucket]->find(largeKey) != tJoiners[j][bucket]->end());
+                found = (probe.match != tJoiners[j][probe.bucket]->end());
                 isNull = oldRow.isNullValue(colIndex);
                 /* These conditions define when the row is NOT in the result set:
                  *    - if the key is not in the small side, and the join isn't a large-outer or anti join
@@ -1286,7 +1317,7 @@ void BatchPrimitiveProcessor::executeTupleJoin()
                     continue;
                 }
 
-                getJoinResults(oldRow, j, tSmallSideMatches[j][newRowCount]);
+                getJoinResults(oldRow, j, i, tSmallSideMatches[j][newRowCount]);
                 matchCount = tSmallSideMatches[j][newRowCount].size();
 
                 if (joinTypes[j] & WITHFCNEXP)
@@ -1575,6 +1606,17 @@ void BatchPrimitiveProcessor::execute()
 #endif
             outputRG.resetRowGroup(baseRid);
 
+            if (!bloomFilters.empty())
+            {
+#ifdef PRIMPROC_STOPWATCH
+                stopwatch->start("-- applyBloomFilters()");
+                applyBloomFilters();
+                stopwatch->stop("-- applyBloomFilters()");
+#else
+                applyBloomFilters();
+#endif
+            }
+
             if (fe1)
             {
                 uint32_t newRidCount = 0;
@@ -2088,18 +2130,20 @@ void BatchPrimitiveProcessor::serializeStrings()
 void BatchPrimitiveProcessor::sendResponse()
 {
 
-    if (sendThread->flowControlEnabled())
+    // write it here while the UM has room for it and nothing is waiting to go out
+    // ahead of it, otherwise leave it to the send thread
+    if (sendThread->takeCredit(serialized->lengthWithHdrOverhead()))
+    {
+        boost::mutex::scoped_lock lk(*writelock);
+        sock->write(*serialized);
+    }
+    else
     {
         // newConnection should be set only for the first result of a batch job
         // it tells sendthread it should consider it for the connection array
         sendThread->sendResult(BPPSendThread::Msg_t(serialized, sock, writelock, sockIndex), newConnection);
         newConnection = false;
     }
-    else
-    {
-        boost::mutex::scoped_lock lk(*writelock);
-        sock->write(*serialized);
-    }
 
     serialized.reset();
 }
@@ -2396,6 +2440,10 @@ SBPP BatchPrimitiveProcessor::duplicate()
             bpp->fe2.reset(new FuncExpWrapper(*fe2));
             bpp->fe2Output = fe2Output;
         }
+
+        // the filters are read-only after initBPP(), the copies share them
+        bpp->bloomFilterColumns = bloomFilterColumns;
+        bpp->bloomFilters = bloomFilters;
     }
 
     bpp->doJoin = doJoin;
@@ -2680,7 +2728,53 @@ void BatchPrimitiveProcessor::initGJRG()
     gjrgRowNumber = 0;
 }
 
-inline void BatchPrimitiveProcessor::getJoinResults(const Row& r, uint32_t jIndex, vector<uint32_t>& v)
+/* Looks up the key of every row in outputRG in the integer joiner jIndex.  The keys
+   are hashed and their slots prefetched a group at a time before any slot is read,
+   which overlaps the cache misses of a group. */
+void BatchPrimitiveProcessor::probeLargeKeys(uint32_t jIndex)
+{
+    const uint32_t groupSize = TJoiner::PREFETCH_GROUP;
+    uint64_t keys[groupSize];
+    uint32_t tags[groupSize];
+    uint32_t i, j, count;
+    uint32_t colIndex = largeSideKeyColumns[jIndex];
+    vector<LargeKeyProbe>& probes = largeKeyProbes[jIndex];
+    Row r;
+
+    outputRG.initRow(&r);
+    outputRG.getRow(0, &r);
+    probes.resize(ridCount);
+
+    bool isUnsigned = r.isUnsigned(colIndex);
+
+    for (i = 0; i < ridCount; i += count)
+    {
+        count = min(ridCount - i, groupSize);
+
+        for (j = 0; j < count; j++, r.nextRow())
+        {
+            LargeKeyProbe& probe = probes[i + j];
+
+            if (isUnsigned)
+                keys[j] = r.getUintField(colIndex);
+            else
+                keys[j] = r.getIntField(colIndex);
+
+            probe.bucket = bucketPicker((char *) &keys[j], 8, bpSeed) & ptMask;
+            tags[j] = tJoiners[jIndex][probe.bucket]->tag(keys[j]);
+            tJoiners[jIndex][probe.bucket]->prefetch(tags[j]);
+        }
+
+        for (j = 0; j < count; j++)
+        {
+            LargeKeyProbe& probe = probes[i + j];
+            probe.match = tJoiners[jIndex][probe.bucket]->find(keys[j], tags[j]);
+        }
+    }
+}
+
+inline void BatchPrimitiveProcessor::getJoinResults(const Row& r, uint32_t jIndex, uint32_t rowIndex,
+        vector<uint32_t>& v)
 {
     uint bucket;
 
@@ -2703,20 +2797,9 @@ inline void BatchPrimitiveProcessor::getJoinResults(const Row& r, uint32_t jInde
                 return;
         }
 
-        uint64_t largeKey;
-        uint32_t colIndex = largeSideKeyColumns[jIndex];
-
-        if (r.isUnsigned(colIndex))
-        {
-            largeKey = r.getUintField(colIndex);
-        }
-        else
-        {
-            largeKey = r.getIntField(colIndex);
-        }
-
-        bucket = bucketPicker((char *) &largeKey, 8, bpSeed) & ptMask;
-        pair<TJoiner::iterator, TJoiner::iterator> range = tJoiners[jIndex][bucket]->equal_range(largeKey);
+        // the key was looked up by probeLargeKeys()
+        const LargeKeyProbe& probe = largeKeyProbes[jIndex][rowIndex];
+        pair<TJoiner::iterator, TJoiner::iterator> range(probe.match, tJoiners[jIndex][probe.bucket]->end());
         for (; range.first != range.second; ++range.first)
             v.push_back(range.first->second);
 
@@ -2764,6 +2847,49 @@ inline void BatchPrimitiveProcessor::getJoinResults(const Row& r, uint32_t jInde
     }
 }
 
+/* Drop the rows whose join key isn't in the Bloom filter of the small side before
+   the other columns get projected and joined.  The key column is projected into
+   outputRG to read it; it gets projected again with the surviving rows later. */
+void BatchPrimitiveProcessor::applyBloomFilters()
+{
+    Row r;
+    uint32_t i, j, newRidCount;
+
+    outputRG.initRow(&r);
+
+    for (i = 0; i < bloomFilters.size() && ridCount > 0; i++)
+    {
+        if (bloomFilterProj[i] == -1)
+            continue;
+
+        uint32_t col = bloomFilterColumns[i];
+        const BloomFilter& filter = *bloomFilters[i];
+
+        projectSteps[bloomFilterProj[i]]->projectIntoRowGroup(outputRG, col);
+        outputRG.getRow(0, &r);
+        bool isUnsigned = r.isUnsigned(col);
+
+        for (j = 0, newRidCount = 0; j < ridCount; j++, r.nextRow())
+        {
+            uint64_t key = (isUnsigned ? r.getUintField(col) : (uint64_t) r.getIntField(col));
+
+            // a NULL key matches nothing
+            if (filter.mayContain(key) && !r.isNullValue(col))
+            {
+                relRids[newRidCount] = relRids[j];
+                values[newRidCount] = values[j];
+
+                if (wideColumnsWidths)
+                    wide128Values[newRidCount] = wide128Values[j];
+
+                newRidCount++;
+            }
+        }
+
+        ridCount = newRidCount;
+    }
+}
+
 void BatchPrimitiveProcessor::buildVSSCache(uint32_t loopCount)
 {
     vector<int64_t> lbidList;
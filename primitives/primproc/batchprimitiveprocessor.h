@@ -48,6 +48,8 @@
 #include "command.h"
 #include "umsocketselector.h"
 #include "tuplejoiner.h"
+#include "flatjointable.h"
+#include "bloomfilter.h"
 #include "rowgroup.h"
 #include "rowaggregation.h"
 #include "funcexpwrapper.h"
@@ -302,15 +304,12 @@ private:
     bool hasRowGroup;
 
     /* Rowgroups + join */
-    typedef std::tr1::unordered_multimap<uint64_t, uint32_t,
-            joiner::TupleJoiner::hasher, std::equal_to<uint64_t>,
-            utils::STLPoolAllocator<std::pair<const uint64_t, uint32_t> > > TJoiner;
+    typedef joiner::FlatJoinTable<uint64_t, uint32_t, joiner::TupleJoiner::hasher> TJoiner;
 
-    typedef std::tr1::unordered_multimap<joiner::TypelessData,
+    typedef joiner::FlatJoinTable<joiner::TypelessData,
             uint32_t,
             joiner::TupleJoiner::TypelessDataHasher,
-            joiner::TupleJoiner::TypelessDataComparator,
-            utils::STLPoolAllocator<std::pair<const joiner::TypelessData, uint32_t> > > TLJoiner;
+            joiner::TupleJoiner::TypelessDataComparator> TLJoiner;
 
     bool generateJoinedRowGroup(rowgroup::Row& baseRow, const uint32_t depth = 0);
     /* generateJoinedRowGroup helper fcns & vars */
@@ -362,7 +361,26 @@ private:
     const rowgroup::RowGroup* mSmallSideRGPtr;
     const std::vector<uint32_t>* mSmallSideKeyColumnsPtr;
 
-    inline void getJoinResults(const rowgroup::Row& r, uint32_t jIndex, std::vector<uint32_t>& v);
+    inline void getJoinResults(const rowgroup::Row& r, uint32_t jIndex, uint32_t rowIndex,
+                               std::vector<uint32_t>& v);
+
+    /* The integer join lookups of the rows in outputRG, done ahead of executeTupleJoin()'s
+       row loop so that they can be prefetched, see probeLargeKeys() */
+    struct LargeKeyProbe
+    {
+        uint32_t bucket;
+        TJoiner::iterator match;
+    };
+    boost::scoped_array<std::vector<LargeKeyProbe> > largeKeyProbes;
+    void probeLargeKeys(uint32_t jIndex);
+
+    /* Bloom filters on the join keys from the UM, see applyBloomFilters() */
+    void applyBloomFilters();
+    // BFC[i] = the key column of bloomFilters[i] in outputRG
+    std::vector<uint32_t> bloomFilterColumns;
+    std::vector<boost::shared_ptr<joiner::BloomFilter> > bloomFilters;
+    // BFP[i] = the projection step of that column, -1 if there is none
+    boost::shared_array<int> bloomFilterProj;
     // these allocators hold the memory for the keys stored in tlJoiners
     boost::shared_array<utils::PoolAllocator> storedKeyAllocators;
 
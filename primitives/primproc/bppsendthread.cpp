@@ -36,16 +36,17 @@ namespace primitiveprocessor
 extern uint32_t connectionsPerUM;
 
 BPPSendThread::BPPSendThread() : die(false), gotException(false), mainThreadWaiting(false),
-    sizeThreshold(100), msgsLeft(-1), waiting(false), sawAllConnections(false),
+    sizeThreshold(100), credit(0), waiting(false), sawAllConnections(false),
     fcEnabled(false), currentByteSize(0), maxByteSize(25000000)
 {
     runner = boost::thread(Runner_t(this));
 }
 
-BPPSendThread::BPPSendThread(uint32_t initMsgsLeft) : die(false), gotException(false),
-    mainThreadWaiting(false), sizeThreshold(100), msgsLeft(initMsgsLeft), waiting(false),
+BPPSendThread::BPPSendThread(uint64_t initCredit) : die(false), gotException(false),
+    mainThreadWaiting(false), sizeThreshold(100), credit(0), waiting(false),
     sawAllConnections(false), fcEnabled(false), currentByteSize(0), maxByteSize(25000000)
 {
+    addCredit(initCredit);
     runner = boost::thread(Runner_t(this));
 }
 
@@ -141,28 +142,38 @@ void BPPSendThread::sendResults(const vector<Msg_t>& msgs, bool newConnection)
         queueNotEmpty.notify_one();
 }
 
-void BPPSendThread::sendMore(int num)
+void BPPSendThread::addCredit(uint64_t bytes)
 {
     boost::mutex::scoped_lock sl(ackLock);
 
-//	cout << "got an ACK for " << num << " msgsLeft=" << msgsLeft << endl;
-    if (num == -1)
+    if (bytes == UNLIMITED_CREDIT)
         fcEnabled = false;
-    else if (num == 0)
+    else
     {
         fcEnabled = true;
-        msgsLeft = 0;
+        (void)atomicops::atomicAdd<int64_t>(&credit, (int64_t) bytes);
     }
-    else
-        (void)atomicops::atomicAdd(&msgsLeft, num);
 
     if (waiting)
         okToSend.notify_one();
 }
 
-bool BPPSendThread::flowControlEnabled()
+bool BPPSendThread::takeCredit(uint64_t bytes)
 {
-    return fcEnabled;
+    if (!fcEnabled)
+        return true;
+
+    // the msgs queued or being sent go first
+    boost::mutex::scoped_lock sl(ackLock);
+
+    if (!fcEnabled)
+        return true;
+
+    if (credit <= 0 || currentByteSize != 0 || die)
+        return false;
+
+    (void)atomicops::atomicSub<int64_t>(&credit, (int64_t) bytes);
+    return true;
 }
 
 void BPPSendThread::mainLoop()
@@ -200,18 +211,18 @@ void BPPSendThread::mainLoop()
         sl.unlock();
 
         /* In the send loop below, msgsSent tracks progress on sending the msg array,
-         * i how many msgs are sent by 1 run of the loop, limited by msgCount or msgsLeft. */
+         * i how many msgs are sent by 1 run of the loop, limited by msgCount or the credit. */
         msgsSent = 0;
 
         while (msgsSent < msgCount && !die)
         {
             uint64_t bsSize;
 
-            if (msgsLeft <= 0 && fcEnabled && !die)
+            if (credit <= 0 && fcEnabled && !die)
             {
                 boost::mutex::scoped_lock sl2(ackLock);
 
-                while (msgsLeft <= 0 && fcEnabled && !die)
+                while (credit <= 0 && fcEnabled && !die)
                 {
                     waiting = true;
                     okToSend.wait(sl2);
@@ -219,7 +230,7 @@ void BPPSendThread::mainLoop()
                 }
             }
 
-            for (i = 0; msgsSent < msgCount && ((fcEnabled && msgsLeft > 0) || !fcEnabled) && !die;
+            for (i = 0; msgsSent < msgCount && ((fcEnabled && credit > 0) || !fcEnabled) && !die;
                     msgsSent++, i++)
             {
                 if (doLoadBalancing)
@@ -250,7 +261,7 @@ void BPPSendThread::mainLoop()
                     return;
                 }
 
-                (void)atomicops::atomicDec(&msgsLeft);
+                (void)atomicops::atomicSub<int64_t>(&credit, (int64_t) bsSize);
                 (void)atomicops::atomicSub(&currentByteSize, bsSize);
                 msg[msgsSent].msg.reset();
             }
@@ -40,7 +40,7 @@ class BPPSendThread
 
 public:
     BPPSendThread();   // starts unthrottled
-    BPPSendThread(uint32_t initMsgsLeft);   // starts throttled
+    BPPSendThread(uint64_t initCredit);   // starts throttled
     virtual ~BPPSendThread();
 
     struct Msg_t
@@ -63,12 +63,17 @@ public:
             msg(m), sock(so), sockLock(sl), sockIndex(si) { }
     };
 
+    /* The UM grants the bytes it has room for.  UNLIMITED_CREDIT turns flow control off. */
+    static const uint64_t UNLIMITED_CREDIT = (uint64_t) -1;
+
     bool okToProceed();
-    void sendMore(int num);
+    void addCredit(uint64_t bytes);
+    /* Returns true if a msg of this size can be written by the caller right away,
+     * and charges it to the credit.  Otherwise the msg has to go through sendResult(). */
+    bool takeCredit(uint64_t bytes);
     void sendResults(const std::vector<Msg_t>& msgs, bool newConnection);
     void sendResult(const Msg_t& msg, bool newConnection);
     void mainLoop();
-    bool flowControlEnabled();
     void abort();
     inline bool aborted() const
     {
@@ -96,7 +101,8 @@ private:
     volatile bool die, gotException, mainThreadWaiting;
     std::string exceptionString;
     uint32_t sizeThreshold;
-    volatile int32_t msgsLeft;
+    /* bytes the UM is ready to receive; the last msg sent may overdraw it */
+    volatile int64_t credit;
     bool waiting;
     boost::mutex ackLock;
     boost::condition okToSend;
@@ -489,7 +489,7 @@ void DictStep::_projectToRG(RowGroup& rg, uint32_t col)
     int64_t o_lbid = 0;
     OldGetSigParams* pt;
     StringPtr* tmpStrings = new StringPtr[LOGICAL_BLOCK_RIDS];
-    rowgroup::Row r;
+    rowgroup::Row r, tokenRow;
     boost::scoped_array<OrderedToken> newRidList;
 
     // make the OrderedToken list
@@ -504,8 +504,18 @@ void DictStep::_projectToRG(RowGroup& rg, uint32_t col)
 
     sort(&newRidList[0], &newRidList[bpp->ridCount], TokenSorter());
 
+    // A token always resolves to the same string, and the sort puts the rows
+    // sharing a token next to each other.  Each distinct token is looked up
+    // once, stored into its first row, and the other rows refer to that copy.
+    // Blobs keep one lookup per row; the multi-block ones are read per row below.
+    bool isBlob = (rg.getColTypes()[col] == execplan::CalpontSystemCatalog::VARBINARY ||
+                   rg.getColTypes()[col] == execplan::CalpontSystemCatalog::BLOB ||
+                   rg.getColTypes()[col] == execplan::CalpontSystemCatalog::TEXT);
+
     rg.initRow(&r);
+    rg.initRow(&tokenRow);
     uint32_t curResultCounter = 0;
+    uint32_t firstRow, j, entry;
     tmpResultCounter = 0;
     totalResultLength = 0;
     i = 0;
@@ -513,6 +523,7 @@ void DictStep::_projectToRG(RowGroup& rg, uint32_t col)
     //cout << "DS: projectingToRG rids: " << bpp->ridCount << endl;
     while (i < bpp->ridCount)
     {
+        firstRow = i;
         l_lbid = ((int64_t) newRidList[i].token) >> 10;
         primMsg->LBID = (l_lbid == -1) ? l_lbid : l_lbid & 0xFFFFFFFFFL;
         primMsg->NVALS = 0;
@@ -540,6 +551,12 @@ void DictStep::_projectToRG(RowGroup& rg, uint32_t col)
                 values[newRidList[i].pos] = 0xfffffffffffffffeLL;
             }
 
+            if (!isBlob && i > firstRow && newRidList[i].token == newRidList[i - 1].token)
+            {
+                i++;
+                continue;
+            }
+
             if ((((int64_t)newRidList[i].token) >> 10) < 0)
             {
                 pt[primMsg->NVALS].rid = newRidList[i].rid | 0x8000000000000000LL;
@@ -570,15 +587,25 @@ void DictStep::_projectToRG(RowGroup& rg, uint32_t col)
 
         // bug 4901 - move this inside the loop and call incrementally
         // to save the unnecessary string copy
-        if ((rg.getColTypes()[col] != execplan::CalpontSystemCatalog::VARBINARY) &&
-                (rg.getColTypes()[col] != execplan::CalpontSystemCatalog::BLOB) &&
-                (rg.getColTypes()[col] != execplan::CalpontSystemCatalog::TEXT))
+        if (!isBlob)
         {
-            for (i = curResultCounter; i < tmpResultCounter; i++)
+            idbassert(tmpResultCounter - curResultCounter == primMsg->NVALS);
+            entry = curResultCounter;
+            rg.getRow(newRidList[firstRow].pos, &tokenRow);
+            tokenRow.setStringField(tmpStrings[entry].getConstString(), col);
+
+            for (j = firstRow + 1; j < i; j++)
             {
-                rg.getRow(newRidList[i].pos, &r);
-                //cout << "serializing " << tmpStrings[i] << endl;
-                r.setStringField(tmpStrings[i].getConstString(), col);
+                if (newRidList[j].token != newRidList[j - 1].token)
+                {
+                    rg.getRow(newRidList[j].pos, &tokenRow);
+                    tokenRow.setStringField(tmpStrings[++entry].getConstString(), col);
+                }
+                else
+                {
+                    rg.getRow(newRidList[j].pos, &r);
+                    r.shareStringField(tokenRow, col);
+                }
             }
         }
         else
@@ -640,7 +667,7 @@ void DictStep::_projectToRG(RowGroup& rg, uint32_t col)
     }
 
     //cout << "_projectToRG() total length = " << totalResultLength << endl;
-    idbassert(tmpResultCounter == bpp->ridCount);
+    idbassert(isBlob ? tmpResultCounter == bpp->ridCount : tmpResultCounter <= bpp->ridCount);
 
     delete [] tmpStrings;
     //cout << "DS: /projectingToRG l: " << (int64_t)primMsg->LBID
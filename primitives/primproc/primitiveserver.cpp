@@ -1426,19 +1426,19 @@ struct BPPHandler
     int doAck(ByteStream& bs)
     {
         uint32_t key;
-        int16_t msgCount;
+        uint64_t credit;
         SBPPV bpps;
         const ISMPacketHeader* ism = (const ISMPacketHeader*) bs.buf();
 
         key = ism->Interleave;
-        msgCount = (int16_t) ism->Size;
         bs.advance(sizeof(ISMPacketHeader));
+        bs >> credit;
 
         bpps = grabBPPs(key);
 
         if (bpps)
         {
-            bpps->getSendThread()->sendMore(msgCount);
+            bpps->getSendThread()->addCredit(credit);
             return 0;
         }
         else
@@ -1448,7 +1448,8 @@ struct BPPHandler
     void createBPP(ByteStream& bs)
     {
         uint32_t i;
-        uint32_t key, initMsgsLeft;
+        uint32_t key;
+        uint64_t initCredit;
         SBPP bpp;
         SBPPV bppv;
 
@@ -1458,14 +1459,14 @@ struct BPPHandler
                                               bppv->getSendThread(), fPrimitiveServerPtr->ProcessorThreads()));
 
         if (bs.length() > 0)
-            bs >> initMsgsLeft;
+            bs >> initCredit;
         else
         {
-            initMsgsLeft = -1;
+            initCredit = BPPSendThread::UNLIMITED_CREDIT;
         }
 
         idbassert(bs.length() == 0);
-        bppv->getSendThread()->sendMore(initMsgsLeft);
+        bppv->getSendThread()->addCredit(initCredit);
         bppv->add(bpp);
 
         // this block of code creates some BPP instances up front for user queries,
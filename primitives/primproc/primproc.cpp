@@ -61,6 +61,8 @@ using namespace logging;
 #include "umsocketselector.h"
 using namespace primitiveprocessor;
 
+#include "stats.h"
+
 #include "liboamcpp.h"
 using namespace oam;
 
@@ -337,6 +339,8 @@ void* waitForSIGUSR1(void* p)
                 BRPp[i]->formatLRUList(out);
                 cout << out.str() << "###" << endl;
             }
+
+            dbbc::Stats::formatCacheStats(cout);
         }
         else if (rec_sig == SIGUSR2)
         {
@@ -83,9 +83,15 @@ enum Opcodes {
     LIST_DIRECTORY,
     PING,
     COPY,
-    SYNC
+    SYNC,
+    ATTACH_BUFFER
 };
 
+// Or'd into the READ, WRITE and APPEND opcodes, it means the data is in the
+// buffer the connection shares with StorageManager (see ATTACH_BUFFER) rather
+// than in the message.
+static const uint8_t SHARED_BUFFER = 0x80;
+
 /*
     All commands sent to and from StorageManager begin with
     SM_MSG_START, and a uint32_t for the length of the payload.
@@ -283,6 +289,28 @@ struct copy_cmd {
     f_name file1;
     // use f_name as an overlay at the end of file1 to get file2.
 };
+
+/*
+    ATTACH_BUFFER
+    -------------
+    command format:
+    1-byte opcode|8-byte buffer size
+
+    The message is followed by a single byte, outside of the message, that
+    carries the descriptor of the buffer (a memfd) as SCM_RIGHTS ancillary data.
+    StorageManager maps it and uses it for the data of READ, WRITE and APPEND
+    commands on this connection that have the SHARED_BUFFER bit set.  For those
+    the data isn't part of the message: a READ response carries only the return
+    code, and the WRITE and APPEND commands end with the filename.
+
+    response format:
+    nothing beyond the return code, which is 0 on success.  On an error the
+    connection keeps the buffer it had before, if any.
+*/
+struct attach_buffer_cmd {
+    uint8_t opcode;   // == ATTACH_BUFFER
+    uint64_t size;
+};
     
 #pragma pack(pop)
 
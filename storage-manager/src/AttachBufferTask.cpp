@@ -0,0 +1,94 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+
+
+#include "AttachBufferTask.h"
+#include "messageFormat.h"
+#include "SMLogging.h"
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace storagemanager
+{
+
+AttachBufferTask::AttachBufferTask(int sock, uint len) : PosixTask(sock, len)
+{
+}
+
+AttachBufferTask::~AttachBufferTask()
+{
+}
+
+// a client can ask for a buffer as large as the largest read
+static const uint64_t maxBufferSize = 100 << 20;
+
+bool AttachBufferTask::run()
+{
+    SMLogging* logger = SMLogging::get();
+    attach_buffer_cmd cmd;
+    
+    // the buffer's descriptor comes right after the msg.  It has to be taken off the
+    // socket even when the msg is bad, or its byte would start the next msg.
+    bool badLength = (getLength() != sizeof(cmd));
+    if (badLength)
+        consumeMsg();
+    else
+    {
+        int success = read((uint8_t *) &cmd, sizeof(cmd));
+        if (success < 0)
+        {
+            handleError("AttachBufferTask read", errno);
+            return false;
+        }
+    }
+
+    int fd = readFd();
+    if (fd < 0)
+    {
+        handleError("AttachBufferTask readFd", errno);
+        return false;
+    }
+
+    struct stat statbuf;
+    if (badLength || cmd.size == 0 || cmd.size > maxBufferSize || ::fstat(fd, &statbuf) != 0 || 
+      (uint64_t) statbuf.st_size < cmd.size)
+    {
+        ::close(fd);
+        handleError("AttachBufferTask", EINVAL);
+        return true;
+    }
+
+    void *buf = ::mmap(NULL, cmd.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int l_errno = errno;
+    ::close(fd);
+    if (buf == MAP_FAILED)
+    {
+        logger->log(LOG_ERR, "AttachBufferTask: failed to map a %llu byte buffer", (unsigned long long) cmd.size);
+        handleError("AttachBufferTask mmap", l_errno);
+        return true;
+    }
+    setSharedBuffer((uint8_t *) buf, cmd.size);
+
+    sm_response ret;
+    ret.returnCode = 0;
+    return write(ret, 0);
+}
+
+}
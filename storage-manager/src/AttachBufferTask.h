@@ -0,0 +1,41 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+
+
+#ifndef ATTACHBUFFERTASK_H_
+#define ATTACHBUFFERTASK_H_
+
+#include "PosixTask.h"
+
+namespace storagemanager
+{
+
+class AttachBufferTask : public PosixTask
+{
+    public:
+        AttachBufferTask(int sock, uint length);
+        virtual ~AttachBufferTask();
+        
+        bool run();
+    
+    private:
+        AttachBufferTask();
+};
+
+}
+#endif
@@ -24,6 +24,7 @@
 #include <boost/thread/mutex.hpp>
 #include <string>
 #include <ctype.h>
+#include <errno.h>
 #include <iostream>
 
 using namespace std;
@@ -77,6 +78,18 @@ CloudStorage::CloudStorage()
         existenceChecks = 0;
 }
 
+int CloudStorage::getObjectSize(const string &, size_t *)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+int CloudStorage::getObjectRange(const string &, uint8_t *, off_t, size_t)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
 void CloudStorage::printKPIs() const
 {
     cout << "CloudStorage" << endl;
@@ -20,6 +20,7 @@
 #define CLOUDSTORAGE_H_
 
 #include <string>
+#include <sys/types.h>
 #include <boost/shared_array.hpp>
 #include "SMLogging.h"
 
@@ -38,6 +39,11 @@ class CloudStorage
         virtual int deleteObject(const std::string &key) = 0;
         virtual int copyObject(const std::string &sourceKey, const std::string &destKey) = 0;
         virtual int exists(const std::string &key, bool *out) = 0;
+
+        /* Ranged reads let the Downloader fetch a large object in parallel parts.  The defaults
+           fail with ENOTSUP, which makes the Downloader get the whole object instead. */
+        virtual int getObjectSize(const std::string &key, size_t *size);
+        virtual int getObjectRange(const std::string &key, uint8_t *data, off_t offset, size_t length);
         
         virtual void printKPIs() const;
         
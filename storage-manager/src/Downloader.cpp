@@ -21,22 +21,28 @@
 #include <string>
 #include <errno.h>
 #include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
 #include <boost/filesystem.hpp>
+#include <boost/scoped_array.hpp>
+#include "Utilities.h"
 
 using namespace std;
 namespace bf = boost::filesystem;
 namespace storagemanager
 {
 
-Downloader::Downloader() : maxDownloads(0)
+Downloader::Downloader() : maxDownloads(0), partSize(0)
 {
     storage = CloudStorage::get();
     configListener();
     Config::get()->addConfigListener(this);
     workers.setName("Downloader");
+    partWorkers.setName("DownloaderParts");
     logger = SMLogging::get();
     tmpPath = "downloading";
     bytesDownloaded = 0;
+    partsDownloaded = 0;
 }
 
 Downloader::~Downloader()
@@ -118,6 +124,7 @@ void Downloader::download(const vector<const string *> &keys, vector<int> *errno
 void Downloader::printKPIs() const
 {
     cout << "Downloader: bytesDownloaded = " << bytesDownloaded << endl;
+    cout << "Downloader: partsDownloaded = " << partsDownloaded << endl;
 }
 
 bool Downloader::inProgress(const string &key)
@@ -159,7 +166,15 @@ void Downloader::Download::operator()()
     if (!bf::exists(dlPath / dl->getTmpPath()))
         bf::create_directories(dlPath / dl->getTmpPath());
     bf::path tmpFile = dlPath / dl->getTmpPath() / key;
-    int err = storage->getObject(key, tmpFile.string(), &size);
+    int err;
+    size_t objectSize;
+    if (dl->partSize > 0 && storage->getObjectSize(key, &objectSize) == 0 && objectSize > dl->partSize)
+    {
+        err = dl->downloadInParts(key, tmpFile, objectSize);
+        size = (err == 0 ? objectSize : 0);
+    }
+    else
+        err = storage->getObject(key, tmpFile.string(), &size);
     if (err != 0)
     {
         dl_errno = errno;
@@ -184,6 +199,68 @@ void Downloader::Download::operator()()
     lock->unlock();
 }
 
+int Downloader::downloadInParts(const string &key, const bf::path &dest, size_t objectSize)
+{
+    int fd = ::open(dest.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+        return fd;
+    ScopedCloser s(fd);
+
+    uint partCount = (objectSize + partSize - 1) / partSize;
+    PartGroup group(partCount);
+    for (off_t offset = 0; (size_t) offset < objectSize; offset += partSize)
+    {
+        size_t length = min<size_t>(partSize, objectSize - offset);
+        partWorkers.addJob(boost::shared_ptr<Part>(new Part(key, fd, offset, length, &group)));
+    }
+
+    boost::unique_lock<boost::mutex> gl(group.mutex);
+    while (group.remaining > 0)
+        group.done.wait(gl);
+    if (group.part_errno)
+    {
+        errno = group.part_errno;
+        return -1;
+    }
+    boost::unique_lock<boost::mutex> s2(lock);
+    partsDownloaded += partCount;
+    return 0;
+}
+
+Downloader::PartGroup::PartGroup(uint count) : remaining(count), part_errno(0)
+{
+}
+
+Downloader::Part::Part(const string &_key, int _fd, off_t _offset, size_t _length, PartGroup *_group) :
+    key(_key), fd(_fd), offset(_offset), length(_length), group(_group)
+{
+}
+
+void Downloader::Part::operator()()
+{
+    boost::scoped_array<uint8_t> data(new uint8_t[length]);
+    int l_errno = 0;
+    int err = CloudStorage::get()->getObjectRange(key, data.get(), offset, length);
+    if (err)
+        l_errno = errno;
+
+    size_t count = 0;
+    while (!l_errno && count < length)
+    {
+        ssize_t written = ::pwrite(fd, &data[count], length - count, offset + count);
+        if (written < 0)
+            l_errno = errno;
+        else
+            count += written;
+    }
+
+    boost::unique_lock<boost::mutex> s(group->mutex);
+    if (l_errno && !group->part_errno)
+        group->part_errno = l_errno;
+    if (--group->remaining == 0)
+        group->done.notify_all();
+}
+
 Downloader::DownloadListener::DownloadListener(uint *_counter, boost::condition *condvar) : counter(_counter), cond(condvar)
 {
 }
@@ -231,5 +308,22 @@ void Downloader::configListener()
     {
         logger->log(LOG_CRIT, "max_concurrent_downloads is not a number. Using current value = %u",maxDownloads);
     }
+    partWorkers.setMaxThreads(maxDownloads);
+
+    // ranged downloads, off unless set
+    stmp = Config::get()->getValue("ObjectStorage", "download_part_size");
+    try
+    {
+        size_t newValue = (stmp.empty() ? 0 : stoul(stmp));
+        if (newValue != partSize)
+        {
+            partSize = newValue;
+            logger->log(LOG_INFO, "download_part_size = %zu", partSize);
+        }
+    }
+    catch (invalid_argument &)
+    {
+        logger->log(LOG_CRIT, "download_part_size is not a number. Using current value = %zu", partSize);
+    }
 }
 }
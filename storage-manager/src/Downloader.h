@@ -56,6 +56,7 @@ class Downloader : public ConfigListener
         
     private:
         uint maxDownloads;
+        size_t partSize;    // objects larger than this are downloaded in parts, 0 means never
         //boost::filesystem::path downloadPath;
         boost::mutex lock;
     
@@ -102,13 +103,40 @@ class Downloader : public ConfigListener
         typedef std::unordered_set<boost::shared_ptr<Download>, DLHasher, DLEquals> Downloads_t;
         Downloads_t downloads;
         boost::filesystem::path tmpPath;
+
+        /* The parts of one object are ranged GETs run by partWorkers, each writing its range of the
+           destination file.  They have their own pool so a Download never waits on a job queued
+           behind it.
+        */
+        struct PartGroup
+        {
+            PartGroup(uint count);
+            boost::mutex mutex;
+            boost::condition done;
+            uint remaining;
+            int part_errno;
+        };
+
+        struct Part : public ThreadPool::Job
+        {
+            Part(const std::string &key, int fd, off_t offset, size_t length, PartGroup *group);
+            void operator()();
+            const std::string key;
+            int fd;
+            off_t offset;
+            size_t length;
+            PartGroup *group;
+        };
+
+        int downloadInParts(const std::string &key, const boost::filesystem::path &dest, size_t objectSize);
         
         ThreadPool workers;
+        ThreadPool partWorkers;
         CloudStorage *storage;
         SMLogging *logger;
 
         // KPIs
-        size_t bytesDownloaded;
+        size_t bytesDownloaded, partsDownloaded;
 };
 
 }
@@ -41,6 +41,12 @@ namespace
 {
     storagemanager::IOCoordinator *ioc = NULL;
     boost::mutex m;
+
+    // read-ahead starts after this many sequential reads of a file
+    const uint SEQUENTIAL_READS = 2;
+    // files whose access pattern is tracked, the states are dropped when there are more
+    const size_t MAX_READ_AHEAD_STATES = 1024;
+    const uint READ_AHEAD_THREADS = 8;
 }
 
 namespace bf = boost::filesystem;
@@ -82,10 +88,26 @@ IOCoordinator::IOCoordinator()
     
     cachePath = cache->getCachePath();
     journalPath = cache->getJournalPath();
+
+    // read-ahead, off unless set
+    readAheadObjects = 0;
+    try
+    {
+        string stmp = config->getValue("ObjectStorage", "read_ahead_objects");
+        if (!stmp.empty())
+            readAheadObjects = stoul(stmp);
+    }
+    catch (...)
+    {
+        logger->log(LOG_ERR, "ObjectStorage/read_ahead_objects is not a number, read-ahead is disabled");
+    }
+    readAheadWorkers.setName("ReadAhead");
+    readAheadWorkers.setMaxThreads(READ_AHEAD_THREADS);
     
     bytesRead = bytesWritten = filesOpened = filesCreated = filesCopied = filesDeleted = 
         bytesCopied = filesTruncated = listingCount = callsToWrite = 0;
     iocFilesOpened = iocObjectsCreated = iocJournalsCreated = iocBytesWritten = iocFilesDeleted = iocBytesRead = 0;
+    iocObjectsReadAhead = 0;
 }
 
 IOCoordinator::~IOCoordinator()
@@ -122,6 +144,7 @@ void IOCoordinator::printKPIs() const
     cout << "\t\tiocJournalsCreated = " << iocJournalsCreated << endl;
     cout << "\t\tiocBytesRead = " << iocBytesRead << endl;
     cout << "\t\tiocBytesWritten = " << iocBytesWritten << endl;
+    cout << "\t\tiocObjectsReadAhead = " << iocObjectsReadAhead << endl;
 }
 
 
@@ -191,6 +214,8 @@ ssize_t IOCoordinator::read(const char *_filename, uint8_t *data, off_t offset,
     }
     
     vector<metadataObject> relevants = meta.metadataRead(offset, length);
+    if (readAheadObjects > 0)
+        readAhead(filename, meta, offset, length);
     map<string, int> journalFDs, objectFDs;
     map<string, string> keyToJournalName, keyToObjectName;
     utils::VLArray<ScopedCloser> fdMinders(relevants.size() * 2);
@@ -301,6 +326,66 @@ out:
     return count;
 }
 
+void IOCoordinator::readAhead(const bf::path &filename, const MetadataFile &meta, off_t offset, size_t length)
+{
+    off_t end = offset + length;
+    off_t prefetchFrom, prefetchTo;
+
+    boost::unique_lock<boost::mutex> s(readAheadMutex);
+    if (readAheadStates.size() >= MAX_READ_AHEAD_STATES && readAheadStates.find(filename.string()) == readAheadStates.end())
+        readAheadStates.clear();
+    ReadAheadState &state = readAheadStates[filename.string()];
+    if (offset == state.nextOffset)
+        ++state.streak;
+    else
+    {
+        state.streak = 0;
+        state.prefetchedTo = 0;
+    }
+    state.nextOffset = end;
+    if (state.streak < SEQUENTIAL_READS)
+        return;
+
+    // the objects this read touches are loaded by the read itself
+    off_t readEnd = ((end + objectSize - 1) / objectSize) * objectSize;
+    prefetchFrom = max(readEnd, state.prefetchedTo);
+    prefetchTo = readEnd + readAheadObjects * objectSize;
+    if (prefetchFrom >= prefetchTo || (size_t) prefetchFrom >= meta.getLength())
+        return;
+    state.prefetchedTo = prefetchTo;
+    s.unlock();
+
+    readAheadWorkers.addJob(boost::shared_ptr<ReadAheadJob>(
+        new ReadAheadJob(this, filename, prefetchFrom, prefetchTo - prefetchFrom)));
+}
+
+IOCoordinator::ReadAheadJob::ReadAheadJob(IOCoordinator *_ioc, const bf::path &_filename, off_t _offset,
+    size_t _length) : ioc(_ioc), filename(_filename), offset(_offset), length(_length)
+{
+}
+
+void IOCoordinator::ReadAheadJob::operator()()
+{
+    // same as read(), the lock keeps the objects from being replaced while they download
+    const bf::path firstDir = *(filename.begin());
+    ScopedReadLock fileLock(ioc, filename.string());
+    MetadataFile meta(filename, MetadataFile::no_create_t(), true);
+    if (!meta.exists())
+        return;
+
+    vector<metadataObject> objects = meta.metadataRead(offset, length);
+    if (objects.empty())
+        return;
+    vector<string> keys;
+    keys.reserve(objects.size());
+    for (const auto &object : objects)
+        keys.push_back(object.key);
+    ioc->cache->read(firstDir, keys);
+    fileLock.unlock();
+    ioc->cache->doneReading(firstDir, keys);
+    ioc->iocObjectsReadAhead += keys.size();
+}
+
 ssize_t IOCoordinator::write(const char *_filename, const uint8_t *data, off_t offset, size_t length)
 {
     ++callsToWrite;
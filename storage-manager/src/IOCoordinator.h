@@ -24,6 +24,7 @@
 #include <sys/stat.h>
 #include <vector>
 #include <string>
+#include <unordered_map>
 #include <boost/utility.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/shared_array.hpp>
@@ -36,12 +37,15 @@
 #include "Replicator.h"
 #include "Utilities.h"
 #include "Ownership.h"
+#include "ThreadPool.h"
 
 namespace storagemanager
 {
 
 boost::shared_array<char> seekToEndOfHeader1(int fd, size_t *bytesRead);
 
+class MetadataFile;
+
 class IOCoordinator : public boost::noncopyable
 {
     public:
@@ -112,6 +116,32 @@ class IOCoordinator : public boost::noncopyable
         void remove(const boost::filesystem::path &path);
         void deleteMetaFile(const boost::filesystem::path &file);
 
+        /* Read-ahead.  A file read sequentially gets the next readAheadObjects objects past the
+           read loaded into the cache in the background, so a scan doesn't wait on every object.
+        */
+        struct ReadAheadState
+        {
+            off_t nextOffset;      // where a sequential read would start
+            uint streak;           // sequential reads in a row
+            off_t prefetchedTo;    // end of the range already given to readAheadWorkers
+        };
+        struct ReadAheadJob : public ThreadPool::Job
+        {
+            ReadAheadJob(IOCoordinator *ioc, const boost::filesystem::path &filename, off_t offset, size_t length);
+            void operator()();
+            IOCoordinator *ioc;
+            const boost::filesystem::path filename;
+            off_t offset;
+            size_t length;
+        };
+        void readAhead(const boost::filesystem::path &filename, const MetadataFile &meta, off_t offset,
+            size_t length);
+
+        uint readAheadObjects;
+        std::unordered_map<std::string, ReadAheadState> readAheadStates;
+        boost::mutex readAheadMutex;
+        ThreadPool readAheadWorkers;
+
         int _truncate(const boost::filesystem::path &path, size_t newsize, ScopedFileLock *lock);
         ssize_t _write(const boost::filesystem::path &filename, const uint8_t *data, off_t offset, size_t length,
             const boost::filesystem::path &firstDir);
@@ -127,7 +157,7 @@ class IOCoordinator : public boost::noncopyable
         
         // from IOC's pov...
         size_t iocFilesOpened, iocObjectsCreated, iocJournalsCreated, iocFilesDeleted;
-        size_t iocBytesRead, iocBytesWritten;
+        size_t iocBytesRead, iocBytesWritten, iocObjectsReadAhead;
 };
 
 }
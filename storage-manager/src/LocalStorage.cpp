@@ -173,6 +173,49 @@ int LocalStorage::getObject(const std::string &sourceKey, boost::shared_array<ui
     return 0;
 }
 
+int LocalStorage::getObjectSize(const string &key, size_t *size)
+{
+    addLatency();
+
+    struct stat statbuf;
+    bf::path source = prefix / key;
+    int err = ::stat(source.string().c_str(), &statbuf);
+    if (err)
+        return err;
+    *size = statbuf.st_size;
+    return 0;
+}
+
+int LocalStorage::getObjectRange(const string &key, uint8_t *data, off_t offset, size_t length)
+{
+    addLatency();
+
+    bf::path source = prefix / key;
+    int l_errno;
+
+    int fd = ::open(source.string().c_str(), O_RDONLY);
+    if (fd < 0)
+        return fd;
+
+    size_t count = 0;
+    while (count < length)
+    {
+        int err = ::pread(fd, &data[count], length - count, offset + count);
+        if (err <= 0)
+        {
+            l_errno = (err == 0 ? ENODATA : errno);   // the object is shorter than the range
+            close(fd);
+            bytesRead += count;
+            errno = l_errno;
+            return -1;
+        }
+        count += err;
+    }
+    close(fd);
+    bytesRead += length;
+    return 0;
+}
+
 int LocalStorage::putObject(const string &source, const string &dest)
 {
     addLatency();
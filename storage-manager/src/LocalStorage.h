@@ -39,6 +39,8 @@ class LocalStorage : public CloudStorage
         int deleteObject(const std::string &key);
         int copyObject(const std::string &sourceKey, const std::string &destKey);
         int exists(const std::string &key, bool *out);
+        int getObjectSize(const std::string &key, size_t *size);
+        int getObjectRange(const std::string &key, uint8_t *data, off_t offset, size_t length);
         
         const boost::filesystem::path & getPrefix() const;
         void printKPIs() const;
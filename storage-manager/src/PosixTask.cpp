@@ -19,6 +19,7 @@
 #include "PosixTask.h"
 #include "messageFormat.h"
 #include "SMLogging.h"
+#include "SessionManager.h"
 #include <iostream>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -196,6 +197,49 @@ bool PosixTask::write(const vector<uint8_t> &buf)
     return write(&buf[0], buf.size());
 }
 
+int PosixTask::readFd()
+{
+    uint8_t byte;
+    char cbuf[CMSG_SPACE(sizeof(int))];
+    struct iovec iov;
+    struct msghdr msg;
+    int err;
+
+    iov.iov_base = &byte;
+    iov.iov_len = 1;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+
+    err = ::recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    if (err <= 0)
+        return -1;
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+      cmsg->cmsg_len != CMSG_LEN(sizeof(int)))
+    {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    int fd;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+    return fd;
+}
+
+bool PosixTask::getSharedBuffer(uint8_t **buf, size_t *len)
+{
+    return SessionManager::get()->getSharedBuffer(sock, buf, len);
+}
+
+void PosixTask::setSharedBuffer(uint8_t *buf, size_t len)
+{
+    SessionManager::get()->setSharedBuffer(sock, buf, len);
+}
+
 void PosixTask::consumeMsg()
 {
     SMLogging* logger = SMLogging::get();
@@ -49,6 +49,9 @@ class PosixTask
         uint getLength();  // returns the total length of the msg
         uint getRemainingLength();   // returns the remaining length from the caller's perspective
         void handleError(const char *name, int errCode);
+        int readFd();   // receives the descriptor sent after the msg, -1 on error
+        bool getSharedBuffer(uint8_t **buf, size_t *len);   // see ATTACH_BUFFER
+        void setSharedBuffer(uint8_t *buf, size_t len);
         
         IOCoordinator *ioc;
         
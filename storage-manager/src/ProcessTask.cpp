@@ -24,6 +24,7 @@
 #include <boost/scoped_ptr.hpp>
 
 #include "AppendTask.h"
+#include "AttachBufferTask.h"
 #include "CopyTask.h"
 #include "ListDirectoryTask.h"
 #include "OpenTask.h"
@@ -81,7 +82,7 @@ void ProcessTask::operator()()
     }
         
     boost::scoped_ptr<PosixTask> task;
-    switch(opcode)
+    switch(opcode & ~SHARED_BUFFER)
     {
         case OPEN:
             task.reset(new OpenTask(sock, length));
@@ -116,6 +117,9 @@ void ProcessTask::operator()()
         case COPY:
             task.reset(new CopyTask(sock, length));
             break;
+        case ATTACH_BUFFER:
+            task.reset(new AttachBufferTask(sock, length));
+            break;
         default:
             throw runtime_error("ProcessTask: got an unknown opcode");
     }
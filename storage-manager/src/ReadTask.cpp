@@ -63,12 +63,22 @@ bool ReadTask::run()
     logger->log(LOG_DEBUG,"read %s count %i offset %i.",cmd->filename,cmd->count,cmd->offset);
     #endif
     
-    // read from IOC, write to the socket
+    // read from IOC, write to the socket or into the shared buffer
+    bool shared = (cmd->opcode & SHARED_BUFFER);
+    uint8_t *sharedBuf = NULL;
+    size_t sharedLen = 0;
+    if (shared && (!getSharedBuffer(&sharedBuf, &sharedLen) || cmd->count > sharedLen))
+    {
+        handleError("ReadTask", EINVAL);
+        return true;
+    }
+
     vector<uint8_t> outbuf;
     if (cmd->count > (100 << 20))
         cmd->count = (100 << 20);   // cap a read request at 100MB
-    outbuf.resize(max(cmd->count, 4) + sizeof(sm_response));  
+    outbuf.resize((shared ? 4 : max(cmd->count, 4)) + sizeof(sm_response));
     sm_response *resp = (sm_response *) &outbuf[0];
+    uint8_t *data = (shared ? sharedBuf : resp->payload);
     
     resp->returnCode = 0;
     uint payloadLen = 0;
@@ -80,7 +90,7 @@ bool ReadTask::run()
     {
         try
         {
-            err = ioc->read(cmd->filename, &resp->payload[resp->returnCode], cmd->offset + resp->returnCode, 
+            err = ioc->read(cmd->filename, &data[resp->returnCode], cmd->offset + resp->returnCode, 
                 cmd->count - resp->returnCode);
         }
         catch (exception &e)
@@ -102,7 +112,7 @@ bool ReadTask::run()
         resp->returnCode += err;
     }
     if (resp->returnCode >= 0)
-        payloadLen = resp->returnCode;
+        payloadLen = (shared ? 0 : resp->returnCode);
     return write(*resp, payloadLen);
 }
 
@@ -24,6 +24,7 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/un.h>
+#include <sys/mman.h>
 #include <netinet/in.h>
 #include <errno.h>
 #include <string>
@@ -167,7 +168,7 @@ int SessionManager::start()
                     //logger->log(LOG_DEBUG,"Error! revents = %d", fds[socketIncr].revents,);
                     if (fds[socketIncr].fd == -1)
                         logger->log(LOG_DEBUG,"!= POLLIN, closing fd -1");
-                    close(fds[socketIncr].fd);
+                    closeSocket(fds[socketIncr].fd);
                     fds[socketIncr].fd = -1;
                     continue;
                 }
@@ -222,7 +223,7 @@ int SessionManager::start()
                                     if (shutdown)
                                     {
                                         logger->log(LOG_DEBUG,"Shutdown in progress, closed socket %i at index %i", fds[i].fd,i);                                       
-                                        close(socket);
+                                        closeSocket(socket);
                                         break;
                                     }
                                     fds[i].events = (POLLIN | POLLPRI);
@@ -242,7 +243,7 @@ int SessionManager::start()
                                 {
                                     if (socket == -1)
                                         logger->log(LOG_DEBUG,"REMOVEFD told to remove fd -1");
-                                    close(socket);
+                                    closeSocket(socket);
                                     fds[i].fd = -1;
                                     break;
                                 }
@@ -379,7 +380,7 @@ int SessionManager::start()
                     {
                         if (fds[socketIncr].fd == -1)
                             logger->log(LOG_DEBUG,"closeConn closing fd -1");
-                        close(fds[socketIncr].fd);
+                        closeSocket(fds[socketIncr].fd);
                         fds[socketIncr].fd = -1;
                     }
                 }
@@ -401,7 +402,7 @@ int SessionManager::start()
             {
                 if (fds[i].events == (POLLIN | POLLPRI))
                 {
-                    close(fds[i].fd);
+                    closeSocket(fds[i].fd);
                     fds[i].fd = -1;
                 }
             }
@@ -472,6 +473,40 @@ void SessionManager::socketError(int socket)
     }
 }
 
+void SessionManager::closeSocket(int socket)
+{
+    boost::mutex::scoped_lock s(sharedBufferMutex);
+    tr1::unordered_map<int, SharedBuffer>::iterator it = sharedBuffers.find(socket);
+    if (it != sharedBuffers.end())
+    {
+        munmap(it->second.buf, it->second.len);
+        sharedBuffers.erase(it);
+    }
+    s.unlock();
+    close(socket);
+}
+
+void SessionManager::setSharedBuffer(int socket, uint8_t *buf, size_t len)
+{
+    boost::mutex::scoped_lock s(sharedBufferMutex);
+    SharedBuffer &sb = sharedBuffers[socket];
+    if (sb.buf != NULL)
+        munmap(sb.buf, sb.len);
+    sb.buf = buf;
+    sb.len = len;
+}
+
+bool SessionManager::getSharedBuffer(int socket, uint8_t **buf, size_t *len)
+{
+    boost::mutex::scoped_lock s(sharedBufferMutex);
+    tr1::unordered_map<int, SharedBuffer>::iterator it = sharedBuffers.find(socket);
+    if (it == sharedBuffers.end())
+        return false;
+    *buf = it->second.buf;
+    *len = it->second.len;
+    return true;
+}
+
 void SessionManager::shutdownSM(int sig){
     boost::mutex::scoped_lock s(ctrlMutex);
     SMLogging* logger = SMLogging::get();
@@ -59,6 +59,10 @@ public:
     void CRPTest(int socket,uint length);
     void shutdownSM(int sig);
 
+    // the buffers clients share with us (see ATTACH_BUFFER).  One is unmapped when its socket is closed.
+    void setSharedBuffer(int socket, uint8_t *buf, size_t len);
+    bool getSharedBuffer(int socket, uint8_t **buf, size_t *len);
+
 private:
     SessionManager();
     //SMConfig&  config;
@@ -74,6 +78,15 @@ private:
         uint remainingBytes;
     };
     std::tr1::unordered_map<int, SockState> sockState;
+
+    void closeSocket(int socket);
+
+    struct SharedBuffer {
+        uint8_t *buf;
+        size_t len;
+    };
+    std::tr1::unordered_map<int, SharedBuffer> sharedBuffers;
+    boost::mutex sharedBufferMutex;
     
 };
 
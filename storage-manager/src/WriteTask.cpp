@@ -67,26 +67,22 @@ bool WriteTask::run()
     #endif
             
     ssize_t readCount = 0, writeCount = 0;
-    vector<uint8_t> databuf;
-    uint bufsize = min(100 << 20, cmd->count);   // 100 MB
-    //uint bufsize = cmd->count;
-    databuf.resize(bufsize);
-
-    while (readCount < cmd->count)
+    if (cmd->opcode & SHARED_BUFFER)
     {
-        uint toRead = min(static_cast<uint>(cmd->count - readCount), bufsize);
-        success = read(&databuf[0], toRead);
-        check_error("WriteTask read data", false);
-        if (success==0)
-            break;
-        readCount += success;
-        uint writePos = 0;
+        // the data is in the buffer shared with the client rather than in the msg
+        uint8_t *sharedBuf = NULL;
+        size_t sharedLen = 0;
+        if (cmd->count < 0 || !getSharedBuffer(&sharedBuf, &sharedLen) || (size_t) cmd->count > sharedLen)
+        {
+            handleError("WriteTask", EINVAL);
+            return true;
+        }
         ssize_t err;
-        while (writeCount < readCount)
+        while (writeCount < cmd->count)
         {
-            try 
+            try
             {
-                err = ioc->write(cmd->filename, &databuf[writePos], cmd->offset + writeCount, success - writePos);
+                err = ioc->write(cmd->filename, &sharedBuf[writeCount], cmd->offset + writeCount, cmd->count - writeCount);
             }
             catch (exception &e)
             {
@@ -97,10 +93,45 @@ bool WriteTask::run()
             if (err <= 0)
                 break;
             writeCount += err;
-            writePos += err;
         }
-        if (writeCount != readCount)
-            break;
+    }
+    else
+    {
+        vector<uint8_t> databuf;
+        uint bufsize = min(100 << 20, cmd->count);   // 100 MB
+        //uint bufsize = cmd->count;
+        databuf.resize(bufsize);
+
+        while (readCount < cmd->count)
+        {
+            uint toRead = min(static_cast<uint>(cmd->count - readCount), bufsize);
+            success = read(&databuf[0], toRead);
+            check_error("WriteTask read data", false);
+            if (success==0)
+                break;
+            readCount += success;
+            uint writePos = 0;
+            ssize_t err;
+            while (writeCount < readCount)
+            {
+                try 
+                {
+                    err = ioc->write(cmd->filename, &databuf[writePos], cmd->offset + writeCount, success - writePos);
+                }
+                catch (exception &e)
+                {
+                    logger->log(LOG_ERR, "WriteTask: caught '%s'", e.what());
+                    errno = EIO;
+                    err = -1;
+                }
+                if (err <= 0)
+                    break;
+                writeCount += err;
+                writePos += err;
+            }
+            if (writeCount != readCount)
+                break;
+        }
     }
     
     uint8_t respbuf[sizeof(sm_response) + 4];
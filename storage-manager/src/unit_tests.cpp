@@ -16,8 +16,10 @@
    MA 02110-1301, USA. */
 
 #include "OpenTask.h"
+#include "ReadTask.h"
 #include "WriteTask.h"
 #include "AppendTask.h"
+#include "AttachBufferTask.h"
 #include "UnlinkTask.h"
 #include "StatTask.h"
 #include "TruncateTask.h"
@@ -34,12 +36,14 @@
 #include "Utilities.h"
 #include "Synchronizer.h"
 #include "ProcessTask.h"
+#include "SessionManager.h"
 
 #include <iostream>
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/mman.h>
 #include <sys/un.h>
 #include <string.h>
 #include <fcntl.h>
@@ -507,6 +511,231 @@ bool appendtask()
     return true;
 }
 
+int openFds()
+{
+    int count = 0;
+    for (bf::directory_iterator it("/proc/self/fd"); it != bf::directory_iterator(); ++it)
+        count++;
+    return count;
+}
+
+// sends an ATTACH_BUFFER msg of payloadLen bytes for a file of fileSize bytes, followed
+// by the byte that carries its descriptor.  Returns the return code of the response,
+// and on success the caller's mapping of the buffer in *shared.
+ssize_t attachBuffer(size_t fileSize, uint64_t size, uint payloadLen, int *l_errno,
+  uint8_t **shared = NULL)
+{
+    // any file that can be mapped will do, the client uses a memfd
+    bf::path fullPath = homepath / prefix / "attachBufferTest";
+    int fd = ::open(fullPath.string().c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+    assert(fd >= 0);
+    scoped_closer f(fd);
+    ::unlink(fullPath.string().c_str());
+    assert(::ftruncate(fd, fileSize) == 0);
+
+    uint8_t buf[1024] = {0};
+    attach_buffer_cmd *cmd = (attach_buffer_cmd *) buf;
+    cmd->opcode = ATTACH_BUFFER;
+    cmd->size = size;
+
+    AttachBufferTask a(clientSock, payloadLen);
+    ssize_t result = ::write(sessionSock, cmd, payloadLen);
+    assert(result == static_cast<ssize_t>(payloadLen));
+
+    uint8_t byte = 0;
+    char cbuf[CMSG_SPACE(sizeof(int))];
+    struct iovec iov;
+    struct msghdr msg;
+    iov.iov_base = &byte;
+    iov.iov_len = 1;
+    memset(&msg, 0, sizeof(msg));
+    memset(cbuf, 0, sizeof(cbuf));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    assert(::sendmsg(sessionSock, &msg, 0) == 1);
+
+    a.run();
+
+    // verify response
+    int err = ::recv(sessionSock, buf, sizeof(buf), MSG_DONTWAIT);
+    sm_response *resp = (sm_response *) buf;
+    assert(resp->header.type == SM_MSG_START);
+    assert(resp->header.flags == 0);
+    if (resp->returnCode < 0)
+    {
+        assert(err == sizeof(*resp) + 4);
+        assert(resp->header.payloadLen == sizeof(ssize_t) + 4);
+        *l_errno = *((int32_t *) resp->payload);
+    }
+    else
+    {
+        assert(err == sizeof(*resp));
+        assert(resp->header.payloadLen == sizeof(ssize_t));
+    }
+
+    // neither the rest of the msg nor the descriptor's byte is left for the next msg
+    err = ::recv(clientSock, buf, sizeof(buf), MSG_DONTWAIT);
+    assert(err == -1 && (errno == EAGAIN || errno == EWOULDBLOCK));
+
+    if (shared != NULL && resp->returnCode == 0)
+    {
+        void *mapped = ::mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        assert(mapped != MAP_FAILED);
+        *shared = (uint8_t *) mapped;
+    }
+    return resp->returnCode;
+}
+
+void attachbuffertask()
+{
+    const size_t size = 1 << 20;
+    int fds = openFds();
+    int l_errno = 0;
+
+    // a msg of the wrong length, a size past the end of the file, and a size of 0
+    assert(attachBuffer(size, size, sizeof(attach_buffer_cmd) + 4, &l_errno) == -1);
+    assert(l_errno == EINVAL);
+    l_errno = 0;
+    assert(attachBuffer(size, size, sizeof(attach_buffer_cmd) - 1, &l_errno) == -1);
+    assert(l_errno == EINVAL);
+    l_errno = 0;
+    assert(attachBuffer(size, size + 1, sizeof(attach_buffer_cmd), &l_errno) == -1);
+    assert(l_errno == EINVAL);
+    l_errno = 0;
+    assert(attachBuffer(size, 0, sizeof(attach_buffer_cmd), &l_errno) == -1);
+    assert(l_errno == EINVAL);
+
+    // none of them kept the descriptor it was sent, or attached a buffer
+    assert(openFds() == fds);
+    uint8_t *sharedBuf;
+    size_t sharedLen;
+    assert(!SessionManager::get()->getSharedBuffer(clientSock, &sharedBuf, &sharedLen));
+
+    uint8_t *shared = NULL;
+    assert(attachBuffer(size, size, sizeof(attach_buffer_cmd), &l_errno, &shared) == 0);
+    assert(openFds() == fds);
+    assert(SessionManager::get()->getSharedBuffer(clientSock, &sharedBuf, &sharedLen));
+    assert(sharedLen == size);
+
+    // both sides see the same memory
+    shared[0] = 42;
+    shared[size - 1] = 43;
+    assert(sharedBuf[0] == 42 && sharedBuf[size - 1] == 43);
+    ::munmap(shared, size);
+    cout << "attach buffer task OK" << endl;
+}
+
+// READ, WRITE and APPEND with the data in the buffer attached by attachbuffertask()
+void sharedbuffertasks()
+{
+    uint8_t *shared;
+    size_t sharedLen;
+    assert(SessionManager::get()->getSharedBuffer(clientSock, &shared, &sharedLen));
+
+    bf::path fullPath = homepath / prefix / "sharedBufferTest";
+    string filename = fullPath.string();
+    IOCoordinator::get()->unlink(filename.c_str());
+    const ssize_t writeSize = 100000;   // spans several objects
+    const ssize_t appendSize = 5000;
+    uint8_t buf[1024];
+    sm_response *resp = (sm_response *) buf;
+    int err;
+
+    // WRITE, the msg ends with the filename
+    for (ssize_t i = 0; i < writeSize; i++)
+        shared[i] = i % 251;
+    {
+        uint8_t cmdbuf[1024];
+        write_cmd *cmd = (write_cmd *) cmdbuf;
+        cmd->opcode = WRITE | SHARED_BUFFER;
+        cmd->offset = 0;
+        cmd->count = writeSize;
+        cmd->flen = filename.size();
+        memcpy(&cmd->filename, filename.c_str(), cmd->flen);
+        uint payloadLen = sizeof(*cmd) + cmd->flen;
+
+        WriteTask w(clientSock, payloadLen);
+        ssize_t result = ::write(sessionSock, cmd, payloadLen);
+        assert(result == static_cast<ssize_t>(payloadLen));
+        w.run();
+
+        err = ::recv(sessionSock, buf, sizeof(buf), MSG_DONTWAIT);
+        assert(err == sizeof(*resp));
+        assert(resp->header.payloadLen == sizeof(ssize_t));
+        assert(resp->returnCode == writeSize);
+    }
+
+    // APPEND
+    for (ssize_t i = 0; i < appendSize; i++)
+        shared[i] = i % 13;
+    {
+        uint8_t cmdbuf[1024];
+        append_cmd *cmd = (append_cmd *) cmdbuf;
+        cmd->opcode = APPEND | SHARED_BUFFER;
+        cmd->count = appendSize;
+        cmd->flen = filename.size();
+        memcpy(&cmd->filename, filename.c_str(), cmd->flen);
+        uint payloadLen = sizeof(*cmd) + cmd->flen;
+
+        AppendTask a(clientSock, payloadLen);
+        ssize_t result = ::write(sessionSock, cmd, payloadLen);
+        assert(result == static_cast<ssize_t>(payloadLen));
+        a.run();
+
+        err = ::recv(sessionSock, buf, sizeof(buf), MSG_DONTWAIT);
+        assert(err == sizeof(*resp));
+        assert(resp->header.payloadLen == sizeof(ssize_t));
+        assert(resp->returnCode == appendSize);
+    }
+
+    // READ, the response carries only the return code.  Then a read larger than the buffer.
+    memset(shared, 0, sharedLen);
+    for (size_t count : { (size_t) (writeSize + appendSize), sharedLen + 1 })
+    {
+        uint8_t cmdbuf[1024];
+        read_cmd *cmd = (read_cmd *) cmdbuf;
+        cmd->opcode = READ | SHARED_BUFFER;
+        cmd->count = count;
+        cmd->offset = 0;
+        cmd->flen = filename.size();
+        memcpy(&cmd->filename, filename.c_str(), cmd->flen);
+        uint payloadLen = sizeof(*cmd) + cmd->flen;
+
+        ReadTask r(clientSock, payloadLen);
+        ssize_t result = ::write(sessionSock, cmd, payloadLen);
+        assert(result == static_cast<ssize_t>(payloadLen));
+        r.run();
+
+        err = ::recv(sessionSock, buf, sizeof(buf), MSG_DONTWAIT);
+        if (count <= sharedLen)
+        {
+            assert(err == sizeof(*resp));
+            assert(resp->header.payloadLen == sizeof(ssize_t));
+            assert(resp->returnCode == writeSize + appendSize);
+        }
+        else
+        {
+            assert(err == sizeof(*resp) + 4);
+            assert(resp->returnCode == -1);
+            assert(*((int32_t *) resp->payload) == EINVAL);
+        }
+    }
+    for (ssize_t i = 0; i < writeSize; i++)
+        assert(shared[i] == i % 251);
+    for (ssize_t i = 0; i < appendSize; i++)
+        assert(shared[writeSize + i] == i % 13);
+
+    IOCoordinator::get()->unlink(filename.c_str());
+    cout << "shared buffer tasks OK" << endl;
+}
+
 void unlinktask(bool connectionTest=false)
 {
 	int err=0;
@@ -1116,7 +1345,26 @@ bool localstorageTest1()
 {
     LocalStorage ls;
 
-    /* TODO: Some stuff */
+    // ranged reads of the test object
+    makeTestObject((ls.getPrefix()/testObjKey).string().c_str());
+    size_t size = 0;
+    int err = ls.getObjectSize(testObjKey, &size);
+    assert(!err);
+    assert(size == 8192);
+
+    int data[100];
+    err = ls.getObjectRange(testObjKey, (uint8_t *) data, 4000, sizeof(data));
+    assert(!err);
+    for (int i = 0; i < 100; i++)
+        assert(data[i] == 1000 + i);
+
+    // a range past the end of the object fails
+    err = ls.getObjectRange(testObjKey, (uint8_t *) data, 8000, sizeof(data));
+    assert(err);
+    err = ls.getObjectSize("does-not-exist", &size);
+    assert(err && errno == ENOENT);
+
+    bf::remove(ls.getPrefix()/testObjKey);
     cout << "local storage test 1 OK" << endl;
     return true;
 }
@@ -1936,6 +2184,8 @@ int main(int argc, char* argv[])
 
     //writetask();
     //appendtask();
+    attachbuffertask();
+    sharedbuffertasks();
     unlinktask();
     stattask();
     truncatetask();
@@ -0,0 +1,81 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <gtest/gtest.h>
+
+#include "bloomfilter.h"
+
+using namespace joiner;
+
+TEST(BloomFilterTest, NoFalseNegatives)
+{
+    const uint64_t keyCount = 100000;
+    BloomFilter filter(keyCount);
+
+    for (uint64_t i = 0; i < keyCount; i++)
+        filter.insert(i * 3);
+
+    for (uint64_t i = 0; i < keyCount; i++)
+        EXPECT_TRUE(filter.mayContain(i * 3));
+
+    // keys are hashed, negative values must work like any other
+    filter.insert((uint64_t) -42);
+    EXPECT_TRUE(filter.mayContain((uint64_t) -42));
+}
+
+TEST(BloomFilterTest, FalsePositiveRate)
+{
+    const uint64_t keyCount = 100000;
+    BloomFilter filter(keyCount);
+    uint64_t falsePositives = 0;
+
+    for (uint64_t i = 0; i < keyCount; i++)
+        filter.insert(i * 3);
+
+    for (uint64_t i = 0; i < keyCount; i++)
+        if (filter.mayContain(i * 3 + 1))
+            falsePositives++;
+
+    EXPECT_LT(falsePositives, keyCount / 50);
+}
+
+TEST(BloomFilterTest, EmptyFilter)
+{
+    BloomFilter filter(0);
+
+    EXPECT_FALSE(filter.mayContain(1));
+    EXPECT_FALSE(filter.mayContain(12345678));
+}
+
+TEST(BloomFilterTest, Serialize)
+{
+    BloomFilter filter(1000), copy;
+    messageqcpp::ByteStream bs;
+
+    for (uint64_t i = 0; i < 1000; i++)
+        filter.insert(i);
+
+    filter.serialize(bs);
+    copy.deserialize(bs);
+
+    EXPECT_EQ(filter.getSize(), copy.getSize());
+
+    for (uint64_t i = 0; i < 1000; i++)
+        EXPECT_TRUE(copy.mayContain(i));
+
+    EXPECT_EQ(0U, bs.length());
+}
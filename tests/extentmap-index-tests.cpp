@@ -0,0 +1,354 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "extentmap.h"
+
+using namespace BRM;
+
+class ExtentMapIndexTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        // unordered on purpose, with an empty slot in the middle
+        resize(5);
+        addExtent(0, 3000, 1, 7);
+        addExtent(1, 0, 1, 5);
+        addExtent(3, 1024, 1, 5);
+        addExtent(4, 5048, 1, 6);
+
+        shminfo.tableShmkey = 1;
+        shminfo.allocdSize = entries.size() * sizeof(EMEntry);
+        shminfo.currentSize = 4 * sizeof(EMEntry);
+        shminfo.changeSeq = 10;
+    }
+
+    // new slots are empty, as in the zeroed EM segment
+    void resize(size_t count)
+    {
+        size_t oldCount = entries.size();
+        entries.resize(count);
+
+        for (size_t i = oldCount; i < count; i++)
+        {
+            entries[i].range.start = 0;
+            entries[i].range.size = 0;
+        }
+    }
+
+    void addExtent(int i, LBID_t start, int size, int oid)
+    {
+        entries[i].range.start = start;
+        entries[i].range.size = size;
+        entries[i].fileID = oid;
+    }
+
+    // what ExtentMap::logEMChange() does
+    void logChange(int i)
+    {
+        shminfo.changeLog[shminfo.changeSeq % MSTEntry::CHANGE_LOG_SIZE] = i;
+        shminfo.changeSeq++;
+    }
+
+    // an updated index has to answer like one built from scratch
+    void expectSameAsRebuilt(const ExtentMapIndex& index, LBID_t lastLBID, int lastOID)
+    {
+        ExtentMapIndex rebuilt(&entries[0], entries.size(), shminfo);
+
+        for (LBID_t lbid = 0; lbid <= lastLBID; lbid += 7)
+            ASSERT_EQ(rebuilt.findLBID(lbid), index.findLBID(lbid)) << "lbid " << lbid;
+
+        for (int oid = 0; oid <= lastOID; oid++)
+            ASSERT_EQ(rebuilt.findOID(oid), index.findOID(oid)) << "oid " << oid;
+    }
+
+    std::vector<EMEntry> entries;
+    MSTEntry shminfo;
+};
+
+TEST_F(ExtentMapIndexTest, FindLBID)
+{
+    ExtentMapIndex index(&entries[0], entries.size(), shminfo);
+
+    EXPECT_EQ(1, index.findLBID(0));
+    EXPECT_EQ(1, index.findLBID(1023));
+    EXPECT_EQ(3, index.findLBID(1024));
+    EXPECT_EQ(3, index.findLBID(2047));
+    // hole between two extents
+    EXPECT_EQ(-1, index.findLBID(2048));
+    EXPECT_EQ(-1, index.findLBID(2999));
+    EXPECT_EQ(0, index.findLBID(3000));
+    EXPECT_EQ(0, index.findLBID(3000 + 1023));
+    EXPECT_EQ(-1, index.findLBID(3000 + 1024));
+    EXPECT_EQ(4, index.findLBID(5048 + 1023));
+    EXPECT_EQ(-1, index.findLBID(5048 + 1024));
+}
+
+TEST_F(ExtentMapIndexTest, FindOID)
+{
+    ExtentMapIndex index(&entries[0], entries.size(), shminfo);
+
+    const std::vector<int>& oid5 = index.findOID(5);
+    ASSERT_EQ(2U, oid5.size());
+    EXPECT_EQ(1, oid5[0]);
+    EXPECT_EQ(3, oid5[1]);
+    EXPECT_EQ(1U, index.findOID(7).size());
+    EXPECT_TRUE(index.findOID(8).empty());
+}
+
+TEST_F(ExtentMapIndexTest, IsCurrent)
+{
+    ExtentMapIndex index(&entries[0], entries.size(), shminfo);
+    EXPECT_TRUE(index.isCurrent(shminfo));
+
+    MSTEntry changed = shminfo;
+    changed.changeSeq++;
+    EXPECT_FALSE(index.isCurrent(changed));
+
+    changed = shminfo;
+    changed.tableShmkey++;
+    EXPECT_FALSE(index.isCurrent(changed));
+
+    // HWM and CP updates don't count as changes
+    changed = shminfo;
+    changed.currentSize -= sizeof(EMEntry);
+    EXPECT_TRUE(index.isCurrent(changed));
+}
+
+TEST_F(ExtentMapIndexTest, UpdateFollowsChanges)
+{
+    ExtentMapIndex index(&entries[0], entries.size(), shminfo);
+
+    // delete one extent, create one in the free slot and one in the slot
+    // of the deleted extent, for another OID
+    entries[1].range.size = 0;
+    logChange(1);
+    addExtent(2, 7000, 1, 5);
+    logChange(2);
+    addExtent(1, 9000, 2, 8);
+    logChange(1);
+
+    ASSERT_TRUE(index.update(&entries[0], entries.size(), shminfo));
+    EXPECT_TRUE(index.isCurrent(shminfo));
+    EXPECT_EQ(-1, index.findLBID(0));
+    EXPECT_EQ(2, index.findLBID(7000));
+    EXPECT_EQ(1, index.findLBID(9000 + 2047));
+
+    const std::vector<int>& oid5 = index.findOID(5);
+    ASSERT_EQ(2U, oid5.size());
+    EXPECT_EQ(2, oid5[0]);
+    EXPECT_EQ(3, oid5[1]);
+    expectSameAsRebuilt(index, 12000, 10);
+
+    // nothing changed
+    EXPECT_TRUE(index.update(&entries[0], entries.size(), shminfo));
+}
+
+TEST_F(ExtentMapIndexTest, UpdateNeedsTheWholeLog)
+{
+    ExtentMapIndex index(&entries[0], entries.size(), shminfo);
+
+    entries[1].range.size = 0;
+
+    for (uint32_t i = 0; i <= MSTEntry::CHANGE_LOG_SIZE; i++)
+        logChange(1);
+
+    EXPECT_FALSE(index.update(&entries[0], entries.size(), shminfo));
+
+    // left as it was
+    EXPECT_EQ(1, index.findLBID(0));
+    EXPECT_FALSE(index.isCurrent(shminfo));
+}
+
+TEST_F(ExtentMapIndexTest, UpdateAcrossGrownSegment)
+{
+    ExtentMapIndex index(&entries[0], entries.size(), shminfo);
+
+    // a new segment without a grow logged is a different EM
+    MSTEntry other = shminfo;
+    other.tableShmkey++;
+    EXPECT_FALSE(index.update(&entries[0], entries.size(), other));
+
+    resize(8);
+    shminfo.tableShmkey++;
+    shminfo.allocdSize = entries.size() * sizeof(EMEntry);
+    logChange(MSTEntry::SEGMENT_GROWN);
+    addExtent(6, 8000, 1, 6);
+    logChange(6);
+
+    ASSERT_TRUE(index.update(&entries[0], entries.size(), shminfo));
+    EXPECT_EQ(6, index.findLBID(8000));
+    EXPECT_EQ(2U, index.findOID(6).size());
+    expectSameAsRebuilt(index, 10000, 10);
+}
+
+// Another process catching up now and then with a writer creating and
+// deleting extents
+TEST_F(ExtentMapIndexTest, InterleavedChanges)
+{
+    std::mt19937 gen(3);
+    entries.clear();
+    resize(64);
+    shminfo.allocdSize = entries.size() * sizeof(EMEntry);
+    ExtentMapIndex writer(&entries[0], entries.size(), shminfo);
+    ExtentMapIndex reader(&entries[0], entries.size(), shminfo);
+
+    for (int step = 0; step < 2000; step++)
+    {
+        int i = gen() % entries.size();
+
+        if (entries[i].range.size == 0)
+            addExtent(i, (LBID_t) i * 4096 + (gen() % 3) * 1024, 1 + gen() % 2, gen() % 10);
+        else
+            entries[i].range.size = 0;
+
+        logChange(i);
+        ASSERT_TRUE(writer.update(&entries[0], entries.size(), shminfo));
+
+        if (step % 13 == 0 || step % 97 == 0)
+            ASSERT_TRUE(reader.update(&entries[0], entries.size(), shminfo));
+
+        if (step % 97 == 0)
+        {
+            expectSameAsRebuilt(writer, 64 * 4096, 10);
+            expectSameAsRebuilt(reader, 64 * 4096, 10);
+        }
+    }
+}
+
+// Creates, deletes and rollbacks through the ExtentMap itself, with lookups
+// in between.  Needs the BRM shared memory, the OIDs used are far above the
+// ones a test system hands out.
+class ExtentMapTest : public ::testing::Test
+{
+protected:
+    static const int FIRST_OID = 2000000000;
+    static const int OIDS = 4;
+
+    void TearDown() override
+    {
+        for (int oid = FIRST_OID; oid < FIRST_OID + OIDS; oid++)
+        {
+            try
+            {
+                em.deleteOID(oid);
+                em.confirmChanges();
+            }
+            catch (std::exception&)
+            {
+                em.undoChanges();
+            }
+        }
+    }
+
+    struct Extent
+    {
+        int oid;
+        LBID_t lbid;
+        int size;
+        uint32_t fbo;
+    };
+
+    void createExtent(int oid)
+    {
+        Extent e;
+        e.oid = oid;
+        em.createDictStoreExtent(oid, 1, 0, 0, e.lbid, e.size);
+        em.confirmChanges();
+
+        int lookupOID;
+        uint16_t dbRoot, segment;
+        uint32_t partition;
+        ASSERT_EQ(0, em.lookupLocal(e.lbid, lookupOID, dbRoot, partition, segment, e.fbo));
+        extents.push_back(e);
+    }
+
+    void expectLookups()
+    {
+        std::map<int, size_t> perOID;
+
+        for (size_t i = 0; i < extents.size(); i++)
+        {
+            const Extent& e = extents[i];
+            int oid;
+            uint16_t dbRoot, segment;
+            uint32_t partition, fbo;
+            LBID_t lbid;
+
+            ASSERT_EQ(0, em.lookupLocal(e.lbid + e.size - 1, oid, dbRoot, partition, segment, fbo));
+            EXPECT_EQ(e.oid, oid);
+            EXPECT_EQ(e.fbo + e.size - 1, fbo);
+            ASSERT_EQ(0, em.lookupLocal(e.oid, 0, 0, e.fbo, lbid));
+            EXPECT_EQ(e.lbid, lbid);
+            perOID[e.oid]++;
+        }
+
+        for (int oid = FIRST_OID; oid < FIRST_OID + OIDS; oid++)
+        {
+            std::vector<EMEntry> oidExtents;
+            em.getExtents(oid, oidExtents, true, false);
+            EXPECT_EQ(perOID[oid], oidExtents.size()) << "oid " << oid;
+        }
+    }
+
+    ExtentMap em;
+    std::vector<Extent> extents;
+};
+
+TEST_F(ExtentMapTest, InterleavedCreatesAndLookups)
+{
+    for (int i = 0; i < 300; i++)
+    {
+        createExtent(FIRST_OID + i % OIDS);
+        expectLookups();
+    }
+
+    // a rolled back extent is gone from the index too
+    LBID_t lbid;
+    int size;
+    em.createDictStoreExtent(FIRST_OID, 1, 0, 0, lbid, size);
+    em.undoChanges();
+
+    int oid;
+    uint16_t dbRoot, segment;
+    uint32_t partition, fbo;
+    EXPECT_EQ(-1, em.lookupLocal(lbid, oid, dbRoot, partition, segment, fbo));
+    expectLookups();
+
+    // the extents of the other OIDs are still found after a delete
+    em.deleteOID(FIRST_OID + 1);
+    em.confirmChanges();
+    std::vector<Extent> left;
+
+    for (size_t i = 0; i < extents.size(); i++)
+    {
+        if (extents[i].oid != FIRST_OID + 1)
+            left.push_back(extents[i]);
+        else
+            EXPECT_EQ(-1, em.lookupLocal(extents[i].lbid, oid, dbRoot, partition, segment, fbo));
+    }
+
+    extents.swap(left);
+    expectLookups();
+    createExtent(FIRST_OID + 1);
+    expectLookups();
+}
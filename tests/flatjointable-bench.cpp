@@ -0,0 +1,176 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+/* Compares the join probe cost of FlatJoinTable with the tr1::unordered_multimap
+ * the join tables used before.  The small side has N distinct integer keys,
+ * every other one with a duplicate; the large side probes with random keys of
+ * which about half are in the small side.
+ *
+ *   flatjointable-bench [small side keys] [large side probes]
+ */
+
+#include <stdlib.h>
+#include <sys/time.h>
+#include <iostream>
+#include <iomanip>
+#include <limits>
+#include <vector>
+#include <tr1/unordered_map>
+
+#include "flatjointable.h"
+#include "stlpoolallocator.h"
+
+using namespace std;
+using namespace joiner;
+
+namespace
+{
+
+// same hash as TupleJoiner::hasher
+struct IntHasher
+{
+    size_t operator()(uint64_t val) const
+    {
+        return fHasher((char*) &val, 8);
+    }
+
+    utils::Hasher fHasher;
+};
+
+typedef tr1::unordered_multimap<uint64_t, uint32_t, IntHasher, equal_to<uint64_t>,
+        utils::STLPoolAllocator<pair<const uint64_t, uint32_t> > > TR1Table;
+typedef FlatJoinTable<uint64_t, uint32_t, IntHasher> FlatTable;
+
+const uint32_t BATCH_SIZE = 8192;   // a logical block of rids
+
+double now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+uint64_t randomKey()
+{
+    return ((uint64_t) random() << 31) | random();
+}
+
+void report(const char* name, double seconds, uint64_t probes, uint64_t matches, uint64_t mem)
+{
+    cout << setw(24) << left << name << setw(10) << right << fixed << setprecision(1) <<
+         (seconds * 1000000000.0 / probes) << " ns/op" << setw(14) << matches << " matches" <<
+         setw(10) << (mem >> 20) << " MB" << endl;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t keyCount = (argc > 1 ? strtoull(argv[1], NULL, 0) : 4000000);
+    uint64_t probeCount = (argc > 2 ? strtoull(argv[2], NULL, 0) : 20000000);
+    vector<uint64_t> smallKeys(keyCount), probes(probeCount);
+    uint64_t i, j, matches;
+    double start;
+
+    srandom(1);
+
+    for (i = 0; i < keyCount; i++)
+        smallKeys[i] = randomKey();
+
+    for (i = 0; i < probeCount; i++)
+        probes[i] = (random() & 1 ? smallKeys[random() % keyCount] : randomKey());
+
+    cout << keyCount << " small side keys, " << probeCount << " probes" << endl;
+
+    {
+        utils::STLPoolAllocator<pair<const uint64_t, uint32_t> > alloc;
+        TR1Table table(10, IntHasher(), TR1Table::key_equal(), alloc);
+
+        start = now();
+
+        for (i = 0; i < keyCount; i++)
+        {
+            table.insert(make_pair(smallKeys[i], (uint32_t) i));
+
+            if (i % 2 == 0)
+                table.insert(make_pair(smallKeys[i], (uint32_t) i));
+        }
+
+        report("tr1 insert", now() - start, keyCount, 0, alloc.getPoolAllocator()->getMemUsage());
+
+        matches = 0;
+        start = now();
+
+        for (i = 0; i < probeCount; i++)
+        {
+            pair<TR1Table::iterator, TR1Table::iterator> range = table.equal_range(probes[i]);
+
+            for (; range.first != range.second; ++range.first)
+                matches++;
+        }
+
+        report("tr1 equal_range", now() - start, probeCount, matches, 0);
+    }
+
+    {
+        FlatTable table;
+
+        start = now();
+
+        for (i = 0; i < keyCount; i++)
+        {
+            table.insert(make_pair(smallKeys[i], (uint32_t) i));
+
+            if (i % 2 == 0)
+                table.insert(make_pair(smallKeys[i], (uint32_t) i));
+        }
+
+        report("flat insert", now() - start, keyCount, 0, table.getMemUsage());
+
+        matches = 0;
+        start = now();
+
+        for (i = 0; i < probeCount; i++)
+        {
+            pair<FlatTable::iterator, FlatTable::iterator> range = table.equal_range(probes[i]);
+
+            for (; range.first != range.second; ++range.first)
+                matches++;
+        }
+
+        report("flat equal_range", now() - start, probeCount, matches, 0);
+
+        vector<FlatTable::iterator> results(BATCH_SIZE);
+        matches = 0;
+        start = now();
+
+        for (i = 0; i < probeCount; i += BATCH_SIZE)
+        {
+            uint32_t count = min<uint64_t>(BATCH_SIZE, probeCount - i);
+            table.findBatch(&probes[i], count, &results[0]);
+
+            for (j = 0; j < count; j++)
+                for (FlatTable::iterator it = results[j]; it != table.end(); ++it)
+                    matches++;
+        }
+
+        report("flat findBatch", now() - start, probeCount, matches, 0);
+    }
+
+    return 0;
+}
+// vim:ts=4 sw=4:
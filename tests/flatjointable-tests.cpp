@@ -0,0 +1,173 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <algorithm>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "flatjointable.h"
+
+using namespace std;
+using namespace joiner;
+
+namespace
+{
+
+struct IntHasher
+{
+    size_t operator()(uint64_t val) const
+    {
+        return fHasher((char*) &val, 8);
+    }
+
+    utils::Hasher fHasher;
+};
+
+// every key gets the same hash, all of them share one probe sequence
+struct CollidingHasher
+{
+    size_t operator()(uint64_t) const
+    {
+        return 7;
+    }
+};
+
+typedef FlatJoinTable<uint64_t, uint32_t, IntHasher> IntTable;
+
+vector<uint32_t> valuesOf(IntTable::iterator it, IntTable::iterator end)
+{
+    vector<uint32_t> ret;
+
+    for (; it != end; ++it)
+        ret.push_back(it->second);
+
+    sort(ret.begin(), ret.end());
+    return ret;
+}
+
+}
+
+TEST(FlatJoinTableTest, FindAndDuplicates)
+{
+    const uint32_t keyCount = 50000;
+    IntTable table;
+
+    // every key goes in three times, enough to make the table grow a few times
+    for (uint32_t dup = 0; dup < 3; dup++)
+        for (uint32_t i = 0; i < keyCount; i++)
+            table.insert(make_pair((uint64_t) i * 2, i * 3 + dup));
+
+    EXPECT_EQ(keyCount * 3, table.size());
+
+    for (uint32_t i = 0; i < keyCount; i++)
+    {
+        pair<IntTable::iterator, IntTable::iterator> range = table.equal_range(i * 2);
+        vector<uint32_t> expected = { i * 3, i * 3 + 1, i * 3 + 2 };
+
+        ASSERT_EQ(expected, valuesOf(range.first, range.second));
+        EXPECT_TRUE(table.find(i * 2 + 1) == table.end());
+    }
+}
+
+TEST(FlatJoinTableTest, FullIteration)
+{
+    IntTable table;
+    IntTable::iterator it;
+    uint32_t count = 0;
+    uint64_t sum = 0;
+
+    EXPECT_TRUE(table.empty());
+    EXPECT_TRUE(table.begin() == table.end());
+
+    for (uint32_t i = 0; i < 1000; i++)
+        table.insert(make_pair((uint64_t) i % 10, i));
+
+    for (it = table.begin(); it != table.end(); ++it)
+    {
+        count++;
+        sum += it->second;
+    }
+
+    EXPECT_EQ(1000U, count);
+    EXPECT_EQ(999U * 1000 / 2, sum);
+}
+
+TEST(FlatJoinTableTest, CollidingHashes)
+{
+    FlatJoinTable<uint64_t, uint32_t, CollidingHasher> table;
+
+    for (uint32_t i = 0; i < 100; i++)
+        table.insert(make_pair((uint64_t) i, i));
+
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        FlatJoinTable<uint64_t, uint32_t, CollidingHasher>::iterator it = table.find(i);
+        ASSERT_TRUE(it != table.end());
+        EXPECT_EQ(i, it->second);
+        EXPECT_TRUE(++it == table.end());
+    }
+
+    EXPECT_TRUE(table.find(100) == table.end());
+}
+
+TEST(FlatJoinTableTest, FindBatch)
+{
+    const uint32_t keyCount = 10000;
+    IntTable table(keyCount);
+    vector<uint64_t> keys;
+    vector<IntTable::iterator> results(keyCount * 2 + 5);
+
+    for (uint32_t i = 0; i < keyCount; i++)
+        table.insert(make_pair((uint64_t) i * 2, i));
+
+    // an odd count leaves a partial group at the end
+    for (uint32_t i = 0; i < keyCount * 2 + 5; i++)
+        keys.push_back(i);
+
+    table.findBatch(&keys[0], keys.size(), &results[0]);
+
+    for (uint32_t i = 0; i < keys.size(); i++)
+    {
+        IntTable::iterator it = table.find(keys[i]);
+        ASSERT_TRUE(results[i] == it);
+
+        if (i % 2 == 0 && i < keyCount * 2)
+        {
+            EXPECT_EQ(i / 2, results[i]->second);
+        }
+    }
+}
+
+TEST(FlatJoinTableTest, ClearAndMemUsage)
+{
+    IntTable table;
+    uint64_t emptyUsage = table.getMemUsage();
+
+    for (uint32_t i = 0; i < 10000; i++)
+        table.insert(make_pair((uint64_t) i, i));
+
+    EXPECT_GT(table.getMemUsage(), emptyUsage + 10000 * sizeof(IntTable::value_type));
+
+    table.clear();
+    EXPECT_TRUE(table.empty());
+    EXPECT_EQ(emptyUsage, table.getMemUsage());
+    EXPECT_TRUE(table.find(1) == table.end());
+
+    table.insert(make_pair((uint64_t) 1, 2U));
+    EXPECT_EQ(2U, table.find(1)->second);
+}
+// vim:ts=4 sw=4:
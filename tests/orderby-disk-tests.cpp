@@ -0,0 +1,379 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "idbcompress.h"
+#include "jlf_common.h"
+#include "limitedorderby.h"
+#include "resourcemanager.h"
+#include "rowgroup.h"
+
+using namespace joblist;
+
+namespace
+{
+
+const int64_t MEMORY_LIMIT = 8LL * 1024 * 1024 * 1024;
+
+}
+
+// Sorted runs of (key, id) rows, ordered by key
+class OrderByDiskTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char dirTemplate[] = "/tmp/orderby-disk-tests-XXXXXX";
+        ASSERT_NE(mkdtemp(dirTemplate), nullptr);
+        dir = dirTemplate;
+        rm = ResourceManager::instance(true);
+        nextId = 0;
+
+        std::vector<uint32_t> offsets, roids, tkeys, cscale, cprecision, charSetNumVec;
+        std::vector<execplan::CalpontSystemCatalog::ColDataType> types;
+        offsets.push_back(2);
+        offsets.push_back(10);
+        offsets.push_back(18);
+        roids.push_back(3001);
+        roids.push_back(3002);
+        tkeys.push_back(1);
+        tkeys.push_back(2);
+        types.push_back(execplan::CalpontSystemCatalog::BIGINT);
+        types.push_back(execplan::CalpontSystemCatalog::BIGINT);
+        cscale.push_back(0);
+        cscale.push_back(0);
+        cprecision.push_back(19);
+        cprecision.push_back(19);
+        charSetNumVec.push_back(8);
+        charSetNumVec.push_back(8);
+        rg = rowgroup::RowGroup(2, offsets, roids, tkeys, types, charSetNumVec, cscale, cprecision,
+                                20, false);
+
+        rowData.reinit(rg, 1);
+        rg.setData(&rowData);
+        rg.resetRowGroup(0);
+        rg.initRow(&row);
+        rg.getRow(0, &row);
+    }
+
+    void TearDown() override
+    {
+        orderBys.clear();
+        EXPECT_EQ(filesLeft(), 0U);
+        rmdir(dir.c_str());
+    }
+
+    // like a thread of a parallel ORDER BY, which keeps OFFSET + LIMIT rows
+    LimitedOrderBy* makeOrderBy(bool asc, bool compress, uint64_t limitStart = 0,
+                                uint64_t limitCount = -1)
+    {
+        JobInfo jobInfo(rm);
+        jobInfo.orderByColVec.push_back(std::make_pair(1, asc));
+        jobInfo.limitStart = limitStart;
+        jobInfo.limitCount = limitCount;
+        jobInfo.umMemLimit.reset(new int64_t);
+        *(jobInfo.umMemLimit) = MEMORY_LIMIT;
+
+        LimitedOrderBy* orderBy = new LimitedOrderBy();
+        orderBy->initialize(rg, jobInfo, false, true);
+        orderBy->enableDiskBased(dir + "/" + std::to_string(orderBys.size()) + "-",
+                                 ResourceManager::getTempFileCompressionType(compress ? "LZ4" : "N"));
+        orderBys.emplace_back(orderBy);
+        return orderBy;
+    }
+
+    std::vector<int64_t> randomKeys(size_t n, uint32_t seed)
+    {
+        std::mt19937 gen(seed);
+        std::uniform_int_distribution<int64_t> dist(-5000, 5000);
+        std::vector<int64_t> keys(n);
+
+        for (size_t i = 0; i < n; i++)
+            keys[i] = dist(gen);
+
+        return keys;
+    }
+
+    // processes the rows and writes them out as one more run
+    void addRun(LimitedOrderBy* orderBy, const std::vector<int64_t>& keys)
+    {
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            row.setIntField(keys[i], 0);
+            row.setIntField(nextId++, 1);
+            orderBy->processRow(row);
+        }
+
+        orderBy->spillRun();
+    }
+
+    // writes the keys in the given order as a run, without a LimitedOrderBy
+    std::string writeRun(const std::vector<int64_t>& keys)
+    {
+        std::string filename = dir + "/run" + std::to_string(nextId);
+
+        compress::CompressInterface* compressor = nullptr;
+        SortedRunWriter writer(filename, rg, compressor);
+
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            row.setIntField(keys[i], 0);
+            row.setIntField(nextId++, 1);
+            writer.write(row);
+        }
+
+        writer.flush();
+        return filename;
+    }
+
+    std::vector<int64_t> sorted(std::vector<int64_t> keys, bool asc)
+    {
+        if (asc)
+            std::sort(keys.begin(), keys.end());
+        else
+            std::sort(keys.begin(), keys.end(), std::greater<int64_t>());
+
+        return keys;
+    }
+
+    size_t filesLeft() const
+    {
+        size_t count = 0;
+        DIR* d = opendir(dir.c_str());
+
+        if (!d)
+            return 0;
+
+        while (struct dirent* e = readdir(d))
+        {
+            if (e->d_name[0] != '.')
+                count++;
+        }
+
+        closedir(d);
+        return count;
+    }
+
+    std::string dir;
+    ResourceManager* rm;
+    rowgroup::RowGroup rg;
+    rowgroup::RGData rowData;
+    rowgroup::Row row;
+    int64_t nextId;
+    std::vector<std::unique_ptr<LimitedOrderBy> > orderBys;
+};
+
+TEST_F(OrderByDiskTest, SpillRunRoundTrip)
+{
+    for (bool compress : {false, true})
+    {
+        LimitedOrderBy* orderBy = makeOrderBy(true, compress);
+        EXPECT_EQ(orderBy->getCompressor() != nullptr,
+                  compress && compress::CompressInterface::isCompressionAvail(3));
+
+        // more than a RowGroup in the first run
+        std::vector<std::vector<int64_t> > runs;
+        runs.push_back(randomKeys(rowgroup::rgCommonSize * 2 + 100, 1));
+        runs.push_back(randomKeys(10, 2));
+
+        for (size_t i = 0; i < runs.size(); i++)
+            addRun(orderBy, runs[i]);
+
+        // nothing was left in memory
+        orderBy->spillRun();
+        ASSERT_EQ(orderBy->getRunFiles().size(), runs.size());
+
+        for (size_t i = 0; i < runs.size(); i++)
+        {
+            const std::string& filename = orderBy->getRunFiles()[i];
+            SortedRun run(filename, rg, orderBy->getCompressor());
+            std::vector<int64_t> keys;
+
+            while (run.next())
+                keys.push_back(run.getRow().getIntField(0));
+
+            EXPECT_EQ(keys, sorted(runs[i], true)) << "compress " << compress << " run " << i;
+
+            // a run is deleted once it is read
+            EXPECT_NE(access(filename.c_str(), F_OK), 0);
+        }
+    }
+}
+
+TEST_F(OrderByDiskTest, LoserTree)
+{
+    for (bool asc : {true, false})
+    {
+        LimitedOrderBy* orderBy = makeOrderBy(asc, false);
+
+        // k = 1, 2, a power of two with empty runs and a non-power of two
+        std::vector<std::vector<std::vector<int64_t> > > cases = {
+            {randomKeys(100, 3)},
+            {randomKeys(50, 4), randomKeys(70, 5)},
+            {{}, randomKeys(30, 6), {}, {}},
+            {randomKeys(40, 7), {42}, {}, randomKeys(300, 8), {-7, -7},
+             randomKeys(rowgroup::rgCommonSize + 1, 9), {}}};
+
+        for (size_t c = 0; c < cases.size(); c++)
+        {
+            SortedRunMerger merger(orderBy->getRule());
+            std::vector<int64_t> all;
+
+            for (size_t i = 0; i < cases[c].size(); i++)
+            {
+                std::vector<int64_t> keys = sorted(cases[c][i], asc);
+                merger.addRun(boost::shared_ptr<SortedRun>(
+                    new SortedRun(writeRun(keys), rg, nullptr)));
+                all.insert(all.end(), keys.begin(), keys.end());
+            }
+
+            std::vector<int64_t> merged;
+
+            while (merger.next())
+                merged.push_back(merger.getRow().getIntField(0));
+
+            EXPECT_EQ(merged, sorted(all, asc)) << "asc " << asc << " k " << cases[c].size();
+            EXPECT_FALSE(merger.next());
+        }
+    }
+
+    // and no runs at all
+    SortedRunMerger merger(orderBys[0]->getRule());
+    EXPECT_FALSE(merger.next());
+}
+
+TEST_F(OrderByDiskTest, MultiPassMerge)
+{
+    for (bool asc : {true, false})
+    {
+        for (bool compress : {false, true})
+        {
+            LimitedOrderBy* orderBy = makeOrderBy(asc, compress);
+            std::vector<int64_t> all;
+
+            for (uint32_t i = 0; i < 23; i++)
+            {
+                std::vector<int64_t> keys = randomKeys(i * 37 % 500, 10 + i);
+                addRun(orderBy, keys);
+                all.insert(all.end(), keys.begin(), keys.end());
+            }
+
+            // the last run stays in memory until the merge
+            std::vector<int64_t> keys = randomKeys(123, 99);
+            for (size_t i = 0; i < keys.size(); i++)
+            {
+                row.setIntField(keys[i], 0);
+                row.setIntField(nextId++, 1);
+                orderBy->processRow(row);
+            }
+            all.insert(all.end(), keys.begin(), keys.end());
+
+            std::vector<int64_t> merged;
+            std::vector<bool> seen(nextId);
+
+            {
+                MultiPassMerger merger(std::vector<LimitedOrderBy*>(1, orderBy), rg, 0, -1, 3);
+
+                // 22 runs, the first has no rows, and the one from memory, 23 -> 8 -> 3
+                EXPECT_EQ(merger.passes(), 2U);
+
+                while (merger.next())
+                {
+                    merged.push_back(merger.getRow().getIntField(0));
+                    int64_t id = merger.getRow().getIntField(1);
+                    EXPECT_FALSE(seen[id]);
+                    seen[id] = true;
+                }
+            }
+
+            EXPECT_EQ(merged, sorted(all, asc)) << "asc " << asc << " compress " << compress;
+            EXPECT_EQ(filesLeft(), 0U);
+        }
+    }
+}
+
+TEST_F(OrderByDiskTest, MergeReturnsItsMemory)
+{
+    LimitedOrderBy* orderBy = makeOrderBy(true, false);
+
+    for (uint32_t i = 0; i < 5; i++)
+        addRun(orderBy, randomKeys(1000, 20 + i));
+
+    int64_t available = rm->availableMemory();
+
+    {
+        MultiPassMerger merger(std::vector<LimitedOrderBy*>(1, orderBy), rg, 0, -1, 2);
+        EXPECT_LT(rm->availableMemory(), available);
+        EXPECT_EQ(merger.passes(), 2U);
+
+        while (merger.next())
+            ;
+    }
+
+    EXPECT_EQ(rm->availableMemory(), available);
+}
+
+TEST_F(OrderByDiskTest, OffsetAndLimitAcrossRuns)
+{
+    const uint64_t limitStart = 1500;
+    const uint64_t limitCount = 7000;
+
+    for (uint64_t fanIn : {2UL, (uint64_t) MultiPassMerger::MAX_FAN_IN})
+    {
+        for (bool asc : {true, false})
+        {
+            // two threads with three runs each
+            std::vector<LimitedOrderBy*> threads;
+            std::vector<int64_t> all;
+
+            for (uint32_t t = 0; t < 2; t++)
+            {
+                threads.push_back(makeOrderBy(asc, false, limitStart, limitCount));
+
+                for (uint32_t i = 0; i < 3; i++)
+                {
+                    std::vector<int64_t> keys = randomKeys(2000, 30 + t * 3 + i);
+                    addRun(threads.back(), keys);
+                    all.insert(all.end(), keys.begin(), keys.end());
+                }
+            }
+
+            std::vector<int64_t> expected = sorted(all, asc);
+            expected.erase(expected.begin(), expected.begin() + limitStart);
+            expected.resize(limitCount);
+
+            std::vector<int64_t> merged;
+            MultiPassMerger merger(threads, rg, limitStart, limitCount, fanIn);
+
+            while (merger.next())
+                merged.push_back(merger.getRow().getIntField(0));
+
+            EXPECT_EQ(merged, expected) << "fan-in " << fanIn << " asc " << asc;
+            EXPECT_FALSE(merger.next());
+        }
+    }
+}
@@ -18,6 +18,8 @@
 #include <iostream>
 #include <gtest/gtest.h>
 #include "datatypes/mcs_datatype.h"
+#include "datatypes/mcs_decimal.h"
+#include "joblisttypes.h"
 #include "stats.h"
 #include "primitives/linux-port/primitiveprocessor.h"
 
@@ -82,6 +84,59 @@ class ColumnScanFilterTest : public ::testing::Test
     close(fd);
     return block;
   }
+
+  // Fill the block with a repeating sequence of values mixed with NULL and EMPTY ones
+  template<typename T>
+  void fillBlock(T nullValue, T emptyValue, int64_t modulo, int64_t offset)
+  {
+    T* values = reinterpret_cast<T*>(block);
+
+    for (uint32_t j = 0; j < BLOCK_SIZE / sizeof(T); j++)
+    {
+      if (j % 13 == 0)
+        values[j] = nullValue;
+      else if (j % 17 == 0)
+        values[j] = emptyValue;
+      else
+        values[j] = static_cast<T>(static_cast<int64_t>(j * 7 % modulo) - offset);
+    }
+    pp.setBlockPtr((int*) block);
+  }
+
+  template<typename T>
+  void setFilter(uint32_t index, uint8_t cop, T value)
+  {
+    ColArgs* arg = reinterpret_cast<ColArgs*>(&input[sizeof(NewColRequestHeader) +
+                                                     index * (sizeof(ColArgs) + sizeof(T))]);
+    arg->COP = cop;
+    arg->rf = 0;
+    memcpy(arg->val, &value, sizeof(T));
+  }
+
+  // Scan the block using the given SIMD level and return the whole result message
+  template<typename T>
+  std::vector<uint8_t> scanWithSimdLevel(simd::SimdLevel level)
+  {
+    memset(output, 0, 4 * BLOCK_SIZE);
+    pp.setSimdLevel(level);
+    pp.columnScanAndFilter<T>(in, out, 4 * BLOCK_SIZE, &written);
+    return std::vector<uint8_t>(output, output + written);
+  }
+
+  // The vectorized filter must produce exactly the same message as the row-at-a-time one
+  template<typename T>
+  void expectVerticalMatchesScalar()
+  {
+    std::vector<uint8_t> expected = scanWithSimdLevel<T>(simd::SIMD_NONE);
+
+    for (auto level : {simd::SIMD_GENERIC, simd::SIMD_SSE42, simd::SIMD_AVX2})
+    {
+      if (level > simd::hostSimdLevel())
+        continue;
+
+      EXPECT_EQ(scanWithSimdLevel<T>(level), expected) << "SIMD level " << level;
+    }
+  }
 };
 
 TEST_F(ColumnScanFilterTest, ColumnScan1Byte)
@@ -626,4 +681,127 @@ TEST_F(ColumnScanFilterTest, ColumnScan16Bytes2CompFilters)
 {
 //TBD
 }
+TEST_F(ColumnScanFilterTest, ColumnScanVertical1ByteUnsignedInArray)
+{
+  using IntegralType = uint8_t;
+  in->colType.DataSize = 1;
+  in->colType.DataType = SystemCatalog::UTINYINT;
+  in->OutputType = OT_BOTH;
+  in->BOP = BOP_OR;
+  in->NOPS = 3;
+  in->NVALS = 0;
+
+  setFilter<IntegralType>(0, COMPARE_EQ, 7);
+  setFilter<IntegralType>(1, COMPARE_EQ, 200);
+  setFilter<IntegralType>(2, COMPARE_EQ, 252);
+  fillBlock<IntegralType>(joblist::UTINYINTNULL, joblist::UTINYINTEMPTYROW, 253, 0);
+
+  expectVerticalMatchesScalar<int8_t>();
+  ASSERT_GT(out->NVALS, 0);
+}
+
+TEST_F(ColumnScanFilterTest, ColumnScanVertical2BytesXorFilters)
+{
+  using IntegralType = int16_t;
+  in->colType.DataSize = 2;
+  in->colType.DataType = SystemCatalog::SMALLINT;
+  in->OutputType = OT_DATAVALUE;
+  in->BOP = BOP_XOR;
+  in->NOPS = 2;
+  in->NVALS = 0;
+
+  setFilter<IntegralType>(0, COMPARE_LE, 500);
+  setFilter<IntegralType>(1, COMPARE_GE, -50);
+  fillBlock<IntegralType>(joblist::SMALLINTNULL, joblist::SMALLINTEMPTYROW, 3000, 1000);
+
+  expectVerticalMatchesScalar<IntegralType>();
+  ASSERT_GT(out->NVALS, 0);
+}
+
+TEST_F(ColumnScanFilterTest, ColumnScanVertical4BytesNullAndMinMax)
+{
+  using IntegralType = int32_t;
+  in->colType.DataSize = 4;
+  in->colType.DataType = SystemCatalog::INT;
+  in->OutputType = OT_BOTH;
+  in->BOP = BOP_OR;
+  in->NOPS = 2;
+  in->NVALS = 0;
+
+  // Every 13th value is NULL.  NULLs never match a filter, not even
+  // COMPARE_NE against the NULL value, so the OR returns only non-NULL rows
+  // and Min/Max are taken over those rows.
+  setFilter<IntegralType>(0, COMPARE_LT, 10);
+  setFilter<IntegralType>(1, COMPARE_NE, (IntegralType) joblist::INTNULL);
+  fillBlock<IntegralType>(joblist::INTNULL, joblist::INTEMPTYROW, 5000, 2500);
+
+  expectVerticalMatchesScalar<IntegralType>();
+  ASSERT_TRUE(out->ValidMinMax);
+  ASSERT_TRUE(out->Min == -2493);
+}
+
+TEST_F(ColumnScanFilterTest, ColumnScanVertical8BytesUsingRID)
+{
+  using IntegralType = int64_t;
+  in->colType.DataSize = 8;
+  in->colType.DataType = SystemCatalog::BIGINT;
+  in->OutputType = OT_RID;
+  in->BOP = BOP_AND;
+  in->NOPS = 2;
+  in->NVALS = 300;
+
+  setFilter<IntegralType>(0, COMPARE_GT, -100);
+  setFilter<IntegralType>(1, COMPARE_NE, 1000);
+  rids = reinterpret_cast<uint16_t*>(&input[sizeof(NewColRequestHeader) +
+                                     2 * (sizeof(ColArgs) + sizeof(IntegralType))]);
+
+  for (i = 0; i < in->NVALS; i++)
+    rids[i] = i * 3;
+
+  fillBlock<IntegralType>(joblist::BIGINTNULL, joblist::BIGINTEMPTYROW, 2000, 700);
+
+  expectVerticalMatchesScalar<IntegralType>();
+  ASSERT_GT(out->NVALS, 0);
+}
+
+TEST_F(ColumnScanFilterTest, ColumnScanVertical8BytesDouble)
+{
+  using IntegralType = int64_t;
+  in->colType.DataSize = 8;
+  in->colType.DataType = SystemCatalog::DOUBLE;
+  in->OutputType = OT_BOTH;
+  in->BOP = BOP_AND;
+  in->NOPS = 2;
+  in->NVALS = 0;
+
+  setFilter<double>(0, COMPARE_GT, -5.0);
+  setFilter<double>(1, COMPARE_LT, 5.0);
+  double* values = reinterpret_cast<double*>(block);
+
+  for (i = 0; i < BLOCK_SIZE / sizeof(double); i++)
+    values[i] = (i % 40) * 0.5 - 10.0;
+
+  pp.setBlockPtr((int*) block);
+
+  expectVerticalMatchesScalar<IntegralType>();
+  ASSERT_EQ(out->NVALS, 488);
+}
+
+TEST_F(ColumnScanFilterTest, ColumnScanVertical16Bytes)
+{
+  using IntegralType = int128_t;
+  in->colType.DataSize = 16;
+  in->colType.DataType = SystemCatalog::DECIMAL;
+  in->OutputType = OT_DATAVALUE;
+  in->BOP = BOP_NONE;
+  in->NOPS = 1;
+  in->NVALS = 0;
+
+  setFilter<IntegralType>(0, COMPARE_GE, 3000);
+  fillBlock<IntegralType>(datatypes::Decimal128Null, datatypes::Decimal128Empty, 4000, 0);
+
+  expectVerticalMatchesScalar<IntegralType>();
+  ASSERT_GT(out->NVALS, 0);
+}
+
 // vim:ts=2 sw=2:
@@ -0,0 +1,163 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <vector>
+#include <atomic>
+#include <boost/thread/mutex.hpp>
+
+#include "prioritythreadpool.h"
+
+using namespace threadpool;
+
+namespace
+{
+
+// records the order the jobs ran in
+struct RunLog
+{
+    RunLog() : gate(true) { }
+
+    void ran(uint32_t query)
+    {
+        boost::mutex::scoped_lock lk(mutex);
+        order.push_back(query);
+    }
+
+    size_t count()
+    {
+        boost::mutex::scoped_lock lk(mutex);
+        return order.size();
+    }
+
+    boost::mutex mutex;
+    std::vector<uint32_t> order;
+    std::atomic<bool> gate;
+};
+
+class LoggedJob : public PriorityThreadPool::Functor
+{
+public:
+    LoggedJob(RunLog& l, uint32_t q, int runs = 1) : log(l), query(q), runsLeft(runs) { }
+
+    int operator()()
+    {
+        while (!log.gate)
+            usleep(1000);
+
+        // -1 reschedules the job, like a BPP waiting for its input
+        if (--runsLeft > 0)
+            return -1;
+
+        log.ran(query);
+        return 0;
+    }
+
+private:
+    RunLog& log;
+    uint32_t query;
+    int runsLeft;
+};
+
+PriorityThreadPool::Job makeJob(RunLog& log, uint32_t query, int runs = 1)
+{
+    PriorityThreadPool::Job job;
+    job.functor.reset(new LoggedJob(log, query, runs));
+    job.id = query;
+    job.uniqueID = query;
+    return job;
+}
+
+bool waitFor(RunLog& log, size_t count)
+{
+    for (int i = 0; i < 5000 && log.count() < count; i++)
+        usleep(1000);
+
+    return log.count() == count;
+}
+
+}
+
+TEST(PriorityThreadPoolTest, RunsAndReschedulesJobs)
+{
+    RunLog log;
+    PriorityThreadPool pool(8, 0, 0, 4);
+
+    for (uint32_t i = 0; i < 200; i++)
+        pool.addJob(makeJob(log, i % 5, 1 + i % 3));
+
+    EXPECT_TRUE(waitFor(log, 200));
+    EXPECT_EQ(0U, pool.getStats(PriorityThreadPool::LOW).depth);
+    EXPECT_GE(pool.getStats(PriorityThreadPool::LOW).jobsRun, 200U);
+    pool.stop();
+}
+
+TEST(PriorityThreadPoolTest, QueriesTakeTurns)
+{
+    RunLog log;
+    PriorityThreadPool pool(1, 0, 0, 1);
+
+    // hold the only thread while the queue fills up
+    log.gate = false;
+    pool.addJob(makeJob(log, 0));
+    usleep(20000);
+
+    for (uint32_t i = 0; i < 500; i++)
+        pool.addJob(makeJob(log, 1));
+
+    for (uint32_t i = 0; i < 10; i++)
+        pool.addJob(makeJob(log, 2));
+
+    log.gate = true;
+    ASSERT_TRUE(waitFor(log, 511));
+
+    // the small query doesn't wait for the big one to drain
+    size_t lastSmall = 0;
+
+    for (size_t i = 0; i < log.order.size(); i++)
+        if (log.order[i] == 2)
+            lastSmall = i;
+
+    EXPECT_LT(lastSmall, 30U);
+    pool.stop();
+}
+
+TEST(PriorityThreadPoolTest, RemoveJobs)
+{
+    RunLog log;
+    PriorityThreadPool pool(1, 0, 0, 1);
+
+    log.gate = false;
+    pool.addJob(makeJob(log, 0));
+    usleep(20000);
+
+    for (uint32_t i = 0; i < 100; i++)
+        pool.addJob(makeJob(log, 1 + i % 2));
+
+    pool.removeJobs(1);
+    EXPECT_EQ(50U, pool.getStats(PriorityThreadPool::LOW).depth);
+
+    log.gate = true;
+    ASSERT_TRUE(waitFor(log, 51));
+
+    for (size_t i = 0; i < log.order.size(); i++)
+        EXPECT_NE(1U, log.order[i]);
+
+    pool.stop();
+}
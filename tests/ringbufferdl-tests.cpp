@@ -0,0 +1,286 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+#include <thread>
+#include <vector>
+
+#include "ringbufferdl.h"
+
+using namespace joblist;
+
+namespace
+{
+
+typedef RingBufferDL<uint64_t> Ring;
+
+// polls a counter the other thread bumps right before it goes to sleep
+template<typename Counter>
+bool waitFor(Counter counter, uint64_t expected)
+{
+    for (int i = 0; i < 5000; i++)
+    {
+        if (counter() >= expected)
+            return true;
+
+        usleep(1000);
+    }
+
+    return false;
+}
+
+// reads until the end of input, checking the elements come in insertion order
+void readAll(Ring& ring, uint64_t it, uint64_t expected, uint64_t& count)
+{
+    uint64_t e;
+
+    count = 0;
+
+    while (ring.next(it, &e))
+    {
+        EXPECT_EQ(e, count);
+        count++;
+    }
+
+    EXPECT_EQ(count, expected);
+}
+
+}
+
+TEST(RingBufferDLTest, CapacityIsAPowerOfTwo)
+{
+    Ring ring(1, 5);
+    EXPECT_EQ(ring.maxElements(), 5U);
+
+    // 8 elements fit in a ring asked for 5
+    for (uint64_t i = 0; i < 8; i++)
+        ring.insert(i);
+
+    EXPECT_TRUE(ring.isOutputBlocked());
+    EXPECT_EQ(ring.blockedWriteCount(), 0U);
+
+    uint64_t count;
+    ring.endOfInput();
+    readAll(ring, ring.getIterator(), 8, count);
+}
+
+TEST(RingBufferDLTest, Wraparound)
+{
+    Ring ring(1, 4);
+    uint64_t it = ring.getIterator();
+    uint64_t in = 0, out = 0, e;
+
+    // 3 in, 3 out, many times over a ring of 4
+    for (int round = 0; round < 100; round++)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            bool blocked, started;
+            ring.insert(in++, blocked, started);
+            EXPECT_EQ(started, round > 0);
+            EXPECT_FALSE(blocked);
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+            ASSERT_TRUE(ring.next(it, &e));
+            EXPECT_EQ(e, out++);
+        }
+    }
+
+    ring.endOfInput();
+    EXPECT_FALSE(ring.next(it, &e));
+    EXPECT_FALSE(ring.more(it));
+    EXPECT_EQ(ring.totalSize(), 300U);
+    EXPECT_EQ(ring.blockedWriteCount(), 0U);
+    EXPECT_EQ(ring.blockedReadCount(), 0U);
+}
+
+TEST(RingBufferDLTest, MultipleConsumersSeeEveryElement)
+{
+    const uint64_t n = 1000;
+    Ring ring(3, 8);
+    std::vector<uint64_t> counts(3);
+    std::vector<std::thread> consumers;
+
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        uint64_t it = ring.getIterator();
+        consumers.emplace_back(readAll, std::ref(ring), it, n, std::ref(counts[i]));
+    }
+
+    for (uint64_t i = 0; i < n; i++)
+        ring.insert(i);
+
+    ring.endOfInput();
+
+    for (std::thread& t : consumers)
+        t.join();
+
+    for (uint64_t count : counts)
+        EXPECT_EQ(count, n);
+}
+
+TEST(RingBufferDLTest, SlowConsumerHoldsTheProducer)
+{
+    Ring ring(2, 4);
+    uint64_t fast = ring.getIterator();
+    uint64_t slow = ring.getIterator();
+    uint64_t e;
+
+    for (uint64_t i = 0; i < 4; i++)
+        ring.insert(i);
+
+    // the fast consumer is done with all 4, the slow one with none
+    for (uint64_t i = 0; i < 4; i++)
+        ASSERT_TRUE(ring.next(fast, &e));
+
+    EXPECT_TRUE(ring.isOutputBlocked());
+
+    std::thread producer([&]()
+    {
+        ring.insert(4);
+        ring.endOfInput();
+    });
+
+    ASSERT_TRUE(waitFor([&]()
+    {
+        return ring.blockedWriteCount();
+    }, 1));
+
+    ASSERT_TRUE(ring.next(slow, &e));
+    EXPECT_EQ(e, 0U);
+    producer.join();
+
+    ASSERT_TRUE(ring.next(fast, &e));
+    EXPECT_EQ(e, 4U);
+    EXPECT_FALSE(ring.next(fast, &e));
+
+    for (uint64_t i = 1; i < 5; i++)
+    {
+        ASSERT_TRUE(ring.next(slow, &e));
+        EXPECT_EQ(e, i);
+    }
+
+    EXPECT_FALSE(ring.next(slow, &e));
+    EXPECT_EQ(ring.blockedWriteCount(), 1U);
+}
+
+TEST(RingBufferDLTest, BlockedConsumer)
+{
+    Ring ring(1, 4);
+    uint64_t it = ring.getIterator();
+    uint64_t e = 0;
+    bool got = false;
+
+    std::thread consumer([&]()
+    {
+        got = ring.next(it, &e);
+    });
+
+    ASSERT_TRUE(waitFor([&]()
+    {
+        return ring.blockedReadCount();
+    }, 1));
+
+    ring.insert(42);
+    consumer.join();
+
+    EXPECT_TRUE(got);
+    EXPECT_EQ(e, 42U);
+    EXPECT_EQ(ring.blockedReadCount(), 1U);
+    EXPECT_EQ(ring.blockedWriteCount(), 0U);
+}
+
+TEST(RingBufferDLTest, EndOfInputWakesReaders)
+{
+    Ring ring(2, 4);
+    std::vector<std::thread> consumers;
+    std::vector<uint64_t> counts(2, 1);
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        uint64_t it = ring.getIterator();
+        consumers.emplace_back(readAll, std::ref(ring), it, 0, std::ref(counts[i]));
+    }
+
+    // let both readers go to sleep on the empty ring
+    ASSERT_TRUE(waitFor([&]()
+    {
+        return ring.blockedReadCount();
+    }, 2));
+    usleep(10000);
+
+    ring.endOfInput();
+
+    for (std::thread& t : consumers)
+        t.join();
+
+    EXPECT_EQ(counts[0], 0U);
+    EXPECT_EQ(counts[1], 0U);
+}
+
+TEST(RingBufferDLTest, ProducerConsumerStress)
+{
+    const uint64_t n = 100000;
+    const uint32_t numConsumers = 3;
+    Ring ring(numConsumers, 16);
+    std::vector<uint64_t> counts(numConsumers);
+    std::vector<std::thread> consumers;
+
+    for (uint32_t i = 0; i < numConsumers; i++)
+    {
+        uint64_t it = ring.getIterator();
+        consumers.emplace_back(readAll, std::ref(ring), it, n, std::ref(counts[i]));
+    }
+
+    std::thread producer([&]()
+    {
+        std::vector<uint64_t> batch;
+
+        for (uint64_t i = 0; i < n; i++)
+        {
+            batch.push_back(i);
+
+            if (batch.size() < 7 && i + 1 < n)
+                continue;
+
+            // mix the vector and the single inserts
+            if ((i / 7) % 2)
+                ring.insert(batch);
+            else
+                for (uint64_t e : batch)
+                    ring.insert(e);
+
+            batch.clear();
+        }
+
+        ring.endOfInput();
+    });
+
+    producer.join();
+
+    for (std::thread& t : consumers)
+        t.join();
+
+    for (uint64_t count : counts)
+        EXPECT_EQ(count, n);
+
+    EXPECT_EQ(ring.totalSize(), n);
+}
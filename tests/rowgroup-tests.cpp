@@ -16,9 +16,14 @@
    MA 02110-1301, USA. */
 
 #include <gtest/gtest.h> // googletest header file
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
+#include <cstring>
+#include <memory>
 
 #include "rowgroup.h"
+#include "rowaggregation.h"
 #include "columnwidth.h"
 #include "joblisttypes.h"
 #include "dataconvert.h"
@@ -313,3 +318,420 @@ TEST_F(RowDecimalTest, RowEqualsCheck)
         }
     }
 }
+
+namespace
+{
+
+struct ColSpec
+{
+    CSCDataType type;
+    uint32_t width;
+    uint32_t scale;
+    uint32_t precision;
+};
+
+rowgroup::RowGroup makeRowGroup(const std::vector<ColSpec>& cols)
+{
+    std::vector<CSCDataType> types;
+    std::vector<uint32_t> offsets, roids, tkeys, cscale, precision, charSetNumVec;
+    uint32_t offset = INITIAL_ROW_OFFSET;
+    offsets.push_back(offset);
+
+    for (size_t i = 0; i < cols.size(); i++)
+    {
+        offset += cols[i].width;
+        offsets.push_back(offset);
+        roids.push_back(3001 + i);
+        tkeys.push_back(i + 1);
+        types.push_back(cols[i].type);
+        cscale.push_back(cols[i].scale);
+        precision.push_back(cols[i].precision);
+        charSetNumVec.push_back(8);
+    }
+
+    return rowgroup::RowGroup(cols.size(), offsets, roids, tkeys, types, charSetNumVec,
+                              cscale, precision, 20, false);
+}
+
+// the output column the aggregate steps make for a function of an input column
+ColSpec outputSpec(rowgroup::RowAggFunctionType func, const ColSpec& in)
+{
+    switch (func)
+    {
+        case rowgroup::ROWAGG_COUNT_ASTERISK:
+        case rowgroup::ROWAGG_COUNT_COL_NAME:
+            return {execplan::CalpontSystemCatalog::UBIGINT, 8, 0, 9999};
+
+        case rowgroup::ROWAGG_SUM:
+            if (in.width == datatypes::MAXDECIMALWIDTH)
+                return in;
+
+            if (datatypes::hasUnderlyingWideDecimalForSumAndAvg(in.type))
+                return {execplan::CalpontSystemCatalog::DECIMAL, datatypes::MAXDECIMALWIDTH, 0,
+                        datatypes::INT128MAXPRECISION};
+
+            return {execplan::CalpontSystemCatalog::LONGDOUBLE, sizeof(long double), 0, (uint32_t) -1};
+
+        default:
+            return in;
+    }
+}
+
+// counts the RowGroups addRowGroup() aggregated a column at a time
+class BatchAggregation : public rowgroup::RowAggregation
+{
+public:
+    BatchAggregation(const std::vector<rowgroup::SP_ROWAGG_GRPBY_t>& groupByCols,
+                     const std::vector<rowgroup::SP_ROWAGG_FUNC_t>& functionCols) :
+        RowAggregation(groupByCols, functionCols), batches(0) { }
+
+    uint32_t batches;
+
+protected:
+    bool aggregateBatch(const rowgroup::RowGroup* pRG) override
+    {
+        bool ret = RowAggregation::aggregateBatch(pRG);
+        batches += ret;
+        return ret;
+    }
+};
+
+}
+
+// Aggregates the same input through addRowGroup(), which takes the column at
+// a time path when there is no GROUP BY, and row by row through
+// aggregateRow(), and expects the same output row.
+class RowAggregationBatchTest : public ::testing::Test
+{
+protected:
+    // every row starts out NULL
+    void setInput(const std::vector<ColSpec>& cols, uint32_t rowCount)
+    {
+        inCols = cols;
+        inRG = makeRowGroup(cols);
+        inData.reinit(inRG, std::max(rowCount, 1U));
+        inRG.setData(&inData);
+        inRG.resetRowGroup(0);
+        inRG.setRowCount(rowCount);
+        inRG.initRow(&r);
+
+        for (uint32_t i = 0; i < rowCount; i++)
+        {
+            inRG.getRow(i, &r);
+            r.initToNull();
+        }
+    }
+
+    rowgroup::Row& inputRow(uint32_t i)
+    {
+        inRG.getRow(i, &r);
+        return r;
+    }
+
+    // returns the index of the output column
+    uint32_t addFunction(rowgroup::RowAggFunctionType func, uint32_t colIn)
+    {
+        uint32_t colOut = outCols.size();
+        functionCols.push_back(rowgroup::SP_ROWAGG_FUNC_t(
+            new rowgroup::RowAggFunctionCol(func, rowgroup::ROWAGG_FUNCT_UNDEFINE, colIn, colOut)));
+        outCols.push_back(outputSpec(func, inCols[colIn]));
+        return colOut;
+    }
+
+    // feeds the input RowGroup feeds times to both aggregations
+    void run(uint32_t feeds = 2)
+    {
+        std::vector<rowgroup::SP_ROWAGG_GRPBY_t> groupByCols;
+
+        batchOut = rowOut = makeRowGroup(outCols);
+        batchOutData.reinit(batchOut, 1);
+        rowOutData.reinit(rowOut, 1);
+        batchOut.setData(&batchOutData);
+        rowOut.setData(&rowOutData);
+
+        batchAgg.reset(new BatchAggregation(groupByCols, functionCols));
+        rowAgg.reset(new BatchAggregation(groupByCols, functionCols));
+        batchAgg->setInputOutput(inRG, &batchOut);
+        rowAgg->setInputOutput(inRG, &rowOut);
+
+        rowgroup::Row rowIn;
+        inRG.initRow(&rowIn);
+
+        for (uint32_t feed = 0; feed < feeds; feed++)
+        {
+            batchAgg->addRowGroup(&inRG);
+
+            for (uint32_t i = 0; i < inRG.getRowCount(); i++)
+            {
+                inRG.getRow(i, &rowIn);
+                rowAgg->aggregateRow(rowIn);
+            }
+        }
+
+        EXPECT_EQ(batchAgg->batches, feeds);
+        EXPECT_EQ(rowAgg->batches, 0U);
+
+        rowgroup::Row expected;
+        batchAgg->getOutputRowGroup()->initRow(&result);
+        batchAgg->getOutputRowGroup()->getRow(0, &result);
+        rowAgg->getOutputRowGroup()->initRow(&expected);
+        rowAgg->getOutputRowGroup()->getRow(0, &expected);
+
+        for (uint32_t col = 0; col < outCols.size(); col++)
+        {
+            if (outCols[col].type == execplan::CalpontSystemCatalog::LONGDOUBLE)
+            {
+                EXPECT_EQ(result.getLongDoubleField(col), expected.getLongDoubleField(col))
+                    << "output column " << col;
+            }
+            else
+            {
+                EXPECT_EQ(memcmp(result.getData() + result.getOffset(col),
+                                 expected.getData() + expected.getOffset(col), outCols[col].width), 0)
+                    << "output column " << col;
+            }
+        }
+    }
+
+    std::vector<ColSpec> inCols, outCols;
+    std::vector<rowgroup::SP_ROWAGG_FUNC_t> functionCols;
+    rowgroup::RowGroup inRG, batchOut, rowOut;
+    rowgroup::RGData inData, batchOutData, rowOutData;
+    rowgroup::Row r, result;
+    std::unique_ptr<BatchAggregation> batchAgg, rowAgg;
+};
+
+TEST_F(RowAggregationBatchTest, NullsAtEveryWidth)
+{
+    const uint32_t rowCount = 100;
+    std::vector<ColSpec> cols = {
+        {execplan::CalpontSystemCatalog::TINYINT, 1, 0, 3},
+        {execplan::CalpontSystemCatalog::SMALLINT, 2, 0, 5},
+        {execplan::CalpontSystemCatalog::INT, 4, 0, 10},
+        {execplan::CalpontSystemCatalog::BIGINT, 8, 0, 19},
+        {execplan::CalpontSystemCatalog::DECIMAL, 16, 0, WIDE_DEC_PRECISION},
+        {execplan::CalpontSystemCatalog::UTINYINT, 1, 0, 3},
+        {execplan::CalpontSystemCatalog::USMALLINT, 2, 0, 5},
+        {execplan::CalpontSystemCatalog::UINT, 4, 0, 10},
+        {execplan::CalpontSystemCatalog::UBIGINT, 8, 0, 20},
+        // NULL on every row
+        {execplan::CalpontSystemCatalog::INT, 4, 0, 10}};
+    setInput(cols, rowCount);
+
+    for (uint32_t i = 0; i < rowCount; i++)
+    {
+        if (i % 3 == 0)
+            continue;
+
+        rowgroup::Row& row = inputRow(i);
+        int64_t s = (int64_t)(i * 37 % 101) - 50;
+        uint64_t u = i * 37 % 101;
+        int128_t wide = (int128_t) s << 70;
+
+        for (uint32_t col = 0; col < 4; col++)
+            row.setIntField(s, col);
+
+        row.setBinaryField(&wide, 4);
+
+        for (uint32_t col = 5; col < 9; col++)
+            row.setUintField(u, col);
+    }
+
+    uint32_t countStar = addFunction(rowgroup::ROWAGG_COUNT_ASTERISK, 0);
+    std::vector<uint32_t> counts, sums, mins;
+
+    for (uint32_t col = 0; col < cols.size(); col++)
+    {
+        counts.push_back(addFunction(rowgroup::ROWAGG_COUNT_COL_NAME, col));
+        sums.push_back(addFunction(rowgroup::ROWAGG_SUM, col));
+        mins.push_back(addFunction(rowgroup::ROWAGG_MIN, col));
+        addFunction(rowgroup::ROWAGG_MAX, col);
+    }
+
+    run();
+
+    EXPECT_EQ(result.getUintField(countStar), 2U * rowCount);
+    EXPECT_EQ(result.getUintField(counts[0]), 2U * (rowCount - 34));
+    EXPECT_EQ(result.getUintField(counts[9]), 0U);
+    EXPECT_TRUE(result.isNullValue(sums[9]));
+    EXPECT_TRUE(result.isNullValue(mins[9]));
+    EXPECT_FALSE(result.isNullValue(mins[4]));
+}
+
+TEST_F(RowAggregationBatchTest, SumOverflowsIntoInt128)
+{
+    // the values have few significant bits, so the long double sums of the
+    // per-row path stay exact past 64 bits
+    const uint32_t rowCount = 64;
+    std::vector<ColSpec> cols = {
+        {execplan::CalpontSystemCatalog::BIGINT, 8, 0, 19},
+        {execplan::CalpontSystemCatalog::BIGINT, 8, 0, 19},
+        {execplan::CalpontSystemCatalog::UBIGINT, 8, 0, 20},
+        {execplan::CalpontSystemCatalog::INT, 4, 0, 10}};
+    setInput(cols, rowCount);
+
+    for (uint32_t i = 0; i < rowCount; i++)
+    {
+        rowgroup::Row& row = inputRow(i);
+        row.setIntField((int64_t) 3 << 61, 0);
+        row.setIntField(-((int64_t) 1 << 62), 1);
+        row.setUintField(0xC000000000000000ULL, 2);
+        row.setIntField(0x7FFFFFFF, 3);
+    }
+
+    std::vector<uint32_t> sums;
+
+    for (uint32_t col = 0; col < cols.size(); col++)
+    {
+        sums.push_back(addFunction(rowgroup::ROWAGG_SUM, col));
+        addFunction(rowgroup::ROWAGG_MIN, col);
+        addFunction(rowgroup::ROWAGG_MAX, col);
+    }
+
+    run();
+
+    const int128_t rows = 2 * rowCount;
+    EXPECT_EQ(*result.getBinaryField<int128_t>(sums[0]), rows * ((int128_t) 3 << 61));
+    EXPECT_EQ(*result.getBinaryField<int128_t>(sums[1]), -rows * ((int128_t) 1 << 62));
+    EXPECT_EQ(*result.getBinaryField<int128_t>(sums[2]), rows * (int128_t) 0xC000000000000000ULL);
+    EXPECT_EQ(*result.getBinaryField<int128_t>(sums[3]), rows * 0x7FFFFFFF);
+}
+
+TEST_F(RowAggregationBatchTest, DecimalWithScale)
+{
+    const uint32_t rowCount = 50;
+    std::vector<ColSpec> cols = {
+        {execplan::CalpontSystemCatalog::DECIMAL, 1, 1, 2},
+        {execplan::CalpontSystemCatalog::DECIMAL, 2, 2, 4},
+        {execplan::CalpontSystemCatalog::DECIMAL, 4, 3, 9},
+        {execplan::CalpontSystemCatalog::DECIMAL, 8, 4, 18},
+        {execplan::CalpontSystemCatalog::DECIMAL, 16, 10, WIDE_DEC_PRECISION}};
+    setInput(cols, rowCount);
+
+    for (uint32_t i = 0; i < rowCount; i++)
+    {
+        if (i % 7 == 3)
+            continue;
+
+        rowgroup::Row& row = inputRow(i);
+        int64_t v = (int64_t)(i * 13 % 97) - 48;
+        int128_t wide = (int128_t) v * 1000000000000000000LL * 1000;
+
+        for (uint32_t col = 0; col < 4; col++)
+            row.setIntField(v, col);
+
+        row.setBinaryField(&wide, 4);
+    }
+
+    for (uint32_t col = 0; col < cols.size(); col++)
+    {
+        addFunction(rowgroup::ROWAGG_COUNT_COL_NAME, col);
+        addFunction(rowgroup::ROWAGG_SUM, col);
+        addFunction(rowgroup::ROWAGG_MIN, col);
+        addFunction(rowgroup::ROWAGG_MAX, col);
+    }
+
+    run();
+}
+
+TEST_F(RowAggregationBatchTest, FloatAndDouble)
+{
+    const uint32_t rowCount = 80;
+    std::vector<ColSpec> cols = {
+        {execplan::CalpontSystemCatalog::DOUBLE, 8, 0, 15},
+        {execplan::CalpontSystemCatalog::FLOAT, 4, 0, 7}};
+    setInput(cols, rowCount);
+
+    for (uint32_t i = 0; i < rowCount; i++)
+    {
+        rowgroup::Row& row = inputRow(i);
+
+        if (i % 5 != 0)
+            row.setDoubleField(i * 0.37 - 11.5, 0);
+
+        if (i % 4 != 1)
+            row.setFloatField(i * 1.3f - 40.1f, 1);
+    }
+
+    for (uint32_t col = 0; col < cols.size(); col++)
+    {
+        addFunction(rowgroup::ROWAGG_COUNT_COL_NAME, col);
+        addFunction(rowgroup::ROWAGG_SUM, col);
+        addFunction(rowgroup::ROWAGG_MIN, col);
+        addFunction(rowgroup::ROWAGG_MAX, col);
+    }
+
+    run();
+}
+
+TEST_F(RowAggregationBatchTest, TemporalMinMax)
+{
+    const uint32_t rowCount = 28;
+    std::vector<ColSpec> cols = {
+        {execplan::CalpontSystemCatalog::DATE, 4, 0, 10},
+        {execplan::CalpontSystemCatalog::DATETIME, 8, 0, 19},
+        {execplan::CalpontSystemCatalog::TIME, 8, 0, 8}};
+    setInput(cols, rowCount);
+
+    char buf[32];
+
+    for (uint32_t i = 0; i < rowCount; i++)
+    {
+        if (i % 6 == 2)
+            continue;
+
+        rowgroup::Row& row = inputRow(i);
+        uint32_t day = (i * 11) % rowCount + 1;
+
+        snprintf(buf, sizeof(buf), "2021-02-%02u", day);
+        row.setUintField(dataconvert::DataConvert::stringToDate(buf), 0);
+        snprintf(buf, sizeof(buf), "2020-12-%02u 10:%02u:00", day, i);
+        row.setUintField(dataconvert::DataConvert::stringToDatetime(buf), 1);
+        snprintf(buf, sizeof(buf), "%02u:30:%02u", day, i);
+        row.setUintField(dataconvert::DataConvert::stringToTime(buf), 2);
+    }
+
+    std::vector<uint32_t> mins, maxs;
+
+    for (uint32_t col = 0; col < cols.size(); col++)
+    {
+        addFunction(rowgroup::ROWAGG_COUNT_COL_NAME, col);
+        mins.push_back(addFunction(rowgroup::ROWAGG_MIN, col));
+        maxs.push_back(addFunction(rowgroup::ROWAGG_MAX, col));
+    }
+
+    run();
+
+    // day 1 is on row 0, day 28 on row 5
+    EXPECT_EQ(result.getUintField(mins[0]), (uint64_t) dataconvert::DataConvert::stringToDate("2021-02-01"));
+    EXPECT_EQ(result.getUintField(maxs[0]), (uint64_t) dataconvert::DataConvert::stringToDate("2021-02-28"));
+}
+
+TEST_F(RowAggregationBatchTest, EmptyRowGroup)
+{
+    std::vector<ColSpec> cols = {
+        {execplan::CalpontSystemCatalog::INT, 4, 0, 10},
+        {execplan::CalpontSystemCatalog::DECIMAL, 16, 2, WIDE_DEC_PRECISION},
+        {execplan::CalpontSystemCatalog::DOUBLE, 8, 0, 15}};
+    setInput(cols, 0);
+
+    uint32_t countStar = addFunction(rowgroup::ROWAGG_COUNT_ASTERISK, 0);
+    std::vector<uint32_t> counts, sums, mins;
+
+    for (uint32_t col = 0; col < cols.size(); col++)
+    {
+        counts.push_back(addFunction(rowgroup::ROWAGG_COUNT_COL_NAME, col));
+        sums.push_back(addFunction(rowgroup::ROWAGG_SUM, col));
+        mins.push_back(addFunction(rowgroup::ROWAGG_MIN, col));
+        addFunction(rowgroup::ROWAGG_MAX, col);
+    }
+
+    run();
+
+    EXPECT_EQ(result.getUintField(countStar), 0U);
+    EXPECT_EQ(result.getUintField(counts[0]), 0U);
+    EXPECT_TRUE(result.isNullValue(sums[0]));
+    EXPECT_TRUE(result.isNullValue(sums[1]));
+    EXPECT_TRUE(result.isNullValue(mins[0]));
+    EXPECT_TRUE(result.isNullValue(mins[2]));
+}
@@ -0,0 +1,175 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <gtest/gtest.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bytestream.h"
+#include "rowstorage.h"
+
+using messageqcpp::ByteStream;
+
+class DumpFileTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char dirTemplate[] = "/tmp/rowstorage-tests-XXXXXX";
+        ASSERT_NE(mkdtemp(dirTemplate), nullptr);
+        dir = dirTemplate;
+        fname = dir + "/dump";
+    }
+
+    void TearDown() override
+    {
+        unlink(fname.c_str());
+        rmdir(dir.c_str());
+    }
+
+    static ByteStream compressible(size_t len)
+    {
+        ByteStream bs;
+        for (size_t i = 0; i < len; i++)
+            bs << (uint8_t)((i / 1000) % 7);
+        return bs;
+    }
+
+    static ByteStream incompressible(size_t len)
+    {
+        std::mt19937 gen(42);
+        ByteStream bs;
+        for (size_t i = 0; i < len; i++)
+            bs << (uint8_t)gen();
+        return bs;
+    }
+
+    // the first field of the dump header
+    uint32_t storedCompression() const
+    {
+        uint32_t compression = 0xffffffff;
+        int fd = open(fname.c_str(), O_RDONLY);
+        EXPECT_GE(fd, 0);
+        EXPECT_EQ(read(fd, &compression, sizeof(compression)), (ssize_t)sizeof(compression));
+        close(fd);
+        return compression;
+    }
+
+    off_t fileSize() const
+    {
+        struct stat st;
+        EXPECT_EQ(stat(fname.c_str(), &st), 0);
+        return st.st_size;
+    }
+
+    void expectRoundTrip(const ByteStream& in)
+    {
+        ByteStream out;
+        ASSERT_EQ(rowgroup::loadDump(fname, out), 0);
+        ASSERT_EQ(out.length(), in.length());
+        EXPECT_EQ(memcmp(out.buf(), in.buf(), in.length()), 0);
+    }
+
+    std::string dir;
+    std::string fname;
+};
+
+TEST_F(DumpFileTest, RawRoundTrip)
+{
+    ByteStream bs = compressible(1 << 20);
+    ASSERT_EQ(rowgroup::saveDump(fname, bs, 0), 0);
+    EXPECT_EQ(storedCompression(), 0U);
+    EXPECT_GT(fileSize(), (off_t)bs.length());
+    expectRoundTrip(bs);
+}
+
+TEST_F(DumpFileTest, SnappyRoundTrip)
+{
+    ByteStream bs = compressible(1 << 20);
+    ASSERT_EQ(rowgroup::saveDump(fname, bs, 2), 0);
+    EXPECT_EQ(storedCompression(), 2U);
+    EXPECT_LT(fileSize(), (off_t)bs.length());
+    expectRoundTrip(bs);
+}
+
+TEST_F(DumpFileTest, LZ4RoundTrip)
+{
+    ByteStream bs = compressible(1 << 20);
+    ASSERT_EQ(rowgroup::saveDump(fname, bs, 3), 0);
+
+    // a build without LZ4 fails to compress and stores the data as is
+    uint32_t compression = storedCompression();
+    EXPECT_TRUE(compression == 3 || compression == 0);
+    if (compression == 3)
+        EXPECT_LT(fileSize(), (off_t)bs.length());
+    expectRoundTrip(bs);
+}
+
+TEST_F(DumpFileTest, IncompressibleStoredRaw)
+{
+    ByteStream bs = incompressible(1 << 16);
+    ASSERT_EQ(rowgroup::saveDump(fname, bs, 2), 0);
+    EXPECT_EQ(storedCompression(), 0U);
+    expectRoundTrip(bs);
+}
+
+TEST_F(DumpFileTest, EmptyRoundTrip)
+{
+    for (uint32_t compression : {0U, 2U, 3U})
+    {
+        ByteStream bs;
+        ASSERT_EQ(rowgroup::saveDump(fname, bs, compression), 0);
+        expectRoundTrip(bs);
+    }
+}
+
+TEST_F(DumpFileTest, TruncatedHeader)
+{
+    int fd = open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+    uint32_t compression = 0;
+    ASSERT_EQ(write(fd, &compression, sizeof(compression)), (ssize_t)sizeof(compression));
+    close(fd);
+
+    ByteStream out;
+    EXPECT_EQ(rowgroup::loadDump(fname, out), EIO);
+}
+
+TEST_F(DumpFileTest, TruncatedData)
+{
+    for (uint32_t compression : {0U, 2U})
+    {
+        ByteStream bs = compressible(1 << 16);
+        ASSERT_EQ(rowgroup::saveDump(fname, bs, compression), 0);
+        ASSERT_EQ(truncate(fname.c_str(), fileSize() - 1), 0);
+
+        ByteStream out;
+        EXPECT_EQ(rowgroup::loadDump(fname, out), EIO) << "compression " << compression;
+    }
+}
+
+TEST_F(DumpFileTest, MissingFile)
+{
+    ByteStream out;
+    EXPECT_EQ(rowgroup::loadDump(fname, out), ENOENT);
+}
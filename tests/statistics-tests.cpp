@@ -0,0 +1,246 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <gtest/gtest.h>
+
+#include "hyperloglog.h"
+#include "tdigest.h"
+#include "statistics.h"
+#include "joblisttypes.h"
+
+using namespace statistics;
+
+TEST(HyperLogLogTest, Estimate)
+{
+    utils::HyperLogLog hll;
+    const uint64_t distinct = 100000;
+
+    for (uint32_t pass = 0; pass < 3; pass++)
+        for (uint64_t i = 0; i < distinct; i++)
+            hll.add(utils::HyperLogLog::hashInt(i));
+
+    EXPECT_NEAR(hll.estimate(), distinct, distinct * 0.03);
+
+    utils::HyperLogLog small;
+    for (uint64_t i = 0; i < 100; i++)
+        small.add(utils::HyperLogLog::hashInt(i));
+
+    EXPECT_NEAR(small.estimate(), 100, 3);
+}
+
+TEST(HyperLogLogTest, MergeAndSerialize)
+{
+    utils::HyperLogLog a, b;
+
+    for (uint64_t i = 0; i < 50000; i++)
+        a.add(utils::HyperLogLog::hashInt(i));
+
+    for (uint64_t i = 25000; i < 75000; i++)
+        b.add(utils::HyperLogLog::hashInt(i));
+
+    a.merge(b);
+    EXPECT_NEAR(a.estimate(), 75000, 75000 * 0.03);
+
+    messageqcpp::ByteStream bs;
+    a.serialize(bs);
+    utils::HyperLogLog c(4);
+    c.deserialize(bs);
+    EXPECT_EQ(c.estimate(), a.estimate());
+    EXPECT_EQ(bs.length(), 0U);
+}
+
+TEST(TDigestTest, Quantiles)
+{
+    utils::TDigest digest;
+    const uint32_t count = 100000;
+
+    EXPECT_TRUE(std::isnan(digest.quantile(0.5)));
+
+    for (uint32_t i = 1; i <= count; i++)
+        digest.add(i);
+
+    EXPECT_EQ(digest.quantile(0), 1);
+    EXPECT_EQ(digest.quantile(1), count);
+    EXPECT_NEAR(digest.quantile(0.5), count * 0.5, count * 0.005);
+    EXPECT_NEAR(digest.quantile(0.01), count * 0.01, count * 0.001);
+    EXPECT_NEAR(digest.quantile(0.99), count * 0.99, count * 0.001);
+}
+
+TEST(TDigestTest, MergeAndSerialize)
+{
+    utils::TDigest a, b;
+
+    for (uint32_t i = 0; i < 50000; i++)
+        (i % 2 ? a : b).add(i);
+
+    a.merge(b);
+    EXPECT_EQ(a.count(), 50000);
+    EXPECT_NEAR(a.quantile(0.25), 12500, 250);
+
+    messageqcpp::ByteStream bs;
+    a.serialize(bs);
+    utils::TDigest c;
+    c.deserialize(bs);
+    EXPECT_EQ(c.count(), a.count());
+    EXPECT_DOUBLE_EQ(c.quantile(0.25), a.quantile(0.25));
+    EXPECT_EQ(bs.length(), 0U);
+}
+
+class ColumnStatisticsTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        std::vector<uint32_t> offsets{2, 10}, roids{3000}, tkeys{1}, cscale{0}, precision{18}, charSetNumbers{8};
+        std::vector<execplan::CalpontSystemCatalog::ColDataType> types{execplan::CalpontSystemCatalog::BIGINT};
+
+        rg = rowgroup::RowGroup(roids.size(), offsets, roids, tkeys, types, charSetNumbers, cscale, precision,
+                                20, false);
+        rgData.reinit(rg);
+        rg.setData(&rgData);
+        rg.resetRowGroup(0);
+
+        // Every tenth row is NULL, the rest hold 900 distinct values.
+        rowgroup::Row r;
+        rg.initRow(&r);
+        rg.getRow(0, &r);
+
+        for (uint32_t i = 0; i < rowgroup::rgCommonSize; i++, r.nextRow())
+        {
+            if (i % 10 == 0)
+                r.setIntField(joblist::BIGINTNULL, 0);
+            else
+                r.setIntField(i % 1000, 0);
+        }
+
+        rg.setRowCount(rowgroup::rgCommonSize);
+    }
+
+    rowgroup::RowGroup rg;
+    rowgroup::RGData rgData;
+};
+
+TEST_F(ColumnStatisticsTest, CollectAndEstimate)
+{
+    ColumnStatisticsCollector collector(rg);
+    collector.add(rg);
+    auto columnStats = collector.finish();
+
+    ASSERT_EQ(columnStats.count(3000), 1U);
+    const ColumnStatistics& stats = columnStats[3000];
+
+    EXPECT_EQ(stats.rowCount, rowgroup::rgCommonSize);
+    EXPECT_NEAR(stats.nullFraction(), 0.1, 0.001);
+    EXPECT_EQ(stats.distinctCount, 900U);
+    ASSERT_TRUE(stats.hasHistogram());
+    EXPECT_EQ(stats.histogram.front(), 1);
+    EXPECT_EQ(stats.histogram.back(), 999);
+
+    EXPECT_NEAR(stats.lessFraction(500, false), 0.45, 0.02);
+    EXPECT_NEAR(stats.lessFraction(999, true), 0.9, 0.001);
+    EXPECT_EQ(stats.lessFraction(0, true), 0.0);
+    EXPECT_NEAR(stats.equalFraction(7), 0.001, 0.0005);
+    EXPECT_EQ(stats.equalFraction(5000), 0.0);
+}
+
+TEST_F(ColumnStatisticsTest, MostCommonValues)
+{
+    ColumnStatistics stats;
+    stats.rowCount = 1000;
+    stats.nullCount = 0;
+    stats.distinctCount = 101;
+    stats.histogram = {0, 50, 100};
+    stats.mostCommonValues.emplace_back(42, 0.5);
+
+    EXPECT_DOUBLE_EQ(stats.equalFraction(42), 0.5);
+    EXPECT_DOUBLE_EQ(stats.equalFraction(43), 0.5 / 100);
+    EXPECT_DOUBLE_EQ(stats.averageEqualFraction(), 1.0 / 101);
+}
+
+TEST_F(ColumnStatisticsTest, Serialize)
+{
+    ColumnStatisticsCollector collector(rg);
+    collector.add(rg);
+    auto columnStats = collector.finish();
+    const ColumnStatistics& stats = columnStats[3000];
+
+    messageqcpp::ByteStream bs;
+    stats.serialize(bs);
+    ColumnStatistics copy;
+    copy.unserialize(bs);
+
+    EXPECT_EQ(copy.rowCount, stats.rowCount);
+    EXPECT_EQ(copy.nullCount, stats.nullCount);
+    EXPECT_EQ(copy.distinctCount, stats.distinctCount);
+    EXPECT_EQ(copy.histogram, stats.histogram);
+    EXPECT_EQ(copy.mostCommonValues.size(), stats.mostCommonValues.size());
+    EXPECT_EQ(bs.length(), 0U);
+}
+
+// Columns that aren't ordered as integers are hashed by value, the values of a
+// DOUBLE or a wide DECIMAL mostly start with a zero byte.
+TEST(ColumnStatisticsCollectorTest, DistinctFixedWidthValues)
+{
+    std::vector<uint32_t> offsets{2, 10, 26, 42, 46}, roids{3001, 3002, 3003, 3004}, tkeys{1, 2, 3, 4},
+        cscale{0, 2, 0, 0}, precision{15, 38, 18, 7}, charSetNumbers{8, 8, 8, 8};
+    std::vector<execplan::CalpontSystemCatalog::ColDataType> types{
+        execplan::CalpontSystemCatalog::DOUBLE, execplan::CalpontSystemCatalog::DECIMAL,
+        execplan::CalpontSystemCatalog::LONGDOUBLE, execplan::CalpontSystemCatalog::FLOAT};
+
+    rowgroup::RowGroup rg(roids.size(), offsets, roids, tkeys, types, charSetNumbers, cscale, precision, 20,
+                          false);
+    rowgroup::RGData rgData(rg);
+    rg.setData(&rgData);
+    rg.resetRowGroup(0);
+
+    // Every tenth row is NULL, the rest hold 900 distinct values.
+    rowgroup::Row r;
+    rg.initRow(&r);
+    rg.getRow(0, &r);
+
+    for (uint32_t i = 0; i < rowgroup::rgCommonSize; i++, r.nextRow())
+    {
+        r.initToNull();
+
+        if (i % 10 == 0)
+            continue;
+
+        // -0.0 and 0.0 are the same value
+        double value = (i % 1000 == 1) ? -0.0 : (i % 1000 == 2) ? 0.0 : i % 1000;
+        r.setDoubleField(value, 0);
+        r.setInt128Field((int128_t) (i % 1000) * 100, 1);
+        r.setLongDoubleField(value, 2);
+        r.setFloatField(value, 3);
+    }
+
+    rg.setRowCount(rowgroup::rgCommonSize);
+
+    ColumnStatisticsCollector collector(rg);
+    collector.add(rg);
+    auto columnStats = collector.finish();
+
+    for (uint32_t oid : roids)
+    {
+        ASSERT_EQ(columnStats.count(oid), 1U);
+        const ColumnStatistics& stats = columnStats[oid];
+        EXPECT_NEAR(stats.nullFraction(), 0.1, 0.001) << "oid " << oid;
+        EXPECT_FALSE(stats.hasHistogram()) << "oid " << oid;
+        // 1 and 2 are both 0 in the floating point columns
+        uint64_t expected = (oid == 3002 ? 900 : 899);
+        EXPECT_NEAR(stats.distinctCount, expected, expected * 0.02) << "oid " << oid;
+    }
+}
@@ -0,0 +1,262 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "arithmeticcolumn.h"
+#include "configcpp.h"
+#include "idbcompress.h"
+#include "jlf_common.h"
+#include "resourcemanager.h"
+#include "rowgroup.h"
+#include "windowfunctioncolumn.h"
+#include "windowfunctionstep.h"
+
+using namespace execplan;
+using namespace joblist;
+
+namespace
+{
+
+const int64_t MEMORY_LIMIT = 4LL * 1024 * 1024;
+const uint64_t PARTITIONS = 4096;
+const uint64_t INPUT_RGS = 50;
+
+}
+
+// ROW_NUMBER() OVER (PARTITION BY p ORDER BY id) on (p, id) rows, with p = id % PARTITIONS
+class WindowFunctionDiskTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char dirTemplate[] = "/tmp/windowfunction-disk-tests-XXXXXX";
+        ASSERT_NE(mkdtemp(dirTemplate), nullptr);
+        dir = dirTemplate;
+        ASSERT_EQ(mkdir((dir + "/windowfunctions").c_str(), 0700), 0);
+
+        // read when the ResourceManager is made
+        config::Config* config = config::Config::makeConfig();
+        config->setConfig("SystemConfig", "SystemTempFileDir", dir);
+        config->setConfig("WindowFunction", "AllowDiskBasedWindowFunction", "Y");
+        rm = ResourceManager::instance(true);
+    }
+
+    void TearDown() override
+    {
+        EXPECT_EQ(filesLeft(), 0U);
+        rmdir((dir + "/windowfunctions").c_str());
+        rmdir(dir.c_str());
+    }
+
+    SRCP makeColumn(ReturnedColumn* rc, uint32_t expressionId, const std::string& alias)
+    {
+        CalpontSystemCatalog::ColType ct;
+        ct.colDataType = CalpontSystemCatalog::BIGINT;
+        ct.colWidth = 8;
+        ct.precision = 19;
+        ct.scale = 0;
+        rc->resultType(ct);
+        rc->expressionId(expressionId);
+        rc->alias(alias);
+        return SRCP(rc);
+    }
+
+    // runs the step and returns the row number of each id, 0 for the ids not returned
+    std::vector<int64_t> run(bool compress, int64_t memoryLimit, uint64_t& spillBytes,
+                             bool& compressed)
+    {
+        config::Config::makeConfig()->setConfig("WindowFunction", "TempFileCompression",
+                                                compress ? "LZ4" : "N");
+
+        JobInfo jobInfo(rm);
+        jobInfo.queryType = "SELECT";
+        jobInfo.keyInfo.reset(new TupleKeyInfo);
+        jobInfo.errorInfo.reset(new ErrorInfo());
+        jobInfo.stringTableThreshold = 20;
+        jobInfo.umMemLimit.reset(new int64_t);
+        *(jobInfo.umMemLimit) = memoryLimit;
+
+        SRCP p = makeColumn(new ArithmeticColumn(), 1, "p");
+        SRCP id = makeColumn(new ArithmeticColumn(), 2, "id");
+        WindowFunctionColumn* wc = new WindowFunctionColumn("ROW_NUMBER");
+        SRCP rn = makeColumn(wc, 3, "rn");
+        wc->partitions(std::vector<SRCP>(1, p));
+        wc->orderBy(WF_OrderBy(std::vector<SRCP>(1, id)));
+
+        jobInfo.windowCols.push_back(rn);
+        jobInfo.windowDels.push_back(p);
+        jobInfo.windowDels.push_back(id);
+        jobInfo.windowDels.push_back(rn);
+
+        std::vector<uint32_t> offsets, roids, tkeys, cscale, cprecision, charSetNumVec;
+        std::vector<CalpontSystemCatalog::ColDataType> types;
+        offsets.push_back(2);
+
+        for (uint32_t i = 0; i < jobInfo.windowDels.size(); i++)
+        {
+            offsets.push_back(offsets.back() + 8);
+            roids.push_back(3001 + i);
+            tkeys.push_back(getTupleKey(jobInfo, jobInfo.windowDels[i], true));
+            types.push_back(CalpontSystemCatalog::BIGINT);
+            cscale.push_back(0);
+            cprecision.push_back(19);
+            charSetNumVec.push_back(8);
+        }
+
+        rowgroup::RowGroup rg(3, offsets, roids, tkeys, types, charSetNumVec, cscale, cprecision,
+                              20, false);
+
+        std::unique_ptr<WindowFunctionStep> step(new WindowFunctionStep(jobInfo));
+        step->initialize(rg, jobInfo);
+
+        AnyDataListSPtr spdlIn(new AnyDataList());
+        RowGroupDL* dlIn = new RowGroupDL(1, INPUT_RGS);
+        spdlIn->rowGroupDL(dlIn);
+        JobStepAssociation jsaIn;
+        jsaIn.outAdd(spdlIn);
+        step->inputAssociation(jsaIn);
+
+        AnyDataListSPtr spdlOut(new AnyDataList());
+        RowGroupDL* dlOut = new RowGroupDL(1, 1024);
+        spdlOut->rowGroupDL(dlOut);
+        JobStepAssociation jsaOut;
+        jsaOut.outAdd(spdlOut);
+        step->outputAssociation(jsaOut);
+        uint64_t it = dlOut->getIterator();
+
+        rowgroup::Row row;
+        rg.initRow(&row);
+        int64_t nextId = 0;
+
+        for (uint64_t i = 0; i < INPUT_RGS; i++)
+        {
+            rowgroup::RGData rgData(rg);
+            rg.setData(&rgData);
+            rg.resetRowGroup(0);
+            rg.getRow(0, &row);
+
+            for (uint64_t j = 0; j < rowgroup::rgCommonSize; j++, row.nextRow())
+            {
+                row.setIntField(nextId % PARTITIONS, 0);
+                row.setIntField(nextId++, 1);
+                row.setIntField(0, 2);
+            }
+
+            rg.setRowCount(rowgroup::rgCommonSize);
+            dlIn->insert(rgData);
+        }
+
+        dlIn->endOfInput();
+
+        step->run();
+
+        std::vector<int64_t> rowNumbers(nextId);
+        rowgroup::RowGroup outRG = step->getOutputRowGroup();
+        rowgroup::RGData outData;
+
+        while (dlOut->next(it, &outData))
+        {
+            outRG.setData(&outData);
+            outRG.initRow(&row);
+            outRG.getRow(0, &row);
+
+            for (uint64_t j = 0; j < outRG.getRowCount(); j++, row.nextRow())
+            {
+                int64_t id = row.getIntField(1);
+                EXPECT_EQ(row.getIntField(0), id % (int64_t) PARTITIONS);
+                EXPECT_EQ(rowNumbers[id], 0) << "id " << id << " returned twice";
+                rowNumbers[id] = row.getIntField(2);
+            }
+        }
+
+        step->join();
+        EXPECT_EQ(step->status(), 0U);
+        spillBytes = step->getSpillBytes();
+        compressed = step->getCompressor() != NULL;
+
+        // the memory is given back once the step is gone
+        step.reset();
+        EXPECT_EQ(*(jobInfo.umMemLimit), memoryLimit);
+        return rowNumbers;
+    }
+
+    size_t filesLeft() const
+    {
+        size_t count = 0;
+        DIR* d = opendir((dir + "/windowfunctions").c_str());
+
+        if (!d)
+            return 0;
+
+        while (struct dirent* e = readdir(d))
+        {
+            if (e->d_name[0] != '.')
+                count++;
+        }
+
+        closedir(d);
+        return count;
+    }
+
+    std::string dir;
+    ResourceManager* rm;
+};
+
+TEST_F(WindowFunctionDiskTest, SpillAndReadBack)
+{
+    uint64_t spillBytes[2];
+
+    for (bool compress : {false, true})
+    {
+        bool compressed = false;
+        std::vector<int64_t> rowNumbers = run(compress, MEMORY_LIMIT, spillBytes[compress],
+                                              compressed);
+
+        EXPECT_GT(spillBytes[compress], 0U) << "compress " << compress;
+        EXPECT_EQ(compressed, compress && compress::CompressInterface::isCompressionAvail(3));
+
+        // the ids of a partition are numbered in order
+        for (uint64_t id = 0; id < rowNumbers.size(); id++)
+            ASSERT_EQ(rowNumbers[id], (int64_t)(id / PARTITIONS + 1))
+                    << "compress " << compress << " id " << id;
+
+        EXPECT_EQ(filesLeft(), 0U);
+    }
+
+    if (compress::CompressInterface::isCompressionAvail(3))
+        EXPECT_LT(spillBytes[1], spillBytes[0]);
+}
+
+TEST_F(WindowFunctionDiskTest, InMemory)
+{
+    uint64_t spillBytes = 0;
+    bool compressed = false;
+    std::vector<int64_t> rowNumbers = run(true, 1LL << 30, spillBytes, compressed);
+
+    EXPECT_EQ(spillBytes, 0U);
+
+    for (uint64_t id = 0; id < rowNumbers.size(); id++)
+        ASSERT_EQ(rowNumbers[id], (int64_t)(id / PARTITIONS + 1)) << "id " << id;
+}
@@ -113,13 +113,22 @@ ssize_t SMComm::pread(const string &filename, void *buf, const size_t count, con
     ssize_t err;
     string absfilename(getAbsFilename(filename));
     
-    *command << (uint8_t) storagemanager::READ << count << offset << absfilename;
-    err = sockets.send_recv(*command, response);
+    // the data comes back through the connection's shared buffer if it has one
+    *command << (uint8_t) (storagemanager::READ | storagemanager::SHARED_BUFFER) << count << offset << absfilename;
+    err = sockets.send_recv_shared(*command, response, NULL, buf, count);
+    bool shared = (err != 1);
+    if (!shared)
+    {
+        command->restart();
+        *command << (uint8_t) storagemanager::READ << count << offset << absfilename;
+        err = sockets.send_recv(*command, response);
+    }
     if (err)
         common_exit(command, response, err);
     check_for_error(command, response, err);
     
-    memcpy(buf, response->buf(), err);
+    if (!shared)
+        memcpy(buf, response->buf(), err);
     common_exit(command, response, err);
 }
 
@@ -130,12 +139,18 @@ ssize_t SMComm::pwrite(const string &filename, const void *buf, const size_t cou
     ssize_t err;
     string absfilename(getAbsFilename(filename));
     
-    *command << (uint8_t) storagemanager::WRITE << count << offset << absfilename;
-    command->needAtLeast(count);
-    uint8_t *cmdBuf = command->getInputPtr();
-    memcpy(cmdBuf, buf, count);
-    command->advanceInputPtr(count);
-    err = sockets.send_recv(*command, response);
+    *command << (uint8_t) (storagemanager::WRITE | storagemanager::SHARED_BUFFER) << count << offset << absfilename;
+    err = sockets.send_recv_shared(*command, response, buf, NULL, count);
+    if (err == 1)
+    {
+        command->restart();
+        *command << (uint8_t) storagemanager::WRITE << count << offset << absfilename;
+        command->needAtLeast(count);
+        uint8_t *cmdBuf = command->getInputPtr();
+        memcpy(cmdBuf, buf, count);
+        command->advanceInputPtr(count);
+        err = sockets.send_recv(*command, response);
+    }
     if (err)
         common_exit(command, response, err);
     check_for_error(command, response, err);
@@ -149,12 +164,18 @@ ssize_t SMComm::append(const string &filename, const void *buf, const size_t cou
     ssize_t err;
     string absfilename(getAbsFilename(filename));
 
-    *command << (uint8_t) storagemanager::APPEND << count << absfilename;
-    command->needAtLeast(count);
-    uint8_t *cmdBuf = command->getInputPtr();
-    memcpy(cmdBuf, buf, count);
-    command->advanceInputPtr(count);
-    err = sockets.send_recv(*command, response);
+    *command << (uint8_t) (storagemanager::APPEND | storagemanager::SHARED_BUFFER) << count << absfilename;
+    err = sockets.send_recv_shared(*command, response, buf, NULL, count);
+    if (err == 1)
+    {
+        command->restart();
+        *command << (uint8_t) storagemanager::APPEND << count << absfilename;
+        command->needAtLeast(count);
+        uint8_t *cmdBuf = command->getInputPtr();
+        memcpy(cmdBuf, buf, count);
+        command->advanceInputPtr(count);
+        err = sockets.send_recv(*command, response);
+    }
     if (err)
         common_exit(command, response, err);
     check_for_error(command, response, err);
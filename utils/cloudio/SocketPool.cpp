@@ -22,6 +22,10 @@
 
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
 
 using namespace std;
 
@@ -64,6 +68,27 @@ SocketPool::SocketPool()
         log(logging::LOG_TYPE_CRITICAL, os.str());
         maxSockets = defaultSockets;
     }
+
+    sharedSize = 0;
+    sharedDisabled = false;
+    try
+    {
+        stmp = config->getConfig("StorageManager", "SharedBufferSize");
+        if (!stmp.empty())
+        {
+            itmp = config::Config::fromText(stmp);
+            if (itmp < 0 || itmp > (100 << 20))
+                log(logging::LOG_TYPE_WARNING, "SocketPool(): Got a bad value '" + stmp + 
+                  "' for StorageManager/SharedBufferSize.  Range is 0-100M.  Not using shared buffers.");
+            else
+                sharedSize = itmp;
+        }
+    }
+    catch (exception &e)
+    {
+    }
+    if (sharedSize == 0)
+        sharedDisabled = true;
 }
 
 SocketPool::~SocketPool()
@@ -72,6 +97,8 @@ SocketPool::~SocketPool()
 
     for (uint i = 0; i < allSockets.size(); i++)
         ::close(allSockets[i]);
+    for (map<int, uint8_t *>::iterator it = sharedBuffers.begin(); it != sharedBuffers.end(); ++it)
+        ::munmap(it->second, sharedSize);
 }
 
 #define sm_check_error \
@@ -86,11 +113,8 @@ SocketPool::~SocketPool()
     
 int SocketPool::send_recv(messageqcpp::ByteStream &in, messageqcpp::ByteStream *out)
 {
-    uint count = 0;
-    uint length = in.length();
     int sock = -1;
-    const uint8_t *inbuf = in.buf();
-    ssize_t err = 0;
+    int err;
     
 retry:
     int retries = 0;
@@ -112,6 +136,67 @@ retry:
         }
     }
     
+    err = send_msg(sock, in);
+    if (err == -2)
+    {
+        log(logging::LOG_TYPE_WARNING, "SocketPool: remote connection is closed, getting a new one");
+        sock = -1;
+        goto retry;
+    }
+    if (err < 0 || recv_msg(sock, out) < 0)
+        return -1;
+    returnSocket(sock);
+    return 0;
+}
+
+int SocketPool::send_recv_shared(messageqcpp::ByteStream &in, messageqcpp::ByteStream *out,
+  const void *toWrite, void *toRead, size_t length)
+{
+    if (length > sharedBufferSize())
+        return 1;
+    
+    // if there's no connection to be had, send_recv() has the retry loop
+    int sock = getSocket();
+    if (sock < 0)
+        return 1;
+    uint8_t *buffer = attachBuffer(sock);
+    if (buffer == NULL)
+        return 1;
+
+    if (toWrite)
+        memcpy(buffer, toWrite, length);
+    int err = send_msg(sock, in);
+    if (err == -2)
+        return 1;
+    if (err < 0 || recv_msg(sock, out) < 0)
+        return -1;
+    
+    // the response begins with the return code, which for a read is the amount of data
+    ssize_t returnCode;
+    if (toRead && out->length() >= sizeof(returnCode))
+    {
+        memcpy(&returnCode, out->buf(), sizeof(returnCode));
+        if (returnCode > 0)
+            memcpy(toRead, buffer, std::min((size_t) returnCode, length));
+    }
+    returnSocket(sock);
+    return 0;
+}
+
+size_t SocketPool::sharedBufferSize()
+{
+    boost::mutex::scoped_lock lock(mutex);
+    return (sharedDisabled ? 0 : sharedSize);
+}
+
+// returns -2 if the connection was found closed before anything was sent, and the msg can go on another one
+int SocketPool::send_msg(int sock, messageqcpp::ByteStream &in)
+{
+    uint count = 0;
+    uint length = in.length();
+    const uint8_t *inbuf = in.buf();
+    ssize_t err = 0;
+    
     storagemanager::sm_msg_header hdr;
     hdr.type = storagemanager::SM_MSG_START;
     hdr.payloadLen = length;
@@ -120,10 +205,8 @@ retry:
     err = ::write(sock, &hdr, sizeof(hdr));
     if (err < 0 && errno == EPIPE)
     {
-        log(logging::LOG_TYPE_WARNING, "SocketPool: remote connection is closed, getting a new one");
         remoteClosed(sock);
-        sock = -1;
-        goto retry;
+        return -2;
     }
     sm_check_error;
     while (count < length)
@@ -131,9 +214,14 @@ retry:
         err = ::write(sock, &inbuf[count], length-count);
         sm_check_error;
         count += err;
-        in.advance(err);
     }
     //cout << "SP sent msg with length = " << length << endl;
+    return 0;
+}
+
+int SocketPool::recv_msg(int sock, messageqcpp::ByteStream *out)
+{
+    ssize_t err = 0;
     
     out->restart();
     uint8_t *outbuf;
@@ -205,10 +293,109 @@ retry:
         remainingBytes -= err;
         out->advanceInputPtr(err);
     }
-    returnSocket(sock);
     return 0;
 }
 
+/* Returns the connection's shared buffer, setting one up if it has none.  On failure the
+connection is given back or closed, and NULL is returned. */
+uint8_t *SocketPool::attachBuffer(int sock)
+{
+    boost::mutex::scoped_lock lock(mutex);
+    map<int, uint8_t *>::iterator it = sharedBuffers.find(sock);
+    if (it != sharedBuffers.end())
+        return it->second;
+    if (sharedDisabled)
+    {
+        lock.unlock();
+        returnSocket(sock);
+        return NULL;
+    }
+    lock.unlock();
+
+    int fd = -1;
+    void *buf = MAP_FAILED;
+    char errbuf[80];
+#ifdef __NR_memfd_create
+    fd = ::syscall(__NR_memfd_create, "storagemanager", 1);   // 1 = MFD_CLOEXEC
+#else
+    errno = ENOSYS;
+#endif
+    if (fd >= 0 && ::ftruncate(fd, sharedSize) == 0)
+        buf = ::mmap(NULL, sharedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (buf == MAP_FAILED)
+    {
+        log(logging::LOG_TYPE_WARNING, string("SocketPool: failed to make a shared buffer, got '") + 
+          strerror_r(errno, errbuf, 80) + "'.  Sending the data over the sockets.");
+        if (fd >= 0)
+            ::close(fd);
+        lock.lock();
+        sharedDisabled = true;
+        lock.unlock();
+        returnSocket(sock);
+        return NULL;
+    }
+    
+    // the buffer's descriptor goes in a byte after the msg
+    messageqcpp::ByteStream cmd, resp;
+    cmd << (uint8_t) storagemanager::ATTACH_BUFFER << (uint64_t) sharedSize;
+    int err = send_msg(sock, cmd);
+    if (err == 0)
+    {
+        uint8_t byte = 0;
+        char cbuf[CMSG_SPACE(sizeof(int))];
+        struct iovec iov;
+        struct msghdr msg;
+        
+        iov.iov_base = &byte;
+        iov.iov_len = 1;
+        memset(&msg, 0, sizeof(msg));
+        memset(cbuf, 0, sizeof(cbuf));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = cbuf;
+        msg.msg_controllen = sizeof(cbuf);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+        if (::sendmsg(sock, &msg, MSG_NOSIGNAL) != 1)
+        {
+            log(logging::LOG_TYPE_ERROR, string("SocketPool: got a network error: ") + strerror_r(errno, errbuf, 80));
+            remoteClosed(sock);
+            err = -1;
+        }
+    }
+    ::close(fd);
+    if (err == 0)
+        err = recv_msg(sock, &resp);
+    if (err < 0)
+    {
+        ::munmap(buf, sharedSize);
+        return NULL;
+    }
+    
+    ssize_t returnCode;
+    resp >> returnCode;
+    if (returnCode < 0)
+    {
+        int l_errno;
+        resp >> l_errno;
+        log(logging::LOG_TYPE_WARNING, string("SocketPool: StorageManager refused a shared buffer, got '") + 
+          strerror_r(l_errno, errbuf, 80) + "'.  Sending the data over the sockets.");
+        ::munmap(buf, sharedSize);
+        lock.lock();
+        sharedDisabled = true;
+        lock.unlock();
+        returnSocket(sock);
+        return NULL;
+    }
+    
+    lock.lock();
+    sharedBuffers[sock] = (uint8_t *) buf;
+    return (uint8_t *) buf;
+}
+
 int SocketPool::getSocket()
 {
     boost::mutex::scoped_lock lock(mutex);
@@ -262,6 +449,12 @@ void SocketPool::remoteClosed(const int sock)
     boost::mutex::scoped_lock lock(mutex);
     //cout << "closing socket " << sock << endl;
     ::close(sock);
+    map<int, uint8_t *>::iterator it = sharedBuffers.find(sock);
+    if (it != sharedBuffers.end())
+    {
+        ::munmap(it->second, sharedSize);
+        sharedBuffers.erase(it);
+    }
     for (vector<int>::iterator i = allSockets.begin(); i != allSockets.end(); ++i)
         if (*i == sock)
         {
@@ -22,6 +22,7 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition_variable.hpp>
 
+#include <map>
 #include "bytestream.h"
 
 namespace idbdatafile
@@ -39,17 +40,34 @@ class SocketPool : public boost::noncopyable
         // 0 = success, -1 = failure.  Should this throw instead?
         int send_recv(messageqcpp::ByteStream &to_send, messageqcpp::ByteStream *to_recv);
 
+        /* The shared-memory transport.  A connection can have a buffer of sharedBufferSize() bytes that
+        StorageManager maps as well, set up with ATTACH_BUFFER.  Commands with the SHARED_BUFFER bit pass their
+        data through it, and only the command and response go through the socket.
+
+        send_recv_shared() copies 'length' bytes from toWrite into the buffer before sending the command,
+        and copies the data a read returned into toRead afterward.  Either can be NULL.  It returns 1 without
+        sending anything if there is no shared buffer to use; the caller then sends the data in the msg. */
+        int send_recv_shared(messageqcpp::ByteStream &to_send, messageqcpp::ByteStream *to_recv,
+          const void *toWrite, void *toRead, size_t length);
+        size_t sharedBufferSize();
+
     private:
         int getSocket();
         void returnSocket(const int sock);
         void remoteClosed(const int sock);
+        int send_msg(int sock, messageqcpp::ByteStream &to_send);
+        int recv_msg(int sock, messageqcpp::ByteStream *to_recv);
+        uint8_t *attachBuffer(int sock);
         
         std::vector<int> allSockets;
         std::deque<int> freeSockets;
+        std::map<int, uint8_t *> sharedBuffers;
         boost::mutex mutex;
         boost::condition_variable socketAvailable;
         uint maxSockets;
         static const uint defaultSockets = 20;
+        size_t sharedSize;
+        bool sharedDisabled;
 };
 
 }
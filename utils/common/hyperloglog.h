@@ -0,0 +1,171 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+/** @file
+ * class HyperLogLog interface
+ */
+
+#ifndef UTILS_HYPERLOGLOG_H
+#define UTILS_HYPERLOGLOG_H
+
+#include <stdint.h>
+#include <cmath>
+#include <vector>
+#include <stdexcept>
+
+#include "bytestream.h"
+#include "hasher.h"
+
+namespace utils
+{
+
+/** @brief Estimates the number of distinct values in a stream
+ *
+ * The counter keeps 2^precision one byte registers, 16KB at the default
+ * precision, and its estimates have a standard error of about
+ * 1.04 / sqrt(2^precision), under 1% at the default.  Values are added
+ * as 64 bit hashes.  Counters of the same precision can be merged into
+ * the counter of the union of their streams.
+ */
+class HyperLogLog
+{
+public:
+    static const uint32_t MIN_PRECISION = 4;
+    static const uint32_t MAX_PRECISION = 18;
+    static const uint32_t DEFAULT_PRECISION = 14;
+
+    explicit HyperLogLog(uint32_t precision = DEFAULT_PRECISION)
+    {
+        if (precision < MIN_PRECISION || precision > MAX_PRECISION)
+            throw std::invalid_argument("HyperLogLog: precision is out of range");
+
+        fPrecision = precision;
+        fRegisters.assign(1U << precision, 0);
+    }
+
+    /** @brief hashes integer values for add() */
+    static inline uint64_t hashInt(uint64_t value)
+    {
+        return fmix((uint64_t) (value ^ 0x9e3779b97f4a7c15ULL));
+    }
+
+    /** @brief hashes strings for add() */
+    static inline uint64_t hashBytes(const char* data, uint64_t len)
+    {
+        return Hasher128()(data, len);
+    }
+
+    inline void add(uint64_t hash)
+    {
+        uint32_t index = hash >> (64 - fPrecision);
+        // the guard bit keeps the rank within 64 - precision + 1
+        uint64_t rest = (hash << fPrecision) | (1ULL << (fPrecision - 1));
+        uint8_t rank = __builtin_clzll(rest) + 1;
+
+        if (rank > fRegisters[index])
+            fRegisters[index] = rank;
+    }
+
+    void merge(const HyperLogLog& other)
+    {
+        if (other.fPrecision != fPrecision)
+            throw std::invalid_argument("HyperLogLog: can't merge counters of different precisions");
+
+        for (uint32_t i = 0; i < fRegisters.size(); i++)
+            if (other.fRegisters[i] > fRegisters[i])
+                fRegisters[i] = other.fRegisters[i];
+    }
+
+    uint64_t estimate() const
+    {
+        const double m = fRegisters.size();
+        double sum = 0;
+        uint32_t zeros = 0;
+
+        for (uint32_t i = 0; i < fRegisters.size(); i++)
+        {
+            sum += std::ldexp(1.0, -fRegisters[i]);
+
+            if (fRegisters[i] == 0)
+                zeros++;
+        }
+
+        double estimate = alpha() * m * m / sum;
+
+        // small cardinalities are counted better by the empty registers
+        if (estimate <= 2.5 * m && zeros > 0)
+            estimate = m * std::log(m / zeros);
+
+        return (uint64_t)(estimate + 0.5);
+    }
+
+    void clear()
+    {
+        fRegisters.assign(fRegisters.size(), 0);
+    }
+
+    uint32_t precision() const
+    {
+        return fPrecision;
+    }
+
+    void serialize(messageqcpp::ByteStream& bs) const
+    {
+        bs << fPrecision;
+        bs.append(&fRegisters[0], fRegisters.size());
+    }
+
+    void deserialize(messageqcpp::ByteStream& bs)
+    {
+        uint32_t precision;
+        bs >> precision;
+
+        if (precision < MIN_PRECISION || precision > MAX_PRECISION || bs.length() < (1U << precision))
+            throw std::runtime_error("HyperLogLog: bad serialized counter");
+
+        fPrecision = precision;
+        fRegisters.assign(bs.buf(), bs.buf() + (1U << precision));
+        bs.advance(1U << precision);
+    }
+
+private:
+    double alpha() const
+    {
+        switch (fRegisters.size())
+        {
+            case 16:
+                return 0.673;
+
+            case 32:
+                return 0.697;
+
+            case 64:
+                return 0.709;
+
+            default:
+                return 0.7213 / (1.0 + 1.079 / fRegisters.size());
+        }
+    }
+
+    uint32_t fPrecision;
+    std::vector<uint8_t> fRegisters;
+};
+
+}
+
+#endif
+// vim:ts=4 sw=4:
@@ -0,0 +1,188 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+/** @file
+ *  Building blocks for the vectorized primitives.
+ *
+ *  Kernels are written once with GCC vector extensions and instantiated
+ *  several times: for the baseline ISA and inside functions marked with
+ *  MCS_TARGET_SSE42/MCS_TARGET_AVX2.  The caller picks an instantiation
+ *  at runtime with hostSimdLevel(), so the binary still runs on CPUs that
+ *  lack the newer instruction sets.
+ */
+
+#ifndef UTILS_COMMON_SIMD_H
+#define UTILS_COMMON_SIMD_H
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MCS_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define MCS_TARGET_AVX2  __attribute__((target("avx2")))
+#else
+#define MCS_TARGET_SSE42
+#define MCS_TARGET_AVX2
+#endif
+
+#define MCS_FORCE_INLINE inline __attribute__((always_inline))
+
+namespace simd
+{
+
+// Instruction set levels the vectorized primitives can be dispatched to.
+enum SimdLevel
+{
+    SIMD_NONE,      // vectorized primitives are disabled, use the row-at-a-time code
+    SIMD_GENERIC,   // baseline ISA of the build (SSE2 on x86_64, NEON on aarch64)
+    SIMD_SSE42,
+    SIMD_AVX2
+};
+
+inline SimdLevel detectSimdLevel()
+{
+#if defined(__GNUC__) && defined(__x86_64__)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        return SIMD_AVX2;
+
+    if (__builtin_cpu_supports("sse4.2"))
+        return SIMD_SSE42;
+#endif
+    return SIMD_GENERIC;
+}
+
+// The best level supported by this host, detected once per process.
+inline SimdLevel hostSimdLevel()
+{
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+// Signed integer with the given width, used as a lane of comparison masks.
+template<int W> struct MaskLane;
+template<> struct MaskLane<1> { using type = int8_t; };
+template<> struct MaskLane<2> { using type = int16_t; };
+template<> struct MaskLane<4> { using type = int32_t; };
+template<> struct MaskLane<8> { using type = int64_t; };
+
+// VBYTES wide vector of T lanes and the matching comparison mask.
+template<typename T, int VBYTES>
+struct Vec
+{
+    static constexpr int LANES = VBYTES / sizeof(T);
+    typedef T type __attribute__((vector_size(VBYTES)));
+    typedef typename MaskLane<sizeof(T)>::type MaskT;
+    typedef MaskT mask_type __attribute__((vector_size(VBYTES)));
+
+    // Vectors are passed by reference: their by-value ABI depends on the target ISA
+    static MCS_FORCE_INLINE void load(type& v, const void* src)
+    {
+        memcpy(&v, src, sizeof(v));
+    }
+
+    static MCS_FORCE_INLINE void broadcast(type& v, T value)
+    {
+        v = type{};
+
+        for (int i = 0; i < LANES; i++)
+            v[i] = value;
+    }
+
+    // Take lanes of a where mask is set and lanes of v elsewhere.
+    static MCS_FORCE_INLINE void blend(type& v, const mask_type& mask, const type& a)
+    {
+        v = (type)(((mask_type) a & mask) | ((mask_type) v & ~mask));
+    }
+};
+
+// Pack the lanes of a 16 byte comparison mask into LANES bits, lane 0 in bit 0.
+template<int W>
+MCS_FORCE_INLINE uint32_t movemask16(const void* mask);
+
+#if defined(__x86_64__)
+template<>
+MCS_FORCE_INLINE uint32_t movemask16<1>(const void* mask)
+{
+    __m128i m;
+    memcpy(&m, mask, sizeof(m));
+    return _mm_movemask_epi8(m);
+}
+
+template<>
+MCS_FORCE_INLINE uint32_t movemask16<2>(const void* mask)
+{
+    __m128i m;
+    memcpy(&m, mask, sizeof(m));
+    return _mm_movemask_epi8(_mm_packs_epi16(m, _mm_setzero_si128()));
+}
+
+template<>
+MCS_FORCE_INLINE uint32_t movemask16<4>(const void* mask)
+{
+    __m128i m;
+    memcpy(&m, mask, sizeof(m));
+    return _mm_movemask_ps(_mm_castsi128_ps(m));
+}
+
+template<>
+MCS_FORCE_INLINE uint32_t movemask16<8>(const void* mask)
+{
+    __m128i m;
+    memcpy(&m, mask, sizeof(m));
+    return _mm_movemask_pd(_mm_castsi128_pd(m));
+}
+#else
+template<int W>
+MCS_FORCE_INLINE uint32_t movemask16(const void* mask)
+{
+    typedef typename MaskLane<W>::type MaskT;
+    MaskT lanes[16 / W];
+    uint32_t bits = 0;
+    memcpy(lanes, mask, sizeof(lanes));
+
+    for (int i = 0; i < 16 / W; i++)
+        bits |= (uint32_t)(lanes[i] & 1) << i;
+
+    return bits;
+}
+#endif
+
+// Pack the lanes of a comparison mask of any supported width into a bit mask.
+template<typename M>
+MCS_FORCE_INLINE uint32_t movemask(const M& mask)
+{
+    constexpr int W = sizeof(mask[0]);
+    constexpr int HALF_LANES = 16 / W;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&mask);
+    uint32_t bits = movemask16<W>(bytes);
+
+    for (uint32_t i = 16; i < sizeof(M); i += 16)
+        bits |= movemask16<W>(bytes + i) << (i / 16 * HALF_LANES);
+
+    return bits;
+}
+
+} // namespace simd
+
+#endif // UTILS_COMMON_SIMD_H
+// vim:ts=4 sw=4:
@@ -17,6 +17,8 @@
 
 #include <iostream>
 #include <atomic>
+#include <algorithm>
+#include <limits>
 #include <boost/filesystem.hpp>
 
 #include "statistics.h"
@@ -87,6 +89,71 @@ void StatisticsManager::output(StatisticsType statisticsType)
         for (const auto& p : keyTypes)
             std::cout << p.first << " " << (int) p.second << std::endl;
     }
+    else if (statisticsType == StatisticsType::COLUMN)
+    {
+        std::lock_guard<std::mutex> lock(columnStatsMut);
+        std::cout << "Columns count: " << columnStatistics.size() << std::endl;
+        for (const auto& p : columnStatistics)
+        {
+            const auto& stats = *p.second;
+            std::cout << p.first << " rows " << stats.rowCount << " nulls " << stats.nullCount
+                      << " distinct " << stats.distinctCount << " buckets "
+                      << (stats.hasHistogram() ? stats.histogram.size() - 1 : 0) << " common values "
+                      << stats.mostCommonValues.size() << std::endl;
+        }
+    }
+}
+
+void StatisticsManager::setColumnStatistics(const std::map<uint32_t, ColumnStatistics>& columnStats,
+                                            bool trace)
+{
+    {
+        std::lock_guard<std::mutex> lock(columnStatsMut);
+        for (const auto& p : columnStats)
+            columnStatistics[p.first] = std::make_shared<const ColumnStatistics>(p.second);
+    }
+
+    if (trace)
+        output(StatisticsType::COLUMN);
+}
+
+std::shared_ptr<const ColumnStatistics> StatisticsManager::getColumnStatistics(uint32_t oid)
+{
+    std::lock_guard<std::mutex> lock(columnStatsMut);
+    auto it = columnStatistics.find(oid);
+    if (it == columnStatistics.end())
+        return std::shared_ptr<const ColumnStatistics>();
+
+    return it->second;
+}
+
+void StatisticsManager::serializeColumnStatistics(messageqcpp::ByteStream& bs)
+{
+    std::lock_guard<std::mutex> lock(columnStatsMut);
+    uint64_t count = columnStatistics.size();
+    bs << count;
+
+    for (const auto& p : columnStatistics)
+    {
+        bs << p.first;
+        p.second->serialize(bs);
+    }
+}
+
+void StatisticsManager::unserializeColumnStatistics(messageqcpp::ByteStream& bs)
+{
+    std::lock_guard<std::mutex> lock(columnStatsMut);
+    uint64_t count;
+    bs >> count;
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        uint32_t oid;
+        bs >> oid;
+        auto stats = std::make_shared<ColumnStatistics>();
+        stats->unserialize(bs);
+        columnStatistics[oid] = stats;
+    }
 }
 
 // Someday it will be a virtual method, based on statistics type we processing.
@@ -94,8 +161,13 @@ std::unique_ptr<char[]> StatisticsManager::convertStatsToDataStream(uint64_t& da
 {
     // Number of pairs.
     uint64_t count = keyTypes.size();
-    // count, [[uid, keyType], ... ]
-    dataStreamSize = sizeof(uint64_t) + count * (sizeof(uint32_t) + sizeof(KeyType));
+    // Column statistics.
+    messageqcpp::ByteStream columnStatsBs;
+    serializeColumnStatistics(columnStatsBs);
+    uint64_t columnStatsSize = columnStatsBs.length();
+    // count, [[uid, keyType], ... ], column statistics size, column statistics
+    dataStreamSize = sizeof(uint64_t) + count * (sizeof(uint32_t) + sizeof(KeyType)) +
+                     sizeof(uint64_t) + columnStatsSize;
 
     // Allocate memory for data stream.
     std::unique_ptr<char[]> dataStreamSmartPtr(new char[dataStreamSize]);
@@ -117,6 +189,10 @@ std::unique_ptr<char[]> StatisticsManager::convertStatsToDataStream(uint64_t& da
         offset += sizeof(KeyType);
     }
 
+    std::memcpy(&dataStream[offset], reinterpret_cast<char*>(&columnStatsSize), sizeof(uint64_t));
+    offset += sizeof(uint64_t);
+    std::memcpy(&dataStream[offset], columnStatsBs.buf(), columnStatsSize);
+
     return dataStreamSmartPtr;
 }
 
@@ -197,8 +273,8 @@ void StatisticsManager::loadFromFile()
     if (size != headerSize)
         throw ios_base::failure("StatisticsManager::loadFromFile(): read failed. ");
 
-    // Initialize fields from the file header.
-    version = fileHeader.version;
+    // Initialize fields from the file header, older versions are converted on the next save.
+    const auto fileVersion = fileHeader.version;
     epoch = fileHeader.epoch;
     const auto dataHash = fileHeader.dataHash;
     const auto dataStreamSize = fileHeader.dataSize;
@@ -245,6 +321,20 @@ void StatisticsManager::loadFromFile()
         // Insert pair.
         keyTypes[oid] = keyType;
     }
+
+    if (fileVersion >= 2 && offset + sizeof(uint64_t) <= dataStreamSize)
+    {
+        uint64_t columnStatsSize = 0;
+        std::memcpy(reinterpret_cast<char*>(&columnStatsSize), &dataStream[offset], sizeof(uint64_t));
+        offset += sizeof(uint64_t);
+
+        if (offset + columnStatsSize > dataStreamSize)
+            throw ios_base::failure("StatisticsManager::loadFromFile(): invalid column statistics. ");
+
+        messageqcpp::ByteStream columnStatsBs;
+        columnStatsBs.load(reinterpret_cast<const uint8_t*>(&dataStream[offset]), columnStatsSize);
+        unserializeColumnStatistics(columnStatsBs);
+    }
 }
 
 uint64_t StatisticsManager::computeHashFromStats()
@@ -267,12 +357,15 @@ void StatisticsManager::serialize(messageqcpp::ByteStream& bs)
         bs << keyType.first;
         bs << (uint32_t) keyType.second;
     }
+
+    serializeColumnStatistics(bs);
 }
 
 void StatisticsManager::unserialize(messageqcpp::ByteStream& bs)
 {
     uint64_t count;
-    bs >> version;
+    uint32_t senderVersion;
+    bs >> senderVersion;
     bs >> epoch;
     bs >> count;
 
@@ -283,12 +376,332 @@ void StatisticsManager::unserialize(messageqcpp::ByteStream& bs)
         bs >> keyType;
         keyTypes[oid] = static_cast<KeyType>(keyType);
     }
+
+    if (senderVersion >= 2)
+        unserializeColumnStatistics(bs);
 }
 
 bool StatisticsManager::hasKey(uint32_t oid) { return keyTypes.count(oid) > 0 ? true : false; }
 
 KeyType StatisticsManager::getKeyType(uint32_t oid) { return keyTypes[oid]; }
 
+double ColumnStatistics::averageEqualFraction() const
+{
+    return (1.0 - nullFraction()) / std::max<uint64_t>(distinctCount, 1);
+}
+
+double ColumnStatistics::equalFraction(int64_t value) const
+{
+    const double nonNullFraction = 1.0 - nullFraction();
+    double commonFraction = 0.0;
+
+    for (const auto& p : mostCommonValues)
+    {
+        if (p.first == value)
+            return nonNullFraction * p.second;
+        commonFraction += p.second;
+    }
+
+    if (hasHistogram() && (less(value, histogram.front()) || less(histogram.back(), value)))
+        return 0.0;
+
+    // The rest of the rows are spread evenly over the rest of the values.
+    uint64_t otherValues = distinctCount > mostCommonValues.size() ? distinctCount - mostCommonValues.size() : 1;
+    return std::max(0.0, nonNullFraction * (1.0 - commonFraction) / otherValues);
+}
+
+double ColumnStatistics::lessFraction(int64_t value, bool orEqual) const
+{
+    const double nonNullFraction = 1.0 - nullFraction();
+
+    if (!hasHistogram())
+        return nonNullFraction / 3;
+
+    if (less(value, histogram.front()))
+        return 0.0;
+
+    double fraction;
+    if (!less(value, histogram.back()))
+    {
+        fraction = nonNullFraction;
+    }
+    else
+    {
+        // The last bound that isn't greater than `value`, the value is interpolated
+        // within its bucket.
+        auto it = std::upper_bound(histogram.begin(), histogram.end(), value,
+                                   [this](int64_t a, int64_t b) { return less(a, b); });
+        size_t bucket = (it - histogram.begin()) - 1;
+        long double width = toLongDouble(histogram[bucket + 1]) - toLongDouble(histogram[bucket]);
+        long double position = width > 0 ? (toLongDouble(value) - toLongDouble(histogram[bucket])) / width : 0;
+        fraction = nonNullFraction * (bucket + (double) position) / (histogram.size() - 1);
+    }
+
+    // So far the fraction counts the rows holding `value` as well.
+    if (!orEqual)
+        fraction -= equalFraction(value);
+
+    return std::min(std::max(fraction, 0.0), nonNullFraction);
+}
+
+void ColumnStatistics::serialize(messageqcpp::ByteStream& bs) const
+{
+    bs << rowCount;
+    bs << nullCount;
+    bs << distinctCount;
+    bs << (uint8_t) isUnsigned;
+    bs << (uint32_t) histogram.size();
+    for (auto bound : histogram)
+        bs << bound;
+    bs << (uint32_t) mostCommonValues.size();
+    for (const auto& p : mostCommonValues)
+    {
+        bs << p.first;
+        bs << p.second;
+    }
+}
+
+void ColumnStatistics::unserialize(messageqcpp::ByteStream& bs)
+{
+    uint8_t unsignedFlag;
+    uint32_t size;
+    bs >> rowCount;
+    bs >> nullCount;
+    bs >> distinctCount;
+    bs >> unsignedFlag;
+    isUnsigned = unsignedFlag;
+
+    bs >> size;
+    histogram.resize(size);
+    for (uint32_t i = 0; i < size; ++i)
+        bs >> histogram[i];
+
+    bs >> size;
+    mostCommonValues.resize(size);
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        bs >> mostCommonValues[i].first;
+        bs >> mostCommonValues[i].second;
+    }
+}
+
+ColumnStatisticsCollector::ColumnStatisticsCollector(const rowgroup::RowGroup& rowGroup)
+{
+    const auto& oids = rowGroup.getOIDs();
+    const auto& types = rowGroup.getColTypes();
+    columns.resize(rowGroup.getColumnCount());
+
+    for (uint32_t i = 0; i < columns.size(); ++i)
+    {
+        columns[i].oid = oids[i];
+        columns[i].ordered = isOrdered(types[i], rowGroup.getColumnWidth(i));
+        columns[i].stats.isUnsigned = datatypes::isUnsigned(types[i]);
+    }
+}
+
+// The types whose values and filters compare as integers of the column width.
+bool ColumnStatisticsCollector::isOrdered(execplan::CalpontSystemCatalog::ColDataType type, uint32_t width)
+{
+    switch (type)
+    {
+        case execplan::CalpontSystemCatalog::TINYINT:
+        case execplan::CalpontSystemCatalog::SMALLINT:
+        case execplan::CalpontSystemCatalog::MEDINT:
+        case execplan::CalpontSystemCatalog::INT:
+        case execplan::CalpontSystemCatalog::BIGINT:
+        case execplan::CalpontSystemCatalog::UTINYINT:
+        case execplan::CalpontSystemCatalog::USMALLINT:
+        case execplan::CalpontSystemCatalog::UMEDINT:
+        case execplan::CalpontSystemCatalog::UINT:
+        case execplan::CalpontSystemCatalog::UBIGINT:
+        case execplan::CalpontSystemCatalog::DATE:
+        case execplan::CalpontSystemCatalog::DATETIME:
+        case execplan::CalpontSystemCatalog::TIMESTAMP:
+        case execplan::CalpontSystemCatalog::TIME:
+            return true;
+
+        case execplan::CalpontSystemCatalog::DECIMAL:
+        case execplan::CalpontSystemCatalog::UDECIMAL:
+            return width <= sizeof(int64_t);
+
+        default:
+            return false;
+    }
+}
+
+// Hashes a value that isn't ordered as an integer: strings by their contents,
+// floating point values by their value, anything else by all of its bytes.
+uint64_t ColumnStatisticsCollector::hashValue(const rowgroup::Row& r, uint32_t col)
+{
+    switch (r.getColType(col))
+    {
+        case execplan::CalpontSystemCatalog::CHAR:
+        case execplan::CalpontSystemCatalog::VARCHAR:
+        case execplan::CalpontSystemCatalog::TEXT:
+        case execplan::CalpontSystemCatalog::BLOB:
+        {
+            auto value = r.getConstString(col);
+            return utils::HyperLogLog::hashBytes(value.str(), value.length());
+        }
+
+        case execplan::CalpontSystemCatalog::VARBINARY:
+            return utils::HyperLogLog::hashBytes((const char*) r.getVarBinaryField(col),
+                                                 r.getVarBinaryLength(col));
+
+        // -0.0 and 0.0 are the same value
+        case execplan::CalpontSystemCatalog::FLOAT:
+        case execplan::CalpontSystemCatalog::UFLOAT:
+        {
+            float value = r.getFloatField(col);
+            if (value == 0)
+                value = 0;
+            return utils::HyperLogLog::hashBytes((const char*) &value, sizeof(value));
+        }
+
+        case execplan::CalpontSystemCatalog::DOUBLE:
+        case execplan::CalpontSystemCatalog::UDOUBLE:
+        {
+            double value = r.getDoubleField(col);
+            if (value == 0)
+                value = 0;
+            return utils::HyperLogLog::hashBytes((const char*) &value, sizeof(value));
+        }
+
+        case execplan::CalpontSystemCatalog::LONGDOUBLE:
+        {
+            long double value = r.getLongDoubleField(col);
+            if (value == 0)
+                value = 0;
+            // The x87 format has 10 significant bytes, the rest is padding.
+            const uint64_t len = std::numeric_limits<long double>::digits == 64 ? 10 : sizeof(value);
+            return utils::HyperLogLog::hashBytes((const char*) &value, len);
+        }
+
+        default:
+            return utils::HyperLogLog::hashBytes((const char*) r.getData() + r.getOffset(col),
+                                                 r.getColumnWidth(col));
+    }
+}
+
+void ColumnStatisticsCollector::add(const rowgroup::RowGroup& rowGroup)
+{
+    const auto rowCount = rowGroup.getRowCount();
+    if (!rowCount)
+        return;
+
+    rowgroup::Row r;
+    rowGroup.initRow(&r);
+    rowGroup.getRow(0, &r);
+
+    for (uint32_t i = 0; i < rowCount; ++i, r.nextRow())
+    {
+        for (uint32_t j = 0; j < columns.size(); ++j)
+        {
+            auto& column = columns[j];
+            ++column.stats.rowCount;
+
+            if (r.isNullValue(j))
+            {
+                ++column.stats.nullCount;
+                continue;
+            }
+
+            if (!column.ordered)
+            {
+                column.distinct.add(hashValue(r, j));
+                continue;
+            }
+
+            int64_t value = column.stats.isUnsigned ? (int64_t) r.getUintField(j) : r.getIntField(j);
+            column.distinct.add(utils::HyperLogLog::hashInt(value));
+
+            if (column.valueCount == 0 || column.stats.less(value, column.min))
+                column.min = value;
+            if (column.valueCount == 0 || column.stats.less(column.max, value))
+                column.max = value;
+
+            // Reservoir sampling keeps every value seen with the same chance.
+            if (column.sample.size() < COLUMN_SAMPLE_SIZE)
+                column.sample.push_back(value);
+            else
+            {
+                uint64_t slot = random() % (column.valueCount + 1);
+                if (slot < COLUMN_SAMPLE_SIZE)
+                    column.sample[slot] = value;
+            }
+
+            ++column.valueCount;
+        }
+    }
+}
+
+void ColumnStatisticsCollector::finishColumn(Column& column)
+{
+    auto& stats = column.stats;
+    stats.distinctCount = column.distinct.estimate();
+
+    if (!column.ordered || column.sample.empty())
+        return;
+
+    auto& sample = column.sample;
+    const size_t sampleSize = sample.size();
+    std::sort(sample.begin(), sample.end(), [&stats](int64_t a, int64_t b) { return stats.less(a, b); });
+
+    // Runs of equal values as [count, value].
+    std::vector<std::pair<uint64_t, int64_t>> runs;
+    size_t runStart = 0;
+    for (size_t i = 1; i <= sampleSize; ++i)
+    {
+        if (i == sampleSize || sample[i] != sample[runStart])
+        {
+            runs.emplace_back(i - runStart, sample[runStart]);
+            runStart = i;
+        }
+    }
+
+    // A sample of every value counts the distinct values exactly.
+    if (column.valueCount == sampleSize)
+        stats.distinctCount = runs.size();
+
+    // Equi-depth buckets between the minimum and the maximum of all the values.
+    const size_t buckets = std::min<size_t>(HISTOGRAM_BUCKETS, sampleSize);
+    stats.histogram.resize(buckets + 1);
+    stats.histogram.front() = column.min;
+    for (size_t b = 1; b < buckets; ++b)
+        stats.histogram[b] = sample[b * sampleSize / buckets];
+    stats.histogram.back() = column.max;
+
+    // The values noticeably more common than the average one.
+    const size_t candidates = std::min<size_t>(MOST_COMMON_VALUES, runs.size());
+    std::partial_sort(runs.begin(), runs.begin() + candidates, runs.end(),
+                      [](const std::pair<uint64_t, int64_t>& a, const std::pair<uint64_t, int64_t>& b)
+                      { return a.first > b.first; });
+    const double averageCount = (double) sampleSize / runs.size();
+
+    for (size_t i = 0; i < candidates; ++i)
+    {
+        if (runs[i].first < 2 || runs[i].first < 1.25 * averageCount)
+            break;
+        stats.mostCommonValues.emplace_back(runs[i].second, (double) runs[i].first / sampleSize);
+    }
+
+    sample.clear();
+    sample.shrink_to_fit();
+}
+
+std::map<uint32_t, ColumnStatistics> ColumnStatisticsCollector::finish()
+{
+    std::map<uint32_t, ColumnStatistics> ret;
+
+    for (auto& column : columns)
+    {
+        finishColumn(column);
+        ret[column.oid] = column.stats;
+    }
+
+    return ret;
+}
+
 StatisticsDistributor* StatisticsDistributor::instance()
 {
     static StatisticsDistributor* sd = new StatisticsDistributor();
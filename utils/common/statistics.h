@@ -21,9 +21,12 @@
 #include "rowgroup.h"
 #include "logger.h"
 #include "hasher.h"
+#include "hyperloglog.h"
 #include "IDBPolicy.h"
 
 #include <map>
+#include <memory>
+#include <random>
 #include <unordered_set>
 #include <mutex>
 
@@ -52,7 +55,95 @@ enum class KeyType : uint32_t
 enum class StatisticsType : uint32_t
 {
     // A special statistics type, made to solve circular inner join problem.
-    PK_FK
+    PK_FK,
+    // Histograms, distinct counts, null fractions and most common values of columns.
+    COLUMN
+};
+
+// Number of buckets in the equi-depth histogram of a column.
+const uint32_t HISTOGRAM_BUCKETS = 64;
+// Number of most common values kept for a column.
+const uint32_t MOST_COMMON_VALUES = 16;
+// Number of values of a column ANALYZE TABLE samples to build the histogram from.
+const uint32_t COLUMN_SAMPLE_SIZE = 64 * 1024;
+
+// Represents the statistics ANALYZE TABLE collects for a column.
+// The histogram and the most common values are kept for the columns whose values
+// are ordered as integers, the way the filters of the column compare them, and
+// are empty for the others.
+struct ColumnStatistics
+{
+    // Rows analyzed and how many of them are NULL.
+    uint64_t rowCount = 0;
+    uint64_t nullCount = 0;
+    // Estimated number of distinct non-NULL values.
+    uint64_t distinctCount = 0;
+    // The values are compared as unsigned integers.
+    bool isUnsigned = false;
+    // Bounds of the equi-depth histogram buckets, the front is the minimum value
+    // and the back is the maximum.
+    std::vector<int64_t> histogram;
+    // The most common values with the fraction of non-NULL rows holding them.
+    std::vector<std::pair<int64_t, double>> mostCommonValues;
+
+    bool hasHistogram() const { return histogram.size() >= 2; }
+    double nullFraction() const { return rowCount ? (double) nullCount / rowCount : 0.0; }
+    // Estimates the fraction of rows equal to some value, without looking at the value.
+    double averageEqualFraction() const;
+    // Estimates the fraction of rows equal to `value`.
+    double equalFraction(int64_t value) const;
+    // Estimates the fraction of rows less than `value`, or less than or equal to it.
+    double lessFraction(int64_t value, bool orEqual) const;
+
+    void serialize(messageqcpp::ByteStream& bs) const;
+    void unserialize(messageqcpp::ByteStream& bs);
+
+    // Compares values the way the column does.
+    bool less(int64_t a, int64_t b) const
+    {
+        return isUnsigned ? (uint64_t) a < (uint64_t) b : a < b;
+    }
+
+  private:
+    long double toLongDouble(int64_t a) const
+    {
+        return isUnsigned ? (long double) (uint64_t) a : (long double) a;
+    }
+};
+
+// Builds the column statistics of a table from the RowGroups of an ANALYZE TABLE scan.
+// Null counts and distinct counts cover every row, histograms and most common values
+// are built from a sample of each column.
+class ColumnStatisticsCollector
+{
+  public:
+    explicit ColumnStatisticsCollector(const rowgroup::RowGroup& rowGroup);
+    // Adds the rows of `rowGroup`, laid out like the one the collector was made for.
+    void add(const rowgroup::RowGroup& rowGroup);
+    // Returns the statistics of every column by its oid.
+    std::map<uint32_t, ColumnStatistics> finish();
+
+  private:
+    struct Column
+    {
+        uint32_t oid;
+        // Values are ordered as integers and get a histogram.
+        bool ordered;
+        ColumnStatistics stats;
+        utils::HyperLogLog distinct;
+        // Non-NULL values seen, and a uniform sample of them.
+        uint64_t valueCount = 0;
+        std::vector<int64_t> sample;
+        int64_t min = 0;
+        int64_t max = 0;
+    };
+
+    static bool isOrdered(execplan::CalpontSystemCatalog::ColDataType type, uint32_t width);
+    static uint64_t hashValue(const rowgroup::Row& r, uint32_t col);
+    void finishColumn(Column& column);
+
+    std::vector<Column> columns;
+    std::mt19937_64 random;
 };
 
 // Represetns a header for the statistics file.
@@ -92,13 +183,25 @@ class StatisticsManager
     bool hasKey(uint32_t oid);
     // Returns a KeyType for the given `oid`.
     KeyType getKeyType(uint32_t oid);
+    // Replaces the column statistics of the analyzed columns.
+    void setColumnStatistics(const std::map<uint32_t, ColumnStatistics>& columnStats, bool trace);
+    // Returns the column statistics for the given `oid`, null if the column wasn't analyzed.
+    std::shared_ptr<const ColumnStatistics> getColumnStatistics(uint32_t oid);
 
   private:
+    // Version 1 files have the key types only, version 2 adds the column statistics.
+    static const uint32_t CURRENT_VERSION = 2;
+
     std::map<uint32_t, KeyType> keyTypes;
-    StatisticsManager() : epoch(0), version(1) { IDBPolicy::init(true, false, "", 0); }
+    std::map<uint32_t, std::shared_ptr<const ColumnStatistics>> columnStatistics;
+    StatisticsManager() : epoch(0), version(CURRENT_VERSION) { IDBPolicy::init(true, false, "", 0); }
     std::unique_ptr<char[]> convertStatsToDataStream(uint64_t& dataStreamSize);
+    void serializeColumnStatistics(messageqcpp::ByteStream& bs);
+    void unserializeColumnStatistics(messageqcpp::ByteStream& bs);
 
     std::mutex mut;
+    // Guards `columnStatistics`, the planner reads them while `mut` may be held for file I/O.
+    std::mutex columnStatsMut;
     uint32_t epoch;
     uint32_t version;
     std::string statsFile = "/var/lib/columnstore/local/statistics";
@@ -0,0 +1,278 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+/** @file
+ * class TDigest interface
+ */
+
+#ifndef UTILS_TDIGEST_H
+#define UTILS_TDIGEST_H
+
+#include <stdint.h>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include "bytestream.h"
+
+namespace utils
+{
+
+/** @brief Estimates quantiles of a stream of numbers
+ *
+ * The digest summarizes the values seen as at most about 'compression'
+ * weighted centroids.  The centroids are kept small near both tails, so
+ * the quantiles there are the most accurate, and the error in the middle
+ * is a fraction of a percent at the default compression.  Digests can be
+ * merged into the digest of the union of their streams.
+ */
+class TDigest
+{
+public:
+    static const uint32_t DEFAULT_COMPRESSION = 200;
+
+    explicit TDigest(uint32_t compression = DEFAULT_COMPRESSION)
+    {
+        if (compression < 10)
+            throw std::invalid_argument("TDigest: compression is too small");
+
+        fCompression = compression;
+        clear();
+    }
+
+    void add(double value, double weight = 1)
+    {
+        if (std::isnan(value) || weight <= 0)
+            return;
+
+        fBuffer.push_back(Centroid(value, weight));
+        fMin = std::min(fMin, value);
+        fMax = std::max(fMax, value);
+
+        if (fBuffer.size() >= bufferLimit())
+            compress();
+    }
+
+    void merge(const TDigest& other)
+    {
+        if (other.count() == 0)
+            return;
+
+        fBuffer.insert(fBuffer.end(), other.fCentroids.begin(), other.fCentroids.end());
+        fBuffer.insert(fBuffer.end(), other.fBuffer.begin(), other.fBuffer.end());
+        fMin = std::min(fMin, other.fMin);
+        fMax = std::max(fMax, other.fMax);
+        compress();
+    }
+
+    /** @brief the total weight added */
+    double count() const
+    {
+        double total = 0;
+
+        for (uint32_t i = 0; i < fCentroids.size(); i++)
+            total += fCentroids[i].weight;
+
+        for (uint32_t i = 0; i < fBuffer.size(); i++)
+            total += fBuffer[i].weight;
+
+        return total;
+    }
+
+    /** @brief the value below which the fraction q of the weight lies, NaN if empty */
+    double quantile(double q)
+    {
+        compress();
+
+        if (fCentroids.empty())
+            return std::numeric_limits<double>::quiet_NaN();
+
+        q = std::max(0.0, std::min(1.0, q));
+
+        double total = 0;
+
+        for (uint32_t i = 0; i < fCentroids.size(); i++)
+            total += fCentroids[i].weight;
+
+        // Each centroid stands at the middle of its weight, the minimum at 0
+        // and the maximum at the total; interpolate between neighbours.
+        double index = q * total;
+        double prevPos = 0, prevMean = fMin, cum = 0;
+
+        for (uint32_t i = 0; i < fCentroids.size(); i++)
+        {
+            double pos = cum + fCentroids[i].weight / 2;
+
+            if (index <= pos)
+                return interpolate(index, prevPos, prevMean, pos, fCentroids[i].mean);
+
+            prevPos = pos;
+            prevMean = fCentroids[i].mean;
+            cum += fCentroids[i].weight;
+        }
+
+        return interpolate(index, prevPos, prevMean, total, fMax);
+    }
+
+    void clear()
+    {
+        fCentroids.clear();
+        fBuffer.clear();
+        fMin = std::numeric_limits<double>::infinity();
+        fMax = -std::numeric_limits<double>::infinity();
+    }
+
+    void serialize(messageqcpp::ByteStream& bs) const
+    {
+        bs << fCompression;
+        bs << fMin;
+        bs << fMax;
+        bs << (uint32_t) (fCentroids.size() + fBuffer.size());
+
+        for (uint32_t i = 0; i < fCentroids.size(); i++)
+            bs << fCentroids[i].mean << fCentroids[i].weight;
+
+        for (uint32_t i = 0; i < fBuffer.size(); i++)
+            bs << fBuffer[i].mean << fBuffer[i].weight;
+    }
+
+    void deserialize(messageqcpp::ByteStream& bs)
+    {
+        uint32_t compression, size;
+        double mean, weight;
+
+        bs >> compression;
+
+        if (compression < 10)
+            throw std::runtime_error("TDigest: bad serialized digest");
+
+        fCompression = compression;
+        clear();
+        bs >> fMin;
+        bs >> fMax;
+        bs >> size;
+        fBuffer.reserve(size);
+
+        for (uint32_t i = 0; i < size; i++)
+        {
+            bs >> mean >> weight;
+            fBuffer.push_back(Centroid(mean, weight));
+        }
+
+        compress();
+    }
+
+private:
+    struct Centroid
+    {
+        double mean;
+        double weight;
+
+        Centroid(double m, double w) : mean(m), weight(w) { }
+        bool operator<(const Centroid& c) const
+        {
+            return mean < c.mean;
+        }
+    };
+
+    size_t bufferLimit() const
+    {
+        return fCompression * 5;
+    }
+
+    // the scale function k = compression / 2pi * asin(2q - 1) and its inverse
+    double qToK(double q) const
+    {
+        return fCompression / (2 * M_PI) * std::asin(2 * q - 1);
+    }
+
+    double kToQ(double k) const
+    {
+        return (std::sin(k * 2 * M_PI / fCompression) + 1) / 2;
+    }
+
+    // the weight up to which a centroid starting at the fraction q may grow
+    double weightLimit(double q, double total) const
+    {
+        double k = qToK(std::min(q, 1.0)) + 1;
+
+        return (k >= fCompression / 4.0 ? total : total * kToQ(k));
+    }
+
+    static double interpolate(double x, double x0, double y0, double x1, double y1)
+    {
+        if (x1 <= x0)
+            return y1;
+
+        return y0 + (x - x0) / (x1 - x0) * (y1 - y0);
+    }
+
+    // Merges the buffered values into the centroids.  Neighbouring centroids
+    // are combined while the result spans less than one unit of k.
+    void compress()
+    {
+        if (fBuffer.empty())
+            return;
+
+        fBuffer.insert(fBuffer.end(), fCentroids.begin(), fCentroids.end());
+        std::sort(fBuffer.begin(), fBuffer.end());
+        fCentroids.clear();
+
+        double total = 0;
+
+        for (uint32_t i = 0; i < fBuffer.size(); i++)
+            total += fBuffer[i].weight;
+
+        double soFar = 0;
+        double limit = weightLimit(0, total);
+        Centroid cur = fBuffer[0];
+
+        for (uint32_t i = 1; i < fBuffer.size(); i++)
+        {
+            const Centroid& next = fBuffer[i];
+
+            if (soFar + cur.weight + next.weight <= limit)
+            {
+                cur.weight += next.weight;
+                cur.mean += (next.mean - cur.mean) * next.weight / cur.weight;
+            }
+            else
+            {
+                soFar += cur.weight;
+                fCentroids.push_back(cur);
+                limit = weightLimit(soFar / total, total);
+                cur = next;
+            }
+        }
+
+        fCentroids.push_back(cur);
+        fBuffer.clear();
+    }
+
+    uint32_t fCompression;
+    double fMin;
+    double fMax;
+    std::vector<Centroid> fCentroids;
+    std::vector<Centroid> fBuffer;
+};
+
+}
+
+#endif
+// vim:ts=4 sw=4:
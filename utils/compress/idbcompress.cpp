@@ -113,8 +113,13 @@ CompressInterface::CompressInterface(unsigned int numUserPaddingBytes) :
 /*static*/
 bool CompressInterface::isCompressionAvail(int compressionType)
 {
+    // LZ4 (3) needs the library, CompressInterfaceLZ4 fails every call without it
     return ((compressionType == 0) || (compressionType == 1) ||
-            (compressionType == 2) || (compressionType == 3));
+            (compressionType == 2)
+#ifdef HAVE_LZ4
+            || (compressionType == 3)
+#endif
+           );
 }
 
 size_t CompressInterface::getMaxCompressedSizeGeneric(size_t inLen)
@@ -690,6 +690,10 @@ std::string Config::getTempFileDir(Config::TempDirPurpose what)
     return prefix.append("joins/");
   case TempDirPurpose::Aggregates:
     return prefix.append("aggregates/");
+  case TempDirPurpose::WindowFunctions:
+    return prefix.append("windowfunctions/");
+  case TempDirPurpose::OrderBy:
+    return prefix.append("orderby/");
   }
   // NOTREACHED
   return {};
@@ -206,7 +206,9 @@ public:
     enum class TempDirPurpose
     {
       Joins,      ///< disk joins
-      Aggregates  ///< disk-based aggregation
+      Aggregates, ///< disk-based aggregation
+      WindowFunctions, ///< disk-based window functions
+      OrderBy     ///< disk-based ORDER BY
     };
     /** @brief Return temporaru directory path for the specified purpose */
     EXPORT std::string getTempFileDir(TempDirPurpose what);
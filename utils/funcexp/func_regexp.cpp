@@ -22,7 +22,9 @@
 ****************************************************************************/
 
 #include <cstdlib>
+#include <cstring>
 #include <string>
+#include <tr1/unordered_map>
 using namespace std;
 
 #ifdef __linux__
@@ -47,17 +49,15 @@ using namespace logging;
 
 namespace
 {
-inline bool getBool(rowgroup::Row& row,
-                    funcexp::FunctionParm& pm,
-                    bool& isNull,
-                    CalpontSystemCatalog::ColType& ct,
-                    const string& timeZone)
+inline string getParm(rowgroup::Row& row,
+                      execplan::SPTP& parm,
+                      bool& isNull,
+                      CalpontSystemCatalog::ColType& ct,
+                      const string& timeZone)
 {
+    string str;
 
-    string expr;
-    string pattern;
-
-    switch (pm[0]->data()->resultType().colDataType)
+    switch (parm->data()->resultType().colDataType)
     {
         case execplan::CalpontSystemCatalog::BIGINT:
         case execplan::CalpontSystemCatalog::INT:
@@ -77,52 +77,52 @@ inline bool getBool(rowgroup::Row& row,
         case execplan::CalpontSystemCatalog::FLOAT:
         case execplan::CalpontSystemCatalog::UFLOAT:
         {
-            expr = pm[0]->data()->getStrVal(row, isNull);
+            str = parm->data()->getStrVal(row, isNull);
             break;
         }
 
         case execplan::CalpontSystemCatalog::DATE:
         {
-            expr = dataconvert::DataConvert::dateToString(pm[0]->data()->getDateIntVal(row, isNull));
+            str = dataconvert::DataConvert::dateToString(parm->data()->getDateIntVal(row, isNull));
             break;
         }
 
         case execplan::CalpontSystemCatalog::DATETIME:
         {
-            expr = dataconvert::DataConvert::datetimeToString(pm[0]->data()->getDatetimeIntVal(row, isNull));
+            str = dataconvert::DataConvert::datetimeToString(parm->data()->getDatetimeIntVal(row, isNull));
             //strip off micro seconds
-            expr = expr.substr(0, 19);
+            str = str.substr(0, 19);
             break;
         }
 
         case execplan::CalpontSystemCatalog::TIMESTAMP:
         {
-            expr = dataconvert::DataConvert::timestampToString(pm[0]->data()->getTimestampIntVal(row, isNull), timeZone);
+            str = dataconvert::DataConvert::timestampToString(parm->data()->getTimestampIntVal(row, isNull), timeZone);
             //strip off micro seconds
-            expr = expr.substr(0, 19);
+            str = str.substr(0, 19);
             break;
         }
 
         case execplan::CalpontSystemCatalog::TIME:
         {
-            expr = dataconvert::DataConvert::timeToString(pm[0]->data()->getTimeIntVal(row, isNull));
+            str = dataconvert::DataConvert::timeToString(parm->data()->getTimeIntVal(row, isNull));
             //strip off micro seconds
-            expr = expr.substr(0, 19);
+            str = str.substr(0, 19);
             break;
         }
 
         case execplan::CalpontSystemCatalog::DECIMAL:
         case execplan::CalpontSystemCatalog::UDECIMAL:
         {
-            IDB_Decimal d = pm[0]->data()->getDecimalVal(row, isNull);
+            IDB_Decimal d = parm->data()->getDecimalVal(row, isNull);
 
-            if (pm[0]->data()->resultType().colWidth == datatypes::MAXDECIMALWIDTH)
+            if (parm->data()->resultType().colWidth == datatypes::MAXDECIMALWIDTH)
             {
-                expr = d.toString(true);
+                str = d.toString(true);
             }
             else
             {
-                expr = d.toString();
+                str = d.toString();
             }
 
             break;
@@ -136,110 +136,140 @@ inline bool getBool(rowgroup::Row& row,
         }
     }
 
-    switch (pm[1]->data()->resultType().colDataType)
-    {
-        case execplan::CalpontSystemCatalog::BIGINT:
-        case execplan::CalpontSystemCatalog::INT:
-        case execplan::CalpontSystemCatalog::MEDINT:
-        case execplan::CalpontSystemCatalog::TINYINT:
-        case execplan::CalpontSystemCatalog::SMALLINT:
-        case execplan::CalpontSystemCatalog::UBIGINT:
-        case execplan::CalpontSystemCatalog::UINT:
-        case execplan::CalpontSystemCatalog::UMEDINT:
-        case execplan::CalpontSystemCatalog::UTINYINT:
-        case execplan::CalpontSystemCatalog::USMALLINT:
-        case execplan::CalpontSystemCatalog::VARCHAR: // including CHAR'
-        case execplan::CalpontSystemCatalog::DOUBLE:
-        case execplan::CalpontSystemCatalog::UDOUBLE:
-        case execplan::CalpontSystemCatalog::FLOAT:
-        case execplan::CalpontSystemCatalog::UFLOAT:
-        case execplan::CalpontSystemCatalog::CHAR:
-        case execplan::CalpontSystemCatalog::TEXT:
-        {
-            pattern = pm[1]->data()->getStrVal(row, isNull);
-            break;
-        }
+    return str;
+}
 
-        case execplan::CalpontSystemCatalog::DATE:
-        {
-            pattern = dataconvert::DataConvert::dateToString(pm[1]->data()->getDateIntVal(row, isNull));
-            break;
-        }
+// compiled patterns kept by every thread for the patterns that aren't constants
+const size_t PATTERN_CACHE_SIZE = 64;
+typedef std::tr1::unordered_map<string, boost::shared_ptr<const funcexp::RegexpMatcher> > PatternCache;
 
-        case execplan::CalpontSystemCatalog::DATETIME:
-        {
-            pattern = dataconvert::DataConvert::datetimeToString(pm[1]->data()->getDatetimeIntVal(row, isNull));
-            //strip off micro seconds
-            pattern = pattern.substr(0, 19);
-            break;
-        }
+}
 
-        case execplan::CalpontSystemCatalog::TIMESTAMP:
-        {
-            pattern = dataconvert::DataConvert::timestampToString(pm[1]->data()->getTimestampIntVal(row, isNull), timeZone);
-            //strip off micro seconds
-            pattern = pattern.substr(0, 19);
-            break;
-        }
+namespace funcexp
+{
 
-        case execplan::CalpontSystemCatalog::TIME:
-        {
-            pattern = dataconvert::DataConvert::timeToString(pm[1]->data()->getTimeIntVal(row, isNull));
-            //strip off micro seconds
-            pattern = pattern.substr(0, 19);
-            break;
-        }
+/** @brief A compiled REGEXP pattern
+  *
+  * A pattern made of a literal string, optionally anchored with ^ and $,
+  * is matched with memcmp, memchr or memmem instead of the regex engine.
+  */
+class RegexpMatcher
+{
+public:
+    explicit RegexpMatcher(const string& pattern);
+    ~RegexpMatcher();
 
-        case execplan::CalpontSystemCatalog::DECIMAL:
-        case execplan::CalpontSystemCatalog::UDECIMAL:
-        {
-            IDB_Decimal d = pm[1]->data()->getDecimalVal(row, isNull);
+    bool match(const string& expr) const;
 
-            if (pm[1]->data()->resultType().colWidth == datatypes::MAXDECIMALWIDTH)
-            {
-                pattern = d.toString(true);
-            }
-            else
-            {
-                pattern = d.toString();
-            }
-            break;
-        }
-
-        default:
-        {
-            std::ostringstream oss;
-            oss << "regexp: datatype of " << execplan::colDataTypeToString(ct.colDataType);
-            throw logging::IDBExcept(oss.str(), ERR_DATATYPE_NOT_SUPPORT);
-        }
-    }
+private:
+    RegexpMatcher(const RegexpMatcher&);
+    RegexpMatcher& operator=(const RegexpMatcher&);
 
+    enum MatchType { REGEX, EQUALS, PREFIX, SUFFIX, CONTAINS_CHAR, CONTAINS };
 
+    MatchType fMatchType;
+    string fLiteral;
 #ifdef __linux__
-    regex_t    re;
+    regex_t fRegex;
+    bool fCompiled;
+#else
+    regex fRegex;
+#endif
+};
 
-    regcomp(&re, pattern.c_str(), REG_EXTENDED | REG_NOSUB );
+RegexpMatcher::RegexpMatcher(const string& pattern) : fMatchType(REGEX)
+{
+    size_t begin = 0, end = pattern.length();
+    bool atStart = false, atEnd = false;
 
-    int res = regexec(&re, expr.c_str(), 0, NULL, 0);
-    regfree(&re);
+    if (end > 0 && pattern[0] == '^')
+    {
+        atStart = true;
+        begin++;
+    }
 
-    if (res == 0)
-        return true;
-    else
-        return false;
+    if (end > begin && pattern[end - 1] == '$')
+    {
+        atEnd = true;
+        end--;
+    }
+
+    fLiteral = pattern.substr(begin, end - begin);
+
+    // anything special to an extended regex, an escaped $ included, needs the regex engine
+    if (!fLiteral.empty() && fLiteral.find_first_of(".[]()*+?{}|^$\\") == string::npos)
+    {
+        if (atStart && atEnd)
+            fMatchType = EQUALS;
+        else if (atStart)
+            fMatchType = PREFIX;
+        else if (atEnd)
+            fMatchType = SUFFIX;
+        else if (fLiteral.length() == 1)
+            fMatchType = CONTAINS_CHAR;
+        else
+            fMatchType = CONTAINS;
+    }
+
+#ifdef __linux__
+    fCompiled = false;
 
+    if (fMatchType == REGEX)
+        fCompiled = (regcomp(&fRegex, pattern.c_str(), REG_EXTENDED | REG_NOSUB) == 0);
 #else
-    regex pat(pattern.c_str());
-    return regex_search(expr.c_str(), pat);
-#endif
 
+    if (fMatchType == REGEX)
+        fRegex.assign(pattern.c_str());
 
+#endif
 }
 
+RegexpMatcher::~RegexpMatcher()
+{
+#ifdef __linux__
+
+    if (fCompiled)
+        regfree(&fRegex);
+
+#endif
 }
 
-namespace funcexp
+bool RegexpMatcher::match(const string& expr) const
 {
+    size_t len = fLiteral.length();
+
+    switch (fMatchType)
+    {
+        case EQUALS:
+            return expr == fLiteral;
+
+        case PREFIX:
+            return expr.length() >= len && memcmp(expr.data(), fLiteral.data(), len) == 0;
+
+        case SUFFIX:
+            return expr.length() >= len && memcmp(expr.data() + expr.length() - len, fLiteral.data(), len) == 0;
+
+        case CONTAINS_CHAR:
+            return memchr(expr.data(), fLiteral[0], expr.length()) != NULL;
+
+        case CONTAINS:
+#ifdef __linux__
+            return memmem(expr.data(), expr.length(), fLiteral.data(), len) != NULL;
+#else
+            return expr.find(fLiteral) != string::npos;
+#endif
+
+        default:
+            break;
+    }
+
+#ifdef __linux__
+    // a pattern regcomp() rejects matches nothing
+    return fCompiled && regexec(&fRegex, expr.c_str(), 0, NULL, 0) == 0;
+#else
+    return regex_search(expr.c_str(), fRegex);
+#endif
+}
 
 CalpontSystemCatalog::ColType Func_regexp::operationType( FunctionParm& fp, CalpontSystemCatalog::ColType& resultType )
 {
@@ -251,7 +281,49 @@ bool Func_regexp::getBoolVal(rowgroup::Row& row,
                              bool& isNull,
                              CalpontSystemCatalog::ColType& ct)
 {
-    return getBool(row, pm, isNull, ct, timeZone()) && !isNull;
+    const string tz = timeZone();
+
+    // a constant pattern is compiled once for the column
+    std::call_once(fConstPatternFlag, [&]()
+    {
+        if (dynamic_cast<ConstantColumn*>(pm[1]->data()) == NULL)
+            return;
+
+        string pattern = getParm(row, pm[1], fConstPatternIsNull, ct, tz);
+
+        if (!fConstPatternIsNull)
+            fConstPattern.reset(new RegexpMatcher(pattern));
+    });
+
+    if (fConstPatternIsNull)
+    {
+        isNull = true;
+        return false;
+    }
+
+    string expr = getParm(row, pm[0], isNull, ct, tz);
+
+    if (fConstPattern)
+        return fConstPattern->match(expr) && !isNull;
+
+    string pattern = getParm(row, pm[1], isNull, ct, tz);
+
+    if (isNull)
+        return false;
+
+    static thread_local PatternCache patternCache;
+    PatternCache::iterator it = patternCache.find(pattern);
+
+    if (it == patternCache.end())
+    {
+        if (patternCache.size() >= PATTERN_CACHE_SIZE)
+            patternCache.clear();
+
+        it = patternCache.insert(make_pair(pattern,
+                                           boost::shared_ptr<const RegexpMatcher>(new RegexpMatcher(pattern)))).first;
+    }
+
+    return it->second->match(expr);
 }
 
 
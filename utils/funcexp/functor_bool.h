@@ -195,7 +195,13 @@ public:
 };
 
 
+class RegexpMatcher;
+
 /** @brief Func_regexp class
+  *
+  * Every FunctionColumn gets its own Func_regexp, which compiles a constant
+  * pattern the first time it is used.  Patterns read from the row are looked
+  * up in a per thread cache of compiled patterns.
   */
 class Func_regexp : public Func_Bool
 {
@@ -209,6 +215,11 @@ public:
                     FunctionParm& fp,
                     bool& isNull,
                     execplan::CalpontSystemCatalog::ColType& op_ct);
+
+private:
+    std::once_flag fConstPatternFlag;
+    bool fConstPatternIsNull = false;
+    boost::shared_ptr<const RegexpMatcher> fConstPattern;   // NULL if the pattern isn't a constant
 };
 
 
@@ -196,6 +196,16 @@ public:
      */
     virtual int fallocate(int mode, off64_t offset, off64_t length) = 0;
 
+    /**
+     * The nativeHandle() method returns the kernel file descriptor backing
+     * this file so that callers can issue asynchronous reads against it.
+     * Returns -1 if the file is not backed by a local descriptor.
+     */
+    virtual int nativeHandle()
+    {
+        return -1;
+    }
+
     int colWidth()
     {
         return m_fColWidth;
@@ -273,6 +273,15 @@ int UnbufferedFile::flush()
     return ret;
 }
 
+int UnbufferedFile::nativeHandle()
+{
+#ifdef _MSC_VER
+    return -1;
+#else
+    return m_fd;
+#endif
+}
+
 time_t UnbufferedFile::mtime()
 {
     time_t ret = 0;
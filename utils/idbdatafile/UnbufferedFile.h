@@ -48,6 +48,7 @@ public:
     /* virtual */ int flush();
     /* virtual */ time_t mtime();
     /* virtual */ int fallocate(int mode, off64_t offset, off64_t length);
+    /* virtual */ int nativeHandle();
 
 protected:
     /* virtual */
@@ -0,0 +1,66 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include "exceptclasses.h"
+#include "bloomfilter.h"
+
+using namespace std;
+using namespace messageqcpp;
+
+namespace joiner
+{
+
+// odd multipliers, each picks the bit of one word from the low half of the hash
+const uint32_t BloomFilter::salt[WORDS_PER_BLOCK] =
+{
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+BloomFilter::BloomFilter() : fWords(WORDS_PER_BLOCK, 0), fBlockMask(0)
+{
+}
+
+BloomFilter::BloomFilter(uint64_t keyCount)
+{
+    uint64_t bitsPerBlock = WORDS_PER_BLOCK * 32;
+    uint64_t blocksNeeded = (keyCount * BITS_PER_KEY + bitsPerBlock - 1) / bitsPerBlock;
+    uint64_t blockCount = 1;
+
+    // a power of 2 number of blocks so that the block is picked with a mask
+    while (blockCount < blocksNeeded)
+        blockCount <<= 1;
+
+    fWords.resize(blockCount * WORDS_PER_BLOCK, 0);
+    fBlockMask = blockCount - 1;
+}
+
+void BloomFilter::serialize(ByteStream& bs) const
+{
+    bs << fBlockMask;
+    serializeInlineVector<uint32_t>(bs, fWords);
+}
+
+void BloomFilter::deserialize(ByteStream& bs)
+{
+    bs >> fBlockMask;
+    deserializeInlineVector<uint32_t>(bs, fWords);
+    idbassert(fWords.size() == (fBlockMask + 1) * WORDS_PER_BLOCK);
+}
+
+}
+// vim:ts=4 sw=4:
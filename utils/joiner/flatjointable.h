@@ -0,0 +1,351 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#ifndef JOINER_FLATJOINTABLE_H
+#define JOINER_FLATJOINTABLE_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "hasher.h"
+
+namespace joiner
+{
+
+/** @brief An open addressing hash multimap for the join tables
+ *
+ * It replaces the tr1::unordered_multimaps of TupleJoiner and of the PrimProc
+ * BPP, where a probe followed a pointer to the bucket list and one more per
+ * node on it.
+ *
+ * Every distinct key owns one slot of a linearly probed array.  A slot is
+ * 8 bytes: a 32-bit tag taken from the mixed hash of the key, and the index
+ * of the first entry with that key.  The entries, the (key, value) pairs, are
+ * stored in a separate array; the entries sharing a key are chained through
+ * a parallel array of next indexes.  Tags are compared before keys, so a miss
+ * rarely reads more than one cache line of slots and never touches a key.
+ * The slot of a key is derived from its tag, which lets the table grow
+ * without hashing the keys again.
+ *
+ * The iterators returned by find() and equal_range() walk the entries of one
+ * key, the one returned by begin() walks every entry.  Either kind equals
+ * end() when done.  insert() invalidates iterators.  The Hash and Equal
+ * functors are the ones the tr1 tables were instantiated with.
+ */
+template<typename Key, typename Value, typename Hash, typename Equal = std::equal_to<Key> >
+class FlatJoinTable
+{
+public:
+    typedef Key key_type;
+    typedef Value mapped_type;
+    typedef std::pair<Key, Value> value_type;
+    typedef Hash hasher;
+    typedef Equal key_equal;
+
+    // keys looked up together by findBatch() between two rounds of prefetches
+    static const uint32_t PREFETCH_GROUP = 16;
+
+    class iterator
+    {
+    public:
+        iterator() : fTable(NULL), fEntry(END), fChain(false) { }
+
+        value_type& operator*() const
+        {
+            return fTable->fEntries[fEntry];
+        }
+        value_type* operator->() const
+        {
+            return &fTable->fEntries[fEntry];
+        }
+        iterator& operator++()
+        {
+            if (fChain)
+                fEntry = fTable->fNext[fEntry];
+            else if (++fEntry == fTable->fEntries.size())
+                fEntry = END;
+
+            return *this;
+        }
+        bool operator==(const iterator& it) const
+        {
+            return fEntry == it.fEntry && (fEntry == END || fTable == it.fTable);
+        }
+        bool operator!=(const iterator& it) const
+        {
+            return !(*this == it);
+        }
+
+    private:
+        friend class FlatJoinTable;
+        iterator(FlatJoinTable* table, uint32_t entry, bool chain) :
+            fTable(table), fEntry(entry), fChain(chain) { }
+
+        FlatJoinTable* fTable;
+        uint32_t fEntry;
+        bool fChain;
+    };
+
+    /** @brief Makes an empty table with room for about sizeHint distinct keys */
+    explicit FlatJoinTable(size_t sizeHint = 0, const Hash& hash = Hash(), const Equal& equal = Equal());
+
+    iterator insert(const value_type& v);
+
+    /** @brief Returns an iterator over the entries of key, or end() */
+    iterator find(const Key& key)
+    {
+        return find(key, tag(key));
+    }
+    /** @brief find() for a key whose tag() is already known */
+    inline iterator find(const Key& key, uint32_t keyTag);
+
+    std::pair<iterator, iterator> equal_range(const Key& key)
+    {
+        return std::make_pair(find(key), end());
+    }
+
+    /** @brief Looks up count keys, out[i] gets find(keys[i])
+     *
+     * The keys are hashed and their slots prefetched PREFETCH_GROUP at a
+     * time, then the first entry of every matching slot is prefetched, and
+     * only then are the keys compared.  This keeps several cache misses in
+     * flight where a loop of find() waits on each one in turn.
+     */
+    void findBatch(const Key* keys, uint32_t count, iterator* out);
+
+    /** @brief The hash of key as the table uses it, see prefetch() */
+    uint32_t tag(const Key& key) const
+    {
+        return static_cast<uint32_t>(utils::fmix(static_cast<uint64_t>(fHash(key))) >> 32);
+    }
+    /** @brief Starts loading the slot where a key with keyTag is looked up */
+    void prefetch(uint32_t keyTag) const
+    {
+        __builtin_prefetch(&fSlots[keyTag & fSlotMask]);
+    }
+
+    iterator begin()
+    {
+        return (fEntries.empty() ? end() : iterator(this, 0, false));
+    }
+    iterator end()
+    {
+        return iterator();
+    }
+
+    size_t size() const
+    {
+        return fEntries.size();
+    }
+    bool empty() const
+    {
+        return fEntries.empty();
+    }
+    void clear();
+
+    /** @brief Returns the bytes allocated by the table, not counting what keys point to */
+    uint64_t getMemUsage() const
+    {
+        return fMemUsage;
+    }
+
+private:
+    static const uint32_t END = 0xffffffff;
+    static const uint32_t MIN_SLOTS = 16;
+
+    struct Slot
+    {
+        uint32_t tag;
+        uint32_t first;   // END if the slot is free
+    };
+
+    // returns the slot of the key or the free slot where it would go
+    inline uint32_t findSlot(const Key& key, uint32_t keyTag, uint32_t slot) const;
+    void grow();
+    void updateMemUsage()
+    {
+        fMemUsage = fSlots.capacity() * sizeof(Slot) + fEntries.capacity() * sizeof(value_type) +
+                    fNext.capacity() * sizeof(uint32_t);
+    }
+
+    std::vector<Slot> fSlots;
+    uint32_t fSlotMask;
+    uint32_t fKeyCount;   // number of used slots
+    std::vector<value_type> fEntries;
+    std::vector<uint32_t> fNext;
+    uint64_t fMemUsage;
+    Hash fHash;
+    Equal fEqual;
+};
+
+template<typename Key, typename Value, typename Hash, typename Equal>
+const uint32_t FlatJoinTable<Key, Value, Hash, Equal>::PREFETCH_GROUP;
+template<typename Key, typename Value, typename Hash, typename Equal>
+const uint32_t FlatJoinTable<Key, Value, Hash, Equal>::END;
+template<typename Key, typename Value, typename Hash, typename Equal>
+const uint32_t FlatJoinTable<Key, Value, Hash, Equal>::MIN_SLOTS;
+
+template<typename Key, typename Value, typename Hash, typename Equal>
+FlatJoinTable<Key, Value, Hash, Equal>::FlatJoinTable(size_t sizeHint, const Hash& hash, const Equal& equal) :
+    fKeyCount(0), fHash(hash), fEqual(equal)
+{
+    size_t slotCount = MIN_SLOTS;
+
+    // keep the load factor under 1/2
+    while (slotCount < sizeHint * 2)
+        slotCount <<= 1;
+
+    Slot freeSlot = { 0, END };
+    fSlots.assign(slotCount, freeSlot);
+    fSlotMask = slotCount - 1;
+    updateMemUsage();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal>
+inline uint32_t FlatJoinTable<Key, Value, Hash, Equal>::findSlot(const Key& key, uint32_t keyTag,
+        uint32_t slot) const
+{
+    while (fSlots[slot].first != END)
+    {
+        if (fSlots[slot].tag == keyTag && fEqual(fEntries[fSlots[slot].first].first, key))
+            break;
+
+        slot = (slot + 1) & fSlotMask;
+    }
+
+    return slot;
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal>
+typename FlatJoinTable<Key, Value, Hash, Equal>::iterator
+FlatJoinTable<Key, Value, Hash, Equal>::insert(const value_type& v)
+{
+    if ((fKeyCount + 1) * 2 > fSlots.size())
+        grow();
+
+    uint32_t keyTag = tag(v.first);
+    uint32_t slot = findSlot(v.first, keyTag, keyTag & fSlotMask);
+    uint32_t entry = fEntries.size();
+
+    fEntries.push_back(v);
+
+    // a new duplicate goes to the head of its chain
+    if (fSlots[slot].first == END)
+    {
+        fSlots[slot].tag = keyTag;
+        fNext.push_back(END);
+        fKeyCount++;
+    }
+    else
+        fNext.push_back(fSlots[slot].first);
+
+    fSlots[slot].first = entry;
+    updateMemUsage();
+    return iterator(this, entry, true);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal>
+inline typename FlatJoinTable<Key, Value, Hash, Equal>::iterator
+FlatJoinTable<Key, Value, Hash, Equal>::find(const Key& key, uint32_t keyTag)
+{
+    uint32_t slot = findSlot(key, keyTag, keyTag & fSlotMask);
+    return iterator(this, fSlots[slot].first, true);
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal>
+void FlatJoinTable<Key, Value, Hash, Equal>::findBatch(const Key* keys, uint32_t count, iterator* out)
+{
+    uint32_t tags[PREFETCH_GROUP], slots[PREFETCH_GROUP];
+    uint32_t i, j, groupSize;
+
+    for (i = 0; i < count; i += groupSize)
+    {
+        groupSize = std::min(count - i, PREFETCH_GROUP);
+
+        for (j = 0; j < groupSize; j++)
+        {
+            tags[j] = tag(keys[i + j]);
+            prefetch(tags[j]);
+        }
+
+        // skip the slots with other tags, then prefetch the first entry to compare with
+        for (j = 0; j < groupSize; j++)
+        {
+            uint32_t slot = tags[j] & fSlotMask;
+
+            while (fSlots[slot].first != END && fSlots[slot].tag != tags[j])
+                slot = (slot + 1) & fSlotMask;
+
+            if (fSlots[slot].first != END)
+                __builtin_prefetch(&fEntries[fSlots[slot].first]);
+
+            slots[j] = slot;
+        }
+
+        for (j = 0; j < groupSize; j++)
+            out[i + j] = iterator(this, fSlots[findSlot(keys[i + j], tags[j], slots[j])].first, true);
+    }
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal>
+void FlatJoinTable<Key, Value, Hash, Equal>::clear()
+{
+    std::vector<value_type> entries;
+    std::vector<uint32_t> next;
+    Slot freeSlot = { 0, END };
+
+    fEntries.swap(entries);
+    fNext.swap(next);
+    fSlots.assign(MIN_SLOTS, freeSlot);
+    std::vector<Slot>(fSlots).swap(fSlots);
+    fSlotMask = MIN_SLOTS - 1;
+    fKeyCount = 0;
+    updateMemUsage();
+}
+
+template<typename Key, typename Value, typename Hash, typename Equal>
+void FlatJoinTable<Key, Value, Hash, Equal>::grow()
+{
+    Slot freeSlot = { 0, END };
+    std::vector<Slot> newSlots(fSlots.size() * 2, freeSlot);
+    uint32_t newMask = newSlots.size() - 1;
+
+    // the keys are distinct, a free slot is all that's needed
+    for (uint32_t i = 0; i < fSlots.size(); i++)
+    {
+        if (fSlots[i].first == END)
+            continue;
+
+        uint32_t slot = fSlots[i].tag & newMask;
+
+        while (newSlots[slot].first != END)
+            slot = (slot + 1) & newMask;
+
+        newSlots[slot] = fSlots[i];
+    }
+
+    fSlots.swap(newSlots);
+    fSlotMask = newMask;
+}
+
+}
+
+#endif
+// vim:ts=4 sw=4:
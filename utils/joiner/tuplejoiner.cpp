@@ -61,35 +61,20 @@ TupleJoiner::TupleJoiner(
     if (smallRG.getColTypes()[smallJoinColumn] == CalpontSystemCatalog::LONGDOUBLE)
     {
         ld.reset(new boost::scoped_ptr<ldhash_t>[bucketCount]);
-        _pool.reset(new boost::shared_ptr<PoolAllocator>[bucketCount]);
         for (i = 0; i < bucketCount; i++)
-        {
-            STLPoolAllocator<pair<const long double, Row::Pointer> > alloc;
-            _pool[i] = alloc.getPoolAllocator();
-            ld[i].reset(new ldhash_t(10, hasher(), ldhash_t::key_equal(), alloc));
-        }
+            ld[i].reset(new ldhash_t());
     }
     else if (smallRG.usesStringTable())
     {
         sth.reset(new boost::scoped_ptr<sthash_t>[bucketCount]);
-        _pool.reset(new boost::shared_ptr<PoolAllocator>[bucketCount]);
         for (i = 0; i < bucketCount; i++)
-        {
-            STLPoolAllocator<pair<const int64_t, Row::Pointer> > alloc;
-            _pool[i] = alloc.getPoolAllocator();
-            sth[i].reset(new sthash_t(10, hasher(), sthash_t::key_equal(), alloc));
-        }
+            sth[i].reset(new sthash_t());
     }
     else
     {
         h.reset(new boost::scoped_ptr<hash_t>[bucketCount]);
-        _pool.reset(new boost::shared_ptr<PoolAllocator>[bucketCount]);
         for (i = 0; i < bucketCount; i++)
-        {
-            STLPoolAllocator<pair<const int64_t, uint8_t*> > alloc;
-            _pool[i] = alloc.getPoolAllocator();
-            h[i].reset(new hash_t(10, hasher(), hash_t::key_equal(), alloc));
-        }
+            h[i].reset(new hash_t());
     }
 
     smallRG.initRow(&smallNullRow);
@@ -163,14 +148,9 @@ TupleJoiner::TupleJoiner(
 
     getBucketCount();
 
-    _pool.reset(new boost::shared_ptr<PoolAllocator>[bucketCount]);
     ht.reset(new boost::scoped_ptr<typelesshash_t>[bucketCount]);
     for (i = 0; i < bucketCount; i++)
-    {
-        STLPoolAllocator<pair<const TypelessData, Row::Pointer> > alloc;
-        _pool[i] = alloc.getPoolAllocator();
-        ht[i].reset(new typelesshash_t(10, hasher(), typelesshash_t::key_equal(), alloc));
-    }
+        ht[i].reset(new typelesshash_t());
     m_bucketLocks.reset(new boost::mutex[bucketCount]);
 
     smallRG.initRow(&smallNullRow);
@@ -1057,7 +1037,7 @@ uint64_t TupleJoiner::getMemUsage() const
     {
         size_t ret = 0;
         for (uint i = 0; i < bucketCount; i++)
-            ret += _pool[i]->getMemUsage();
+            ret += ht[i]->getMemUsage();
         for (int i = 0; i < numCores; i++)
             ret += storedKeyAlloc[i].getMemUsage();
         return ret;
@@ -1066,7 +1046,12 @@ uint64_t TupleJoiner::getMemUsage() const
     {
         size_t ret = 0;
         for (uint i = 0; i < bucketCount; i++)
-            ret += _pool[i]->getMemUsage();
+            if (smallRG.getColType(smallKeyColumns[0]) == CalpontSystemCatalog::LONGDOUBLE)
+                ret += ld[i]->getMemUsage();
+            else if (!smallRG.usesStringTable())
+                ret += h[i]->getMemUsage();
+            else
+                ret += sth[i]->getMemUsage();
         return ret;
     }
     else
@@ -1792,7 +1777,6 @@ void TupleJoiner::setTableName(const string& tname)
 
 void TupleJoiner::clearData()
 {
-    _pool.reset(new boost::shared_ptr<utils::PoolAllocator>[bucketCount]);
     if (typelessJoin)
         ht.reset(new boost::scoped_ptr<typelesshash_t>[bucketCount]);
     else if (smallRG.getColTypes()[smallKeyColumns[0]] == CalpontSystemCatalog::LONGDOUBLE)
@@ -1804,16 +1788,14 @@ void TupleJoiner::clearData()
 
     for (uint i = 0; i < bucketCount; i++)
     {
-        STLPoolAllocator<pair<const TypelessData, Row::Pointer> > alloc;
-        _pool[i] = alloc.getPoolAllocator();
         if (typelessJoin)
-            ht[i].reset(new typelesshash_t(10, hasher(), typelesshash_t::key_equal(), alloc));
+            ht[i].reset(new typelesshash_t());
         else if (smallRG.getColTypes()[smallKeyColumns[0]] == CalpontSystemCatalog::LONGDOUBLE)
-            ld[i].reset(new ldhash_t(10, hasher(), ldhash_t::key_equal(), alloc));
+            ld[i].reset(new ldhash_t());
         else if (smallRG.usesStringTable())
-            sth[i].reset(new sthash_t(10, hasher(), sthash_t::key_equal(), alloc));
+            sth[i].reset(new sthash_t());
         else
-            h[i].reset(new hash_t(10, hasher(), hash_t::key_equal(), alloc));
+            h[i].reset(new hash_t());
     }
 
     std::vector<rowgroup::Row::Pointer> empty;
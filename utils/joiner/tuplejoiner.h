@@ -38,6 +38,7 @@
 #include "../funcexp/funcexpwrapper.h"
 #include "stlpoolallocator.h"
 #include "hasher.h"
+#include "flatjointable.h"
 #include "threadpool.h"
 #include "columnwidth.h"
 #include "mcs_string.h"
@@ -487,15 +488,11 @@ public:
     void setConvertToDiskJoin();
 
 private:
-    typedef std::tr1::unordered_multimap<int64_t, uint8_t*, hasher, std::equal_to<int64_t>,
-            utils::STLPoolAllocator<std::pair<const int64_t, uint8_t*> > > hash_t;
-    typedef std::tr1::unordered_multimap<int64_t, rowgroup::Row::Pointer, hasher, std::equal_to<int64_t>,
-            utils::STLPoolAllocator<std::pair<const int64_t, rowgroup::Row::Pointer> > > sthash_t;
-    typedef std::tr1::unordered_multimap<TypelessData, rowgroup::Row::Pointer, hasher, std::equal_to<TypelessData>,
-            utils::STLPoolAllocator<std::pair<const TypelessData, rowgroup::Row::Pointer> > > typelesshash_t;
+    typedef FlatJoinTable<int64_t, uint8_t*, hasher> hash_t;
+    typedef FlatJoinTable<int64_t, rowgroup::Row::Pointer, hasher> sthash_t;
+    typedef FlatJoinTable<TypelessData, rowgroup::Row::Pointer, hasher> typelesshash_t;
     // MCOL-1822 Add support for Long Double AVG/SUM small side
-    typedef std::tr1::unordered_multimap<long double, rowgroup::Row::Pointer, hasher, LongDoubleEq,
-            utils::STLPoolAllocator<std::pair<const long double, rowgroup::Row::Pointer> > > ldhash_t;
+    typedef FlatJoinTable<long double, rowgroup::Row::Pointer, hasher, LongDoubleEq> ldhash_t;
 
     typedef hash_t::iterator iterator;
     typedef typelesshash_t::iterator thIterator;
@@ -532,7 +529,6 @@ private:
     };
     JoinAlg joinAlg;
     joblist::JoinType joinType;
-    boost::shared_array<boost::shared_ptr<utils::PoolAllocator> > _pool; 	// pools for the table and nodes
     uint32_t threadCount;
     std::string tableName;
 
@@ -0,0 +1,131 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <sstream>
+#include <cstring>
+#include <typeinfo>
+#include "approx_count_distinct.h"
+#include "bytestream.h"
+#include "objectreader.h"
+
+using namespace mcsv1sdk;
+
+class Add_approx_count_distinct_ToUDAFMap
+{
+public:
+    Add_approx_count_distinct_ToUDAFMap()
+    {
+        UDAFMap::getMap()["approx_count_distinct"] = new approx_count_distinct();
+    }
+};
+
+static Add_approx_count_distinct_ToUDAFMap addToMap;
+
+mcsv1_UDAF::ReturnCode approx_count_distinct::init(mcsv1Context* context,
+                                                   ColumnDatum* colTypes)
+{
+    if (context->getParameterCount() != 1)
+    {
+        // The error message will be prepended with
+        // "The storage engine for the table doesn't support "
+        context->setErrorMessage("approx_count_distinct() with other than 1 argument");
+        return mcsv1_UDAF::ERROR;
+    }
+
+    context->setResultType(execplan::CalpontSystemCatalog::BIGINT);
+    context->setColWidth(8);
+    context->setRunFlag(mcsv1sdk::UDAF_IGNORE_NULLS);
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_count_distinct::reset(mcsv1Context* context)
+{
+    ApproxCountDistinctData* data = static_cast<ApproxCountDistinctData*>(context->getUserData());
+    data->fSketch.clear();
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_count_distinct::nextValue(mcsv1Context* context, ColumnDatum* valsIn)
+{
+    static_any::any& valIn = valsIn[0].columnData;
+    ApproxCountDistinctData* data = static_cast<ApproxCountDistinctData*>(context->getUserData());
+    uint64_t hash;
+
+    if (valIn.empty())
+    {
+        return mcsv1_UDAF::SUCCESS; // Ought not happen when UDAF_IGNORE_NULLS is on.
+    }
+
+    if (valIn.compatible(strTypeId))
+    {
+        const std::string& str = valIn.cast<std::string>();
+        hash = utils::HyperLogLog::hashBytes(str.data(), str.length());
+    }
+    else if (valIn.compatible(doubleTypeId) || valIn.compatible(floatTypeId))
+    {
+        double val = convertAnyTo<double>(valIn);
+        uint64_t bits;
+
+        if (val == 0)
+            val = 0;  // -0.0 and 0.0 are the same value
+
+        memcpy(&bits, &val, sizeof(bits));
+        hash = utils::HyperLogLog::hashInt(bits);
+    }
+    else if (valIn.compatible(int128TypeId))
+    {
+        int128_t val = valIn.cast<int128_t>();
+        hash = utils::HyperLogLog::hashBytes((const char*) &val, sizeof(val));
+    }
+    else
+    {
+        hash = utils::HyperLogLog::hashInt(convertAnyTo<uint64_t>(valIn));
+    }
+
+    data->fSketch.add(hash);
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_count_distinct::subEvaluate(mcsv1Context* context, const UserData* userDataIn)
+{
+    if (!userDataIn)
+    {
+        return mcsv1_UDAF::SUCCESS;
+    }
+
+    ApproxCountDistinctData* outData = static_cast<ApproxCountDistinctData*>(context->getUserData());
+    const ApproxCountDistinctData* inData = static_cast<const ApproxCountDistinctData*>(userDataIn);
+
+    outData->fSketch.merge(inData->fSketch);
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_count_distinct::evaluate(mcsv1Context* context, static_any::any& valOut)
+{
+    ApproxCountDistinctData* data = static_cast<ApproxCountDistinctData*>(context->getUserData());
+
+    valOut = (long long) data->fSketch.estimate();
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_count_distinct::createUserData(UserData*& userData, int32_t& length)
+{
+    userData = new ApproxCountDistinctData;
+    length = sizeof(ApproxCountDistinctData);
+    return mcsv1_UDAF::SUCCESS;
+}
+
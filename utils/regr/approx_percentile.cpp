@@ -0,0 +1,133 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <sstream>
+#include <cstring>
+#include <typeinfo>
+#include "approx_percentile.h"
+#include "bytestream.h"
+#include "objectreader.h"
+
+using namespace mcsv1sdk;
+
+class Add_approx_percentile_ToUDAFMap
+{
+public:
+    Add_approx_percentile_ToUDAFMap()
+    {
+        UDAFMap::getMap()["approx_percentile"] = new approx_percentile();
+    }
+};
+
+static Add_approx_percentile_ToUDAFMap addToMap;
+
+mcsv1_UDAF::ReturnCode approx_percentile::init(mcsv1Context* context,
+                                               ColumnDatum* colTypes)
+{
+    if (context->getParameterCount() != 2)
+    {
+        // The error message will be prepended with
+        // "The storage engine for the table doesn't support "
+        context->setErrorMessage("approx_percentile() with other than 2 arguments");
+        return mcsv1_UDAF::ERROR;
+    }
+
+    if (!(datatypes::isNumeric(colTypes[0].dataType) && datatypes::isNumeric(colTypes[1].dataType)))
+    {
+        // The error message will be prepended with
+        // "The storage engine for the table doesn't support "
+        context->setErrorMessage("approx_percentile() with a non-numeric argument");
+        return mcsv1_UDAF::ERROR;
+    }
+
+    context->setResultType(execplan::CalpontSystemCatalog::DOUBLE);
+    context->setColWidth(8);
+    context->setScale(DECIMAL_NOT_SPECIFIED);
+    context->setPrecision(0);
+    context->setRunFlag(mcsv1sdk::UDAF_IGNORE_NULLS);
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_percentile::reset(mcsv1Context* context)
+{
+    ApproxPercentileData* data = static_cast<ApproxPercentileData*>(context->getUserData());
+    data->fPercentile = -1;
+    data->fDigest.clear();
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_percentile::nextValue(mcsv1Context* context, ColumnDatum* valsIn)
+{
+    static_any::any& valIn = valsIn[0].columnData;
+    static_any::any& percentIn = valsIn[1].columnData;
+    ApproxPercentileData* data = static_cast<ApproxPercentileData*>(context->getUserData());
+
+    if (valIn.empty() || percentIn.empty())
+    {
+        return mcsv1_UDAF::SUCCESS; // Ought not happen when UDAF_IGNORE_NULLS is on.
+    }
+
+    double percentile = toDouble(valsIn[1]);
+
+    if (percentile < 0 || percentile > 1)
+    {
+        context->setErrorMessage("approx_percentile() with a percentile outside of [0, 1]");
+        return mcsv1_UDAF::ERROR;
+    }
+
+    data->fPercentile = percentile;
+    data->fDigest.add(toDouble(valsIn[0]));
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_percentile::subEvaluate(mcsv1Context* context, const UserData* userDataIn)
+{
+    if (!userDataIn)
+    {
+        return mcsv1_UDAF::SUCCESS;
+    }
+
+    ApproxPercentileData* outData = static_cast<ApproxPercentileData*>(context->getUserData());
+    const ApproxPercentileData* inData = static_cast<const ApproxPercentileData*>(userDataIn);
+
+    if (inData->fPercentile >= 0)
+        outData->fPercentile = inData->fPercentile;
+
+    outData->fDigest.merge(inData->fDigest);
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_percentile::evaluate(mcsv1Context* context, static_any::any& valOut)
+{
+    ApproxPercentileData* data = static_cast<ApproxPercentileData*>(context->getUserData());
+
+    // An empty group is NULL
+    if (data->fPercentile >= 0 && data->fDigest.count() > 0)
+    {
+        valOut = data->fDigest.quantile(data->fPercentile);
+    }
+
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_percentile::createUserData(UserData*& userData, int32_t& length)
+{
+    userData = new ApproxPercentileData;
+    length = sizeof(ApproxPercentileData);
+    return mcsv1_UDAF::SUCCESS;
+}
+
@@ -0,0 +1,113 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+/***********************************************************************
+*   $Id$
+*
+*   approx_percentile.h
+***********************************************************************/
+
+/**
+ * Columnstore interface for the approx_percentile User Defined
+ * Aggregate Function (UDAF) and User Defined Analytic Function (UDAnF).
+ *
+ * To notify mysqld about the new function:
+ *
+ *    CREATE AGGREGATE FUNCTION approx_percentile returns REAL soname 'libregr_mysql.so';
+ *
+ * approx_percentile(x, p) estimates the value below which the fraction p
+ * of the x values lie, 0 <= p <= 1, with a t-digest of a few KB per group.
+ */
+#ifndef HEADER_approx_percentile
+#define HEADER_approx_percentile
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "mcsv1_udaf.h"
+#include "calpontsystemcatalog.h"
+#include "windowfunctioncolumn.h"
+#include "tdigest.h"
+
+#if defined(_MSC_VER) && defined(xxxRGNODE_DLLEXPORT)
+#define EXPORT __declspec(dllexport)
+#else
+#define EXPORT
+#endif
+
+namespace mcsv1sdk
+{
+
+// Override UserData for data storage
+struct ApproxPercentileData : public UserData
+{
+    ApproxPercentileData() : fPercentile(-1) {};
+    virtual ~ApproxPercentileData() {};
+
+    virtual void serialize(messageqcpp::ByteStream& bs) const
+    {
+        bs << fPercentile;
+        fDigest.serialize(bs);
+    }
+
+    virtual void unserialize(messageqcpp::ByteStream& bs)
+    {
+        bs >> fPercentile;
+        fDigest.deserialize(bs);
+    }
+
+    double fPercentile;   // negative until the first value is seen
+    utils::TDigest fDigest;
+
+private:
+    // For now, copy construction is unwanted
+    ApproxPercentileData(UserData&);
+};
+
+class approx_percentile : public  mcsv1_UDAF
+{
+public:
+    // Defaults OK
+    approx_percentile() : mcsv1_UDAF() {};
+    virtual ~approx_percentile() {};
+
+    virtual ReturnCode init(mcsv1Context* context,
+                            ColumnDatum* colTypes);
+
+    virtual ReturnCode reset(mcsv1Context* context);
+
+    virtual ReturnCode nextValue(mcsv1Context* context, ColumnDatum* valsIn);
+
+    virtual ReturnCode subEvaluate(mcsv1Context* context, const UserData* valIn);
+
+    virtual ReturnCode evaluate(mcsv1Context* context, static_any::any& valOut);
+
+    // A digest can't forget a value, so there is no dropValue();
+    // moving window frames are evaluated from scratch.
+
+    virtual ReturnCode createUserData(UserData*& userData, int32_t& length);
+
+protected:
+};
+
+};  // namespace
+
+#undef EXPORT
+
+#endif // HEADER_approx_percentile.h
+
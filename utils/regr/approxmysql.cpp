@@ -0,0 +1,230 @@
+#include <my_config.h>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+
+#include "idb_mysql.h"
+
+// These run when mysqld evaluates the functions itself, e.g. over tables
+// of other engines.  They keep every value and return exact results.
+namespace
+{
+inline bool isNumeric(int type, const char* attr)
+{
+    if (type == INT_RESULT || type == REAL_RESULT || type == DECIMAL_RESULT)
+    {
+        return true;
+    }
+#if _MSC_VER
+    if (_strnicmp("NULL", attr, 4) == 0))
+#else
+    if (strncasecmp("NULL", attr, 4) == 0)
+#endif
+    {
+        return true;
+    }
+    return false;
+}
+
+inline double cvtArgToDouble(int t, const char* v)
+{
+    double d = 0.0;
+
+    switch (t)
+    {
+        case INT_RESULT:
+            d = (double)(*((long long*)v));
+            break;
+
+        case REAL_RESULT:
+            d = *((double*)v);
+            break;
+
+        case DECIMAL_RESULT:
+        case STRING_RESULT:
+            d = strtod(v, 0);
+            break;
+
+        case ROW_RESULT:
+            break;
+    }
+
+    return d;
+}
+
+struct approx_count_distinct_data
+{
+    std::unordered_set<std::string> values;
+};
+
+struct approx_percentile_data
+{
+    double percentile;
+    std::vector<double> values;
+};
+}
+
+extern "C"
+{
+
+//=======================================================================
+
+/**
+ * approx_count_distinct
+ */
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+my_bool approx_count_distinct_init(UDF_INIT* initid, UDF_ARGS* args, char* message)
+{
+    if (args->arg_count != 1)
+    {
+        strcpy(message,"approx_count_distinct() requires one argument");
+        return 1;
+    }
+
+    initid->ptr = (char*)new approx_count_distinct_data;
+    return 0;
+}
+
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+void approx_count_distinct_deinit(UDF_INIT* initid)
+{
+    delete (struct approx_count_distinct_data*)initid->ptr;
+}
+
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+void approx_count_distinct_clear(UDF_INIT* initid, char* is_null __attribute__((unused)),
+                                 char* message __attribute__((unused)))
+{
+    struct approx_count_distinct_data* data = (struct approx_count_distinct_data*)initid->ptr;
+    data->values.clear();
+}
+
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+void approx_count_distinct_add(UDF_INIT* initid,
+                               UDF_ARGS* args,
+                               char* is_null,
+                               char* message __attribute__((unused)))
+{
+    // Test for NULL
+    if (args->args[0] == 0)
+    {
+        return;
+    }
+
+    struct approx_count_distinct_data* data = (struct approx_count_distinct_data*)initid->ptr;
+    data->values.insert(std::string(args->args[0], args->lengths[0]));
+}
+
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+long long approx_count_distinct(UDF_INIT* initid, UDF_ARGS* args __attribute__((unused)),
+                                char* is_null, char* error __attribute__((unused)))
+{
+    struct approx_count_distinct_data* data = (struct approx_count_distinct_data*)initid->ptr;
+    return data->values.size();
+}
+
+//=======================================================================
+
+/**
+ * approx_percentile
+ */
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+my_bool approx_percentile_init(UDF_INIT* initid, UDF_ARGS* args, char* message)
+{
+    if (args->arg_count != 2)
+    {
+        strcpy(message,"approx_percentile() requires two arguments");
+        return 1;
+    }
+    if (!(isNumeric(args->arg_type[0], args->attributes[0]) && isNumeric(args->arg_type[1], args->attributes[1])))
+    {
+        strcpy(message,"approx_percentile() with a non-numeric argument");
+        return 1;
+    }
+
+    struct approx_percentile_data* data = new approx_percentile_data;
+    data->percentile = -1;
+    initid->decimals = DECIMAL_NOT_SPECIFIED;
+    initid->maybe_null = 1;
+    initid->ptr = (char*)data;
+    return 0;
+}
+
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+void approx_percentile_deinit(UDF_INIT* initid)
+{
+    delete (struct approx_percentile_data*)initid->ptr;
+}
+
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+void approx_percentile_clear(UDF_INIT* initid, char* is_null __attribute__((unused)),
+                             char* message __attribute__((unused)))
+{
+    struct approx_percentile_data* data = (struct approx_percentile_data*)initid->ptr;
+    data->percentile = -1;
+    data->values.clear();
+}
+
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+void approx_percentile_add(UDF_INIT* initid,
+                           UDF_ARGS* args,
+                           char* is_null,
+                           char* message __attribute__((unused)))
+{
+    // Test for NULL in x and p
+    if (args->args[0] == 0 || args->args[1] == 0)
+    {
+        return;
+    }
+
+    struct approx_percentile_data* data = (struct approx_percentile_data*)initid->ptr;
+    data->percentile = cvtArgToDouble(args->arg_type[1], args->args[1]);
+    data->values.push_back(cvtArgToDouble(args->arg_type[0], args->args[0]));
+}
+
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+double approx_percentile(UDF_INIT* initid, UDF_ARGS* args __attribute__((unused)),
+                         char* is_null, char* error __attribute__((unused)))
+{
+    struct approx_percentile_data* data = (struct approx_percentile_data*)initid->ptr;
+
+    if (data->values.empty() || data->percentile < 0 || data->percentile > 1)
+    {
+        *is_null = 1;
+        return 0;
+    }
+
+    // Interpolate between the two closest ranks
+    std::sort(data->values.begin(), data->values.end());
+    double pos = data->percentile * (data->values.size() - 1);
+    size_t lower = (size_t) pos;
+    size_t upper = std::min(lower + 1, data->values.size() - 1);
+    return data->values[lower] + (pos - lower) * (data->values[upper] - data->values[lower]);
+}
+
+} // Extern "C"
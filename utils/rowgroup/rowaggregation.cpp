@@ -225,6 +225,152 @@ inline string getStringNullValue()
     return joblist::CPNULLSTRMARK;
 }
 
+// Column kernels for RowAggregation::aggregateBatch().  The rows of a RowGroup
+// are laid out back to back, so a column is walked with a stride of the row
+// size; p points at the column in the first row.  NULLs are the values whose
+// bits equal nullValue.
+template <typename T>
+inline T loadValue(const uint8_t* p)
+{
+    T v;
+    memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+template <typename T>
+inline bool isNullBits(const T& v, const T& nullValue)
+{
+    return memcmp(&v, &nullValue, sizeof(T)) == 0;
+}
+
+template <typename T>
+uint64_t batchCount(const uint8_t* p, uint32_t rowSize, uint64_t rowCount, T nullValue)
+{
+    uint64_t count = 0;
+
+    for (uint64_t i = 0; i < rowCount; i++, p += rowSize)
+        count += !isNullBits(loadValue<T>(p), nullValue);
+
+    return count;
+}
+
+// Adds the values to sum in row order, so floating point sums round as they
+// would row by row.
+template <typename T, typename S>
+uint64_t batchSum(const uint8_t* p, uint32_t rowSize, uint64_t rowCount, T nullValue, S& sum)
+{
+    uint64_t count = 0;
+
+    for (uint64_t i = 0; i < rowCount; i++, p += rowSize)
+    {
+        T v = loadValue<T>(p);
+
+        if (!isNullBits(v, nullValue))
+        {
+            sum += v;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+// Narrow DECIMAL values are summed as scaled long doubles like doSum() does
+template <typename T>
+uint64_t batchScaledSum(const uint8_t* p, uint32_t rowSize, uint64_t rowCount, T nullValue,
+                        uint32_t scale, long double& sum)
+{
+    const long double divisor = datatypes::scaleDivisor<long double>(scale);
+    uint64_t count = 0;
+
+    for (uint64_t i = 0; i < rowCount; i++, p += rowSize)
+    {
+        T v = loadValue<T>(p);
+
+        if (!isNullBits(v, nullValue))
+        {
+            sum += (scale ? (long double) v / divisor : (long double) v);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+template <typename T>
+uint64_t batchMinMax(const uint8_t* p, uint32_t rowSize, uint64_t rowCount, T nullValue,
+                     int funcType, T& result)
+{
+    uint64_t count = 0;
+
+    for (uint64_t i = 0; i < rowCount; i++, p += rowSize)
+    {
+        T v = loadValue<T>(p);
+
+        if (!isNullBits(v, nullValue) && (count++ == 0 || minMax(v, result, funcType)))
+            result = v;
+    }
+
+    return count;
+}
+
+// The kinds of input columns the kernels handle
+enum BatchColumnKind
+{
+    BATCH_NONE,
+    BATCH_SIGNED,
+    BATCH_UNSIGNED,
+    BATCH_DECIMAL,
+    BATCH_WIDE_DECIMAL,
+    BATCH_DOUBLE,
+    BATCH_FLOAT,
+    BATCH_TEMPORAL
+};
+
+inline BatchColumnKind batchColumnKind(const rowgroup::RowGroup& rg, uint32_t col)
+{
+    switch (rg.getColTypes()[col])
+    {
+        case execplan::CalpontSystemCatalog::TINYINT:
+        case execplan::CalpontSystemCatalog::SMALLINT:
+        case execplan::CalpontSystemCatalog::MEDINT:
+        case execplan::CalpontSystemCatalog::INT:
+        case execplan::CalpontSystemCatalog::BIGINT:
+            return BATCH_SIGNED;
+
+        case execplan::CalpontSystemCatalog::UTINYINT:
+        case execplan::CalpontSystemCatalog::USMALLINT:
+        case execplan::CalpontSystemCatalog::UMEDINT:
+        case execplan::CalpontSystemCatalog::UINT:
+        case execplan::CalpontSystemCatalog::UBIGINT:
+            return BATCH_UNSIGNED;
+
+        case execplan::CalpontSystemCatalog::DECIMAL:
+        case execplan::CalpontSystemCatalog::UDECIMAL:
+            if (rg.getColumnWidth(col) == datatypes::MAXDECIMALWIDTH)
+                return BATCH_WIDE_DECIMAL;
+
+            return (rg.getColumnWidth(col) <= datatypes::MAXLEGACYWIDTH ? BATCH_DECIMAL : BATCH_NONE);
+
+        case execplan::CalpontSystemCatalog::DOUBLE:
+        case execplan::CalpontSystemCatalog::UDOUBLE:
+            return BATCH_DOUBLE;
+
+        case execplan::CalpontSystemCatalog::FLOAT:
+        case execplan::CalpontSystemCatalog::UFLOAT:
+            return BATCH_FLOAT;
+
+        case execplan::CalpontSystemCatalog::DATE:
+        case execplan::CalpontSystemCatalog::DATETIME:
+        case execplan::CalpontSystemCatalog::TIMESTAMP:
+        case execplan::CalpontSystemCatalog::TIME:
+            return BATCH_TEMPORAL;
+
+        default:
+            return BATCH_NONE;
+    }
+}
+
 }
 
 namespace rowgroup
@@ -580,6 +726,9 @@ void RowAggregation::addRowGroup(const RowGroup* pRows)
 
     fRowGroupOut->setDBRoot(pRows->getDBRoot());
 
+    if (fGroupByCols.empty() && aggregateBatch(pRows))
+        return;
+
     Row rowIn;
     pRows->initRow(&rowIn);
     pRows->getRow(0, &rowIn);
@@ -593,6 +742,238 @@ void RowAggregation::addRowGroup(const RowGroup* pRows)
 }
 
 
+//------------------------------------------------------------------------------
+// Aggregate a RowGroup without GROUP BY a function column at a time.  Each
+// column is read by a tight loop over the rows instead of dispatching on the
+// function and the column type for every row in updateEntry().
+// COUNT, SUM, MIN and MAX of fixed width numeric columns, and COUNT, MIN and
+// MAX of temporal ones, are handled; with any other function nothing is done
+// and false is returned.
+// pRows(in) - RowGroup to be aggregated.
+//------------------------------------------------------------------------------
+bool RowAggregation::aggregateBatch(const RowGroup* pRows)
+{
+    for (uint64_t i = 0; i < fFunctionCols.size(); i++)
+    {
+        switch (fFunctionCols[i]->fAggFunction)
+        {
+            case ROWAGG_COUNT_ASTERISK:
+            case ROWAGG_COUNT_NO_OP:
+            case ROWAGG_DUP_FUNCT:
+            case ROWAGG_CONSTANT:
+                break;
+
+            case ROWAGG_COUNT_COL_NAME:
+            case ROWAGG_MIN:
+            case ROWAGG_MAX:
+                if (batchColumnKind(fRowGroupIn, fFunctionCols[i]->fInputColumnIndex) == BATCH_NONE)
+                    return false;
+
+                break;
+
+            case ROWAGG_SUM:
+            {
+                BatchColumnKind kind = batchColumnKind(fRowGroupIn, fFunctionCols[i]->fInputColumnIndex);
+
+                if (kind == BATCH_NONE || kind == BATCH_TEMPORAL)
+                    return false;
+
+                break;
+            }
+
+            default:
+                return false;
+        }
+    }
+
+    uint64_t rowCount = pRows->getRowCount();
+
+    if (rowCount == 0)
+        return true;
+
+    Row rowIn;
+    pRows->initRow(&rowIn);
+    pRows->getRow(0, &rowIn);
+    const uint8_t* data = rowIn.getData();
+    uint32_t rowSize = rowIn.getSize();
+
+    for (uint64_t i = 0; i < fFunctionCols.size(); i++)
+    {
+        const RowAggFunctionCol& funcCol = *fFunctionCols[i];
+        int64_t colIn  = funcCol.fInputColumnIndex;
+        int64_t colOut = funcCol.fOutputColumnIndex;
+
+        if (funcCol.fAggFunction == ROWAGG_COUNT_ASTERISK)
+        {
+            fRow.setUintField<8>(fRow.getUintField<8>(colOut) + rowCount, colOut);
+            continue;
+        }
+
+        if (funcCol.fAggFunction != ROWAGG_COUNT_COL_NAME && funcCol.fAggFunction != ROWAGG_SUM &&
+                funcCol.fAggFunction != ROWAGG_MIN && funcCol.fAggFunction != ROWAGG_MAX)
+            continue;
+
+        const uint8_t* col = data + rowIn.getOffset(colIn);
+        uint32_t width = fRowGroupIn.getColumnWidth(colIn);
+        BatchColumnKind kind = batchColumnKind(fRowGroupIn, colIn);
+
+        switch (kind)
+        {
+            case BATCH_SIGNED:
+            case BATCH_DECIMAL:
+                if (width == 1)
+                    aggregateBatchColumn<int8_t>(col, rowSize, rowCount, joblist::TINYINTNULL, kind, funcCol);
+                else if (width == 2)
+                    aggregateBatchColumn<int16_t>(col, rowSize, rowCount, joblist::SMALLINTNULL, kind, funcCol);
+                else if (width == 4)
+                    aggregateBatchColumn<int32_t>(col, rowSize, rowCount, joblist::INTNULL, kind, funcCol);
+                else
+                    aggregateBatchColumn<int64_t>(col, rowSize, rowCount, joblist::BIGINTNULL, kind, funcCol);
+
+                break;
+
+            case BATCH_UNSIGNED:
+            case BATCH_TEMPORAL:
+                if (width == 1)
+                    aggregateBatchColumn<uint8_t>(col, rowSize, rowCount, joblist::UTINYINTNULL, kind, funcCol);
+                else if (width == 2)
+                    aggregateBatchColumn<uint16_t>(col, rowSize, rowCount, joblist::USMALLINTNULL, kind, funcCol);
+                else if (width == 4)
+                    aggregateBatchColumn<uint32_t>(col, rowSize, rowCount, joblist::UINTNULL, kind, funcCol);
+                else
+                    aggregateBatchColumn<uint64_t>(col, rowSize, rowCount, joblist::UBIGINTNULL, kind, funcCol);
+
+                break;
+
+            case BATCH_WIDE_DECIMAL:
+                aggregateBatchColumn<int128_t>(col, rowSize, rowCount, datatypes::Decimal128Null, kind, funcCol);
+                break;
+
+            case BATCH_DOUBLE:
+                aggregateBatchColumn<double>(col, rowSize, rowCount, getDoubleNullValue(), kind, funcCol);
+                break;
+
+            case BATCH_FLOAT:
+                aggregateBatchColumn<float>(col, rowSize, rowCount, getFloatNullValue(), kind, funcCol);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Update one function column of fRow from a column of a RowGroup.
+// col(in)       - the column in the first row
+// rowSize(in)   - the distance between the rows
+// rowCount(in)  - the number of rows
+// nullValue(in) - the NULL value of the column, of its storage type T
+// kind(in)      - the BatchColumnKind of the column
+// funcCol(in)   - the function to update
+//------------------------------------------------------------------------------
+template <typename T>
+void RowAggregation::aggregateBatchColumn(const uint8_t* col, uint32_t rowSize, uint64_t rowCount,
+                                          T nullValue, int kind, const RowAggFunctionCol& funcCol)
+{
+    int64_t colIn  = funcCol.fInputColumnIndex;
+    int64_t colOut = funcCol.fOutputColumnIndex;
+    int funcType = funcCol.fAggFunction;
+
+    switch (funcType)
+    {
+        case ROWAGG_COUNT_COL_NAME:
+        {
+            uint64_t count = batchCount(col, rowSize, rowCount, nullValue);
+            fRow.setUintField<8>(fRow.getUintField<8>(colOut) + count, colOut);
+            break;
+        }
+
+        case ROWAGG_SUM:
+        {
+            bool outIsNull = isNull(fRowGroupOut, fRow, colOut);
+
+            if (kind == BATCH_SIGNED || kind == BATCH_UNSIGNED || kind == BATCH_WIDE_DECIMAL)
+            {
+                // integers and wide decimals are summed exactly as int128
+                int128_t sum = 0;
+
+                if (batchSum(col, rowSize, rowCount, nullValue, sum) == 0)
+                    break;
+
+                if (!outIsNull)
+                    sum += *fRow.getBinaryField<int128_t>(colOut);
+
+                fRow.setBinaryField(&sum, colOut);
+            }
+            else
+            {
+                long double sum = (outIsNull ? 0 : fRow.getLongDoubleField(colOut));
+                uint64_t count;
+
+                if (kind == BATCH_DECIMAL)
+                    count = batchScaledSum(col, rowSize, rowCount, nullValue, fRowGroupIn.getScale()[colIn], sum);
+                else
+                    count = batchSum(col, rowSize, rowCount, nullValue, sum);
+
+                if (count > 0)
+                    fRow.setLongDoubleField(sum, colOut);
+            }
+
+            break;
+        }
+
+        case ROWAGG_MIN:
+        case ROWAGG_MAX:
+        {
+            T result = nullValue;
+
+            if (batchMinMax(col, rowSize, rowCount, nullValue, funcType, result) == 0)
+                break;
+
+            switch (kind)
+            {
+                case BATCH_SIGNED:
+                case BATCH_DECIMAL:
+                    updateIntMinMax((int64_t) result, fRow.getIntField(colOut), colOut, funcType);
+                    break;
+
+                case BATCH_UNSIGNED:
+                case BATCH_TEMPORAL:
+                    updateUintMinMax((uint64_t) result, fRow.getUintField(colOut), colOut, funcType);
+                    break;
+
+                case BATCH_WIDE_DECIMAL:
+                {
+                    int128_t value = (int128_t) result;
+                    updateIntMinMax(&value, fRow.getBinaryField<int128_t>(colOut), colOut, funcType);
+                    break;
+                }
+
+                case BATCH_DOUBLE:
+                    updateDoubleMinMax((double) result, fRow.getDoubleField(colOut), colOut, funcType);
+                    break;
+
+                case BATCH_FLOAT:
+                    updateFloatMinMax((float) result, fRow.getFloatField(colOut), colOut, funcType);
+                    break;
+
+                default:
+                    break;
+            }
+
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+
 void RowAggregation::addRowGroup(const RowGroup* pRows, vector<std::pair<Row::Pointer, uint64_t>>& inRows)
 {
     // this function is for threaded aggregation, which is for group by and distinct.
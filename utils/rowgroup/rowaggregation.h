@@ -555,6 +555,14 @@ protected:
         return true;
     }
 
+    // Aggregates all the rows of pRG into fRow one function column at a time,
+    // for aggregations without GROUP BY.  Returns false without touching fRow
+    // if some function or input column type has no batch kernel.
+    virtual bool aggregateBatch(const RowGroup* pRG);
+    template <typename T>
+    void aggregateBatchColumn(const uint8_t* col, uint32_t rowSize, uint64_t rowCount,
+                              T nullValue, int kind, const RowAggFunctionCol& funcCol);
+
     void resetUDAF(RowUDAFFunctionCol* rowUDAF);
     void resetUDAF(RowUDAFFunctionCol* rowUDAF, uint64_t funcColIdx);
 
@@ -848,6 +856,11 @@ protected:
     {
         return false;
     }
+    // the input rows hold partial aggregates, which the kernels don't merge
+    bool aggregateBatch(const RowGroup* pRG) override
+    {
+        return false;
+    }
 };
 
 
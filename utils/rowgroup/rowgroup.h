@@ -488,6 +488,9 @@ public:
     inline utils::ConstString getShortConstString(uint32_t colIndex) const;
     void setStringField(const std::string& val, uint32_t colIndex);
     inline void setStringField(const utils::ConstString &str, uint32_t colIndex);
+    // Sets the string column to the value src holds in it.  Both rows must belong to
+    // the same RowGroup; a string kept in the StringStore is shared, not stored again.
+    inline void shareStringField(const Row& src, uint32_t colIndex);
     template<typename T>
     inline void setBinaryField(const T* value, uint32_t width, uint32_t colIndex);
     template<typename T>
@@ -1050,6 +1053,13 @@ inline void Row::setStringField(const utils::ConstString &str, uint32_t colIndex
     }
 }
 
+inline void Row::shareStringField(const Row& src, uint32_t colIndex)
+{
+    idbassert(strings == src.strings);
+    memcpy(&data[offsets[colIndex]], &src.data[offsets[colIndex]],
+           offsets[colIndex + 1] - offsets[colIndex]);
+}
+
 template <typename T>
 inline T* Row::getBinaryField(uint32_t colIndex) const
 {
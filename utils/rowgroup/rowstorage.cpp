@@ -21,8 +21,13 @@
 #include "rowgroup.h"
 #include <resourcemanager.h>
 #include <fcntl.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 #include "rowstorage.h"
 #include "robin_hood.h"
+#include "idbcompress.h"
 
 namespace
 {
@@ -81,6 +86,283 @@ std::string errorString(int errNo)
   return {buf};
 }
 
+/** @brief Header of a dump file, the data follows it compressed or as is */
+struct DumpHeader
+{
+  uint32_t compression; ///< 0 or the compression type of the data
+  uint64_t rawSize;     ///< size of the data before compression
+};
+
+/** @brief Pick the compression type of the dumps from the config */
+uint32_t getDumpCompression(joblist::ResourceManager* rm)
+{
+  if (!rm)
+    return 0;
+
+  return joblist::ResourceManager::getTempFileCompressionType(
+      rm->getAggregationTempFileCompression());
+}
+
+const compress::CompressInterface* getDumpCompressor(uint32_t compression)
+{
+  static const compress::CompressorPool pool = []() {
+    compress::CompressorPool p;
+    compress::initializeCompressorPool(p);
+    return p;
+  }();
+
+  auto it = pool.find(compression);
+  return (it == pool.end() ? nullptr : it->second.get());
+}
+
+} // anonymous namespace
+
+namespace rowgroup
+{
+
+int saveDump(const std::string& fname, const messageqcpp::ByteStream& bs,
+             uint32_t compression)
+{
+  DumpHeader hdr{0, bs.length()};
+  const char* data = (const char*)bs.buf();
+  size_t sz = bs.length();
+  std::unique_ptr<char[]> compressed;
+
+  const auto* compressor = getDumpCompressor(compression);
+  if (compressor && sz > 0)
+  {
+    size_t outLen = compressor->maxCompressedSize(sz);
+    compressed.reset(new char[outLen]);
+    // incompressible data is written as is
+    if (compressor->compress(data, sz, compressed.get(), &outLen) ==
+            compress::CompressInterface::ERR_OK && outLen < sz)
+    {
+      hdr.compression = compression;
+      data = compressed.get();
+      sz = outLen;
+    }
+  }
+
+  int fd = open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (UNLIKELY(fd < 0))
+    return errno;
+
+  int errNo;
+  if ((errNo = writeData(fd, (const char*)&hdr, sizeof(hdr))) != 0 ||
+      (errNo = writeData(fd, data, sz)) != 0)
+  {
+    close(fd);
+    unlink(fname.c_str());
+    return errNo;
+  }
+  close(fd);
+  return 0;
+}
+
+int loadDump(const std::string& fname, messageqcpp::ByteStream& bs)
+{
+  int fd = open(fname.c_str(), O_RDONLY);
+  if (UNLIKELY(fd < 0))
+    return errno;
+
+  struct stat st
+  {
+  };
+  fstat(fd, &st);
+
+  DumpHeader hdr;
+  int errNo;
+  if (st.st_size < (off_t)sizeof(hdr))
+  {
+    close(fd);
+    return EIO;
+  }
+  size_t sz = st.st_size - sizeof(hdr);
+  if ((errNo = readData(fd, (char*)&hdr, sizeof(hdr))) != 0)
+  {
+    close(fd);
+    return errNo;
+  }
+
+  bs.restart();
+  bs.needAtLeast(hdr.rawSize);
+  if (hdr.compression == 0)
+  {
+    errNo = (sz == hdr.rawSize ? readData(fd, (char*)bs.getInputPtr(), sz) : EIO);
+    close(fd);
+  }
+  else
+  {
+    std::unique_ptr<char[]> compressed(new char[sz]);
+    errNo = readData(fd, compressed.get(), sz);
+    close(fd);
+    const auto* compressor = getDumpCompressor(hdr.compression);
+    size_t outLen = hdr.rawSize;
+    if (errNo == 0 &&
+        (!compressor ||
+         compressor->uncompress(compressed.get(), sz, (char*)bs.getInputPtr(), &outLen) !=
+             compress::CompressInterface::ERR_OK ||
+         outLen != hdr.rawSize))
+      errNo = EIO;
+  }
+
+  if (errNo == 0)
+    bs.advanceInputPtr(hdr.rawSize);
+  return errNo;
+}
+
+} // namespace rowgroup
+
+namespace
+{
+
+using rowgroup::saveDump;
+using rowgroup::loadDump;
+
+/** @brief Writes the RGData dumps of a RowGroupStorage in the background
+ *
+ *   A dump stays queued until it is on the disk, and at most two are queued,
+ *   so the aggregation fills the next buffer while the previous one is being
+ *   compressed and written.  Anything that opens, renames or removes a dump
+ *   file waits for that file first.
+ *
+ *   The memory of a queued dump stays charged.  MemManager is not thread
+ *   safe, so the writer only counts what it has written and the owner gives
+ *   it back with takeWritten().
+ */
+class DumpWriter
+{
+public:
+  explicit DumpWriter(uint32_t compression) : fCompression(compression) {}
+
+  ~DumpWriter()
+  {
+    {
+      std::unique_lock<std::mutex> lk(fMutex);
+      fStop = true;
+    }
+    fCond.notify_all();
+    if (fThread.joinable())
+      fThread.join();
+  }
+
+  uint32_t compression() const
+  {
+    return fCompression;
+  }
+
+  /** @brief Queue the ByteStream to be written, taking its contents
+   *
+   * @param memSz(in) memory charged for the dump, see takeWritten()
+   */
+  void write(const std::string& fname, messageqcpp::ByteStream& bs, size_t memSz = 0)
+  {
+    std::unique_lock<std::mutex> lk(fMutex);
+    fCond.wait(lk, [this] { return fJobs.size() < MAX_QUEUED; });
+    checkError();
+    if (!fThread.joinable())
+      fThread = std::thread(&DumpWriter::run, this);
+
+    fJobs.emplace_back();
+    fJobs.back().fname = fname;
+    fJobs.back().bs.swap(bs);
+    fJobs.back().memSz = memSz;
+    fCond.notify_all();
+  }
+
+  /** @brief Memory of the dumps written since the last call */
+  size_t takeWritten()
+  {
+    std::unique_lock<std::mutex> lk(fMutex);
+    size_t ret = fWritten;
+    fWritten = 0;
+    return ret;
+  }
+
+  /** @brief Wait until the file is written */
+  void wait(const std::string& fname)
+  {
+    std::unique_lock<std::mutex> lk(fMutex);
+    fCond.wait(lk, [&] { return !isQueued(fname); });
+    checkError();
+  }
+
+  /** @brief Wait until all the files are written */
+  void wait()
+  {
+    std::unique_lock<std::mutex> lk(fMutex);
+    fCond.wait(lk, [this] { return fJobs.empty(); });
+    checkError();
+  }
+
+  bool queued(const std::string& fname)
+  {
+    std::unique_lock<std::mutex> lk(fMutex);
+    return isQueued(fname);
+  }
+
+private:
+  static constexpr size_t MAX_QUEUED = 2;
+
+  struct Job
+  {
+    std::string fname;
+    messageqcpp::ByteStream bs;
+    size_t memSz{0};
+  };
+
+  bool isQueued(const std::string& fname) const
+  {
+    for (const auto& job : fJobs)
+    {
+      if (job.fname == fname)
+        return true;
+    }
+    return false;
+  }
+
+  void checkError() const
+  {
+    if (UNLIKELY(fErrNo != 0))
+    {
+      throw logging::IDBExcept(logging::IDBErrorInfo::instance()->errorMsg(
+          logging::ERR_DISKAGG_FILEIO_ERROR, errorString(fErrNo)),
+                               logging::ERR_DISKAGG_FILEIO_ERROR);
+    }
+  }
+
+  void run()
+  {
+    std::unique_lock<std::mutex> lk(fMutex);
+    while (true)
+    {
+      fCond.wait(lk, [this] { return !fJobs.empty() || fStop; });
+      if (fJobs.empty())
+        return;
+
+      // the job stays at the front, and in place, until it is written
+      Job& job = fJobs.front();
+      lk.unlock();
+      int errNo = saveDump(job.fname, job.bs, fCompression);
+      lk.lock();
+      if (errNo != 0 && fErrNo == 0)
+        fErrNo = errNo;
+      fWritten += job.memSz;
+      fJobs.pop_front();
+      fCond.notify_all();
+    }
+  }
+
+  const uint32_t fCompression;
+  std::mutex fMutex;
+  std::condition_variable fCond;
+  std::deque<Job> fJobs;
+  std::thread fThread;
+  size_t fWritten{0};
+  int fErrNo{0};
+  bool fStop{false};
+};
+
 inline uint64_t hashData(const void* ptr, uint32_t len, uint64_t x = 0ULL)
 {
   static constexpr uint64_t m = 0xc6a4a7935bd1e995ULL;
@@ -378,6 +660,7 @@ public:
       , fRGDatas()
       , fUniqId(this)
       , fTmpDir(tmpDir)
+      , fWriter(new DumpWriter(getDumpCompression(rm)))
   {
     if (rm)
     {
@@ -463,9 +746,11 @@ public:
     while (!fRGDatas.empty())
     {
       uint64_t rgid = fRGDatas.size() - 1;
+      if (rgid > 0)
+        prefetchRG(rgid - 1);
       if (!fRGDatas[rgid])
         loadRG(rgid, fRGDatas[rgid], true);
-      unlink(makeRGFilename(rgid).c_str());
+      removeRG(rgid);
 
       auto rgdata = std::move(fRGDatas[rgid]);
       fRGDatas.pop_back();
@@ -659,6 +944,8 @@ public:
     dumpAll();
     fLRU->clear();
     fMM->release();
+    // already given back by the release above
+    fWriter->takeWritten();
     fRGDatas.clear();
 
     // we need at least one RGData so create it right now
@@ -748,6 +1035,7 @@ public:
 #ifdef DISK_AGG_DEBUG
     dumpMeta();
 #endif
+    fWriter->wait();
     for (uint64_t i = 0; i < fRGDatas.size(); ++i)
     {
       if (fRGDatas[i])
@@ -759,6 +1047,9 @@ public:
           ::abort();
       }
     }
+    // other storages read these files
+    fWriter->wait();
+    releaseWritten();
     if (dumpFin)
       dumpFinalizedInfo();
   }
@@ -772,6 +1063,7 @@ public:
     ret->fMM.reset(fMM->clone());
     ret->fUniqId = fUniqId;
     ret->fGeneration = gen;
+    ret->fWriter.reset(new DumpWriter(fWriter->compression()));
     ret->loadFinalizedInfo();
     return ret;
   }
@@ -825,11 +1117,14 @@ private:
     if (UNLIKELY(fRGDatas.empty()))
     {
       fMM->release();
+      fWriter->takeWritten();
       return false;
     }
     while (!fRGDatas.empty())
     {
       uint64_t rgid = fRGDatas.size() - 1;
+      if (rgid > 0)
+        prefetchRG(rgid - 1);
       rgdata = std::move(fRGDatas[rgid]);
       fRGDatas.pop_back();
 
@@ -854,7 +1149,7 @@ private:
 
         if (!rgdata)
         {
-          unlink(makeRGFilename(rgid).c_str());
+          removeRG(rgid);
           continue;
         }
 
@@ -901,7 +1196,7 @@ private:
         if (pos == 0)
         {
           fLRU->remove(rgid);
-          unlink(makeRGFilename(rgid).c_str());
+          removeRG(rgid);
           continue;
         }
 
@@ -914,11 +1209,13 @@ private:
         fRowGroupOut->setData(rgdata.get());
         int64_t memSz = fRowGroupOut->getSizeWithStrings(fMaxRows);
         fMM->release(memSz);
-        unlink(makeRGFilename(rgid).c_str());
+        removeRG(rgid);
       }
       else
       {
+        // the caller renames the file
         fname = makeRGFilename(rgid);
+        fWriter->wait(fname);
       }
       fLRU->remove(rgid);
       return true;
@@ -964,41 +1261,18 @@ private:
   void loadRG(uint64_t rgid, std::unique_ptr<RGData>& rgdata, bool unlinkDump = false)
   {
     auto fname = makeRGFilename(rgid);
-    int fd = open(fname.c_str(), O_RDONLY);
-    if (UNLIKELY(fd < 0))
+    fWriter->wait(fname);
+    releaseWritten();
+
+    messageqcpp::ByteStream bs;
+    int errNo;
+    if ((errNo = loadDump(fname, bs)) != 0)
     {
+      unlink(fname.c_str());
       throw logging::IDBExcept(logging::IDBErrorInfo::instance()->errorMsg(
-                                   logging::ERR_DISKAGG_FILEIO_ERROR, errorString(errno)),
+          logging::ERR_DISKAGG_FILEIO_ERROR, errorString(errNo)),
                                logging::ERR_DISKAGG_FILEIO_ERROR);
     }
-    messageqcpp::ByteStream bs;
-
-    try
-    {
-      struct stat st
-      {
-      };
-      fstat(fd, &st);
-
-      bs.needAtLeast(st.st_size);
-      bs.restart();
-      int errNo;
-      if ((errNo = readData(fd, (char*)bs.getInputPtr(), st.st_size)) != 0)
-      {
-        close(fd);
-        unlink(fname.c_str());
-        throw logging::IDBExcept(logging::IDBErrorInfo::instance()->errorMsg(
-            logging::ERR_DISKAGG_FILEIO_ERROR, errorString(errNo)),
-                                 logging::ERR_DISKAGG_FILEIO_ERROR);
-      }
-      bs.advanceInputPtr(st.st_size);
-      close(fd);
-    }
-    catch (...)
-    {
-      close(fd);
-      throw;
-    }
 
     if (unlinkDump)
       unlink(fname.c_str());
@@ -1028,38 +1302,61 @@ private:
 
     fLRU->remove(rgid);
     fRowGroupOut->setData(rgdata.get());
-    fMM->release(fRowGroupOut->getSizeWithStrings(fMaxRows));
 
-    saveRG(rgid, rgdata.get());
+    // the memory is given back once the dump is on the disk
+    saveRG(rgid, rgdata.get(), fRowGroupOut->getSizeWithStrings(fMaxRows));
+    releaseWritten();
   }
 
   /** @brief Dump RGData to disk.
    *
    * @param rgid(in)   RGData ID
    * @param rgdata(in) pointer to RGData itself
+   * @param memSz(in)  memory to give back once the dump is written
    */
-  void saveRG(uint64_t rgid, RGData* rgdata) const
+  void saveRG(uint64_t rgid, RGData* rgdata, size_t memSz = 0) const
   {
     messageqcpp::ByteStream bs;
     fRowGroupOut->setData(rgdata);
     rgdata->serialize(bs, fRowGroupOut->getDataSize());
 
-    int fd = open(makeRGFilename(rgid).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
-    if (UNLIKELY(fd < 0))
-    {
-      throw logging::IDBExcept(logging::IDBErrorInfo::instance()->errorMsg(
-                                   logging::ERR_DISKAGG_FILEIO_ERROR, errorString(errno)),
-                               logging::ERR_DISKAGG_FILEIO_ERROR);
-    }
+    fWriter->write(makeRGFilename(rgid), bs, memSz);
+  }
 
-    int errNo;
-    if ((errNo = writeData(fd, (char*)bs.buf(), bs.length())) != 0)
-    {
-      close(fd);
-      throw logging::IDBExcept(logging::IDBErrorInfo::instance()->errorMsg(
-          logging::ERR_DISKAGG_FILEIO_ERROR, errorString(errNo)),
-                               logging::ERR_DISKAGG_FILEIO_ERROR);
-    }
+  /** @brief Give back the memory of the dumps the writer has finished */
+  void releaseWritten() const
+  {
+    size_t memSz = fWriter->takeWritten();
+    // release(0) would release everything
+    if (memSz > 0)
+      fMM->release(memSz);
+  }
+
+  /** @brief Remove the dump of the RGData once it is written */
+  void removeRG(uint64_t rgid) const
+  {
+    auto fname = makeRGFilename(rgid);
+    fWriter->wait(fname);
+    unlink(fname.c_str());
+  }
+
+  /** @brief Ask the kernel to read the dump of the RGData ahead
+   *
+   * @param rgid(in) RGData ID
+   */
+  void prefetchRG(uint64_t rgid) const
+  {
+    if (rgid >= fRGDatas.size() || fRGDatas[rgid])
+      return;
+
+    auto fname = makeRGFilename(rgid);
+    if (fWriter->queued(fname))
+      return;
+
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0)
+      return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
     close(fd);
   }
 
@@ -1111,6 +1408,7 @@ private:
   uint16_t fGeneration{0};
   std::vector<uint64_t> fFinalizedRows;
   std::string fTmpDir;
+  std::unique_ptr<DumpWriter> fWriter;
 };
 
 /** @brief Internal data for the hashmap */
@@ -1346,6 +1644,7 @@ RowAggStorage::RowAggStorage(const std::string& tmpDir,
     , fTmpDir(tmpDir)
     , fRowGroupOut(rowGroupOut)
     , fKeysRowGroup(keysRowGroup)
+    , fDumpCompression(getDumpCompression(rm))
 {
   char suffix[PATH_MAX];
   snprintf(suffix, sizeof(suffix), "/p%u-t%p/", getpid(), this);
@@ -1380,10 +1679,13 @@ RowAggStorage::RowAggStorage(const std::string& tmpDir,
 
 RowAggStorage::~RowAggStorage()
 {
-  cleanupAll();
-
+  // the storages finish their queued dumps before the directory is removed
   if (fExtKeys)
     delete fKeysStorage;
+  fStorage.reset();
+
+  cleanupAll();
+
   for (auto& data : fGens)
   {
     if (data->fInfo != nullptr)
@@ -1892,23 +2194,14 @@ void RowAggStorage::dumpInternalData() const
   bs << fCurData->fInfoInc;
   bs << fCurData->fInfoHashShift;
   bs.append(fCurData->fInfo, calcBytes(calcSizeWithBuffer(fCurData->fMask + 1, fCurData->fMaxSize)));
-  int fd = open(makeDumpFilename().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
-  if (fd < 0)
-  {
-    throw logging::IDBExcept(logging::IDBErrorInfo::instance()->errorMsg(
-        logging::ERR_DISKAGG_FILEIO_ERROR, errorString(errno)),
-                             logging::ERR_DISKAGG_FILEIO_ERROR);
-  }
 
   int errNo;
-  if ((errNo = writeData(fd, (const char*)bs.buf(), bs.length())) != 0)
+  if ((errNo = saveDump(makeDumpFilename(), bs, fDumpCompression)) != 0)
   {
-    close(fd);
     throw logging::IDBExcept(logging::IDBErrorInfo::instance()->errorMsg(
         logging::ERR_DISKAGG_FILEIO_ERROR, errorString(errNo)),
                              logging::ERR_DISKAGG_FILEIO_ERROR);
   }
-  close(fd);
 }
 
 void RowAggStorage::finalize(std::function<void(Row&)> mergeFunc, Row& rowOut)
@@ -2149,27 +2442,13 @@ void RowAggStorage::loadGeneration(uint16_t gen)
 void RowAggStorage::loadGeneration(uint16_t gen, size_t &size, size_t &mask, size_t &maxSize, uint32_t &infoInc, uint32_t &infoHashShift, uint8_t *&info)
 {
   messageqcpp::ByteStream bs;
-  int fd = open(makeDumpFilename(gen).c_str(), O_RDONLY);
-  if (fd < 0)
-  {
-    throw logging::IDBExcept(logging::IDBErrorInfo::instance()->errorMsg(
-        logging::ERR_DISKAGG_FILEIO_ERROR, errorString(errno)),
-                             logging::ERR_DISKAGG_FILEIO_ERROR);
-  }
-  struct stat st{};
-  fstat(fd, &st);
-  bs.needAtLeast(st.st_size);
-  bs.restart();
   int errNo;
-  if ((errNo = readData(fd, (char*)bs.getInputPtr(), st.st_size)) != 0)
+  if ((errNo = loadDump(makeDumpFilename(gen), bs)) != 0)
   {
-    close(fd);
     throw logging::IDBExcept(logging::IDBErrorInfo::instance()->errorMsg(
         logging::ERR_DISKAGG_FILEIO_ERROR, errorString(errNo)),
                              logging::ERR_DISKAGG_FILEIO_ERROR);
   }
-  close(fd);
-  bs.advanceInputPtr(st.st_size);
 
   bs >> size;
   bs >> mask;
@@ -41,6 +41,21 @@ class RowGroupStorage;
 
 uint64_t hashRow(const rowgroup::Row& r, std::size_t lastCol);
 
+/** @brief Write the ByteStream to a new disk aggregation dump file
+ *
+ * @param compression(in) 0 or the compression type to try, the data is
+ *                        stored as is if it does not shrink
+ * @returns 0 or errno
+ */
+int saveDump(const std::string& fname, const messageqcpp::ByteStream& bs,
+             uint32_t compression);
+
+/** @brief Read a dump file written by saveDump() into the ByteStream
+ *
+ * @returns 0 or errno, EIO for a short or corrupted file
+ */
+int loadDump(const std::string& fname, messageqcpp::ByteStream& bs);
+
 class RowAggStorage
 {
 public:
@@ -360,6 +375,7 @@ private:
   bool fInitialized{false};
   rowgroup::RowGroup* fRowGroupOut;
   rowgroup::RowGroup* fKeysRowGroup;
+  uint32_t fDumpCompression;
 };
 
 } // namespace rowgroup
@@ -23,7 +23,9 @@
 
 #include <stdexcept>
 #include <unistd.h>
+#include <time.h>
 #include <exception>
+#include <algorithm>
 using namespace std;
 
 #include "messageobj.h"
@@ -35,152 +37,316 @@ using namespace boost;
 
 #include "dbcon/joblist/primitivemsg.h"
 
+namespace
+{
+
+uint64_t nowUsecs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+}
+
 namespace threadpool
 {
 
 PriorityThreadPool::PriorityThreadPool(uint targetWeightPerRun, uint highThreads,
                                        uint midThreads, uint lowThreads, uint ID) :
-    _stop(false), weightPerRun(targetWeightPerRun), id(ID)
+    nextWorker(0), deadThreads(0), runningThreads(0), idleThreads(0), _stop(false),
+    weightPerRun(std::max(targetWeightPerRun, 1U)), id(ID)
 {
-    boost::thread* newThread;
-    for (uint32_t i = 0; i < highThreads; i++)
-    {
-		newThread = threads.create_thread(ThreadHelper(this, HIGH));
-        newThread->detach();
-    }
-    for (uint32_t i = 0; i < midThreads; i++)
+    const uint32_t threadCounts[_COUNT] = { lowThreads, midThreads, highThreads };
+
+    for (int p = HIGH; p >= LOW; p--)
     {
-		newThread = threads.create_thread(ThreadHelper(this, MEDIUM));
-        newThread->detach();
+        for (uint32_t i = 0; i < threadCounts[p]; i++)
+        {
+            workers.push_back(boost::shared_ptr<WorkerQueue>(new WorkerQueue()));
+            workers.back()->preferredQueue = (Priority) p;
+        }
     }
-    for (uint32_t i = 0; i < lowThreads; i++)
+
+    // jobs need somewhere to go
+    if (workers.empty())
     {
-		newThread = threads.create_thread(ThreadHelper(this, LOW));
-        newThread->detach();
+        workers.push_back(boost::shared_ptr<WorkerQueue>(new WorkerQueue()));
+        workers.back()->preferredQueue = LOW;
     }
+
+    startThreads();
     cout << "started " << highThreads << " high, " << midThreads << " med, " << lowThreads
          << " low.\n";
-    defaultThreadCounts[HIGH] = threadCounts[HIGH] = highThreads;
-    defaultThreadCounts[MEDIUM] = threadCounts[MEDIUM] = midThreads;
-    defaultThreadCounts[LOW] = threadCounts[LOW] = lowThreads;
 }
 
 PriorityThreadPool::~PriorityThreadPool()
 {
     stop();
+
+    // the threads are detached, wait for them to stop using the pool
+    while (runningThreads > 0)
+        usleep(1000);
 }
 
-void PriorityThreadPool::addJob(const Job& job, bool useLock)
+// Starts a thread for every queue whose thread isn't running, at first
+// and again after a thread has died of an exception.
+void PriorityThreadPool::startThreads()
 {
     boost::thread* newThread;
-    boost::mutex::scoped_lock lk(mutex, boost::defer_lock_t());
-
-    if (useLock)
-        lk.lock();
+    boost::mutex::scoped_lock lk(threadMutex);
 
-    // Create any missing threads
-    if (defaultThreadCounts[HIGH] != threadCounts[HIGH])
+    for (uint32_t i = 0; i < workers.size(); i++)
     {
-        newThread = threads.create_thread(ThreadHelper(this, HIGH));
-        newThread->detach();
-        threadCounts[HIGH]++;
-    }
+        if (workers[i]->alive)
+            continue;
 
-    if (defaultThreadCounts[MEDIUM] != threadCounts[MEDIUM])
-    {
-        newThread = threads.create_thread(ThreadHelper(this, MEDIUM));
+        runningThreads++;
+        newThread = threads.create_thread(ThreadHelper(this, i));
         newThread->detach();
-        threadCounts[MEDIUM]++;
+        workers[i]->alive = true;
     }
 
-    if (defaultThreadCounts[LOW] != threadCounts[LOW])
-    {
-        newThread = threads.create_thread(ThreadHelper(this, LOW));
-        newThread->detach();
-        threadCounts[LOW]++;
-    }
+    deadThreads = 0;
+}
 
+PriorityThreadPool::Priority PriorityThreadPool::queueFor(const Job& job)
+{
     if (job.priority > 66)
-        jobQueues[HIGH].push_back(job);
+        return HIGH;
     else if (job.priority > 33)
-        jobQueues[MEDIUM].push_back(job);
+        return MEDIUM;
     else
-        jobQueues[LOW].push_back(job);
+        return LOW;
+}
+
+void PriorityThreadPool::addJob(const Job& job)
+{
+    // Create any missing threads
+    if (deadThreads > 0)
+        startThreads();
+
+    enqueue(*workers[nextWorker++ % workers.size()], job);
+    wakeThreads(1);
+}
+
+void PriorityThreadPool::enqueue(WorkerQueue& wq, Job job)
+{
+    Priority queue = queueFor(job);
 
-    if (useLock)
+    job.queuedAt = nowUsecs();
+
+    {
+        boost::mutex::scoped_lock lk(wq.mutex);
+        JobQueue& jq = wq.jobQueues[queue];
+        QueryJobs& qj = jq.queries[job.uniqueID];
+
+        // a query without queued jobs gets back in line with a full turn
+        if (qj.jobs.empty())
+        {
+            qj.credit = weightPerRun;
+            jq.turns.push_back(job.uniqueID);
+        }
+
+        qj.jobs.push_back(job);
+        jq.size++;
+        wq.sizes[queue]++;
+        stats[queue].depth++;
+    }
+}
+
+// An idle thread counts itself in idleThreads before it checks the depth for
+// the last time, and a job is counted in the depth before this checks
+// idleThreads, so either the thread sees the job or it gets woken.
+void PriorityThreadPool::wakeThreads(uint32_t count)
+{
+    if (idleThreads == 0)
+        return;
+
+    boost::mutex::scoped_lock lk(idleMutex);
+
+    if (count > 1)
+        newJob.notify_all();
+    else
         newJob.notify_one();
 }
 
+uint64_t PriorityThreadPool::totalDepth() const
+{
+    return stats[LOW].depth + stats[MEDIUM].depth + stats[HIGH].depth;
+}
+
 void PriorityThreadPool::removeJobs(uint32_t id)
 {
-    list<Job>::iterator it;
+    for (uint32_t w = 0; w < workers.size(); w++)
+    {
+        WorkerQueue& wq = *workers[w];
+        boost::mutex::scoped_lock lk(wq.mutex);
 
-    boost::mutex::scoped_lock lk(mutex);
+        for (uint32_t i = 0; i < _COUNT; i++)
+        {
+            JobQueue& jq = wq.jobQueues[i];
+            uint32_t removed = 0;
+            deque<uint32_t> turns;
 
-    for (uint32_t i = 0; i < _COUNT; i++)
-        for (it = jobQueues[i].begin(); it != jobQueues[i].end();)
-            if (it->id == id)
-                it = jobQueues[i].erase(it);
-            else
-                ++it;
+            for (deque<uint32_t>::iterator it = jq.turns.begin(); it != jq.turns.end(); ++it)
+            {
+                deque<Job>& jobs = jq.queries[*it].jobs;
+
+                for (deque<Job>::iterator jit = jobs.begin(); jit != jobs.end();)
+                {
+                    if (jit->id == id)
+                    {
+                        jit = jobs.erase(jit);
+                        removed++;
+                    }
+                    else
+                        ++jit;
+                }
+
+                if (jobs.empty())
+                    jq.queries.erase(*it);
+                else
+                    turns.push_back(*it);
+            }
+
+            jq.turns.swap(turns);
+            jq.size -= removed;
+            wq.sizes[i] -= removed;
+            stats[i].depth -= removed;
+        }
+    }
 }
 
-PriorityThreadPool::Priority PriorityThreadPool::pickAQueue(Priority preference)
+// Takes the next jobs of the given priority from wq, the queries taking
+// turns.  3 conditions stop this thread from grabbing all jobs in the queue
+//
+// 1: The weight limit has been exceeded
+// 2: The queue is empty
+// 3: It has grabbed more than half of the jobs available &
+//     should leave some to the other threads
+bool PriorityThreadPool::takeJobs(WorkerQueue& wq, Priority queue, vector<Job>& runList)
 {
-    if (!jobQueues[preference].empty())
-        return preference;
-    else if (!jobQueues[HIGH].empty())
-        return HIGH;
-    else if (!jobQueues[MEDIUM].empty())
-        return MEDIUM;
-    else
-        return LOW;
+    uint32_t weight = 0, taken = 0;
+    boost::mutex::scoped_lock lk(wq.mutex);
+    JobQueue& jq = wq.jobQueues[queue];
+    const uint32_t queueSize = jq.size;
+
+    while ((weight < weightPerRun) && (jq.size > 0) && (taken <= queueSize / 2))
+    {
+        uint32_t query = jq.turns.front();
+        QueryJobs& qj = jq.queries[query];
+
+        runList.push_back(qj.jobs.front());
+        qj.jobs.pop_front();
+        jq.size--;
+        taken++;
+        weight += runList.back().weight;
+        qj.credit -= runList.back().weight;
+
+        // the query's turn ends with its jobs or its credit
+        if (qj.jobs.empty())
+        {
+            jq.queries.erase(query);
+            jq.turns.pop_front();
+        }
+        else if (qj.credit <= 0)
+        {
+            qj.credit += weightPerRun;
+            jq.turns.pop_front();
+            jq.turns.push_back(query);
+        }
+    }
+
+    wq.sizes[queue] -= taken;
+    lk.unlock();
+
+    if (taken == 0)
+        return false;
+
+    uint64_t now = nowUsecs(), maxWait = 0, totalWait = 0;
+
+    for (uint32_t i = runList.size() - taken; i < runList.size(); i++)
+    {
+        uint64_t wait = (now > runList[i].queuedAt ? now - runList[i].queuedAt : 0);
+        totalWait += wait;
+        maxWait = std::max(maxWait, wait);
+    }
+
+    PriorityStats& ps = stats[queue];
+    ps.depth -= taken;
+    ps.jobsRun += taken;
+    ps.totalWait += totalWait;
+
+    uint64_t prevMax = ps.maxWait;
+
+    while (maxWait > prevMax && !ps.maxWait.compare_exchange_weak(prevMax, maxWait))
+        ;
+
+    return true;
+}
+
+// Looks for work the way the single queue did, the thread's preferred
+// priority first and then from the highest down, in the thread's own queue
+// before the others.
+bool PriorityThreadPool::findJobs(uint32_t worker, Priority& queue, vector<Job>& runList)
+{
+    const Priority preferred = workers[worker]->preferredQueue;
+    const Priority order[_COUNT + 1] = { preferred, HIGH, MEDIUM, LOW };
+    const uint32_t count = workers.size();
+
+    for (uint32_t i = 0; i <= _COUNT; i++)
+    {
+        Priority p = order[i];
+
+        if ((i > 0 && p == preferred) || stats[p].depth == 0)
+            continue;
+
+        for (uint32_t k = 0; k < count; k++)
+        {
+            WorkerQueue& wq = *workers[(worker + k) % count];
+
+            if (wq.sizes[p] > 0 && takeJobs(wq, p, runList))
+            {
+                if (k > 0)
+                    stats[p].steals++;
+
+                queue = p;
+                return true;
+            }
+        }
+    }
+
+    return false;
 }
 
-void PriorityThreadPool::threadFcn(const Priority preferredQueue) throw()
+void PriorityThreadPool::threadFcn(uint32_t worker) throw()
 {
     Priority queue = LOW;
-    uint32_t weight, i = 0;
+    uint32_t i = 0;
     vector<Job> runList;
     vector<bool> reschedule;
     uint32_t rescheduleCount;
-    uint32_t queueSize;
     bool running = false;
+    WorkerQueue& home = *workers[worker];
 
     try
     {
         while (!_stop)
         {
+            if (!findJobs(worker, queue, runList))
+            {
+                boost::mutex::scoped_lock lk(idleMutex);
+                idleThreads++;
 
-            boost::mutex::scoped_lock lk(mutex);
-
-            queue = pickAQueue(preferredQueue);
+                // the timeout only guards against a missed wakeup
+                if (!_stop && totalDepth() == 0)
+                    newJob.timed_wait(lk, boost::posix_time::milliseconds(100));
 
-            if (jobQueues[queue].empty())
-            {
-                newJob.wait(lk);
+                idleThreads--;
                 continue;
             }
 
-            queueSize = jobQueues[queue].size();
-            weight = 0;
-            // 3 conditions stop this thread from grabbing all jobs in the queue
-            //
-            // 1: The weight limit has been exceeded
-            // 2: The queue is empty
-            // 3: It has grabbed more than half of the jobs available &
-            //     should leave some to the other threads
-
-            while ((weight < weightPerRun) && (!jobQueues[queue].empty())
-                    && (runList.size() <= queueSize / 2))
-            {
-                runList.push_back(jobQueues[queue].front());
-                jobQueues[queue].pop_front();
-                weight += runList.back().weight;
-            }
-
-            lk.unlock();
-
             reschedule.resize(runList.size());
             rescheduleCount = 0;
 
@@ -199,20 +365,14 @@ void PriorityThreadPool::threadFcn(const Priority preferredQueue) throw()
             if (rescheduleCount == runList.size())
                 usleep(1000);
 
+            // rescheduled jobs stay with this thread, whose cache has their data
             if (rescheduleCount > 0)
             {
-                lk.lock();
-
                 for (i = 0; i < runList.size(); i++)
                     if (reschedule[i])
-                        addJob(runList[i], false);
-
-                if (rescheduleCount > 1)
-                    newJob.notify_all();
-                else
-                    newJob.notify_one();
+                        enqueue(home, runList[i]);
 
-                lk.unlock();
+                wakeThreads(rescheduleCount);
             }
 
             runList.clear();
@@ -223,7 +383,11 @@ void PriorityThreadPool::threadFcn(const Priority preferredQueue) throw()
         // Log the exception and exit this thread
         try
         {
-            threadCounts[queue]--;
+            {
+                boost::mutex::scoped_lock lk(threadMutex);
+                home.alive = false;
+                deadThreads++;
+            }
 #ifndef NOLOGGING
             logging::Message::Args args;
             logging::Message message(5);
@@ -251,7 +415,11 @@ void PriorityThreadPool::threadFcn(const Priority preferredQueue) throw()
         // Log the exception and exit this thread
         try
         {
-            threadCounts[queue]--;
+            {
+                boost::mutex::scoped_lock lk(threadMutex);
+                home.alive = false;
+                deadThreads++;
+            }
 #ifndef NOLOGGING
             logging::Message::Args args;
             logging::Message message(6);
@@ -272,6 +440,9 @@ void PriorityThreadPool::threadFcn(const Priority preferredQueue) throw()
         {
         }
     }
+
+    // the last use of the pool by this thread
+    runningThreads--;
 }
 
 void PriorityThreadPool::sendErrorMsg(uint32_t id, uint32_t step, primitiveprocessor::SP_UM_IOSOCK sock)
@@ -292,6 +463,35 @@ void PriorityThreadPool::sendErrorMsg(uint32_t id, uint32_t step, primitiveproce
 void PriorityThreadPool::stop()
 {
     _stop = true;
+    boost::mutex::scoped_lock lk(idleMutex);
+    newJob.notify_all();
+}
+
+PriorityThreadPool::QueueStats PriorityThreadPool::getStats(Priority priority) const
+{
+    QueueStats ret;
+    const PriorityStats& ps = stats[priority];
+
+    ret.depth = ps.depth;
+    ret.jobsRun = ps.jobsRun;
+    ret.totalWait = ps.totalWait;
+    ret.maxWait = ps.maxWait;
+    ret.steals = ps.steals;
+    return ret;
+}
+
+void PriorityThreadPool::dump()
+{
+    const char* names[_COUNT] = { "low", "medium", "high" };
+
+    for (int p = HIGH; p >= LOW; p--)
+    {
+        QueueStats qs = getStats((Priority) p);
+
+        cout << "PriorityThreadPool " << id << " " << names[p] << ": queued " << qs.depth
+             << ", run " << qs.jobsRun << ", avg wait " << (qs.jobsRun ? qs.totalWait / qs.jobsRun : 0)
+             << "us, max wait " << qs.maxWait << "us, steals " << qs.steals << endl;
+    }
 }
 
 } // namespace threadpool
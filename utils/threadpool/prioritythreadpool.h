@@ -30,6 +30,10 @@
 #include <cstdlib>
 #include <sstream>
 #include <stdexcept>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <tr1/unordered_map>
 #include <boost/thread/thread.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition.hpp>
@@ -41,6 +45,15 @@
 namespace threadpool
 {
 
+/** @brief The PrimProc job scheduler
+ *
+ * Every worker thread owns a queue with its own lock.  New jobs are spread
+ * over the queues, a rescheduled job goes back to the queue of the thread
+ * that ran it, and a thread whose queue is empty steals from the others.
+ * Within a queue the jobs of each priority are kept per query (Job::uniqueID)
+ * and the queries take turns, each allowed about weightPerRun of job weight
+ * per turn, so a query with a large backlog can't hold off a small one.
+ */
 class PriorityThreadPool
 {
 public:
@@ -58,7 +71,7 @@ public:
 
     struct Job
     {
-        Job() : weight(1), priority(0), id(0) { }
+        Job() : weight(1), priority(0), id(0), uniqueID(0), stepID(0), queuedAt(0) { }
         boost::shared_ptr<Functor> functor;
         uint32_t weight;
         uint32_t priority;
@@ -66,6 +79,7 @@ public:
         uint32_t uniqueID;
         uint32_t stepID;
         primitiveprocessor::SP_UM_IOSOCK sock;
+        uint64_t queuedAt;  // set by the pool, in usecs
     };
 
     enum Priority
@@ -76,6 +90,17 @@ public:
         _COUNT
     };
 
+    /** @brief queue depth and queueing latency of one priority */
+    struct QueueStats
+    {
+        QueueStats() : depth(0), jobsRun(0), totalWait(0), maxWait(0), steals(0) { }
+        uint64_t depth;      // jobs waiting now
+        uint64_t jobsRun;    // jobs taken off the queues, reschedules included
+        uint64_t totalWait;  // usecs those jobs spent queued
+        uint64_t maxWait;
+        uint64_t steals;     // batches taken from another thread's queue
+    };
+
     /*********************************************
      *  ctor/dtor
      *
@@ -89,9 +114,11 @@ public:
     virtual ~PriorityThreadPool();
 
     void removeJobs(uint32_t id);
-    void addJob(const Job& job, bool useLock = true);
+    void addJob(const Job& job);
     void stop();
 
+    QueueStats getStats(Priority priority) const;
+
     /** @brief for use in debugging
       */
     void dump();
@@ -101,30 +128,85 @@ protected:
 private:
     struct ThreadHelper
     {
-        ThreadHelper(PriorityThreadPool* impl, Priority queue) : ptp(impl), preferredQueue(queue) { }
+        ThreadHelper(PriorityThreadPool* impl, uint32_t w) : ptp(impl), worker(w) { }
         void operator()()
         {
-            ptp->threadFcn(preferredQueue);
+            ptp->threadFcn(worker);
         }
         PriorityThreadPool* ptp;
+        uint32_t worker;
+    };
+
+    // the jobs of one query at one priority
+    struct QueryJobs
+    {
+        QueryJobs() : credit(0) { }
+        std::deque<Job> jobs;
+        int64_t credit;  // weight the query may still run this turn
+    };
+
+    struct JobQueue
+    {
+        std::tr1::unordered_map<uint32_t, QueryJobs> queries;
+        std::deque<uint32_t> turns;  // queries with jobs, in the order they run
+        uint32_t size;
+    };
+
+    struct WorkerQueue
+    {
+        WorkerQueue() : alive(false)
+        {
+            for (uint32_t i = 0; i < _COUNT; i++)
+            {
+                jobQueues[i].size = 0;
+                sizes[i] = 0;
+            }
+        }
+        boost::mutex mutex;
+        JobQueue jobQueues[_COUNT];  // higher indexes = higher priority
+        std::atomic<uint32_t> sizes[_COUNT];  // to look for work without the lock
         Priority preferredQueue;
+        bool alive;  // guarded by threadMutex
+    };
+
+    struct PriorityStats
+    {
+        PriorityStats() : depth(0), jobsRun(0), totalWait(0), maxWait(0), steals(0) { }
+        std::atomic<uint64_t> depth;
+        std::atomic<uint64_t> jobsRun;
+        std::atomic<uint64_t> totalWait;
+        std::atomic<uint64_t> maxWait;
+        std::atomic<uint64_t> steals;
     };
 
     explicit PriorityThreadPool();
     explicit PriorityThreadPool(const PriorityThreadPool&);
     PriorityThreadPool& operator=(const PriorityThreadPool&);
 
-    Priority pickAQueue(Priority preference);
-    void threadFcn(const Priority preferredQueue) throw();
+    static Priority queueFor(const Job& job);
+    void startThreads();
+    void enqueue(WorkerQueue& wq, Job job);
+    void wakeThreads(uint32_t count);
+    uint64_t totalDepth() const;
+    bool takeJobs(WorkerQueue& wq, Priority queue, std::vector<Job>& runList);
+    bool findJobs(uint32_t worker, Priority& queue, std::vector<Job>& runList);
+    void threadFcn(uint32_t worker) throw();
     void sendErrorMsg(uint32_t id, uint32_t step, primitiveprocessor::SP_UM_IOSOCK sock);
 
-    std::list<Job> jobQueues[3];  // higher indexes = higher priority
-    uint32_t threadCounts[3];
-    uint32_t defaultThreadCounts[3];
-    boost::mutex mutex;
-    boost::condition newJob;
+    std::vector<boost::shared_ptr<WorkerQueue> > workers;
+    std::atomic<uint32_t> nextWorker;  // where the next new job goes
+    std::atomic<uint32_t> deadThreads;
+    std::atomic<uint32_t> runningThreads;
+    boost::mutex threadMutex;  // starting threads
     boost::thread_group threads;
-    bool _stop;
+
+    // idle threads sleep on newJob until a job is queued
+    boost::mutex idleMutex;
+    boost::condition newJob;
+    std::atomic<uint32_t> idleThreads;
+
+    PriorityStats stats[_COUNT];
+    std::atomic<bool> _stop;
     uint32_t weightPerRun;
     volatile uint id;   // prevent it from being optimized out
 };
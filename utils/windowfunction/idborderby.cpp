@@ -901,6 +901,105 @@ bool EqualCompData::operator()(Row::Pointer a, Row::Pointer b)
     return eq;
 }
 
+uint64_t EqualCompData::hash(const Row& r) const
+{
+    utils::Hasher_r hasher;
+    uint32_t h = 0;
+    uint32_t len = 0;
+
+    for (vector<uint64_t>::const_iterator i = fIndex.begin(); i != fIndex.end(); i++)
+    {
+        switch (r.getColType(*i))
+        {
+            case CalpontSystemCatalog::TINYINT:
+            case CalpontSystemCatalog::SMALLINT:
+            case CalpontSystemCatalog::MEDINT:
+            case CalpontSystemCatalog::INT:
+            case CalpontSystemCatalog::BIGINT:
+            case CalpontSystemCatalog::UTINYINT:
+            case CalpontSystemCatalog::USMALLINT:
+            case CalpontSystemCatalog::UMEDINT:
+            case CalpontSystemCatalog::UINT:
+            case CalpontSystemCatalog::UBIGINT:
+            case CalpontSystemCatalog::DATE:
+            case CalpontSystemCatalog::DATETIME:
+            case CalpontSystemCatalog::TIMESTAMP:
+            case CalpontSystemCatalog::TIME:
+            {
+                uint64_t v = r.getUintField(*i);
+                h = hasher((const char*) &v, sizeof(v), h);
+                len += sizeof(v);
+                break;
+            }
+
+            case CalpontSystemCatalog::DECIMAL:
+            case CalpontSystemCatalog::UDECIMAL:
+            {
+                if (r.getColumnWidth(*i) == datatypes::MAXDECIMALWIDTH)
+                {
+                    const int128_t* v = r.getBinaryField<int128_t>(*i);
+                    h = hasher((const char*) v, sizeof(*v), h);
+                    len += sizeof(*v);
+                }
+                else
+                {
+                    uint64_t v = r.getUintField(*i);
+                    h = hasher((const char*) &v, sizeof(v), h);
+                    len += sizeof(v);
+                }
+
+                break;
+            }
+
+            case CalpontSystemCatalog::CHAR:
+            case CalpontSystemCatalog::VARCHAR:
+            {
+                utils::ConstString v = r.getConstString(*i);
+                h = hasher(v.str(), v.length(), h);
+                len += v.length();
+                break;
+            }
+
+            // -0 equals 0
+            case CalpontSystemCatalog::DOUBLE:
+            case CalpontSystemCatalog::UDOUBLE:
+            {
+                double v = r.getDoubleField(*i);
+                v = (v == 0 ? 0 : v);
+                h = hasher((const char*) &v, sizeof(v), h);
+                len += sizeof(v);
+                break;
+            }
+
+            case CalpontSystemCatalog::FLOAT:
+            case CalpontSystemCatalog::UFLOAT:
+            {
+                float v = r.getFloatField(*i);
+                v = (v == 0 ? 0 : v);
+                h = hasher((const char*) &v, sizeof(v), h);
+                len += sizeof(v);
+                break;
+            }
+
+            // the padding of a long double isn't part of the value
+            case CalpontSystemCatalog::LONGDOUBLE:
+            {
+                double v = r.getLongDoubleField(*i);
+                v = (v == 0 ? 0 : v);
+                h = hasher((const char*) &v, sizeof(v), h);
+                len += sizeof(v);
+                break;
+            }
+
+            // operator() rejects the other types
+            default:
+                break;
+        }
+    }
+
+    return hasher.finalize(h, len);
+}
+
 uint64_t IdbOrderBy::Hasher::operator()(const Row::Pointer& p) const
 {
     Row& row = ts->row1;
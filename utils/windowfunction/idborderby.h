@@ -339,6 +339,9 @@ public:
 
     bool operator()(rowgroup::Row::Pointer, rowgroup::Row::Pointer);
 
+    // hash of the compared columns, equal rows get the same hash
+    uint64_t hash(const rowgroup::Row&) const;
+
     std::vector<uint64_t>           fIndex;
 };
 
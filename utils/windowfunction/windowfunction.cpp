@@ -20,6 +20,7 @@
 
 //#define NDEBUG
 #include <cassert>
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 using namespace std;
@@ -37,6 +38,8 @@ using namespace rowgroup;
 #include "idborderby.h"
 using namespace ordering;
 
+#include "atomicops.h"
+
 #include "windowfunctionstep.h"
 using namespace joblist;
 
@@ -49,6 +52,12 @@ using namespace joblist;
 namespace windowfunction
 {
 
+// a function with fewer rows is computed on one thread
+const uint64_t PARALLEL_MIN_ROWS = 64 * 1024;
+
+// buckets of rows per thread, more than one to even out the work
+const uint64_t BUCKETS_PER_THREAD = 4;
+
 WindowFunction::WindowFunction(boost::shared_ptr<WindowFunctionType>& f,
                                boost::shared_ptr<ordering::EqualCompData>& p,
                                boost::shared_ptr<OrderByData>& o,
@@ -69,8 +78,20 @@ void WindowFunction::operator()()
 {
     try
     {
+        // the step calls again for every file in disk-based mode
+        fPartition.clear();
         fRowData.reset(new vector<RowPosition>(fStep->getRowData()));
 
+        // a UDAnF keeps its user data in the rows, it is left on one thread
+        uint64_t threads = fStep->partitionThreads();
+
+        if (threads > 1 && fPartitionBy.get() != NULL && fPartitionBy->fIndex.size() > 0 &&
+                fRowData->size() >= PARALLEL_MIN_ROWS && fFunctionType->functionId() != WF__UDAF)
+        {
+            processPartitionsInParallel(threads);
+            return;
+        }
+
         if (fOrderBy->rule().fCompares.size() > 0)
             sort(fRowData->begin(), fRowData->size());
 
@@ -99,125 +120,343 @@ void WindowFunction::operator()()
         }
 
         // compute partition by partition
-        int64_t uft = fFrame->upper()->boundType();
-        int64_t lft = fFrame->lower()->boundType();
-        bool upperUbnd = (uft == WF__UNBOUNDED_PRECEDING || uft == WF__UNBOUNDED_FOLLOWING);
-        bool lowerUbnd = (lft == WF__UNBOUNDED_PRECEDING || lft == WF__UNBOUNDED_FOLLOWING);
-        bool upperCnrw = (uft == WF__CURRENT_ROW);
-        bool lowerCnrw = (lft == WF__CURRENT_ROW);
         fFunctionType->setRowData(fRowData);
         fFunctionType->setRowMetaData(fRowGroup, fRow);
         fFrame->setRowData(fRowData);
         fFrame->setRowMetaData(fRowGroup, fRow);
 
         for (uint64_t k = 0; k < fPartition.size() && !fStep->cancelled(); k++)
-        {
-            fFunctionType->resetData();
-            fFunctionType->partition(fPartition[k]);
+            processPartition(fFunctionType.get(), fFrame.get(), fPartition[k]);
+    }
+    catch (...)
+    {
+        fStep->handleException(std::current_exception(),
+                        logging::ERR_EXECUTE_WINDOW_FUNCTION,
+                        logging::ERR_WF_DATA_SET_TOO_BIG,
+                        "WindowFunction::operator()");
+    }
+}
+
 
-            int64_t begin = fPartition[k].first;
-            int64_t end   = fPartition[k].second;
+void WindowFunction::processPartition(WindowFunctionType* function, WindowFrame* frame,
+                                      pair<int64_t, int64_t>& partition)
+{
+    int64_t uft = frame->upper()->boundType();
+    int64_t lft = frame->lower()->boundType();
+    bool upperUbnd = (uft == WF__UNBOUNDED_PRECEDING || uft == WF__UNBOUNDED_FOLLOWING);
+    bool lowerUbnd = (lft == WF__UNBOUNDED_PRECEDING || lft == WF__UNBOUNDED_FOLLOWING);
+    bool upperCnrw = (uft == WF__CURRENT_ROW);
+    bool lowerCnrw = (lft == WF__CURRENT_ROW);
+
+    function->resetData();
+    function->partition(partition);
+
+    int64_t begin = partition.first;
+    int64_t end   = partition.second;
 
-            if (upperUbnd && lowerUbnd)
+    if (upperUbnd && lowerUbnd)
+    {
+        function->operator()(begin, end, WF__BOUND_ALL);
+    }
+    else if (upperUbnd && lowerCnrw)
+    {
+        if (frame->unit() == WF__FRAME_ROWS)
+        {
+            for (int64_t i = begin; i <= end && !fStep->cancelled(); i++)
             {
-                fFunctionType->operator()(begin, end, WF__BOUND_ALL);
+                function->operator()(begin, i, i);
             }
-            else if (upperUbnd && lowerCnrw)
+        }
+        else
+        {
+            for (int64_t i = begin; i <= end && !fStep->cancelled(); i++)
             {
-                if (fFrame->unit() == WF__FRAME_ROWS)
-                {
-                    for (int64_t i = begin; i <= end && !fStep->cancelled(); i++)
-                    {
-                        fFunctionType->operator()(begin, i, i);
-                    }
-                }
-                else
-                {
-                    for (int64_t i = begin; i <= end && !fStep->cancelled(); i++)
-                    {
-                        pair<int64_t, int64_t> w = fFrame->getWindow(begin, end, i);
-                        int64_t j = i;
+                pair<int64_t, int64_t> w = frame->getWindow(begin, end, i);
+                int64_t j = i;
 
-                        if (w.second > i)
-                            j = w.second;
+                if (w.second > i)
+                    j = w.second;
 
-                        fFunctionType->operator()(begin, j, i);
-                    }
-                }
+                function->operator()(begin, j, i);
             }
-            else if (upperCnrw && lowerUbnd)
+        }
+    }
+    else if (upperCnrw && lowerUbnd)
+    {
+        if (frame->unit() == WF__FRAME_ROWS)
+        {
+            for (int64_t i = end; i >= begin && !fStep->cancelled(); i--)
             {
-                if (fFrame->unit() == WF__FRAME_ROWS)
-                {
-                    for (int64_t i = end; i >= begin && !fStep->cancelled(); i--)
-                    {
-                        fFunctionType->operator()(i, end, i);
-                    }
-                }
-                else
-                {
-                    for (int64_t i = end; i >= begin && !fStep->cancelled(); i--)
-                    {
-                        pair<int64_t, int64_t> w = fFrame->getWindow(begin, end, i);
-                        int64_t j = i;
+                function->operator()(i, end, i);
+            }
+        }
+        else
+        {
+            for (int64_t i = end; i >= begin && !fStep->cancelled(); i--)
+            {
+                pair<int64_t, int64_t> w = frame->getWindow(begin, end, i);
+                int64_t j = i;
 
-                        if (w.first < i)
-                            j = w.first;
+                if (w.first < i)
+                    j = w.first;
 
-                        fFunctionType->operator()(j, end, i);
-                    }
-                }
+                function->operator()(j, end, i);
+            }
+        }
+    }
+    else
+    {
+        pair<int64_t, int64_t> w;
+        pair<int64_t, int64_t> prevFrame;
+        int64_t b, e;
+        bool firstTime = true;
+
+        for (int64_t i = begin; i <= end && !fStep->cancelled(); i++)
+        {
+            w = frame->getWindow(begin, end, i);
+            b = w.first;
+            e = w.second;
+
+            if (firstTime)
+            {
+                prevFrame = w;
+            }
+
+            // UDAnF functions may have a dropValue function implemented.
+            // If they do, we can optimize by calling dropValue() for those
+            // values leaving the window and nextValue for those entering, rather
+            // than a resetData() and then iterating over the entire window.
+            // Built-in functions may have this functionality added in the future.
+            // If b > e then the frame is entirely outside of the partition
+            // and there's no values to drop
+            if (!firstTime && (b <= e) && function->dropValues(prevFrame.first, w.first))
+            {
+                // Adjust the beginning of the frame for nextValue
+                // to start where the previous frame left off.
+                b = prevFrame.second + 1;
             }
             else
             {
-                pair<int64_t, int64_t> w;
-                pair<int64_t, int64_t> prevFrame;
-                int64_t b, e;
-                bool firstTime = true;
+                // If dropValues failed or doesn't exist,
+                // calculate the entire frame.
+                function->resetData();
+            }
+            function->operator()(b, e, i); // UDAnF: Calls nextValue and evaluate
+            prevFrame = w;
+            firstTime = false;
+        }
+    }
+}
+
 
-                for (int64_t i = begin; i <= end && !fStep->cancelled(); i++)
+/* The rows are split into buckets by the hash of the partition key, so every
+   partition is in one bucket.  A bucket is sorted, cut into partitions and its
+   partitions evaluated by one thread.  The partitions end up grouped by bucket
+   rather than in key order, which no window function depends on. */
+void WindowFunction::processPartitionsInParallel(uint64_t threads)
+{
+    uint64_t rowCnt = fRowData->size();
+    uint64_t bucketCnt = threads * BUCKETS_PER_THREAD;
+    vector<uint32_t> bucketOf(rowCnt);
+    vector<uint64_t> bucketStart(bucketCnt + 1, 0);
+    vector<uint64_t> jobs;
+    uint64_t chunk = (rowCnt + threads - 1) / threads;
+
+    // hash the partition keys
+    for (uint64_t t = 0; t < threads; t++)
+    {
+        jobs.push_back(JobStep::jobstepThreadPool.invoke([this, t, chunk, rowCnt, bucketCnt, &bucketOf]
+        {
+            try
+            {
+                RowGroup rg(fRowGroup);
+                Row row(fRow);
+                uint64_t end = min(rowCnt, (t + 1) * chunk);
+
+                for (uint64_t i = t * chunk; i < end && !fStep->cancelled(); i++)
                 {
-                    w = fFrame->getWindow(begin, end, i);
-                    b = w.first;
-                    e = w.second;
-
-                    if (firstTime)
-                    {
-                        prevFrame = w;
-                    }
-
-                    // UDAnF functions may have a dropValue function implemented.
-                    // If they do, we can optimize by calling dropValue() for those
-                    // values leaving the window and nextValue for those entering, rather
-                    // than a resetData() and then iterating over the entire window.
-                    // Built-in functions may have this functionality added in the future.
-                    // If b > e then the frame is entirely outside of the partition
-                    // and there's no values to drop
-                    if (!firstTime && (b <= e) && fFunctionType->dropValues(prevFrame.first, w.first))
-                    {
-                        // Adjust the beginning of the frame for nextValue
-                        // to start where the previous frame left off.
-                        b = prevFrame.second + 1;
-                    }
-                    else
-                    {
-                        // If dropValues failed or doesn't exist,
-                        // calculate the entire frame.
-                        fFunctionType->resetData();
-                    }
-                    fFunctionType->operator()(b, e, i); // UDAnF: Calls nextValue and evaluate
-                    prevFrame = w;
-                    firstTime = false;
+                    fStep->getPointer((*fRowData)[i], rg, row);
+                    bucketOf[i] = fPartitionBy->hash(row) % bucketCnt;
                 }
             }
-        }
+            catch (...)
+            {
+                fStep->handleException(std::current_exception(),
+                                       logging::ERR_EXECUTE_WINDOW_FUNCTION,
+                                       logging::ERR_WF_DATA_SET_TOO_BIG,
+                                       "WindowFunction::processPartitionsInParallel()");
+            }
+        }));
     }
-    catch (...)
+
+    JobStep::jobstepThreadPool.join(jobs);
+
+    if (fStep->cancelled())
+        return;
+
+    // group the rows by bucket
+    for (uint64_t i = 0; i < rowCnt; i++)
+        bucketStart[bucketOf[i] + 1]++;
+
+    for (uint64_t b = 0; b < bucketCnt; b++)
+        bucketStart[b + 1] += bucketStart[b];
+
     {
-        fStep->handleException(std::current_exception(),
-                        logging::ERR_EXECUTE_WINDOW_FUNCTION,
-                        logging::ERR_WF_DATA_SET_TOO_BIG,
-                        "WindowFunction::operator()");
+        vector<uint64_t> next(bucketStart.begin(), bucketStart.end() - 1);
+        boost::shared_ptr<vector<RowPosition> > grouped(new vector<RowPosition>(rowCnt));
+
+        for (uint64_t i = 0; i < rowCnt; i++)
+            (*grouped)[next[bucketOf[i]]++] = (*fRowData)[i];
+
+        fRowData = grouped;
+    }
+
+    vector<uint32_t>().swap(bucketOf);
+
+    // sort and evaluate the buckets
+    volatile uint64_t nextBucket = 0;
+    jobs.clear();
+
+    for (uint64_t t = 0; t < threads; t++)
+    {
+        jobs.push_back(JobStep::jobstepThreadPool.invoke([this, bucketCnt, &bucketStart, &nextBucket]
+        {
+            try
+            {
+                processBuckets(bucketStart, bucketCnt, &nextBucket);
+            }
+            catch (...)
+            {
+                fStep->handleException(std::current_exception(),
+                                       logging::ERR_EXECUTE_WINDOW_FUNCTION,
+                                       logging::ERR_WF_DATA_SET_TOO_BIG,
+                                       "WindowFunction::processPartitionsInParallel()");
+            }
+        }));
+    }
+
+    JobStep::jobstepThreadPool.join(jobs);
+}
+
+
+namespace
+{
+
+struct SortKey
+{
+    Row::Pointer fData;
+    RowPosition  fPos;
+};
+
+struct SortCancelled { };
+
+// compares the row pointers resolved before the sort, and gives up if the query is cancelled
+class SortKeyLess
+{
+public:
+    SortKeyLess(CompareRule& rule, WindowFunctionStep* step) : fRule(&rule), fStep(step), fCount(0) { }
+
+    bool operator()(const SortKey& a, const SortKey& b)
+    {
+        if ((++fCount & 0xffff) == 0 && fStep->cancelled())
+            throw SortCancelled();
+
+        return fRule->less(a.fData, b.fData);
+    }
+
+private:
+    CompareRule*        fRule;
+    WindowFunctionStep* fStep;
+    uint64_t            fCount;
+};
+
+}
+
+void WindowFunction::processBuckets(const vector<uint64_t>& bucketStart, uint64_t bucketCnt,
+                                    volatile uint64_t* nextBucket)
+{
+    // the comparators, the function and the frame keep rows of their own
+    RowGroup rg(fRowGroup);
+    Row row(fRow);
+    IdbCompare orderByRows;
+    orderByRows.initialize(fRowGroup);
+    CompareRule orderBy(fOrderBy->rule());
+    orderBy.fIdbCompare = &orderByRows;
+    EqualCompData partitionBy(*fPartitionBy);
+    boost::shared_ptr<WindowFunctionType> function(fFunctionType->clone());
+    boost::shared_ptr<WindowFrame> frame(fFrame->clone());
+    boost::shared_ptr<EqualCompData> peer;
+
+    if (fFunctionType->peer())
+    {
+        peer.reset(new EqualCompData(*fFunctionType->peer()));
+        function->peer(peer);
+    }
+
+    if (fFrame->upper()->peer())
+        frame->upper()->peer(boost::shared_ptr<EqualCompData>(new EqualCompData(*fFrame->upper()->peer())));
+
+    if (fFrame->lower()->peer())
+        frame->lower()->peer(boost::shared_ptr<EqualCompData>(new EqualCompData(*fFrame->lower()->peer())));
+
+    function->setCallback(fStep);
+    function->setRowData(fRowData);
+    function->setRowMetaData(rg, row);
+    frame->setCallback(fStep);
+    frame->setRowData(fRowData);
+    frame->setRowMetaData(rg, row);
+
+    vector<SortKey> keys;
+    uint64_t b;
+
+    while ((b = atomicops::atomicInc(nextBucket) - 1) < bucketCnt && !fStep->cancelled())
+    {
+        int64_t begin = bucketStart[b];
+        int64_t end = bucketStart[b + 1];
+
+        if (begin == end)
+            continue;
+
+        if (orderBy.fCompares.size() > 0)
+        {
+            keys.resize(end - begin);
+
+            for (int64_t i = begin; i < end; i++)
+            {
+                keys[i - begin].fPos = (*fRowData)[i];
+                keys[i - begin].fData = fStep->getPointer(keys[i - begin].fPos, rg, row);
+            }
+
+            try
+            {
+                std::sort(keys.begin(), keys.end(), SortKeyLess(orderBy, fStep));
+            }
+            catch (SortCancelled&)
+            {
+                return;
+            }
+
+            for (int64_t i = begin; i < end; i++)
+                (*fRowData)[i] = keys[i - begin].fPos;
+        }
+
+        // cut the bucket into partitions
+        int64_t first = begin;
+
+        for (int64_t i = begin + 1; i <= end && !fStep->cancelled(); i++)
+        {
+            if (i < end)
+            {
+                Row::Pointer prev = fStep->getPointer((*fRowData)[i - 1], rg, row);
+
+                if (partitionBy(prev, fStep->getPointer((*fRowData)[i], rg, row)))
+                    continue;
+            }
+
+            pair<int64_t, int64_t> partition(first, i - 1);
+            processPartition(function.get(), frame.get(), partition);
+            first = i;
+        }
     }
 }
 
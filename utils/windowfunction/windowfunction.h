@@ -84,6 +84,13 @@ protected:
     // cancellable sort function
     void sort(std::vector<joblist::RowPosition>::iterator, uint64_t);
 
+    // evaluates the function for the rows of one partition
+    void processPartition(WindowFunctionType*, WindowFrame*, std::pair<int64_t, int64_t>&);
+
+    // splits the rows by partition key and works on the parts in parallel
+    void processPartitionsInParallel(uint64_t threads);
+    void processBuckets(const std::vector<uint64_t>&, uint64_t, volatile uint64_t*);
+
     // special window frames
     void processUnboundedWindowFrame1();
     void processUnboundedWindowFrame2();
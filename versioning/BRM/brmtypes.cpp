@@ -30,6 +30,8 @@
 #include <cstring>
 #include <unistd.h>
 #include <sstream>
+#include <stdexcept>
+#include <boost/scoped_ptr.hpp>
 
 #include "calpontsystemcatalog.h"
 #include "bytestream.h"
@@ -285,6 +287,42 @@ void log_errno(const string& msg, logging::LOG_TYPE level)
     }
 }
 
+void saveImage(const string& filename, const vector<char>& image)
+{
+    const char* filename_p = filename.c_str();
+    boost::scoped_ptr<IDBDataFile> out(IDBDataFile::open(
+                                           IDBPolicy::getType(filename_p, IDBPolicy::WRITEENG),
+                                           filename_p, "wb", IDBDataFile::USE_VBUF));
+
+    if (!out)
+    {
+        log_errno("saveImage(): open " + filename);
+        throw runtime_error("saveImage(): failed to open " + filename);
+    }
+
+    size_t progress = 0;
+    ssize_t err;
+
+    while (progress < image.size())
+    {
+        err = out->write(&image[progress], image.size() - progress);
+
+        if (err <= 0)
+        {
+            log_errno("saveImage(): write " + filename);
+            throw runtime_error("saveImage(): failed to write " + filename);
+        }
+
+        progress += err;
+    }
+
+    if (out->flush() != 0)
+    {
+        log_errno("saveImage(): flush " + filename);
+        throw runtime_error("saveImage(): failed to flush " + filename);
+    }
+}
+
 //------------------------------------------------------------------------------
 // Map a BRM error code to an error string.
 //------------------------------------------------------------------------------
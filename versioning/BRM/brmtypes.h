@@ -456,6 +456,10 @@ EXPORT void log(const std::string& msg, logging::LOG_TYPE = logging::LOG_TYPE_CR
 EXPORT void log_errno(const std::string& msg, logging::LOG_TYPE = logging::LOG_TYPE_CRITICAL);
 EXPORT void errString( int rc, std::string& errMsg );
 
+/* Writes the image of a structure made by ExtentMap, VBBM or VSS ::save() to
+   filename.  Throws runtime_error on failure. */
+EXPORT void saveImage(const std::string& filename, const std::vector<char>& image);
+
 const struct timespec FIVE_MIN_TIMEOUT = {300, 0};
 
 /* Function identifiers used for master-slave communication.
@@ -280,6 +280,160 @@ FreeListImpl::FreeListImpl(unsigned key, off_t size, bool readOnly) :
 {
 }
 
+//------------------------------------------------------------------------------
+// ExtentMapIndex methods
+//------------------------------------------------------------------------------
+
+ExtentMapIndex::ExtentMapIndex(const EMEntry* entries, int count, const MSTEntry& shminfo) :
+    fShmkey(shminfo.tableShmkey),
+    fChangeSeq(shminfo.changeSeq)
+{
+    IndexedEntry empty = {0, 0, false};
+    fEntries.resize(count, empty);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (entries[i].range.size != 0)
+            addEntry(entries[i], i);
+    }
+}
+
+bool ExtentMapIndex::update(const EMEntry* entries, int count, const MSTEntry& shminfo)
+{
+    uint32_t changes = shminfo.changeSeq - fChangeSeq;
+
+    if (changes > MSTEntry::CHANGE_LOG_SIZE || count < (int) fEntries.size())
+        return false;
+
+    // a new segment is only expected after it was grown
+    bool grown = false;
+
+    for (uint32_t seq = fChangeSeq; seq != shminfo.changeSeq; seq++)
+    {
+        int emIndex = shminfo.changeLog[seq % MSTEntry::CHANGE_LOG_SIZE];
+
+        if (emIndex == MSTEntry::SEGMENT_GROWN)
+            grown = true;
+        else if (emIndex < 0 || emIndex >= count)
+            return false;
+    }
+
+    if (fShmkey != shminfo.tableShmkey && !grown)
+        return false;
+
+    IndexedEntry empty = {0, 0, false};
+    fEntries.resize(count, empty);
+
+    for (uint32_t seq = fChangeSeq; seq != shminfo.changeSeq; seq++)
+    {
+        int emIndex = shminfo.changeLog[seq % MSTEntry::CHANGE_LOG_SIZE];
+
+        if (emIndex == MSTEntry::SEGMENT_GROWN)
+            continue;
+
+        removeEntry(emIndex);
+
+        if (entries[emIndex].range.size != 0)
+            addEntry(entries[emIndex], emIndex);
+    }
+
+    fShmkey = shminfo.tableShmkey;
+    fChangeSeq = shminfo.changeSeq;
+    return true;
+}
+
+void ExtentMapIndex::addEntry(const EMEntry& entry, int emIndex)
+{
+    LBIDRangeEntry e;
+    e.last = entry.range.start + (static_cast<LBID_t>(entry.range.size) * 1024) - 1;
+    e.emIndex = emIndex;
+    fByLBID[entry.range.start] = e;
+
+    // keep the OID's entries in array order
+    vector<int>& oidEntries = fByOID[entry.fileID];
+    oidEntries.insert(lower_bound(oidEntries.begin(), oidEntries.end(), emIndex), emIndex);
+
+    fEntries[emIndex].start = entry.range.start;
+    fEntries[emIndex].OID = entry.fileID;
+    fEntries[emIndex].live = true;
+}
+
+void ExtentMapIndex::removeEntry(int emIndex)
+{
+    IndexedEntry& indexed = fEntries[emIndex];
+
+    if (!indexed.live)
+        return;
+
+    map<LBID_t, LBIDRangeEntry>::iterator lbidIt = fByLBID.find(indexed.start);
+
+    if (lbidIt != fByLBID.end() && lbidIt->second.emIndex == emIndex)
+        fByLBID.erase(lbidIt);
+
+    tr1::unordered_map<int, vector<int> >::iterator oidIt = fByOID.find(indexed.OID);
+
+    if (oidIt != fByOID.end())
+    {
+        vector<int>& oidEntries = oidIt->second;
+        vector<int>::iterator it = lower_bound(oidEntries.begin(), oidEntries.end(), emIndex);
+
+        if (it != oidEntries.end() && *it == emIndex)
+            oidEntries.erase(it);
+
+        if (oidEntries.empty())
+            fByOID.erase(oidIt);
+    }
+
+    indexed.live = false;
+}
+
+int ExtentMapIndex::findLBID(LBID_t lbid) const
+{
+    // ranges don't overlap, so the last one starting at or before lbid is
+    // the only one that can contain it
+    map<LBID_t, LBIDRangeEntry>::const_iterator it = fByLBID.upper_bound(lbid);
+
+    if (it == fByLBID.begin())
+        return -1;
+
+    --it;
+    return (lbid <= it->second.last ? it->second.emIndex : -1);
+}
+
+const vector<int>& ExtentMapIndex::findOID(int OID) const
+{
+    tr1::unordered_map<int, vector<int> >::const_iterator it = fByOID.find(OID);
+
+    if (it == fByOID.end())
+        return fNoExtents;
+
+    return it->second;
+}
+
+/*static*/
+boost::mutex ExtentMap::fIndexMutex;
+
+/*static*/
+boost::shared_ptr<ExtentMapIndex> ExtentMap::fIndex;
+
+boost::shared_ptr<const ExtentMapIndex> ExtentMap::getIndex()
+{
+    boost::mutex::scoped_lock lk(fIndexMutex);
+    int count = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+
+    if (!fIndex || !fIndex->update(fExtentMap, count, *fEMShminfo))
+        fIndex.reset(new ExtentMapIndex(fExtentMap, count, *fEMShminfo));
+
+    return fIndex;
+}
+
+void ExtentMap::logEMChange(int emIndex)
+{
+    fEMShminfo->changeLog[fEMShminfo->changeSeq % MSTEntry::CHANGE_LOG_SIZE] = emIndex;
+    fEMShminfo->changeSeq++;
+    getIndex();
+}
+
 ExtentMap::ExtentMap()
 {
     fExtentMap = NULL;
@@ -328,68 +482,53 @@ ExtentMap::~ExtentMap()
 
 int ExtentMap::_markInvalid(const LBID_t lbid, const execplan::CalpontSystemCatalog::ColDataType colDataType)
 {
-    int entries;
-    int i;
-    LBID_t lastBlock;
+    int i = getIndex()->findLBID(lbid);
 
-    entries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    if (i < 0)
+        throw logic_error("ExtentMap::markInvalid(): lbid isn't allocated");
 
-    for (i = 0; i < entries; i++)
-    {
-        lastBlock = fExtentMap[i].range.start +
-                    (static_cast<LBID_t>(fExtentMap[i].range.size) * 1024) - 1;
+    makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
+    fExtentMap[i].partition.cprange.isValid = CP_UPDATING;
 
-        if (fExtentMap[i].range.size != 0)
+    if (isUnsigned(colDataType))
+    {
+        if (fExtentMap[i].colWid != datatypes::MAXDECIMALWIDTH)
         {
-            if (lbid >= fExtentMap[i].range.start && lbid <= lastBlock)
-            {
-                makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
-                fExtentMap[i].partition.cprange.isValid = CP_UPDATING;
-
-                if (isUnsigned(colDataType))
-                {
-                    if (fExtentMap[i].colWid != datatypes::MAXDECIMALWIDTH)
-                    {
-                        fExtentMap[i].partition.cprange.loVal = numeric_limits<uint64_t>::max();
-                        fExtentMap[i].partition.cprange.hiVal = numeric_limits<uint64_t>::min();
-                    }
-                    else
-                    {
-                        fExtentMap[i].partition.cprange.bigLoVal = -1; // XXX: unsigned wide decimals do not exceed rang of signed wide decimals.
-                        fExtentMap[i].partition.cprange.bigHiVal = 0;
-                    }
-                }
-                else
-                {
-                    if (fExtentMap[i].colWid != datatypes::MAXDECIMALWIDTH)
-                    {
-                        fExtentMap[i].partition.cprange.loVal = numeric_limits<int64_t>::max();
-                        fExtentMap[i].partition.cprange.hiVal = numeric_limits<int64_t>::min();
-                    }
-                    else
-                    {
-                        utils::int128Max(fExtentMap[i].partition.cprange.bigLoVal);
-                        utils::int128Min(fExtentMap[i].partition.cprange.bigHiVal);
-                    }
-                }
-
-                incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
-#ifdef BRM_DEBUG
-                ostringstream os;
-                os << "ExtentMap::_markInvalid(): casual partitioning update: firstLBID=" <<
-                   fExtentMap[i].range.start << " lastLBID=" << fExtentMap[i].range.start +
-                   fExtentMap[i].range.size * 1024 - 1 << " OID=" << fExtentMap[i].fileID <<
-                   " min=" << fExtentMap[i].partition.cprange.loVal <<
-                   " max=" << fExtentMap[i].partition.cprange.hiVal <<
-                   "seq=" << fExtentMap[i].partition.cprange.sequenceNum;
-                log(os.str(), logging::LOG_TYPE_DEBUG);
-#endif
-                return 0;
-            }
+            fExtentMap[i].partition.cprange.loVal = numeric_limits<uint64_t>::max();
+            fExtentMap[i].partition.cprange.hiVal = numeric_limits<uint64_t>::min();
+        }
+        else
+        {
+            fExtentMap[i].partition.cprange.bigLoVal = -1; // XXX: unsigned wide decimals do not exceed rang of signed wide decimals.
+            fExtentMap[i].partition.cprange.bigHiVal = 0;
+        }
+    }
+    else
+    {
+        if (fExtentMap[i].colWid != datatypes::MAXDECIMALWIDTH)
+        {
+            fExtentMap[i].partition.cprange.loVal = numeric_limits<int64_t>::max();
+            fExtentMap[i].partition.cprange.hiVal = numeric_limits<int64_t>::min();
+        }
+        else
+        {
+            utils::int128Max(fExtentMap[i].partition.cprange.bigLoVal);
+            utils::int128Min(fExtentMap[i].partition.cprange.bigHiVal);
         }
     }
 
-    throw logic_error("ExtentMap::markInvalid(): lbid isn't allocated");
+    incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
+#ifdef BRM_DEBUG
+    ostringstream os;
+    os << "ExtentMap::_markInvalid(): casual partitioning update: firstLBID=" <<
+       fExtentMap[i].range.start << " lastLBID=" << fExtentMap[i].range.start +
+       fExtentMap[i].range.size * 1024 - 1 << " OID=" << fExtentMap[i].fileID <<
+       " min=" << fExtentMap[i].partition.cprange.loVal <<
+       " max=" << fExtentMap[i].partition.cprange.hiVal <<
+       "seq=" << fExtentMap[i].partition.cprange.sequenceNum;
+    log(os.str(), logging::LOG_TYPE_DEBUG);
+#endif
+    return 0;
 }
 
 int ExtentMap::markInvalid(const LBID_t lbid,
@@ -508,9 +647,7 @@ int ExtentMap::setMaxMin(const LBID_t lbid,
     }
 
 #endif
-    int entries;
     int i;
-    LBID_t lastBlock;
     int32_t curSequence;
 
 #ifdef BRM_DEBUG
@@ -521,59 +658,51 @@ int ExtentMap::setMaxMin(const LBID_t lbid,
 #endif
 
     grabEMEntryTable(WRITE);
-    entries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    i = getIndex()->findLBID(lbid);
 
-    for (i = 0; i < entries; i++)
+    if (i >= 0)
     {
-        if (fExtentMap[i].range.size != 0)
-        {
-            lastBlock = fExtentMap[i].range.start +
-                        (static_cast<LBID_t>(fExtentMap[i].range.size) * 1024) - 1;
-            curSequence = fExtentMap[i].partition.cprange.sequenceNum;
+        curSequence = fExtentMap[i].partition.cprange.sequenceNum;
 
-            if (lbid >= fExtentMap[i].range.start && lbid <= lastBlock)
-            {
 #ifdef BRM_DEBUG
 
-                if (firstNode)
-                {
-                    ostringstream os;
-                    os << "ExtentMap::setMaxMin(): casual partitioning update: firstLBID=" <<
-                       fExtentMap[i].range.start << " lastLBID=" << fExtentMap[i].range.start +
-                       fExtentMap[i].range.size * 1024 - 1 << " OID=" << fExtentMap[i].fileID <<
-                       " min=" << min << " max=" << max << "seq=" << seqNum;
-                    log(os.str(), logging::LOG_TYPE_DEBUG);
-                }
+        if (firstNode)
+        {
+            ostringstream os;
+            os << "ExtentMap::setMaxMin(): casual partitioning update: firstLBID=" <<
+               fExtentMap[i].range.start << " lastLBID=" << fExtentMap[i].range.start +
+               fExtentMap[i].range.size * 1024 - 1 << " OID=" << fExtentMap[i].fileID <<
+               " min=" << min << " max=" << max << "seq=" << seqNum;
+            log(os.str(), logging::LOG_TYPE_DEBUG);
+        }
 
 #endif
 
-                if (curSequence == seqNum)
-                {
-                    makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
-                    fExtentMap[i].partition.cprange.hiVal = max;
-                    fExtentMap[i].partition.cprange.loVal = min;
-                    fExtentMap[i].partition.cprange.isValid = CP_VALID;
-                    incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
-                    return 0;
-                }
-                //special val to indicate a reset--used by editem -c.
-                //Also used by COMMIT and ROLLBACK to invalidate CP.
-                else if (seqNum == SEQNUM_MARK_INVALID)
-                {
-                    makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
-                    // We set hiVal and loVal to correct values for signed or unsigned
-                    // during the markinvalid step, which sets the invalid variable to CP_UPDATING.
-                    // During this step (seqNum == SEQNUM_MARK_INVALID), the min and max passed in are not reliable
-                    // and should not be used.
-                    fExtentMap[i].partition.cprange.isValid = CP_INVALID;
-                    incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
-                    return 0;
-                }
-                else
-                {
-                    return 0;
-                }
-            }
+        if (curSequence == seqNum)
+        {
+            makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
+            fExtentMap[i].partition.cprange.hiVal = max;
+            fExtentMap[i].partition.cprange.loVal = min;
+            fExtentMap[i].partition.cprange.isValid = CP_VALID;
+            incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
+            return 0;
+        }
+        //special val to indicate a reset--used by editem -c.
+        //Also used by COMMIT and ROLLBACK to invalidate CP.
+        else if (seqNum == SEQNUM_MARK_INVALID)
+        {
+            makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
+            // We set hiVal and loVal to correct values for signed or unsigned
+            // during the markinvalid step, which sets the invalid variable to CP_UPDATING.
+            // During this step (seqNum == SEQNUM_MARK_INVALID), the min and max passed in are not reliable
+            // and should not be used.
+            fExtentMap[i].partition.cprange.isValid = CP_INVALID;
+            incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
+            return 0;
+        }
+        else
+        {
+            return 0;
         }
     }
 
@@ -622,7 +751,6 @@ void ExtentMap::setExtentsMaxMin(const CPMaxMinMap_t& cpMap, bool firstNode, boo
     }
 
 #endif
-    int entries;
     int i;
     int32_t curSequence;
     const int32_t extentsToUpdate = cpMap.size();
@@ -638,67 +766,84 @@ void ExtentMap::setExtentsMaxMin(const CPMaxMinMap_t& cpMap, bool firstNode, boo
     if (useLock)
         grabEMEntryTable(WRITE);
 
-    entries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    boost::shared_ptr<const ExtentMapIndex> index = getIndex();
 
-    for (i = 0; i < entries; i++)
+    for (it = cpMap.begin(); it != cpMap.end(); ++it)
     {
-        if (fExtentMap[i].range.size != 0)
+        i = index->findLBID(it->first);
+
+        if (i >= 0 && fExtentMap[i].range.start == it->first)
         {
-            it = cpMap.find(fExtentMap[i].range.start);
+            curSequence = fExtentMap[i].partition.cprange.sequenceNum;
 
-            if (it != cpMap.end())
+            if (curSequence == it->second.seqNum &&
+                    fExtentMap[i].partition.cprange.isValid == CP_INVALID)
             {
-                curSequence = fExtentMap[i].partition.cprange.sequenceNum;
-
-                if (curSequence == it->second.seqNum &&
-                        fExtentMap[i].partition.cprange.isValid == CP_INVALID)
+                makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
+                if (it->second.isBinaryColumn)
                 {
-                    makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
-                    if (it->second.isBinaryColumn)
-                    {
-                        fExtentMap[i].partition.cprange.bigHiVal = it->second.bigMax;
-                        fExtentMap[i].partition.cprange.bigLoVal = it->second.bigMin;
-                    }
-                    else
-                    {
-                        fExtentMap[i].partition.cprange.hiVal = it->second.max;
-                        fExtentMap[i].partition.cprange.loVal = it->second.min;
-                    }
-                    fExtentMap[i].partition.cprange.isValid = CP_VALID;
-                    incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
-                    extentsUpdated++;
+                    fExtentMap[i].partition.cprange.bigHiVal = it->second.bigMax;
+                    fExtentMap[i].partition.cprange.bigLoVal = it->second.bigMin;
+                }
+                else
+                {
+                    fExtentMap[i].partition.cprange.hiVal = it->second.max;
+                    fExtentMap[i].partition.cprange.loVal = it->second.min;
+                }
+                fExtentMap[i].partition.cprange.isValid = CP_VALID;
+                incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
+                extentsUpdated++;
 #ifdef BRM_DEBUG
 
-                    if (firstNode)
-                    {
-                        ostringstream os;
-                        os << "ExtentMap::setExtentsMaxMin(): casual partitioning update: firstLBID=" <<
-                           fExtentMap[i].range.start << " lastLBID=" << fExtentMap[i].range.start +
-                           fExtentMap[i].range.size * 1024 - 1 << " OID=" << fExtentMap[i].fileID <<
-                           " min=" << it->second.min << " max=" <<
-                           it->second.max << " seq=" <<
-                           it->second.seqNum;
-                        log(os.str(), logging::LOG_TYPE_DEBUG);
-                    }
+                if (firstNode)
+                {
+                    ostringstream os;
+                    os << "ExtentMap::setExtentsMaxMin(): casual partitioning update: firstLBID=" <<
+                       fExtentMap[i].range.start << " lastLBID=" << fExtentMap[i].range.start +
+                       fExtentMap[i].range.size * 1024 - 1 << " OID=" << fExtentMap[i].fileID <<
+                       " min=" << it->second.min << " max=" <<
+                       it->second.max << " seq=" <<
+                       it->second.seqNum;
+                    log(os.str(), logging::LOG_TYPE_DEBUG);
+                }
 
 #endif
+            }
+            //special val to indicate a reset -- ignore the min/max
+            else if (it->second.seqNum == SEQNUM_MARK_INVALID)
+            {
+                makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
+                // We set hiVal and loVal to correct values for signed or unsigned
+                // during the markinvalid step, which sets the invalid variable to CP_UPDATING.
+                // During this step (seqNum == SEQNUM_MARK_INVALID), the min and max passed in are not reliable
+                // and should not be used.
+                fExtentMap[i].partition.cprange.isValid = CP_INVALID;
+                incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
+                extentsUpdated++;
+            }
+            //special val to indicate a reset -- assign the min/max
+            else if (it->second.seqNum == SEQNUM_MARK_INVALID_SET_RANGE)
+            {
+                makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
+                if (it->second.isBinaryColumn)
+                {
+                    fExtentMap[i].partition.cprange.bigHiVal = it->second.bigMax;
+                    fExtentMap[i].partition.cprange.bigLoVal = it->second.bigMin;
                 }
-                //special val to indicate a reset -- ignore the min/max
-                else if (it->second.seqNum == SEQNUM_MARK_INVALID)
+                else
                 {
-                    makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
-                    // We set hiVal and loVal to correct values for signed or unsigned
-                    // during the markinvalid step, which sets the invalid variable to CP_UPDATING.
-                    // During this step (seqNum == SEQNUM_MARK_INVALID), the min and max passed in are not reliable
-                    // and should not be used.
-                    fExtentMap[i].partition.cprange.isValid = CP_INVALID;
-                    incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
-                    extentsUpdated++;
+                    fExtentMap[i].partition.cprange.hiVal = it->second.max;
+                    fExtentMap[i].partition.cprange.loVal = it->second.min;
                 }
-                //special val to indicate a reset -- assign the min/max
-                else if (it->second.seqNum == SEQNUM_MARK_INVALID_SET_RANGE)
+                fExtentMap[i].partition.cprange.isValid = CP_INVALID;
+                incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
+                extentsUpdated++;
+            }
+            else if (it->second.seqNum == SEQNUM_MARK_UPDATING_INVALID_SET_RANGE)
+            {
+                makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
+                if (fExtentMap[i].partition.cprange.isValid == CP_UPDATING)
                 {
-                    makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
                     if (it->second.isBinaryColumn)
                     {
                         fExtentMap[i].partition.cprange.bigHiVal = it->second.bigMax;
@@ -710,39 +855,19 @@ void ExtentMap::setExtentsMaxMin(const CPMaxMinMap_t& cpMap, bool firstNode, boo
                         fExtentMap[i].partition.cprange.loVal = it->second.min;
                     }
                     fExtentMap[i].partition.cprange.isValid = CP_INVALID;
-                    incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
-                    extentsUpdated++;
-                }
-                else if (it->second.seqNum == SEQNUM_MARK_UPDATING_INVALID_SET_RANGE)
-                {
-                    makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
-                    if (fExtentMap[i].partition.cprange.isValid == CP_UPDATING)
-                    {
-                        if (it->second.isBinaryColumn)
-                        {
-                            fExtentMap[i].partition.cprange.bigHiVal = it->second.bigMax;
-                            fExtentMap[i].partition.cprange.bigLoVal = it->second.bigMin;
-                        }
-                        else
-                        {
-                            fExtentMap[i].partition.cprange.hiVal = it->second.max;
-                            fExtentMap[i].partition.cprange.loVal = it->second.min;
-                        }
-                        fExtentMap[i].partition.cprange.isValid = CP_INVALID;
-                    }
-                    incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
-                    extentsUpdated++;
-                }
-                // else sequence has changed since start of the query.  Don't update the EM entry.
-                else
-                {
-                    extentsUpdated++;
                 }
+                incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
+                extentsUpdated++;
+            }
+            // else sequence has changed since start of the query.  Don't update the EM entry.
+            else
+            {
+                extentsUpdated++;
+            }
 
-                if (extentsUpdated == extentsToUpdate)
-                {
-                    return;
-                }
+            if (extentsUpdated == extentsToUpdate)
+            {
+                return;
             }
         }
     }
@@ -751,14 +876,9 @@ void ExtentMap::setExtentsMaxMin(const CPMaxMinMap_t& cpMap, bool firstNode, boo
     oss << "ExtentMap::setExtentsMaxMin(): LBIDs not allocated:";
     for (it = cpMap.begin(); it != cpMap.end(); it ++)
     {
-        for (i = 0; i < entries; i++)
-        {
-            if (fExtentMap[i].range.start == it->first)
-            {
-                break;
-            }
-        }
-        if (i < entries)
+        i = index->findLBID(it->first);
+
+        if (i >= 0 && fExtentMap[i].range.start == it->first)
         {
             continue;
         }
@@ -845,137 +965,107 @@ void ExtentMap::mergeExtentsMaxMin(CPMaxMinMergeMap_t& cpMap, bool useLock)
     if (useLock)
         grabEMEntryTable(WRITE);
 
-    int entries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    boost::shared_ptr<const ExtentMapIndex> index = getIndex();
 
-    for (int i = 0; i < entries; i++)  			// loop through all extents
+    for (it = cpMap.begin(); it != cpMap.end(); ++it)
     {
-        if (fExtentMap[i].range.size != 0)  	// find eligible extents
-        {
-            it = cpMap.find(fExtentMap[i].range.start);
+        int i = index->findLBID(it->first);
 
-            if (it != cpMap.end())
-            {
+        if (i >= 0 && fExtentMap[i].range.start == it->first)
+        {
 #ifdef BRM_DEBUG
-                ostringstream os;
-                os << "ExtentMap::mergeExtentsMaxMin(): casual partitioning update: firstLBID=" <<
-                   fExtentMap[i].range.start << " lastLBID=" << fExtentMap[i].range.start +
-                   fExtentMap[i].range.size * 1024 - 1 << " OID=" << fExtentMap[i].fileID <<
-                   " hiVal=" << fExtentMap[i].partition.cprange.hiVal <<
-                   " loVal=" << fExtentMap[i].partition.cprange.loVal <<
-                   " min=" << it->second.min << " max=" << it->second.max <<
-                   " seq=" << it->second.seqNum;
-                log(os.str(), logging::LOG_TYPE_DEBUG);
+            ostringstream os;
+            os << "ExtentMap::mergeExtentsMaxMin(): casual partitioning update: firstLBID=" <<
+               fExtentMap[i].range.start << " lastLBID=" << fExtentMap[i].range.start +
+               fExtentMap[i].range.size * 1024 - 1 << " OID=" << fExtentMap[i].fileID <<
+               " hiVal=" << fExtentMap[i].partition.cprange.hiVal <<
+               " loVal=" << fExtentMap[i].partition.cprange.loVal <<
+               " min=" << it->second.min << " max=" << it->second.max <<
+               " seq=" << it->second.seqNum;
+            log(os.str(), logging::LOG_TYPE_DEBUG);
 #endif
 
-                bool isBinaryColumn = it->second.colWidth > 8;
+            bool isBinaryColumn = it->second.colWidth > 8;
 
-                switch (fExtentMap[i].partition.cprange.isValid)
+            switch (fExtentMap[i].partition.cprange.isValid)
+            {
+                // Merge input min/max with current min/max
+                case CP_VALID:
                 {
-                    // Merge input min/max with current min/max
-                    case CP_VALID:
+                    if ((!isBinaryColumn && !isValidCPRange(it->second.max, it->second.min, it->second.type)) ||
+                        (isBinaryColumn && !isValidCPRange(it->second.bigMax, it->second.bigMin, it->second.type)))
                     {
-                        if ((!isBinaryColumn && !isValidCPRange(it->second.max, it->second.min, it->second.type)) ||
-                            (isBinaryColumn && !isValidCPRange(it->second.bigMax, it->second.bigMin, it->second.type)))
-                        {
-                            break;
-                        }
+                        break;
+                    }
 
-                        makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
+                    makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
 
-                        // We check the validity of the current min/max,
-                        // because isValid could be CP_VALID for an extent
-                        // having all NULL values, in which case the current
-                        // min/max needs to be set instead of merged.
+                    // We check the validity of the current min/max,
+                    // because isValid could be CP_VALID for an extent
+                    // having all NULL values, in which case the current
+                    // min/max needs to be set instead of merged.
 
-                        if ((!isBinaryColumn && isValidCPRange(fExtentMap[i].partition.cprange.hiVal, fExtentMap[i].partition.cprange.loVal, it->second.type)) ||
-                            (isBinaryColumn && isValidCPRange(fExtentMap[i].partition.cprange.bigHiVal, fExtentMap[i].partition.cprange.bigLoVal, it->second.type)))
+                    if ((!isBinaryColumn && isValidCPRange(fExtentMap[i].partition.cprange.hiVal, fExtentMap[i].partition.cprange.loVal, it->second.type)) ||
+                        (isBinaryColumn && isValidCPRange(fExtentMap[i].partition.cprange.bigHiVal, fExtentMap[i].partition.cprange.bigLoVal, it->second.type)))
+                    {
+                        // Swap byte order to do binary string comparison
+                        if (isCharType(it->second.type))
+                        {
+                            uint64_t newMinVal =
+                                static_cast<uint64_t>( uint64ToStr(
+                                                          static_cast<uint64_t>(it->second.min)));
+                            uint64_t newMaxVal =
+                                static_cast<uint64_t>( uint64ToStr(
+                                                          static_cast<uint64_t>(it->second.max)));
+                            uint64_t oldMinVal =
+                                static_cast<uint64_t>( uint64ToStr(
+                                                          static_cast<uint64_t>(
+                                                              fExtentMap[i].partition.cprange.loVal)) );
+                            uint64_t oldMaxVal =
+                                static_cast<uint64_t>( uint64ToStr(
+                                                          static_cast<uint64_t>(
+                                                              fExtentMap[i].partition.cprange.hiVal)) );
+
+                            if (newMinVal < oldMinVal)
+                                fExtentMap[i].partition.cprange.loVal =
+                                    it->second.min;
+
+                            if (newMaxVal > oldMaxVal)
+                                fExtentMap[i].partition.cprange.hiVal =
+                                    it->second.max;
+                        }
+                        else if (isUnsigned(it->second.type))
                         {
-                            // Swap byte order to do binary string comparison
-                            if (isCharType(it->second.type))
+                            if (!isBinaryColumn)
                             {
-                                uint64_t newMinVal =
-                                    static_cast<uint64_t>( uint64ToStr(
-                                                              static_cast<uint64_t>(it->second.min)));
-                                uint64_t newMaxVal =
-                                    static_cast<uint64_t>( uint64ToStr(
-                                                              static_cast<uint64_t>(it->second.max)));
-                                uint64_t oldMinVal =
-                                    static_cast<uint64_t>( uint64ToStr(
-                                                              static_cast<uint64_t>(
-                                                                  fExtentMap[i].partition.cprange.loVal)) );
-                                uint64_t oldMaxVal =
-                                    static_cast<uint64_t>( uint64ToStr(
-                                                              static_cast<uint64_t>(
-                                                                  fExtentMap[i].partition.cprange.hiVal)) );
-
-                                if (newMinVal < oldMinVal)
+                                if (static_cast<uint64_t>(it->second.min) <
+                                        static_cast<uint64_t>(fExtentMap[i].partition.cprange.loVal))
+                                {
                                     fExtentMap[i].partition.cprange.loVal =
                                         it->second.min;
+                                }
 
-                                if (newMaxVal > oldMaxVal)
+                                if (static_cast<uint64_t>(it->second.max) >
+                                        static_cast<uint64_t>(fExtentMap[i].partition.cprange.hiVal))
+                                {
                                     fExtentMap[i].partition.cprange.hiVal =
                                         it->second.max;
-                            }
-                            else if (isUnsigned(it->second.type))
-                            {
-                                if (!isBinaryColumn)
-                                {
-                                    if (static_cast<uint64_t>(it->second.min) <
-                                            static_cast<uint64_t>(fExtentMap[i].partition.cprange.loVal))
-                                    {
-                                        fExtentMap[i].partition.cprange.loVal =
-                                            it->second.min;
-                                    }
-
-                                    if (static_cast<uint64_t>(it->second.max) >
-                                            static_cast<uint64_t>(fExtentMap[i].partition.cprange.hiVal))
-                                    {
-                                        fExtentMap[i].partition.cprange.hiVal =
-                                            it->second.max;
-                                    }
-                                }
-                                else
-                                {
-                                    if (static_cast<uint128_t>(it->second.bigMin) <
-                                            static_cast<uint128_t>(fExtentMap[i].partition.cprange.bigLoVal))
-                                    {
-                                        fExtentMap[i].partition.cprange.bigLoVal =
-                                            it->second.bigMin;
-                                    }
-
-                                    if (static_cast<uint128_t>(it->second.bigMax) >
-                                            static_cast<uint128_t>(fExtentMap[i].partition.cprange.bigHiVal))
-                                    {
-                                        fExtentMap[i].partition.cprange.bigHiVal =
-                                            it->second.bigMax;
-                                    }
                                 }
                             }
                             else
                             {
-                                if (!isBinaryColumn)
+                                if (static_cast<uint128_t>(it->second.bigMin) <
+                                        static_cast<uint128_t>(fExtentMap[i].partition.cprange.bigLoVal))
                                 {
-                                    if (it->second.min <
-                                            fExtentMap[i].partition.cprange.loVal)
-                                        fExtentMap[i].partition.cprange.loVal =
-                                            it->second.min;
-
-                                    if (it->second.max >
-                                            fExtentMap[i].partition.cprange.hiVal)
-                                        fExtentMap[i].partition.cprange.hiVal =
-                                            it->second.max;
+                                    fExtentMap[i].partition.cprange.bigLoVal =
+                                        it->second.bigMin;
                                 }
-                                else
+
+                                if (static_cast<uint128_t>(it->second.bigMax) >
+                                        static_cast<uint128_t>(fExtentMap[i].partition.cprange.bigHiVal))
                                 {
-                                    if (it->second.bigMin <
-                                            fExtentMap[i].partition.cprange.bigLoVal)
-                                        fExtentMap[i].partition.cprange.bigLoVal =
-                                            it->second.bigMin;
-
-                                    if (it->second.bigMax >
-                                            fExtentMap[i].partition.cprange.bigHiVal)
-                                        fExtentMap[i].partition.cprange.bigHiVal =
-                                            it->second.bigMax;
+                                    fExtentMap[i].partition.cprange.bigHiVal =
+                                        it->second.bigMax;
                                 }
                             }
                         }
@@ -983,88 +1073,111 @@ void ExtentMap::mergeExtentsMaxMin(CPMaxMinMergeMap_t& cpMap, bool useLock)
                         {
                             if (!isBinaryColumn)
                             {
-                                fExtentMap[i].partition.cprange.loVal =
-                                    it->second.min;
-                                fExtentMap[i].partition.cprange.hiVal =
-                                    it->second.max;
+                                if (it->second.min <
+                                        fExtentMap[i].partition.cprange.loVal)
+                                    fExtentMap[i].partition.cprange.loVal =
+                                        it->second.min;
+
+                                if (it->second.max >
+                                        fExtentMap[i].partition.cprange.hiVal)
+                                    fExtentMap[i].partition.cprange.hiVal =
+                                        it->second.max;
                             }
                             else
                             {
-                                fExtentMap[i].partition.cprange.bigLoVal =
-                                    it->second.bigMin;
-                                fExtentMap[i].partition.cprange.bigHiVal =
-                                    it->second.bigMax;
+                                if (it->second.bigMin <
+                                        fExtentMap[i].partition.cprange.bigLoVal)
+                                    fExtentMap[i].partition.cprange.bigLoVal =
+                                        it->second.bigMin;
+
+                                if (it->second.bigMax >
+                                        fExtentMap[i].partition.cprange.bigHiVal)
+                                    fExtentMap[i].partition.cprange.bigHiVal =
+                                        it->second.bigMax;
                             }
                         }
+                    }
+                    else
+                    {
+                        if (!isBinaryColumn)
+                        {
+                            fExtentMap[i].partition.cprange.loVal =
+                                it->second.min;
+                            fExtentMap[i].partition.cprange.hiVal =
+                                it->second.max;
+                        }
+                        else
+                        {
+                            fExtentMap[i].partition.cprange.bigLoVal =
+                                it->second.bigMin;
+                            fExtentMap[i].partition.cprange.bigHiVal =
+                                it->second.bigMax;
+                        }
+                    }
 
-                        incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
+                    incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
 
-                        break;
-                    }
+                    break;
+                }
 
-                    // DML is updating; just increment seqnum.
-                    // This case is here for completeness.  Table lock should
-                    // prevent this state from occurring (see notes at top of
-                    // this function)
-                    case CP_UPDATING:
-                    {
-                        makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
-                        incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
+                // DML is updating; just increment seqnum.
+                // This case is here for completeness.  Table lock should
+                // prevent this state from occurring (see notes at top of
+                // this function)
+                case CP_UPDATING:
+                {
+                    makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
+                    incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
 
-                        break;
-                    }
+                    break;
+                }
 
-                    // Reset min/max to new min/max only "if" we can treat this
-                    // as a new extent, else leave the extent marked as INVALID
-                    case CP_INVALID:
-                    default:
-                    {
-                        makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
+                // Reset min/max to new min/max only "if" we can treat this
+                // as a new extent, else leave the extent marked as INVALID
+                case CP_INVALID:
+                default:
+                {
+                    makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
 
-                        if (it->second.newExtent)
+                    if (it->second.newExtent)
+                    {
+                        if ((!isBinaryColumn && isValidCPRange(it->second.max, it->second.min, it->second.type)) ||
+                            (isBinaryColumn && isValidCPRange(it->second.bigMax, it->second.bigMin, it->second.type)))
                         {
-                            if ((!isBinaryColumn && isValidCPRange(it->second.max, it->second.min, it->second.type)) ||
-                                (isBinaryColumn && isValidCPRange(it->second.bigMax, it->second.bigMin, it->second.type)))
+                            if (!isBinaryColumn)
                             {
-                                if (!isBinaryColumn)
-                                {
-                                    fExtentMap[i].partition.cprange.loVal =
-                                        it->second.min;
-                                    fExtentMap[i].partition.cprange.hiVal =
-                                        it->second.max;
-                                }
-                                else
-                                {
-                                    fExtentMap[i].partition.cprange.bigLoVal =
-                                        it->second.bigMin;
-                                    fExtentMap[i].partition.cprange.bigHiVal =
-                                        it->second.bigMax;
-                                }
+                                fExtentMap[i].partition.cprange.loVal =
+                                    it->second.min;
+                                fExtentMap[i].partition.cprange.hiVal =
+                                    it->second.max;
+                            }
+                            else
+                            {
+                                fExtentMap[i].partition.cprange.bigLoVal =
+                                    it->second.bigMin;
+                                fExtentMap[i].partition.cprange.bigHiVal =
+                                    it->second.bigMax;
                             }
-
-                            // Even if invalid range; we set state to CP_VALID,
-                            // because the extent is valid, it is just empty.
-                            fExtentMap[i].partition.cprange.isValid = CP_VALID;
                         }
 
-                        incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
-                        break;
+                        // Even if invalid range; we set state to CP_VALID,
+                        // because the extent is valid, it is just empty.
+                        fExtentMap[i].partition.cprange.isValid = CP_VALID;
                     }
-                }	// switch on isValid state
-
-                extentsMerged++;
 
-                if (extentsMerged == extentsToMerge)
-                {
-                    return; // Leave when all extents in map are matched
+                    incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
+                    break;
                 }
+            }	// switch on isValid state
 
-                // Deleting objects from map, may speed up successive searches
-                cpMap.erase( it );
+            extentsMerged++;
 
-            }	// found a matching extent in the Map
-        }	// extent map range size != 0
-    }	// end of loop through extent map
+            if (extentsMerged == extentsToMerge)
+            {
+                return; // Leave when all extents in map are matched
+            }
+        }
+    }	// end of loop through cpMap
 
     throw logic_error("ExtentMap::mergeExtentsMaxMin(): lbid not found");
 }
@@ -1165,9 +1278,7 @@ int ExtentMap::getMaxMin(const LBID_t lbid,
         min = numeric_limits<int64_t>::max();
     }
     seqNum *= (-1);
-    int entries;
     int i;
-    LBID_t lastBlock;
     int isValid = CP_INVALID;
 
 #ifdef BRM_DEBUG
@@ -1178,33 +1289,24 @@ int ExtentMap::getMaxMin(const LBID_t lbid,
 #endif
 
     grabEMEntryTable(READ);
-    entries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    i = getIndex()->findLBID(lbid);
 
-    for (i = 0; i < entries; i++)
+    if (i >= 0)
     {
-        if (fExtentMap[i].range.size != 0)
+        if (typeid(T) == typeid(int128_t))
         {
-            lastBlock = fExtentMap[i].range.start +
-                        (static_cast<LBID_t>(fExtentMap[i].range.size) * 1024) - 1;
-
-            if (lbid >= fExtentMap[i].range.start && lbid <= lastBlock)
-            {
-                if (typeid(T) == typeid(int128_t))
-                {
-                    max = fExtentMap[i].partition.cprange.bigHiVal;
-                    min = fExtentMap[i].partition.cprange.bigLoVal;
-                }
-                else
-                {
-                    max = fExtentMap[i].partition.cprange.hiVal;
-                    min = fExtentMap[i].partition.cprange.loVal;
-                }
-                seqNum = fExtentMap[i].partition.cprange.sequenceNum;
-                isValid = fExtentMap[i].partition.cprange.isValid;
-                releaseEMEntryTable(READ);
-                return isValid;
-            }
+            max = fExtentMap[i].partition.cprange.bigHiVal;
+            min = fExtentMap[i].partition.cprange.bigLoVal;
+        }
+        else
+        {
+            max = fExtentMap[i].partition.cprange.hiVal;
+            min = fExtentMap[i].partition.cprange.loVal;
         }
+        seqNum = fExtentMap[i].partition.cprange.sequenceNum;
+        isValid = fExtentMap[i].partition.cprange.isValid;
+        releaseEMEntryTable(READ);
+        return isValid;
     }
 
     releaseEMEntryTable(READ);
@@ -1214,9 +1316,7 @@ int ExtentMap::getMaxMin(const LBID_t lbid,
 
 void ExtentMap::getCPMaxMin(const BRM::LBID_t lbid, BRM::CPMaxMin& cpMaxMin)
 {
-    int entries;
     int i;
-    LBID_t lastBlock;
 
 #ifdef BRM_DEBUG
 
@@ -1226,27 +1326,18 @@ void ExtentMap::getCPMaxMin(const BRM::LBID_t lbid, BRM::CPMaxMin& cpMaxMin)
 #endif
 
     grabEMEntryTable(READ);
-    entries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    i = getIndex()->findLBID(lbid);
 
-    for (i = 0; i < entries; i++)
+    if (i >= 0)
     {
-        if (fExtentMap[i].range.size != 0)
-        {
-            lastBlock = fExtentMap[i].range.start +
-                        (static_cast<LBID_t>(fExtentMap[i].range.size) * 1024) - 1;
+        cpMaxMin.bigMax = fExtentMap[i].partition.cprange.bigHiVal;
+        cpMaxMin.bigMin = fExtentMap[i].partition.cprange.bigLoVal;
+        cpMaxMin.max    = fExtentMap[i].partition.cprange.hiVal;
+        cpMaxMin.min    = fExtentMap[i].partition.cprange.loVal;
+        cpMaxMin.seqNum = fExtentMap[i].partition.cprange.sequenceNum;
 
-            if (lbid >= fExtentMap[i].range.start && lbid <= lastBlock)
-            {
-                cpMaxMin.bigMax = fExtentMap[i].partition.cprange.bigHiVal;
-                cpMaxMin.bigMin = fExtentMap[i].partition.cprange.bigLoVal;
-                cpMaxMin.max    = fExtentMap[i].partition.cprange.hiVal;
-                cpMaxMin.min    = fExtentMap[i].partition.cprange.loVal;
-                cpMaxMin.seqNum = fExtentMap[i].partition.cprange.sequenceNum;
-
-                releaseEMEntryTable(READ);
-                return ;
-            }
-        }
+        releaseEMEntryTable(READ);
+        return ;
     }
 
     releaseEMEntryTable(READ);
@@ -1471,6 +1562,8 @@ void ExtentMap::loadVersion4or5(T* in, bool upgradeV4ToV5)
     }
 
     fEMShminfo->currentSize = emNumElements * sizeof(EMEntry);
+    // every entry is new, have the indexes rebuilt instead of updated
+    fEMShminfo->changeSeq += MSTEntry::CHANGE_LOG_SIZE + 1;
 
 #ifdef DUMP_EXTENT_MAP
     EMEntry* emSrc = fExtentMap;
@@ -1646,6 +1739,16 @@ void ExtentMap::save(const string& filename)
 
 #endif
 
+    vector<char> image;
+
+    save(image);
+    saveImage(filename, image);
+}
+
+// The locks are held only while the shared segments are copied; the caller
+// writes the image out after they're released.
+void ExtentMap::save(vector<char>& image)
+{
     int allocdSize, loadSize[3], i;
 
     grabEMEntryTable(READ);
@@ -1668,105 +1771,41 @@ void ExtentMap::save(const string& filename)
         throw runtime_error("ExtentMap::save(): got request to save an empty BRM");
     }
 
-    const char* filename_p = filename.c_str();
-    scoped_ptr<IDBDataFile> out(IDBDataFile::open(
-                                    IDBPolicy::getType(filename_p, IDBPolicy::WRITEENG),
-                                    filename_p, "wb", IDBDataFile::USE_VBUF));
-
-    if (!out)
-    {
-        log_errno("ExtentMap::save(): open");
-        releaseFreeList(READ);
-        releaseEMEntryTable(READ);
-        throw ios_base::failure("ExtentMap::save(): open failed. Check the error log.");
-    }
-
     loadSize[0] = EM_MAGIC_V5;
     loadSize[1] = fEMShminfo->currentSize / sizeof(EMEntry);
     loadSize[2] = fFLShminfo->allocdSize / sizeof(InlineLBIDRange); // needs to send all entries
 
-    int bytes = 0;
-
     try
     {
-        const int wsize = 3 * sizeof(int);
-        bytes = out->write((char*)loadSize, wsize);
+        image.clear();
+        image.reserve(sizeof(loadSize) + fEMShminfo->currentSize + fFLShminfo->allocdSize);
+        image.insert(image.end(), (char*) loadSize, (char*) loadSize + sizeof(loadSize));
 
-        if (bytes != wsize)
-            throw ios_base::failure("ExtentMap::save(): write failed. Check the error log.");
-    }
-    catch (...)
-    {
-        releaseFreeList(READ);
-        releaseEMEntryTable(READ);
-        throw;
-    }
+        allocdSize = fEMShminfo->allocdSize / sizeof(EMEntry);
+        int first = -1;
 
-    allocdSize = fEMShminfo->allocdSize / sizeof(EMEntry);
-    //const int emEntrySize = sizeof(EMEntry);
-
-    int first = -1, last = -1, err;
-    size_t progress, writeSize;
-    for (i = 0; i < allocdSize; i++)
-    {
-        if (fExtentMap[i].range.size > 0 && first == -1)
-            first = i;
-        else if (fExtentMap[i].range.size <= 0 && first != -1)
+        // copy the runs of entries in use
+        for (i = 0; i <= allocdSize; i++)
         {
-            last = i;
-            writeSize = (last - first) * sizeof(EMEntry);
-            progress = 0;
-            char *writePos = (char *) &fExtentMap[first];
-            while (progress < writeSize)
-            {
-                err = out->write(writePos + progress, writeSize - progress);
-                if (err < 0)
-                {
-                    releaseFreeList(READ);
-                    releaseEMEntryTable(READ);
-                    throw ios_base::failure("ExtentMap::save(): write failed. Check the error log.");
-                }
-                progress += err;
-            }
-            first = -1;
-        }
+            bool inUse = (i < allocdSize && fExtentMap[i].range.size > 0);
 
-    }
-    if (first != -1)
-    {
-        writeSize = (allocdSize - first) * sizeof(EMEntry);
-        progress = 0;
-        char *writePos = (char *) &fExtentMap[first];
-        while (progress < writeSize)
-        {
-            err = out->write(writePos + progress, writeSize - progress);
-            if (err < 0)
+            if (inUse && first == -1)
+                first = i;
+            else if (!inUse && first != -1)
             {
-                releaseFreeList(READ);
-                releaseEMEntryTable(READ);
-                throw ios_base::failure("ExtentMap::save(): write failed. Check the error log.");
+                image.insert(image.end(), (char*) &fExtentMap[first], (char*) &fExtentMap[i]);
+                first = -1;
             }
-            progress += err;
         }
-    }
 
-    //allocdSize = fFLShminfo->allocdSize / sizeof(InlineLBIDRange);
-    //const int inlineLbidRangeSize = sizeof(InlineLBIDRange);
-
-    progress = 0;
-    writeSize = fFLShminfo->allocdSize;
-    char *writePos = (char *) fFreeList;
-    while (progress < writeSize)
+        char* flPos = (char*) fFreeList;
+        image.insert(image.end(), flPos, flPos + fFLShminfo->allocdSize);
+    }
+    catch (...)
     {
-        err = out->write(writePos + progress, writeSize - progress);
-        if (err < 0)
-        {
-            releaseFreeList(READ);
-            releaseEMEntryTable(READ);
-            throw ios_base::failure("ExtentMap::save(): write failed. Check the error log.");
-        }
-
-        progress += err;
+        releaseFreeList(READ);
+        releaseEMEntryTable(READ);
+        throw;
     }
 
     releaseFreeList(READ);
@@ -1982,6 +2021,14 @@ void ExtentMap::growEMShmseg(size_t nrows)
         fPExtMapImpl->grow(newshmkey, allocSize);
     }
 
+    // the entries keep their places in the new segment
+    if (fEMShminfo->allocdSize != 0)
+    {
+        fEMShminfo->changeLog[fEMShminfo->changeSeq % MSTEntry::CHANGE_LOG_SIZE] =
+            MSTEntry::SEGMENT_GROWN;
+        fEMShminfo->changeSeq++;
+    }
+
     fEMShminfo->tableShmkey = newshmkey;
     fEMShminfo->allocdSize = allocSize;
 
@@ -2045,8 +2092,7 @@ int ExtentMap::lookup(LBID_t lbid, LBID_t& firstLbid, LBID_t& lastLbid)
     }
 
 #endif
-    int entries, i;
-    LBID_t lastBlock;
+    int i;
 
 #ifdef BRM_DEBUG
 
@@ -2061,23 +2107,15 @@ int ExtentMap::lookup(LBID_t lbid, LBID_t& firstLbid, LBID_t& lastLbid)
 #endif
 
     grabEMEntryTable(READ);
-    entries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    i = getIndex()->findLBID(lbid);
 
-    for (i = 0; i < entries; i++)
+    if (i >= 0)
     {
-        if (fExtentMap[i].range.size != 0)
-        {
-            lastBlock = fExtentMap[i].range.start +
-                        (static_cast<LBID_t>(fExtentMap[i].range.size) * 1024) - 1;
-
-            if (lbid >= fExtentMap[i].range.start && lbid <= lastBlock)
-            {
-                firstLbid = fExtentMap[i].range.start;
-                lastLbid = lastBlock;
-                releaseEMEntryTable(READ);
-                return 0;
-            }
-        }
+        firstLbid = fExtentMap[i].range.start;
+        lastLbid = fExtentMap[i].range.start +
+                   (static_cast<LBID_t>(fExtentMap[i].range.size) * 1024) - 1;
+        releaseEMEntryTable(READ);
+        return 0;
     }
 
     releaseEMEntryTable(READ);
@@ -2115,8 +2153,7 @@ int ExtentMap::lookupLocal(LBID_t lbid, int& OID, uint16_t& dbRoot, uint32_t& pa
     }
 
 #endif
-    int entries, i, offset;
-    LBID_t lastBlock;
+    int i, offset;
 
     if (lbid < 0)
     {
@@ -2128,30 +2165,21 @@ int ExtentMap::lookupLocal(LBID_t lbid, int& OID, uint16_t& dbRoot, uint32_t& pa
 
     grabEMEntryTable(READ);
 
-    entries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    i = getIndex()->findLBID(lbid);
 
-    for (i = 0; i < entries; i++)
+    if (i >= 0)
     {
-        if (fExtentMap[i].range.size != 0)
-        {
-            lastBlock = fExtentMap[i].range.start +
-                        (static_cast<LBID_t>(fExtentMap[i].range.size) * 1024) - 1;
-
-            if (lbid >= fExtentMap[i].range.start && lbid <= lastBlock)
-            {
-                OID = fExtentMap[i].fileID;
-                dbRoot = fExtentMap[i].dbRoot;
-                segmentNum = fExtentMap[i].segmentNum;
-                partitionNum = fExtentMap[i].partitionNum;
+        OID = fExtentMap[i].fileID;
+        dbRoot = fExtentMap[i].dbRoot;
+        segmentNum = fExtentMap[i].segmentNum;
+        partitionNum = fExtentMap[i].partitionNum;
 
-                // TODO:  Offset logic.
-                offset = lbid - fExtentMap[i].range.start;
-                fileBlockOffset = fExtentMap[i].blockOffset + offset;
+        // TODO:  Offset logic.
+        offset = lbid - fExtentMap[i].range.start;
+        fileBlockOffset = fExtentMap[i].blockOffset + offset;
 
-                releaseEMEntryTable(READ);
-                return 0;
-            }
-        }
+        releaseEMEntryTable(READ);
+        return 0;
     }
 
     releaseEMEntryTable(READ);
@@ -2174,7 +2202,7 @@ int ExtentMap::lookupLocal(int OID, uint32_t partitionNum, uint16_t segmentNum,
     }
 
 #endif
-    int entries, i, offset;
+    int i, offset;
 
     if (OID < 0)
     {
@@ -2184,10 +2212,12 @@ int ExtentMap::lookupLocal(int OID, uint32_t partitionNum, uint16_t segmentNum,
 
     grabEMEntryTable(READ);
 
-    entries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    boost::shared_ptr<const ExtentMapIndex> index = getIndex();
+    const vector<int>& oidExtents = index->findOID(OID);
 
-    for (i = 0; i < entries; i++)
+    for (size_t k = 0; k < oidExtents.size(); k++)
     {
+        i = oidExtents[k];
 
         // TODO:  Blockoffset logic.
         if (fExtentMap[i].range.size != 0 &&
@@ -2227,7 +2257,7 @@ int ExtentMap::lookupLocal_DBroot(int OID, uint16_t dbroot, uint32_t partitionNu
     }
 
 #endif
-    int entries, i, offset;
+    int i, offset;
 
     if (OID < 0)
     {
@@ -2237,10 +2267,12 @@ int ExtentMap::lookupLocal_DBroot(int OID, uint16_t dbroot, uint32_t partitionNu
 
     grabEMEntryTable(READ);
 
-    entries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    boost::shared_ptr<const ExtentMapIndex> index = getIndex();
+    const vector<int>& oidExtents = index->findOID(OID);
 
-    for (i = 0; i < entries; i++)
+    for (size_t k = 0; k < oidExtents.size(); k++)
     {
+        i = oidExtents[k];
 
         // TODO:  Blockoffset logic.
         if (fExtentMap[i].range.size != 0 &&
@@ -2290,7 +2322,7 @@ int ExtentMap::lookupLocalStartLbid(int      OID,
     }
 
 #endif
-    int entries, i;
+    int i;
 
     if (OID < 0)
     {
@@ -2301,10 +2333,12 @@ int ExtentMap::lookupLocalStartLbid(int      OID,
     }
 
     grabEMEntryTable(READ);
-    entries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    boost::shared_ptr<const ExtentMapIndex> index = getIndex();
+    const vector<int>& oidExtents = index->findOID(OID);
 
-    for (i = 0; i < entries; i++)
+    for (size_t k = 0; k < oidExtents.size(); k++)
     {
+        i = oidExtents[k];
         if (fExtentMap[i].range.size   != 0 &&
                 fExtentMap[i].fileID       == OID &&
                 fExtentMap[i].partitionNum == partitionNum &&
@@ -2962,6 +2996,7 @@ LBID_t ExtentMap::_createColumnExtent_DBroot(uint32_t size, int OID,
 
     makeUndoRecord(fEMShminfo, sizeof(MSTEntry));
     fEMShminfo->currentSize += sizeof(struct EMEntry);
+    logEMChange(emptyEMEntry);
 
     return startLBID;
 }
@@ -3185,6 +3220,7 @@ LBID_t ExtentMap::_createColumnExtentExactFile(uint32_t size, int OID,
 
     makeUndoRecord(fEMShminfo, sizeof(MSTEntry));
     fEMShminfo->currentSize += sizeof(struct EMEntry);
+    logEMChange(emptyEMEntry);
 
     return startLBID;
 }
@@ -3355,6 +3391,7 @@ LBID_t ExtentMap::_createDictStoreExtent(uint32_t size, int OID,
 
     makeUndoRecord(fEMShminfo, sizeof(MSTEntry));
     fEMShminfo->currentSize += sizeof(struct EMEntry);
+    logEMChange(emptyEMEntry);
 
     return startLBID;
 }
@@ -4317,15 +4354,16 @@ void ExtentMap::deleteExtent(int emIndex)
         makeUndoRecord(&fFreeList[freeFLIndex], sizeof(InlineLBIDRange));
         fFreeList[freeFLIndex].start = fExtentMap[emIndex].range.start;
         fFreeList[freeFLIndex].size = fExtentMap[emIndex].range.size;
-        makeUndoRecord(&fFLShminfo, sizeof(MSTEntry));
+        makeUndoRecord(fFLShminfo, sizeof(MSTEntry));
         fFLShminfo->currentSize += sizeof(InlineLBIDRange);
     }
 
     //invalidate the entry in the Extent Map
     makeUndoRecord(&fExtentMap[emIndex], sizeof(EMEntry));
     fExtentMap[emIndex].range.size = 0;
-    makeUndoRecord(&fEMShminfo, sizeof(MSTEntry));
+    makeUndoRecord(fEMShminfo, sizeof(MSTEntry));
     fEMShminfo->currentSize -= sizeof(struct EMEntry);
+    logEMChange(emIndex);
 }
 
 //------------------------------------------------------------------------------
@@ -4587,7 +4625,7 @@ void ExtentMap::getExtentState(int OID, uint32_t partitionNum,
     }
 
 #endif
-    int i, emEntries;
+    int i;
     bFound = false;
     status = EXTENTAVAILABLE;
 
@@ -4601,10 +4639,12 @@ void ExtentMap::getExtentState(int OID, uint32_t partitionNum,
 
     grabEMEntryTable(READ);
 
-    emEntries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    boost::shared_ptr<const ExtentMapIndex> index = getIndex();
+    const vector<int>& oidExtents = index->findOID(OID);
 
-    for (i = 0; i < emEntries; i++)
+    for (size_t k = 0; k < oidExtents.size(); k++)
     {
+        i = oidExtents[k];
         if ((fExtentMap[i].range.size  != 0) &&
                 (fExtentMap[i].fileID      == OID) &&
                 (fExtentMap[i].partitionNum == partitionNum) &&
@@ -4649,7 +4689,7 @@ HWM_t ExtentMap::getLocalHWM(int OID, uint32_t partitionNum,
 
 #endif
 
-    int i, emEntries;
+    int i;
     HWM_t ret = 0;
     bool OIDPartSegExists = false;
 
@@ -4663,10 +4703,12 @@ HWM_t ExtentMap::getLocalHWM(int OID, uint32_t partitionNum,
 
     grabEMEntryTable(READ);
 
-    emEntries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    boost::shared_ptr<const ExtentMapIndex> index = getIndex();
+    const vector<int>& oidExtents = index->findOID(OID);
 
-    for (i = 0; i < emEntries; i++)
+    for (size_t k = 0; k < oidExtents.size(); k++)
     {
+        i = oidExtents[k];
         if ((fExtentMap[i].range.size  != 0) &&
                 (fExtentMap[i].fileID      == OID) &&
                 (fExtentMap[i].partitionNum == partitionNum) &&
@@ -4740,10 +4782,12 @@ void ExtentMap::setLocalHWM(int OID, uint32_t partitionNum,
     if (uselock)
         grabEMEntryTable(WRITE);
 
-    int emEntries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    boost::shared_ptr<const ExtentMapIndex> index = getIndex();
+    const vector<int>& oidExtents = index->findOID(OID);
 
-    for (int i = 0; i < emEntries; i++)
+    for (size_t k = 0; k < oidExtents.size(); k++)
     {
+        int i = oidExtents[k];
         if ((fExtentMap[i].range.size  != 0) &&
                 (fExtentMap[i].fileID      == OID) &&
                 (fExtentMap[i].partitionNum == partitionNum) &&
@@ -4904,7 +4948,7 @@ void ExtentMap::getExtents(int OID, vector<struct EMEntry>& entries,
     }
 
 #endif
-    int i, emEntries;
+    int i;
 
     entries.clear();
 
@@ -4917,24 +4961,19 @@ void ExtentMap::getExtents(int OID, vector<struct EMEntry>& entries,
     }
 
     grabEMEntryTable(READ);
-    emEntries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
-    // Pre-expand entries to stop lots of small allocs
-    entries.reserve(emEntries);
+    boost::shared_ptr<const ExtentMapIndex> index = getIndex();
+    const vector<int>& oidExtents = index->findOID(OID);
+    entries.reserve(oidExtents.size());
 
-    if (incOutOfService)
-    {
-        for (i = 0 ; i < emEntries; i++)
-            if ((fExtentMap[i].fileID == OID) &&
-                    (fExtentMap[i].range.size != 0))
-                entries.push_back(fExtentMap[i]);
-    }
-    else
+    for (size_t k = 0; k < oidExtents.size(); k++)
     {
-        for (i = 0 ; i < emEntries; i++)
-            if ((fExtentMap[i].fileID     == OID) &&
-                    (fExtentMap[i].range.size != 0)   &&
-                    (fExtentMap[i].status     != EXTENTOUTOFSERVICE))
-                entries.push_back(fExtentMap[i]);
+        i = oidExtents[k];
+
+        if ((fExtentMap[i].fileID     == OID) &&
+                (fExtentMap[i].range.size != 0)   &&
+                (incOutOfService ||
+                 fExtentMap[i].status     != EXTENTOUTOFSERVICE))
+            entries.push_back(fExtentMap[i]);
     }
 
     releaseEMEntryTable(READ);
@@ -4981,7 +5020,7 @@ void ExtentMap::getExtents_dbroot(int OID, vector<struct EMEntry>& entries, cons
 
 #endif
 
-    int i, emEntries;
+    int i;
 
     entries.clear();
 
@@ -4994,12 +5033,17 @@ void ExtentMap::getExtents_dbroot(int OID, vector<struct EMEntry>& entries, cons
     }
 
     grabEMEntryTable(READ);
-    emEntries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    boost::shared_ptr<const ExtentMapIndex> index = getIndex();
+    const vector<int>& oidExtents = index->findOID(OID);
+
+    for (size_t k = 0; k < oidExtents.size(); k++)
+    {
+        i = oidExtents[k];
 
-    for (i = 0 ; i < emEntries; i++)
         if ((fExtentMap[i].fileID == OID) &&
                 (fExtentMap[i].range.size != 0) && (fExtentMap[i].dbRoot == dbroot))
             entries.push_back(fExtentMap[i]);
+    }
 
     releaseEMEntryTable(READ);
 }
@@ -5012,7 +5056,7 @@ void ExtentMap::getExtents_dbroot(int OID, vector<struct EMEntry>& entries, cons
 void ExtentMap::getExtentCount_dbroot(int OID, uint16_t dbroot,
                                       bool incOutOfService, uint64_t& numExtents)
 {
-    int i, emEntries;
+    int i;
 
     if (OID < 0)
     {
@@ -5024,14 +5068,16 @@ void ExtentMap::getExtentCount_dbroot(int OID, uint16_t dbroot,
     }
 
     grabEMEntryTable(READ);
-    emEntries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    boost::shared_ptr<const ExtentMapIndex> index = getIndex();
+    const vector<int>& oidExtents = index->findOID(OID);
 
     numExtents = 0;
 
     if (incOutOfService)
     {
-        for (i = 0 ; i < emEntries; i++)
+        for (size_t k = 0; k < oidExtents.size(); k++)
         {
+            i = oidExtents[k];
             if ((fExtentMap[i].fileID     == OID) &&
                     (fExtentMap[i].range.size != 0)   &&
                     (fExtentMap[i].dbRoot     == dbroot))
@@ -5040,8 +5086,9 @@ void ExtentMap::getExtentCount_dbroot(int OID, uint16_t dbroot,
     }
     else
     {
-        for (i = 0 ; i < emEntries; i++)
+        for (size_t k = 0; k < oidExtents.size(); k++)
         {
+            i = oidExtents[k];
             if ((fExtentMap[i].fileID     == OID)    &&
                     (fExtentMap[i].range.size != 0)      &&
                     (fExtentMap[i].dbRoot     == dbroot) &&
@@ -5075,10 +5122,12 @@ void ExtentMap::getSysCatDBRoot(OID_t oid, uint16_t& dbRoot)
 
     bool bFound = false;
     grabEMEntryTable(READ);
-    int emEntries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    boost::shared_ptr<const ExtentMapIndex> index = getIndex();
+    const vector<int>& oidExtents = index->findOID(oid);
 
-    for (int i = 0 ; i < emEntries; i++)
+    for (size_t k = 0; k < oidExtents.size(); k++)
     {
+        int i = oidExtents[k];
         if ((fExtentMap[i].range.size != 0) &&
                 (fExtentMap[i].fileID     == oid))
         {
@@ -5627,7 +5676,7 @@ void ExtentMap::lookup(OID_t OID, LBIDRange_v& ranges)
 
 #endif
 
-    int i, emEntries;
+    int i;
     LBIDRange tmp;
 
     ranges.clear();
@@ -5641,9 +5690,13 @@ void ExtentMap::lookup(OID_t OID, LBIDRange_v& ranges)
     }
 
     grabEMEntryTable(READ);
-    emEntries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+    boost::shared_ptr<const ExtentMapIndex> index = getIndex();
+    const vector<int>& oidExtents = index->findOID(OID);
+
+    for (size_t k = 0; k < oidExtents.size(); k++)
+    {
+        i = oidExtents[k];
 
-    for (i = 0 ; i < emEntries; i++)
         if ((fExtentMap[i].fileID     == OID) &&
                 (fExtentMap[i].range.size != 0) &&
                 (fExtentMap[i].status     != EXTENTOUTOFSERVICE))
@@ -5652,6 +5705,7 @@ void ExtentMap::lookup(OID_t OID, LBIDRange_v& ranges)
             tmp.size = fExtentMap[i].range.size * 1024;
             ranges.push_back(tmp);
         }
+    }
 
     releaseEMEntryTable(READ);
 }
@@ -5924,7 +5978,16 @@ void ExtentMap::undoChanges()
     if (fDebug) TRACER_WRITENOW("undoChanges");
 
 #endif
+    uint32_t changeSeq = (emLocked ? fEMShminfo->changeSeq : 0);
+
     Undoable::undoChanges();
+
+    // Rolling back restores the previous changeSeq and changeLog, which no
+    // longer name the entries an index has been updated with in the meantime.
+    // Move past all of them so that those indexes get rebuilt.
+    if (emLocked && fEMShminfo->changeSeq != changeSeq)
+        fEMShminfo->changeSeq = changeSeq + MSTEntry::CHANGE_LOG_SIZE + 1;
+
     finishChanges();
 }
 
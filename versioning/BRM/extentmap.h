@@ -29,6 +29,7 @@
 
 #include <sys/types.h>
 #include <vector>
+#include <map>
 #include <set>
 #ifdef _MSC_VER
 #include <unordered_map>
@@ -37,6 +38,7 @@
 #endif
 //#define NDEBUG
 #include <cassert>
+#include <boost/shared_ptr.hpp>
 #include <boost/interprocess/shared_memory_object.hpp>
 #include <boost/interprocess/mapped_region.hpp>
 
@@ -318,6 +320,65 @@ private:
     static FreeListImpl* fInstance;
 };
 
+/** @brief Lookup structures over the EM entry array
+ *
+ * The entries in the EM shared memory segment are unordered, so finding the
+ * extent holding an LBID or the extents of an OID means scanning the whole
+ * array.  An ExtentMapIndex holds the live entries by LBID range, and the
+ * entries of each OID in array order.  It is built from one state of the
+ * array and then kept up to date by update(), which re-reads the entries
+ * named in the MSTEntry changeLog since that state.
+ */
+class ExtentMapIndex
+{
+public:
+    EXPORT ExtentMapIndex(const EMEntry* entries, int count, const MSTEntry& shminfo);
+
+    /** @brief Is this index built from the current state of the EM? */
+    inline bool isCurrent(const MSTEntry& shminfo) const
+    {
+        return fShmkey == shminfo.tableShmkey && fChangeSeq == shminfo.changeSeq;
+    }
+
+    /** @brief Brings the index up to date with the changes logged in shminfo
+     *
+     * @return false when the changeLog doesn't go back far enough, the
+     * index is left untouched then and has to be rebuilt.
+     */
+    EXPORT bool update(const EMEntry* entries, int count, const MSTEntry& shminfo);
+
+    /** @brief Returns the EM index of the extent containing lbid, or -1 */
+    EXPORT int findLBID(LBID_t lbid) const;
+
+    /** @brief Returns the EM indexes of the extents of OID in array order */
+    EXPORT const std::vector<int>& findOID(int OID) const;
+
+private:
+    struct LBIDRangeEntry
+    {
+        LBID_t last;
+        int emIndex;
+    };
+
+    // what an EM entry was indexed as, to take it out again
+    struct IndexedEntry
+    {
+        LBID_t start;
+        int OID;
+        bool live;
+    };
+
+    void addEntry(const EMEntry& entry, int emIndex);
+    void removeEntry(int emIndex);
+
+    std::map<LBID_t, LBIDRangeEntry> fByLBID;
+    std::tr1::unordered_map<int, std::vector<int> > fByOID;
+    std::vector<IndexedEntry> fEntries;
+    std::vector<int> fNoExtents;
+    key_t fShmkey;
+    uint32_t fChangeSeq;
+};
+
 /** @brief This class encapsulates the extent map functionality of the system
  *
  * This class encapsulates the extent map functionality of the system.  It
@@ -361,6 +422,14 @@ public:
      */
     EXPORT void save(const std::string& filename);
 
+    /** @brief Copies the ExtentMap entries into an image of the file save() writes
+     *
+     * The EM locks are held only for the copy, so the image can be written
+     * out with saveImage() without blocking the writers.
+     * @param image (out) the file image
+     */
+    EXPORT void save(std::vector<char>& image);
+
     // @bug 1509.  Added new version of lookup below.
     /** @brief Returns the first and last LBID in the range for a given LBID
      *
@@ -945,6 +1014,8 @@ private:
 
     EMEntry* fExtentMap;
     InlineLBIDRange* fFreeList;
+    static boost::mutex fIndexMutex;
+    static boost::shared_ptr<ExtentMapIndex> fIndex;
     key_t fCurrentEMShmkey;
     key_t fCurrentFLShmkey;
     MSTEntry* fEMShminfo;
@@ -1003,6 +1074,15 @@ private:
     void growFLShmseg();
     void finishChanges();
 
+    /* Returns the process wide index of the EM, brought up to date first if
+       the EM has changed since.  Must be called holding the EM lock. */
+    boost::shared_ptr<const ExtentMapIndex> getIndex();
+
+    /* Logs that EM entry emIndex was created or deleted and updates the index
+       of this process.  Must be called holding the EM write lock, after the
+       undo record for fEMShminfo. */
+    void logEMChange(int emIndex);
+
     EXPORT unsigned getFilesPerColumnPartition();
     unsigned getExtentsPerSegmentFile();
     unsigned getDbRootCount();
@@ -23,6 +23,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <stdexcept>
+#include <cstring>
 #include <sys/types.h>
 #include <cerrno>
 using namespace std;
@@ -111,8 +112,10 @@ MasterSegmentTableImpl::MasterSegmentTableImpl(int key, int size)
 MSTEntry::MSTEntry() :
     tableShmkey(-1),
     allocdSize(0),
-    currentSize(0)
+    currentSize(0),
+    changeSeq(0)
 {
+    memset(changeLog, 0, sizeof(changeLog));
 }
 
 MasterSegmentTable::MasterSegmentTable()
@@ -35,6 +35,7 @@
 #define _MASTERSEGMENTTABLE_H_
 
 #include <stdexcept>
+#include <stdint.h>
 #include <sys/types.h>
 #include <boost/thread.hpp>
 #include <boost/interprocess/shared_memory_object.hpp>
@@ -58,6 +59,16 @@ struct MSTEntry
     key_t tableShmkey;
     int allocdSize;
     int currentSize;
+    uint32_t changeSeq;     // bumped on changes that invalidate process-local indexes
+
+    // The entry changed by each of the last CHANGE_LOG_SIZE changeSeq bumps,
+    // at changeLog[seq % CHANGE_LOG_SIZE], so that process-local indexes can
+    // catch up without a rebuild.  SEGMENT_GROWN marks a move to a larger
+    // segment that kept the entries in place.
+    static const uint32_t CHANGE_LOG_SIZE = 256;
+    static const int SEGMENT_GROWN = -1;
+    int changeLog[CHANGE_LOG_SIZE];
+
     EXPORT MSTEntry();
 };
 
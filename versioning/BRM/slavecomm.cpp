@@ -27,11 +27,14 @@
 #include <fcntl.h>
 #include <cstdio>
 #include <ctime>
+#include <algorithm>
 #ifdef _MSC_VER
 #include <io.h>
 #include <psapi.h>
 #endif
 
+#include <boost/bind.hpp>
+
 #include "messagequeue.h"
 #include "bytestream.h"
 #include "socketclosed.h"
@@ -65,7 +68,7 @@ namespace BRM
 {
 
 SlaveComm::SlaveComm(string hostname, SlaveDBRMNode* s) :
-    slave(s), currentSaveFile(NULL), journalh(NULL)
+    slave(s), journalh(NULL)
 #ifdef _MSC_VER
     , fPids(0), fMaxPids(64)
 #endif
@@ -153,6 +156,12 @@ SlaveComm::SlaveComm(string hostname, SlaveDBRMNode* s) :
     takeSnapshot = false;
     doSaveDelta = false;
     saveFileToggle = true;	// start with the suffix "A" rather than "B".  Arbitrary.
+    snapshotDone = false;
+    snapshotOK = false;
+
+    if (firstSlave)
+        initSaveFileToggle();
+
     release = false;
     die = false;
     standalone = false;
@@ -169,7 +178,7 @@ SlaveComm::SlaveComm(string hostname, SlaveDBRMNode* s) :
 }
 
 SlaveComm::SlaveComm()
-    : currentSaveFile(NULL), journalh(NULL)
+    : journalh(NULL)
 #ifdef _MSC_VER
     , fPids(0), fMaxPids(64)
 #endif
@@ -195,6 +204,8 @@ SlaveComm::SlaveComm()
     takeSnapshot = false;
     doSaveDelta = false;
     saveFileToggle = true;	// start with the suffix "A" rather than "B".  Arbitrary.
+    snapshotDone = false;
+    snapshotOK = false;
     release = false;
     die = false;
     firstSlave = false;
@@ -209,11 +220,8 @@ SlaveComm::~SlaveComm()
     delete server;
     server = NULL;
 
-    if (firstSlave)
-    {
-        delete currentSaveFile;
-        currentSaveFile = NULL;
-    }
+    if (snapshotThread)
+        finishSnapshot(true);
 
     delete journalh;
     journalh = NULL;
@@ -2048,7 +2056,7 @@ void SlaveComm::do_confirm()
         return;
     }
 
-    if (firstSlave && doSaveDelta && (journalCount < snapshotInterval || snapshotInterval < 0))
+    if (firstSlave && doSaveDelta)
     {
         doSaveDelta = false;
         saveDelta();
@@ -2056,66 +2064,200 @@ void SlaveComm::do_confirm()
 
     slave->confirmChanges();
 
-    string tmp = savefile + "_current";
+    if (!firstSlave)
+        return;
 
-    if (firstSlave && (takeSnapshot ||
-                       (journalCount >= snapshotInterval && snapshotInterval >= 0)))
+    if (takeSnapshot)
     {
-        if (!currentSaveFile)
-        {
-            currentSaveFile = IDBDataFile::open(
-                                  IDBPolicy::getType(tmp.c_str(), IDBPolicy::WRITEENG), tmp.c_str(), "wb", 0);
-        }
+        // the requester expects the snapshot to be on disk when we reply
+        finishSnapshot(true);
+        saveSnapshot(false);
+    }
+    else if (journalCount >= snapshotInterval && snapshotInterval >= 0 && finishSnapshot(false))
+        saveSnapshot(true);
 
-        if (currentSaveFile == NULL)
-        {
-            ostringstream os;
-            os << "WorkerComm: failed to open the current savefile. errno: "
-               << strerror(errno);
-            log(os.str());
-            throw runtime_error(os.str());
-        }
+    takeSnapshot = false;
+    doSaveDelta = false;
+}
 
-        
-        tmp = savefile + (saveFileToggle ? 'A' : 'B');
-        slave->saveState(tmp);
-#ifndef _MSC_VER
-        tmp += '\n';
-#endif
-        int err = 0;
+/* The next snapshot goes to the save file _current doesn't name.  A pending
+   journal named for the current snapshot was left by a crash after _current
+   was written; the snapshot already has its records. */
+void SlaveComm::initSaveFileToggle()
+{
+    string currentName = savefile + "_current";
+    string base = savefile.substr(savefile.find_last_of('/') + 1);
+    char buf[1024];
+    ssize_t len = 0;
 
-        // MCOL-1558.  Make the _current file relative to DBRMRoot.
-        string relative = tmp.substr(tmp.find_last_of('/') + 1);
-        err = currentSaveFile->write(relative.c_str(), relative.length());
+    boost::scoped_ptr<IDBDataFile> currentFile(IDBDataFile::open(
+                IDBPolicy::getType(currentName.c_str(), IDBPolicy::WRITEENG), currentName.c_str(), "rb", 0));
 
-        if (err < (int) relative.length())
-        {
-            ostringstream os;
-            os  << "WorkerComm: currentfile write() returned " << err
-                << " file pointer is " << currentSaveFile;
+    if (currentFile)
+        len = currentFile->read(buf, sizeof(buf));
 
-            if (err < 0)
-                os << " errno: " << strerror(errno);
+    string current(buf, max<ssize_t>(len, 0));
 
-            log(os.str());
-        }
+    if (!current.empty() && current[current.length() - 1] == '\n')
+        current.erase(current.length() - 1);
 
-        currentSaveFile->flush();
-        delete currentSaveFile;
-        currentSaveFile = NULL;
-        saveFileToggle = !saveFileToggle;
+    saveFileToggle = (current != base + 'A');
+
+    for (char suffix = 'A'; suffix <= 'B'; suffix++)
+    {
+        string pending = savefile + suffix + "_journal";
+
+        if ((current == base + suffix || (current != base + 'A' && current != base + 'B')) &&
+                IDBPolicy::exists(pending.c_str()))
+            IDBPolicy::remove(pending.c_str());
+    }
+}
+
+/* Takes a snapshot into the save file saveFileToggle names.  In the background,
+   only the copy of the BRM is made here; the journal records it contains are
+   moved to the pending journal and snapshotThread writes the files.  A pending
+   journal left by a snapshot that failed holds records the current snapshot
+   doesn't have, so that one is folded in synchronously. */
+void SlaveComm::saveSnapshot(bool background)
+{
+    string name = savefile + (saveFileToggle ? 'A' : 'B');
+    string pending = name + "_journal";
 
+    if (background && IDBPolicy::exists(pending.c_str()))
+        background = false;
+
+    if (background)
+    {
         delete journalh;
+        journalh = NULL;
+
+        if (IDBPolicy::rename(journalName.c_str(), pending.c_str()) != 0)
+        {
+            log_errno("WorkerComm: failed to move the journal to " + pending, logging::LOG_TYPE_WARNING);
+            background = false;
+        }
+        else
+            journalCount = 0;
+
         journalh = IDBDataFile::open(
-                       IDBPolicy::getType(journalName.c_str(), IDBPolicy::WRITEENG), journalName.c_str(), "w+b", 0);
+                       IDBPolicy::getType(journalName.c_str(), IDBPolicy::WRITEENG), journalName.c_str(), "a", 0);
 
         if (!journalh)
             throw runtime_error("Could not open the BRM journal for writing!");
+    }
 
-        takeSnapshot = false;
-        doSaveDelta = false;
-        journalCount = 0;
+    if (slave->saveState(snapshotImage) != 0)
+    {
+        log("WorkerComm: failed to copy the BRM for a snapshot", logging::LOG_TYPE_WARNING);
+        snapshotImage = BRMStateImage();
+        return;
+    }
+
+    if (background)
+    {
+        snapshotDone = false;
+        snapshotThread.reset(new boost::thread(boost::bind(&SlaveComm::snapshotThreadMain, this, name)));
+        return;
     }
+
+    bool ok = writeSnapshot(name);
+    snapshotImage = BRMStateImage();
+
+    if (!ok)
+        return;
+
+    // the snapshot has every record, the pending journal's and the journal's
+    if (IDBPolicy::exists(pending.c_str()))
+        IDBPolicy::remove(pending.c_str());
+
+    delete journalh;
+    journalh = IDBDataFile::open(
+                   IDBPolicy::getType(journalName.c_str(), IDBPolicy::WRITEENG), journalName.c_str(), "w+b", 0);
+
+    if (!journalh)
+        throw runtime_error("Could not open the BRM journal for writing!");
+
+    journalCount = 0;
+    saveFileToggle = !saveFileToggle;
+}
+
+/* Writes snapshotImage to the save files called name and makes them current */
+bool SlaveComm::writeSnapshot(const string& name)
+{
+    if (SlaveDBRMNode::writeState(name, snapshotImage) != 0)
+    {
+        log("WorkerComm: failed to write the snapshot " + name);
+        return false;
+    }
+
+    string currentName = savefile + "_current";
+    boost::scoped_ptr<IDBDataFile> currentFile(IDBDataFile::open(
+                IDBPolicy::getType(currentName.c_str(), IDBPolicy::WRITEENG), currentName.c_str(), "wb", 0));
+
+    if (!currentFile)
+    {
+        log_errno("WorkerComm: failed to open the current savefile");
+        return false;
+    }
+
+    // MCOL-1558.  Make the _current file relative to DBRMRoot.
+    string relative = name.substr(name.find_last_of('/') + 1);
+#ifndef _MSC_VER
+    relative += '\n';
+#endif
+    ssize_t err = currentFile->write(relative.c_str(), relative.length());
+
+    if (err < (ssize_t) relative.length() || currentFile->flush() != 0)
+    {
+        ostringstream os;
+        os << "WorkerComm: currentfile write() returned " << err;
+
+        if (err < 0)
+            os << " errno: " << strerror(errno);
+
+        log(os.str());
+        return false;
+    }
+
+    return true;
+}
+
+void SlaveComm::snapshotThreadMain(string name)
+{
+    bool ok = writeSnapshot(name);
+
+    // the current snapshot has the records of the pending journal now
+    if (ok)
+        IDBPolicy::remove((name + "_journal").c_str());
+
+    boost::mutex::scoped_lock lk(snapshotMutex);
+    snapshotOK = ok;
+    snapshotDone = true;
+}
+
+/* Reaps snapshotThread.  Returns false if it's still writing and wait is false. */
+bool SlaveComm::finishSnapshot(bool wait)
+{
+    if (!snapshotThread)
+        return true;
+
+    if (!wait)
+    {
+        boost::mutex::scoped_lock lk(snapshotMutex);
+
+        if (!snapshotDone)
+            return false;
+    }
+
+    snapshotThread->join();
+    snapshotThread.reset();
+    snapshotImage = BRMStateImage();
+
+    // after a failure the next snapshot goes to the same file, with the pending journal
+    if (snapshotOK)
+        saveFileToggle = !saveFileToggle;
+
+    return true;
 }
 
 void SlaveComm::do_flushInodeCache()
@@ -2231,8 +2373,6 @@ void SlaveComm::do_clear()
 
 int SlaveComm::replayJournal(string prefix)
 {
-    ByteStream cmd;
-    uint32_t len;
     int ret = 0;
 
     // @Bug 2667+
@@ -2244,16 +2384,21 @@ int SlaveComm::replayJournal(string prefix)
     // "/usr/local/mariadb/columnstore/data1/systemFiles/dbrm/BRM_saves_journal".
 
     string tmp = prefix.substr(prefix.length() - 1);
-    string fName;
+    string fName, pendingName;
 
     if ((tmp.compare("A") == 0) || (tmp.compare("B") == 0))
     {
         fName = prefix.substr(0, prefix.length() - 1) + "_journal";
+        // the records of a snapshot to the other file that didn't finish
+        pendingName = prefix.substr(0, prefix.length() - 1) + (tmp == "A" ? "B" : "A") + "_journal";
     }
 
 #ifdef _MSC_VER
     else if (tmp == "a" || tmp == "b")
+    {
         fName = prefix.substr(0, prefix.length() - 1) + "_journal";
+        pendingName = prefix.substr(0, prefix.length() - 1) + (tmp == "a" ? "b" : "a") + "_journal";
+    }
 
 #endif
     else
@@ -2261,10 +2406,38 @@ int SlaveComm::replayJournal(string prefix)
         fName = prefix + "_journal";
     }
 
+    bool pending = (!pendingName.empty() && IDBPolicy::exists(pendingName.c_str()));
+
+    if (pending)
+    {
+        ret = replayJournalFile(pendingName, true);
+
+        if (ret < 0)
+            return ret;
+    }
+
+    // the journal may not have been recreated yet after being moved to the pending one
+    int err = replayJournalFile(fName, !pending);
+
+    if (err < 0)
+        return err;
+
+    return ret + err;
+}
+
+int SlaveComm::replayJournalFile(const string& fName, bool mustExist)
+{
+    ByteStream cmd;
+    uint32_t len;
+    int ret = 0;
+
     const char* filename = fName.c_str();
 
-    IDBDataFile* journalf = IDBDataFile::open(
-                                IDBPolicy::getType(filename, IDBPolicy::WRITEENG), filename, "rb", 0);
+    if (!mustExist && !IDBPolicy::exists(filename))
+        return 0;
+
+    boost::scoped_ptr<IDBDataFile> journalf(IDBDataFile::open(
+                IDBPolicy::getType(filename, IDBPolicy::WRITEENG), filename, "rb", 0));
 
     if (!journalf)
     {
@@ -31,6 +31,8 @@
 #include <iostream>
 
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include "brmtypes.h"
 #include "slavedbrmnode.h"
@@ -118,6 +120,12 @@ private:
     void do_ownerCheck(messageqcpp::ByteStream& msg);
     void do_takeSnapshot();
     void saveDelta();
+    void initSaveFileToggle();
+    void saveSnapshot(bool background);
+    bool writeSnapshot(const std::string& name);
+    bool finishSnapshot(bool wait);
+    void snapshotThreadMain(std::string name);
+    int replayJournalFile(const std::string& filename, bool mustExist);
     bool processExists(const uint32_t pid, const std::string& pname);
 
     messageqcpp::MessageQueueServer* server;
@@ -126,10 +134,18 @@ private:
     std::string savefile;
     bool release, die, firstSlave, saveFileToggle, takeSnapshot, doSaveDelta, standalone, printOnly;
     messageqcpp::ByteStream delta;
-    idbdatafile::IDBDataFile* currentSaveFile;
     std::string journalName;
     idbdatafile::IDBDataFile* journalh;
     int64_t snapshotInterval, journalCount;
+
+    /* The periodic snapshots are written by snapshotThread from an image of
+       the BRM taken under its locks.  The journal records made before the
+       image are moved to <savefile><A|B>_journal, named for the snapshot
+       being written, until that snapshot is current. */
+    BRMStateImage snapshotImage;
+    boost::scoped_ptr<boost::thread> snapshotThread;
+    boost::mutex snapshotMutex;
+    bool snapshotDone, snapshotOK;
     struct timespec MSG_TIMEOUT;
 #ifdef _MSC_VER
     boost::mutex fPidMemLock;
@@ -1058,9 +1058,16 @@ int SlaveDBRMNode::checkConsistency() throw()
 
 int SlaveDBRMNode::saveState(string filename) throw()
 {
-    string emFilename = filename + "_em";
-    string vssFilename = filename + "_vss";
-    string vbbmFilename = filename + "_vbbm";
+    BRMStateImage image;
+
+    if (saveState(image) != 0)
+        return -1;
+
+    return writeState(filename, image);
+}
+
+int SlaveDBRMNode::saveState(BRMStateImage& image) throw()
+{
     bool locked[2] = { false, false };
 
     try
@@ -1070,9 +1077,9 @@ int SlaveDBRMNode::saveState(string filename) throw()
         vss.lock(VSS::READ);
         locked[1] = true;
 
-        saveExtentMap(emFilename);
-        vbbm.save(vbbmFilename);
-        vss.save(vssFilename);
+        em.save(image.em);
+        vbbm.save(image.vbbm);
+        vss.save(image.vss);
 
         vss.release(VSS::READ);
         locked[1] = false;
@@ -1093,6 +1100,22 @@ int SlaveDBRMNode::saveState(string filename) throw()
     return 0;
 }
 
+int SlaveDBRMNode::writeState(string filename, const BRMStateImage& image) throw()
+{
+    try
+    {
+        saveImage(filename + "_em", image.em);
+        saveImage(filename + "_vbbm", image.vbbm);
+        saveImage(filename + "_vss", image.vss);
+    }
+    catch (exception& e)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
 int SlaveDBRMNode::loadState(string filename) throw()
 {
     string emFilename = filename + "_em";
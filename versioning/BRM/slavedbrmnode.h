@@ -49,6 +49,18 @@
 namespace BRM
 {
 
+/** @brief An in-memory copy of the BRM save files
+ *
+ * SlaveDBRMNode::saveState(BRMStateImage&) fills it while holding the BRM
+ * locks; writeState() writes it out after they've been released.
+ */
+struct BRMStateImage
+{
+    std::vector<char> em;
+    std::vector<char> vbbm;
+    std::vector<char> vss;
+};
+
 /** @brief The Slave node of the DBRM system
  *
  * There are 3 components of the Distributed BRM (DBRM).
@@ -495,6 +507,8 @@ public:
 
     EXPORT int loadState(std::string filename) throw();
     EXPORT int saveState(std::string filename) throw();
+    EXPORT int saveState(BRMStateImage& image) throw();
+    EXPORT static int writeState(std::string filename, const BRMStateImage& image) throw();
 
     EXPORT const bool* getEMFLLockStatus();
     EXPORT const bool* getEMLockStatus();
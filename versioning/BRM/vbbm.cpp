@@ -1090,87 +1090,45 @@ void VBBM::load(string filename)
     //cout << "done loading " << time2 << " duration: " << time2-time1 << endl;
 }
 
-// read lock
 void VBBM::save(string filename)
 {
-    int i;
-    int var;
+    vector<char> image;
 
-    const char* filename_p = filename.c_str();
-    scoped_ptr<IDBDataFile> out(IDBDataFile::open(
-                                    IDBPolicy::getType(filename_p, IDBPolicy::WRITEENG),
-                                    filename_p, "wb", IDBDataFile::USE_VBUF));
+    save(image);
+    saveImage(filename, image);
+}
 
-    if (!out)
-    {
-        log_errno("VBBM::save()");
-        throw runtime_error("VBBM::save(): Failed to open the file");
-    }
+// read lock
+void VBBM::save(vector<char>& image)
+{
+    int i;
+    int header[3];
 
-    var = VBBM_MAGIC_V2;
-    int bytesWritten = 0;
-    int bytesToWrite = 12;
-    bytesWritten += out->write((char*) &var, 4);
-    bytesWritten += out->write((char*) &vbbm->vbCurrentSize, 4);
-    bytesWritten += out->write((char*) &vbbm->nFiles, 4);
+    header[0] = VBBM_MAGIC_V2;
+    header[1] = vbbm->vbCurrentSize;
+    header[2] = vbbm->nFiles;
 
-    bytesWritten += out->write((char*) files, sizeof(VBFileMetadata) * vbbm->nFiles);
-    bytesToWrite += sizeof(VBFileMetadata) * vbbm->nFiles;
+    image.clear();
+    image.reserve(sizeof(header) + sizeof(VBFileMetadata) * vbbm->nFiles +
+                  (size_t) vbbm->vbCurrentSize * sizeof(VBBMEntry));
+    image.insert(image.end(), (char*) header, (char*) header + sizeof(header));
+    image.insert(image.end(), (char*) files, (char*) (files + vbbm->nFiles));
 
-    int first = -1, last = -1, err;
-    size_t progress, writeSize;
-    
-    for (i = 0; i < vbbm->vbCapacity; i++)
+    int first = -1;
+
+    // copy the runs of entries in use
+    for (i = 0; i <= vbbm->vbCapacity; i++)
     {
-        if (storage[i].lbid != -1 && first == -1)
+        bool inUse = (i < vbbm->vbCapacity && storage[i].lbid != -1);
+
+        if (inUse && first == -1)
             first = i;
-        else if (storage[i].lbid == -1 && first != -1)
+        else if (!inUse && first != -1)
         {
-            last = i;
-            writeSize = (last - first) * sizeof(VBBMEntry);
-            progress = 0;
-            char *writePos = (char *) &storage[first];
-            while (progress < writeSize)
-            {
-                err = out->write(writePos + progress, writeSize - progress);
-                if (err < 0)
-                {
-                    log_errno("VBBM::save()");
-                    throw runtime_error("VBBM::save(): Failed to write the file");
-                }
-                progress += err;
-            }
+            image.insert(image.end(), (char*) &storage[first], (char*) &storage[i]);
             first = -1;
         }
-
-    }
-    if (first != -1)
-    {
-        writeSize = (vbbm->vbCapacity - first) * sizeof(VBBMEntry);
-        progress = 0;
-        char *writePos = (char *) &storage[first];
-        while (progress < writeSize)
-        {
-            err = out->write(writePos + progress, writeSize - progress);
-            if (err < 0)
-            {
-                log_errno("VBBM::save()");
-                throw runtime_error("VBBM::save(): Failed to write the file");
-            }
-            progress += err;
-        }
     }
-    
-
-#if 0
-    cout << "saving... nfiles=" << vbbm->nFiles << "\n";
-
-    for (i = 0; i < vbbm->nFiles; i++)
-    {
-        cout << "file " << i << " vboid=" << files[i].OID << " size=" << files[i].fileSize << endl;
-    }
-
-#endif
 }
 
 uint32_t VBBM::addVBFileIfNotExists(OID_t vbOID)
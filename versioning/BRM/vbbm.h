@@ -216,6 +216,8 @@ public:
     EXPORT void load(std::string filename);
     EXPORT void loadVersion2(idbdatafile::IDBDataFile* in);
     EXPORT void save(std::string filename);
+    // copies the entries into an image of the file save(filename) writes
+    EXPORT void save(std::vector<char>& image);
 
 #ifdef BRM_DEBUG
     EXPORT int getShmid() const;
@@ -31,6 +31,7 @@
 #include <sys/stat.h>
 #include <boost/thread.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/scoped_array.hpp>
 
 #ifdef _MSC_VER
 #include <io.h>
@@ -66,6 +67,8 @@ VSSEntry::VSSEntry()
     vbFlag = false;
     locked = false;
     next = -1;
+    txnNext = -1;
+    txnPrev = -1;
 }
 
 /*static*/
@@ -106,6 +109,7 @@ VSS::VSS()
 {
     vss = 0;
     hashBuckets = 0;
+    txnBuckets = 0;
     storage = 0;
     currentVSSShmkey = -1;
     vssShmid = 0;
@@ -121,8 +125,6 @@ VSS::~VSS()
 // ported from ExtentMap
 void VSS::lock(OPS op)
 {
-    char* shmseg;
-
     if (op == READ)
     {
         vssShminfo = mst.getTable_read(MasterSegmentTable::VSSSegment);
@@ -175,11 +177,7 @@ void VSS::lock(OPS op)
                 fPVSSImpl->makeReadOnly();
 
             vss = fPVSSImpl->get();
-            shmseg = reinterpret_cast<char*>(vss);
-            hashBuckets = reinterpret_cast<int*>
-                          (&shmseg[sizeof(VSSShmsegHeader)]);
-            storage = reinterpret_cast<VSSEntry*>(&shmseg[sizeof(VSSShmsegHeader) +
-                                                                          vss->numHashBuckets * sizeof(int)]);
+            setPointers();
 
             if (op == READ)
                 mutex.unlock();
@@ -188,11 +186,7 @@ void VSS::lock(OPS op)
     else
     {
         vss = fPVSSImpl->get();
-        shmseg = reinterpret_cast<char*>(vss);
-        hashBuckets = reinterpret_cast<int*>
-                      (&shmseg[sizeof(VSSShmsegHeader)]);
-        storage = reinterpret_cast<VSSEntry*>(&shmseg[sizeof(VSSShmsegHeader) +
-                                                                      vss->numHashBuckets * sizeof(int)]);
+        setPointers();
 
         if (op == READ)
             mutex.unlock();
@@ -208,30 +202,35 @@ void VSS::release(OPS op)
         mst.releaseTable_write(MasterSegmentTable::VSSSegment);
 }
 
+void VSS::setPointers()
+{
+    char* shmseg = reinterpret_cast<char*>(vss);
+
+    hashBuckets = reinterpret_cast<int*>(&shmseg[sizeof(VSSShmsegHeader)]);
+    txnBuckets = &hashBuckets[vss->numHashBuckets];
+    storage = reinterpret_cast<VSSEntry*>(&txnBuckets[vss->numTxnBuckets]);
+}
+
 void VSS::initShmseg()
 {
     int i;
-    char* newshmseg;
-    int* buckets;
-    VSSEntry* stor;
 
     vss->capacity = VSSSTORAGE_INITIAL_SIZE / sizeof(VSSEntry);
     vss->currentSize = 0;
     vss->lockedEntryCount = 0;
     vss->LWM = 0;
     vss->numHashBuckets = VSSTABLE_INITIAL_SIZE / sizeof(int);
-    newshmseg = reinterpret_cast<char*>(vss);
-
-    buckets = reinterpret_cast<int*>
-              (&newshmseg[sizeof(VSSShmsegHeader)]);
-    stor = reinterpret_cast<VSSEntry*>(&newshmseg[sizeof(VSSShmsegHeader) +
-                                                               vss->numHashBuckets * sizeof(int)]);
+    vss->numTxnBuckets = VSSTXNTABLE_SIZE / sizeof(int);
+    setPointers();
 
     for (i = 0; i < vss->numHashBuckets; i++)
-        buckets[i] = -1;
+        hashBuckets[i] = -1;
+
+    for (i = 0; i < vss->numTxnBuckets; i++)
+        txnBuckets[i] = -1;
 
     for (i = 0; i < vss->capacity; i++)
-        stor[i].lbid = -1;
+        storage[i].lbid = -1;
 }
 
 //assumes write lock is held
@@ -258,6 +257,7 @@ void VSS::growVSS()
         VSSShmsegHeader* tmp = reinterpret_cast<VSSShmsegHeader*>(newshmseg);
         tmp->capacity = vss->capacity + VSSSTORAGE_INCREMENT / sizeof(VSSEntry);
         tmp->numHashBuckets = vss->numHashBuckets + VSSTABLE_INCREMENT / sizeof(int);
+        tmp->numTxnBuckets = vss->numTxnBuckets;
         tmp->LWM = 0;
         copyVSS(tmp);
         fPVSSImpl->swapout(newShm);
@@ -283,11 +283,7 @@ void VSS::growVSS()
         vss = fPVSSImpl->get();
     }
 
-    newshmseg = reinterpret_cast<char*>(vss);
-    hashBuckets = reinterpret_cast<int*>
-                  (&newshmseg[sizeof(VSSShmsegHeader)]);
-    storage = reinterpret_cast<VSSEntry*>(&newshmseg[sizeof(VSSShmsegHeader) +
-                                                                  vss->numHashBuckets * sizeof(int)]);
+    setPointers();
 }
 
 //assumes write lock is held
@@ -295,7 +291,6 @@ void VSS::growForLoad(int elementCount)
 {
     int allocSize;
     key_t newshmkey;
-    char* newshmseg;
     int i;
 
     if (elementCount < VSSSTORAGE_INITIAL_COUNT)
@@ -325,13 +320,10 @@ void VSS::growForLoad(int elementCount)
     vss->currentSize = 0;
     vss->LWM = 0;
     vss->numHashBuckets = elementCount / 4;
+    vss->numTxnBuckets = VSSTXNTABLE_SIZE / sizeof(int);
     vss->lockedEntryCount = 0;
     undoRecords.clear();
-    newshmseg = reinterpret_cast<char*>(vss);
-    hashBuckets = reinterpret_cast<int*>
-                  (&newshmseg[sizeof(VSSShmsegHeader)]);
-    storage = reinterpret_cast<VSSEntry*>(&newshmseg[sizeof(VSSShmsegHeader) +
-                                                                  vss->numHashBuckets * sizeof(int)]);
+    setPointers();
 
     for (i = 0; i < vss->capacity; i++)
         storage[i].lbid = -1;
@@ -339,16 +331,20 @@ void VSS::growForLoad(int elementCount)
     for (i = 0; i < vss->numHashBuckets; i++)
         hashBuckets[i] = -1;
 
+    for (i = 0; i < vss->numTxnBuckets; i++)
+        txnBuckets[i] = -1;
+
     vssShminfo->tableShmkey = newshmkey;
     vssShminfo->allocdSize = allocSize;
 }
 
 //assumes write lock is held and the src is vbbm
-//and that dest->{numHashBuckets, capacity, LWM} have been set.
+//and that dest->{numHashBuckets, numTxnBuckets, capacity, LWM} have been set.
 void VSS::copyVSS(VSSShmsegHeader* dest)
 {
     int i;
     int* newHashtable;
+    int* newTxnTable;
     VSSEntry* newStorage;
     char* cDest = reinterpret_cast<char*>(dest);
 
@@ -357,13 +353,16 @@ void VSS::copyVSS(VSSShmsegHeader* dest)
     dest->lockedEntryCount = vss->lockedEntryCount;
 
     newHashtable = reinterpret_cast<int*>(&cDest[sizeof(VSSShmsegHeader)]);
-    newStorage = reinterpret_cast<VSSEntry*>(&cDest[sizeof(VSSShmsegHeader) +
-                                         dest->numHashBuckets * sizeof(int)]);
+    newTxnTable = &newHashtable[dest->numHashBuckets];
+    newStorage = reinterpret_cast<VSSEntry*>(&newTxnTable[dest->numTxnBuckets]);
 
     //initialize new storage & hash
     for (i = 0; i < dest->numHashBuckets; i++)
         newHashtable[i] = -1;
 
+    for (i = 0; i < dest->numTxnBuckets; i++)
+        newTxnTable[i] = -1;
+
     for (i = 0; i < dest->capacity; i++)
         newStorage[i].lbid = -1;
 
@@ -371,7 +370,7 @@ void VSS::copyVSS(VSSShmsegHeader* dest)
     for (i = 0; i < vss->currentSize; i++)
         if (storage[i].lbid != -1)
         {
-            _insert(storage[i], dest, newHashtable, newStorage, true);
+            _insert(storage[i], dest, newHashtable, newTxnTable, newStorage, true);
             //confirmChanges();
         }
 }
@@ -420,7 +419,7 @@ void VSS::insert(LBID_t lbid, VER_t verID, bool vbFlag, bool locked, bool loadin
     if (vss->currentSize == vss->capacity)
         growVSS();
 
-    _insert(entry, vss, hashBuckets, storage, loading);
+    _insert(entry, vss, hashBuckets, txnBuckets, storage, loading);
 
     if (!loading)
         makeUndoRecord(&vss->currentSize, sizeof(vss->currentSize));
@@ -435,10 +434,10 @@ void VSS::insert(LBID_t lbid, VER_t verID, bool vbFlag, bool locked, bool loadin
 
 //assumes write lock is held and that it is properly sized already
 //metadata is modified by the caller
-void VSS::_insert(VSSEntry& e, VSSShmsegHeader* dest, int* destHash,
+void VSS::_insert(VSSEntry& e, VSSShmsegHeader* dest, int* destHash, int* destTxnHash,
                   VSSEntry* destStorage, bool loading)
 {
-    int hashIndex, insertIndex;
+    int hashIndex, txnIndex, insertIndex;
 
     hashIndex = hasher((char*) &e.lbid, sizeof(e.lbid)) % dest->numHashBuckets;
 
@@ -471,10 +470,62 @@ void VSS::_insert(VSSEntry& e, VSSShmsegHeader* dest, int* destHash,
     }
 
     e.next = destHash[hashIndex];
+    e.txnNext = -1;
+    e.txnPrev = -1;
+
+    // a locked entry goes to the head of the list of its transaction
+    if (e.locked)
+    {
+        txnIndex = e.verID % dest->numTxnBuckets;
+
+        if (!loading)
+            makeUndoRecord(&destTxnHash[txnIndex], sizeof(int));
+
+        e.txnNext = destTxnHash[txnIndex];
+
+        if (e.txnNext != -1)
+        {
+            if (!loading)
+                makeUndoRecord(&destStorage[e.txnNext], sizeof(VSSEntry));
+
+            destStorage[e.txnNext].txnPrev = insertIndex;
+        }
+
+        destTxnHash[txnIndex] = insertIndex;
+    }
+
     destStorage[insertIndex] = e;
     destHash[hashIndex] = insertIndex;
 }
 
+//assumes write lock is held and that an undo record of storage[index] was made.
+//Takes a locked entry off the list of its transaction.
+void VSS::unlinkTxnEntry(int index)
+{
+    VSSEntry& e = storage[index];
+
+    if (e.txnPrev != -1)
+    {
+        makeUndoRecord(&storage[e.txnPrev], sizeof(VSSEntry));
+        storage[e.txnPrev].txnNext = e.txnNext;
+    }
+    else
+    {
+        int txnIndex = e.verID % vss->numTxnBuckets;
+        makeUndoRecord(&txnBuckets[txnIndex], sizeof(int));
+        txnBuckets[txnIndex] = e.txnNext;
+    }
+
+    if (e.txnNext != -1)
+    {
+        makeUndoRecord(&storage[e.txnNext], sizeof(VSSEntry));
+        storage[e.txnNext].txnPrev = e.txnPrev;
+    }
+
+    e.txnNext = -1;
+    e.txnPrev = -1;
+}
+
 //assumes read lock is held
 int VSS::lookup(LBID_t lbid, const QueryContext_vss& verInfo, VER_t txnID, VER_t* outVer,
                 bool* vbFlag, bool vbOnly) const
@@ -711,6 +762,10 @@ void VSS::removeEntry(LBID_t lbid, VER_t verID, vector<LBID_t>* flushList)
     }
 
     makeUndoRecord(&storage[index], sizeof(VSSEntry));
+
+    if (storage[index].locked)
+        unlinkTxnEntry(index);
+
     storage[index].lbid = -1;
 
     if (prev != -1)
@@ -747,6 +802,10 @@ void VSS::removeEntry(LBID_t lbid, VER_t verID, vector<LBID_t>* flushList)
         if (storage[index].lbid == lbid)
         {
             makeUndoRecord(&storage[index], sizeof(VSSEntry));
+
+            if (storage[index].locked)
+                unlinkTxnEntry(index);
+
             storage[index].lbid = -1;
 
             if (prev == -1)
@@ -931,7 +990,7 @@ void VSS::setVBFlag(LBID_t lbid, VER_t verID, bool vbFlag)
 //write lock
 void VSS::commit(VER_t txnID)
 {
-    int i;
+    int i, next;
 
 #ifdef BRM_DEBUG
 
@@ -943,27 +1002,22 @@ void VSS::commit(VER_t txnID)
 
 #endif
 
-    for (i = 0; i < vss->capacity; i++)
-        if (storage[i].lbid != -1 && storage[i].verID == txnID)
-        {
-#ifdef BRM_DEBUG
-
-            if (storage[i].locked != true)
-            {
-                ostringstream ostr;
-                ostr << "VSS::commit(): An entry has already been unlocked..? txnId = " << txnID ;
-                log(ostr.str(), logging::LOG_TYPE_DEBUG);
-                throw logic_error(ostr.str());
-            }
+    // only the locked entries are on the txn lists
+    for (i = txnBuckets[txnID % vss->numTxnBuckets]; i != -1; i = next)
+    {
+        next = storage[i].txnNext;
 
-#endif
+        if (storage[i].verID == txnID)
+        {
             makeUndoRecord(&storage[i], sizeof(VSSEntry));
+            unlinkTxnEntry(i);
             storage[i].locked = false;
 
             // @ bug 1426 fix. Decrease the counter when an entry releases its lock.
             if (vss->lockedEntryCount > 0)
                 vss->lockedEntryCount--;
         }
+    }
 }
 
 //read lock
@@ -984,18 +1038,11 @@ void VSS::getUncommittedLBIDs(VER_t txnID, vector<LBID_t>& lbids)
 
 #endif
 
-    for (i = 0; i < vss->capacity; i++)
-        if (storage[i].lbid != -1 && storage[i].verID == txnID)
+    for (i = txnBuckets[txnID % vss->numTxnBuckets]; i != -1; i = storage[i].txnNext)
+        if (storage[i].verID == txnID)
         {
 #ifdef BRM_DEBUG
 
-            if (storage[i].locked == false)
-            {
-                log("VSS::getUncommittedLBIDs(): found an unlocked block with that TxnID",
-                    logging::LOG_TYPE_DEBUG);
-                throw logic_error("VSS::getUncommittedLBIDs(): found an unlocked block with that TxnID");
-            }
-
             if (storage[i].vbFlag == true)
             {
                 log("VSS::getUncommittedLBIDs(): found a block with that TxnID in the VB",
@@ -1022,8 +1069,8 @@ void VSS::getLockedLBIDs(BlockList_t& lbids)
 {
     lbids.clear();
 
-    for (int i = 0; i < vss->capacity; i++)
-        if (storage[i].lbid != -1 && storage[i].locked)
+    for (int bucket = 0; bucket < vss->numTxnBuckets; bucket++)
+        for (int i = txnBuckets[bucket]; i != -1; i = storage[i].txnNext)
             lbids.push_back(LVP_t(storage[i].lbid, storage[i].verID));
 }
 //write lock
@@ -1068,6 +1115,10 @@ void VSS::removeEntriesFromDB(const LBIDRange& range, VBBM& vbbm, bool use_vbbm)
                     vbbm.removeEntry(storage[index].lbid, storage[index].verID);
 
                 makeUndoRecord(&storage[index], sizeof(VSSEntry));
+
+                if (storage[index].locked)
+                    unlinkTxnEntry(index);
+
                 storage[index].lbid = -1;
 
                 if (prev == -1)
@@ -1131,7 +1182,6 @@ void VSS::clear()
 {
     int allocSize;
     key_t newshmkey;
-    char* newshmseg;
 
     allocSize = VSS_INITIAL_SIZE;
 
@@ -1151,11 +1201,7 @@ void VSS::clear()
         vss = fPVSSImpl->get();
     }
 
-    newshmseg = reinterpret_cast<char*>(vss);
-    hashBuckets = reinterpret_cast<int*>
-                  (&newshmseg[sizeof(VSSShmsegHeader)]);
-    storage = reinterpret_cast<VSSEntry*>(&newshmseg[sizeof(VSSShmsegHeader) +
-                                                                  vss->numHashBuckets * sizeof(int)]);
+    setPointers();
 }
 
 // read lock
@@ -1170,6 +1216,7 @@ int VSS::checkConsistency(const VBBM& vbbm, ExtentMap& em) const
     	c. each hash table entry points to a non-empty element or -1
     	d. verify that there are no empty entries below the LWM
     	e. verify uniqueness of the entries
+    	f. the txn lists hold exactly the locked entries, each in its bucket
 
     */
 
@@ -1257,6 +1304,35 @@ int VSS::checkConsistency(const VBBM& vbbm, ExtentMap& em) const
                         throw logic_error("VSS::checkConsistency(): Duplicate entry found");
                     }
 
+    /* Test 2f - verify the txn lists */
+
+    int lockedCount = 0, listedCount = 0;
+
+    for (i = 0; i < vss->capacity; i++)
+        if (storage[i].lbid != -1 && storage[i].locked)
+            lockedCount++;
+
+    for (i = 0; i < vss->numTxnBuckets; i++)
+        for (j = txnBuckets[i], k = -1; j != -1; k = j, j = storage[j].txnNext)
+        {
+            if (storage[j].lbid == -1 || !storage[j].locked ||
+                    storage[j].verID % vss->numTxnBuckets != i || storage[j].txnPrev != k)
+            {
+                cerr << "VSS: txn list entry=" << j << " lbid=" << storage[j].lbid << " verID=" <<
+                     storage[j].verID << " locked=" << storage[j].locked << endl;
+                throw logic_error("VSS::checkConsistency(): bad entry on a txn list");
+            }
+
+            if (++listedCount > lockedCount)
+                throw logic_error("VSS::checkConsistency(): a txn list has a cycle");
+        }
+
+    if (listedCount != lockedCount)
+    {
+        cerr << "VSS: locked entries=" << lockedCount << " on the txn lists=" << listedCount << endl;
+        throw logic_error("VSS::checkConsistency(): a locked entry isn't on its txn list");
+    }
+
     return 0;
 }
 
@@ -1267,10 +1343,10 @@ void VSS::setReadOnly()
 
 void VSS::getCurrentTxnIDs(set<VER_t>& list) const
 {
-    int i;
+    int i, bucket;
 
-    for (i = 0; i < vss->capacity; i++)
-        if (storage[i].lbid != -1 && storage[i].locked)
+    for (bucket = 0; bucket < vss->numTxnBuckets; bucket++)
+        for (i = txnBuckets[bucket]; i != -1; i = storage[i].txnNext)
             list.insert(storage[i].verID);
 }
 
@@ -1278,7 +1354,7 @@ void VSS::getCurrentTxnIDs(set<VER_t>& list) const
 
 		VSS V1 magic (32-bits)
 		# of VSS entries in capacity (32-bits)
-		struct VSSEntry * #
+		struct VSSFileEntry * #
 */
 
 struct Header
@@ -1287,74 +1363,54 @@ struct Header
     int entries;
 };
 
-// read lock
+// the layout VSSEntry had before the txn lists were added to it
+struct VSSFileEntry
+{
+    LBID_t lbid;
+    VER_t verID;
+    bool vbFlag;
+    bool locked;
+    int next;
+#ifndef __LP64__
+    uint32_t pad1;
+#endif
+};
+
 void VSS::save(string filename)
 {
-    int i;
-    struct Header header;
+    vector<char> image;
 
-    const char* filename_p = filename.c_str();
-    scoped_ptr<IDBDataFile> out(IDBDataFile::open(
-                                    IDBPolicy::getType(filename_p, IDBPolicy::WRITEENG),
-                                    filename_p, "wb", IDBDataFile::USE_VBUF));
+    save(image);
+    saveImage(filename, image);
+}
 
-    if (!out)
-    {
-        log_errno("VSS::save()");
-        throw runtime_error("VSS::save(): Failed to open the file");
-    }
+// read lock
+void VSS::save(vector<char>& image)
+{
+    int i;
+    struct Header header;
+    VSSFileEntry entry;
 
     header.magic = VSS_MAGIC_V1;
     header.entries = vss->currentSize;
 
-    if (out->write((char*)&header, sizeof(header)) != sizeof(header))
-    {
-        log_errno("VSS::save()");
-        throw runtime_error("VSS::save(): Failed to write header to the file");
-    }
+    image.clear();
+    image.reserve(sizeof(header) + (size_t) vss->currentSize * sizeof(VSSFileEntry));
+    image.insert(image.end(), (char*) &header, (char*) &header + sizeof(header));
+    memset(&entry, 0, sizeof(entry));
 
-    int first = -1, last = -1, err;
-    size_t progress, writeSize;
     for (i = 0; i < vss->capacity; i++)
     {
-        if (storage[i].lbid != -1 && first == -1)
-            first = i;
-        else if (storage[i].lbid == -1 && first != -1)
-        {
-            last = i;
-            writeSize = (last - first) * sizeof(VSSEntry);
-            progress = 0;
-            char *writePos = (char *) &storage[first];
-            while (progress < writeSize)
-            {
-                err = out->write(writePos + progress, writeSize - progress);
-                if (err < 0)
-                {
-                    log_errno("VSS::save()");
-                    throw runtime_error("VSS::save(): Failed to write the file");
-                }
-                progress += err;
-            }
-            first = -1;
-        }
-    }
-    if (first != -1)
-    {
-        writeSize = (vss->capacity - first) * sizeof(VSSEntry);
-        progress = 0;
-        char *writePos = (char *) &storage[first];
-        while (progress < writeSize)
+        if (storage[i].lbid != -1)
         {
-            err = out->write(writePos + progress, writeSize - progress);
-            if (err < 0)
-            {
-                log_errno("VSS::save()");
-                throw runtime_error("VSS::save(): Failed to write the file");
-            }
-            progress += err;
+            entry.lbid = storage[i].lbid;
+            entry.verID = storage[i].verID;
+            entry.vbFlag = storage[i].vbFlag;
+            entry.locked = storage[i].locked;
+            entry.next = storage[i].next;
+            image.insert(image.end(), (char*) &entry, (char*) &entry + sizeof(entry));
         }
     }
-
 }
 
 // Ideally, we;d like to get in and out of this fcn as quickly as possible.
@@ -1395,7 +1451,7 @@ void VSS::load(string filename)
 {
     int i;
     struct Header header;
-    struct VSSEntry entry;
+    struct VSSFileEntry entry;
     //ptime time1, time2;
 
     //time1 = microsec_clock::local_time();
@@ -1461,7 +1517,7 @@ void VSS::load(string filename)
         progress += err;
     }
     
-    VSSEntry *loadedEntries = (VSSEntry *) readBuf;
+    VSSFileEntry *loadedEntries = (VSSFileEntry *) readBuf;
     for (i = 0; i < header.entries; i++)
         insert(loadedEntries[i].lbid, loadedEntries[i].verID, loadedEntries[i].vbFlag, 
           loadedEntries[i].locked, true);
@@ -28,6 +28,7 @@
 #define _VSS_H_
 
 #include <set>
+#include <vector>
 //#define NDEBUG
 #include <cassert>
 #include <boost/thread.hpp>
@@ -62,13 +63,17 @@
 #define VSSTABLE_INITIAL_SIZE (50000*sizeof(int))
 #define VSSTABLE_INCREMENT (5000*sizeof(int))
 
+// buckets of the per-transaction lists of locked entries, keyed by txnID
+#define VSSTXNTABLE_SIZE (1024*sizeof(int))
+
 #define VSS_INITIAL_SIZE (sizeof(VSSShmsegHeader) + \
-	VSSSTORAGE_INITIAL_SIZE + VSSTABLE_INITIAL_SIZE)
+	VSSSTORAGE_INITIAL_SIZE + VSSTABLE_INITIAL_SIZE + VSSTXNTABLE_SIZE)
 
 #define VSS_INCREMENT (VSSTABLE_INCREMENT + VSSSTORAGE_INCREMENT)
 
 #define VSS_SIZE(entries) \
-	((entries*sizeof(VSSEntry)) + (entries/4 * sizeof(int)) + sizeof(VSSShmsegHeader))
+	((entries*sizeof(VSSEntry)) + (entries/4 * sizeof(int)) + VSSTXNTABLE_SIZE + \
+	sizeof(VSSShmsegHeader))
 
 #if defined(_MSC_VER) && defined(xxxVSS_DLLEXPORT)
 #define EXPORT __declspec(dllexport)
@@ -86,6 +91,8 @@ struct VSSEntry
     bool vbFlag;
     bool locked;
     int next;
+    int txnNext;	// the list of locked entries of txn verID, -1 if not locked
+    int txnPrev;
 #ifndef __LP64__
     uint32_t pad1;
 #endif
@@ -99,9 +106,11 @@ struct VSSShmsegHeader
     int LWM;
     int numHashBuckets;
     int lockedEntryCount;
+    int numTxnBuckets;
 
 //  the rest of the overlay looks like this
 // 	int hashBuckets[numHashBuckets];
+// 	int txnBuckets[numTxnBuckets];
 // 	VSSEntry storage[capacity];
 };
 
@@ -200,6 +209,11 @@ class ExtentMap;
  * is created, the contents are reinserted to the new one, the key is
  * registered, and the old segment is destroyed when the last reference to it
  * is detached.
+ *
+ * The locked entries, the ones written by uncommitted transactions, are also
+ * kept on doubly linked lists hashed by txnID, so commit() and the rollback
+ * path touch only the entries of that transaction instead of scanning the
+ * whole storage array.
  */
 
 class VSS : public Undoable
@@ -251,6 +265,8 @@ public:
     EXPORT void clear();
     EXPORT void load(std::string filename);
     EXPORT void save(std::string filename);
+    // copies the entries into an image of the file save(filename) writes
+    EXPORT void save(std::vector<char>& image);
 
 #ifdef BRM_DEBUG
     EXPORT int getShmid() const;
@@ -269,6 +285,7 @@ private:
 
     struct VSSShmsegHeader* vss;
     int* hashBuckets;
+    int* txnBuckets;
     VSSEntry* storage;
     bool r_only;
     static boost::mutex mutex; // @bug5355 - made mutex static
@@ -284,10 +301,12 @@ private:
     void growForLoad(int count);
     void initShmseg();
     void copyVSS(VSSShmsegHeader* dest);
+    void setPointers();
+    void unlinkTxnEntry(int index);
 
     int getIndex(LBID_t lbid, VER_t verID, int& prev, int& bucket) const;
-    void _insert(VSSEntry& e, VSSShmsegHeader* dest, int* destTable, VSSEntry*
-                 destStorage, bool loading = false);
+    void _insert(VSSEntry& e, VSSShmsegHeader* dest, int* destTable, int* destTxnTable,
+                 VSSEntry* destStorage, bool loading = false);
     ShmKeys fShmKeys;
 
     VSSImpl* fPVSSImpl;
@@ -1089,9 +1089,10 @@ uint8_t WE_DMLCommandProc::processBatchInsert(messageqcpp::ByteStream& bs, std::
 
                     boost::any datavalue;
                     bool isNULL = false;
-                    std::vector<std::string> origVals;
-                    origVals = columnPtr->get_DataVector();
+                    const std::vector<std::string>& origVals = columnPtr->get_DataVector();
                     WriteEngine::dictStr dicStrings;
+                    colTuples.reserve(colTuples.size() + origVals.size());
+                    dicStrings.reserve(origVals.size());
 
                     // token
                     if ( isDictCol(colType) )
@@ -1129,10 +1130,9 @@ uint8_t WE_DMLCommandProc::processBatchInsert(messageqcpp::ByteStream& bs, std::
                                     pushWarning = true;
                             }
 
-                            WriteEngine::ColTuple colTuple;
-                            colTuple.data = datavalue;
-
-                            colTuples.push_back(colTuple);
+                            // swap the value in, copying a boost::any clones it
+                            colTuples.push_back(WriteEngine::ColTuple());
+                            colTuples.back().data.swap(datavalue);
                             //@Bug 2515. Only pass string values to write engine
                             dicStrings.push_back( tmpStr );
                         }
@@ -1254,16 +1254,24 @@ uint8_t WE_DMLCommandProc::processBatchInsert(messageqcpp::ByteStream& bs, std::
                             if ( pushWarning && ( rc != dmlpackageprocessor::DMLPackageProcessor::IDBRANGE_WARNING ) )
                                 rc = dmlpackageprocessor::DMLPackageProcessor::IDBRANGE_WARNING;
 
-                            WriteEngine::ColTuple colTuple;
-                            colTuple.data = datavalue;
-
-                            colTuples.push_back(colTuple);
+                            // swap the value in, copying a boost::any clones it
+                            colTuples.push_back(WriteEngine::ColTuple());
+                            colTuples.back().data.swap(datavalue);
                             //@Bug 2515. Only pass string values to write engine
                             dicStrings.push_back( tmpStr );
                         }
 
-                        colValuesList.push_back(colTuples);
-                        dicStringList.push_back( dicStrings );
+                        // the last row hands its values over instead of copying them
+                        if (row_iterator + 1 == rows.end())
+                        {
+                            colValuesList.push_back(WriteEngine::ColTupleList());
+                            colValuesList.back().swap(colTuples);
+                        }
+                        else
+                            colValuesList.push_back(colTuples);
+
+                        dicStringList.push_back(WriteEngine::dictStr());
+                        dicStringList.back().swap(dicStrings);
                     }
 
                     ++row_iterator;
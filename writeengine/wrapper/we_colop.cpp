@@ -727,6 +727,8 @@ int ColumnOp::fillColumn(const TxnID& txnid, Column& column, Column& refCol, voi
     const uint8_t* refEmptyVal = getEmptyRowValue(refCol.colDataType,
                                                   refCol.colWidth);
     findTypeHandler(column.colWidth, column.colDataType);
+    unsigned char emptyBlock[BYTE_PER_BLOCK];
+    setEmptyBuf(emptyBlock, BYTE_PER_BLOCK, emptyVal, column.colWidth);
     //find the dbroots which have rows for refrence column
     unsigned int i = 0, k = 0;
 
@@ -1068,12 +1070,24 @@ int ColumnOp::fillColumn(const TxnID& txnid, Column& column, Column& refCol, voi
             }
             else
             {
+                // The extents of the new column were just created and hold
+                // nothing but empty values, so its blocks are built from an
+                // empty block instead of being read back, and the reference
+                // blocks past the HWM are known to be empty too.
                 while (startRefColFbo <= lastRefHwm || startColFbo <= colHwm)
                 {
                     if ((refBufOffset + refCol.colWidth) > BYTE_PER_BLOCK)
                     {
                         //If current reference column block is fully processed get to the next one
-                        RETURN_ON_ERROR(refColOp->readBlock(refCol.dataFile.pFile, refColBuf, startRefColFbo));
+                        if (startRefColFbo <= lastRefHwm)
+                        {
+                            RETURN_ON_ERROR(refColOp->readBlock(refCol.dataFile.pFile, refColBuf, startRefColFbo));
+                        }
+                        else
+                        {
+                            setEmptyBuf(refColBuf, BYTE_PER_BLOCK, refEmptyVal, refCol.colWidth);
+                        }
+
                         startRefColFbo++;
                         refBufOffset = 0;
                     }
@@ -1087,29 +1101,21 @@ int ColumnOp::fillColumn(const TxnID& txnid, Column& column, Column& refCol, voi
                             dirty = false;
                         }
 
-                        RETURN_ON_ERROR(readBlock(column.dataFile.pFile, colBuf, startColFbo));
+                        memcpy(colBuf, emptyBlock, BYTE_PER_BLOCK);
                         startColFbo++;
                         colBufOffset = 0;
+                        //@Bug 3866, compressed chunks get the empty row values written
+                        dirty = (column.compressionType != 0);
                     }
-                    
+
                     while (((refBufOffset + refCol.colWidth) <= BYTE_PER_BLOCK) &&
                             ((colBufOffset + column.colWidth) <= BYTE_PER_BLOCK))
                     {
                         if (memcmp(refColBuf + refBufOffset, refEmptyVal, refCol.colWidth) != 0)
                         {
-                            /*if (autoincrement)
-                            {
-                            	memcpy(defaultVal, &nextVal, 8);
-                            	nextVal++;
-                            } */
                             memcpy(colBuf + colBufOffset, defaultVal, column.colWidth);
                             dirty = true;
                         }
-                        else if (column.compressionType != 0) //@Bug 3866, fill the empty row value for compressed chunk
-                        {
-                            memcpy(colBuf + colBufOffset, emptyVal, column.colWidth);
-                            dirty = true;
-                        }
 
                         refBufOffset += refCol.colWidth;
                         colBufOffset += column.colWidth;
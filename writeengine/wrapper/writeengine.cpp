@@ -482,23 +482,22 @@ void WriteEngineWrapper::updateMaxMinRange(const size_t totalNewRow, const size_
  ***********************************************************/
 void WriteEngineWrapper::convertValArray(const size_t totalRow, const CalpontSystemCatalog::ColType& cscColType, const ColType colType, ColTupleList& curTupleList, void* valArray, bool bFromList)
 {
-    ColTuple    curTuple;
     ColTupleList::size_type i;
 
+    // the values are converted in place, copying a ColTuple clones its boost::any
     if (bFromList)
     {
         for (i = 0; i < curTupleList.size(); i++)
-        {
-            curTuple = curTupleList[i];
-            convertValue(cscColType, colType, valArray, i, curTuple.data, true);
-        }
-    } 
+            convertValue(cscColType, colType, valArray, i, curTupleList[i].data, true);
+    }
     else
     {
+        curTupleList.reserve(curTupleList.size() + totalRow);
+
         for (i = 0; i < totalRow; i++)
         {
-            convertValue(cscColType, colType, valArray, i, curTuple.data, false);
-            curTupleList.push_back(curTuple);
+            curTupleList.push_back(ColTuple());
+            convertValue(cscColType, colType, valArray, i, curTupleList.back().data, false);
         }
     }
 }
@@ -508,7 +507,6 @@ void WriteEngineWrapper::convertValArray(const size_t totalRow, const CalpontSys
  */
 void WriteEngineWrapper::convertValue(const execplan::CalpontSystemCatalog::ColType& cscColType, ColType colType, void* value, boost::any& data)
 {
-    string curStr;
     int size;
 
     switch (colType)
@@ -543,13 +541,11 @@ void WriteEngineWrapper::convertValue(const execplan::CalpontSystemCatalog::ColT
         case WriteEngine::WR_CHAR :
         case WriteEngine::WR_BLOB :
         case WriteEngine::WR_TEXT :
-            curStr = boost::any_cast<string>(data);
-
-            if ((int) curStr.length() > MAX_COLUMN_BOUNDARY)
-                curStr = curStr.substr(0, MAX_COLUMN_BOUNDARY);
-
-            memcpy(value, curStr.c_str(), curStr.length());
-            break;
+        {
+            const string& str = boost::any_cast<const string&>(data);
+            memcpy(value, str.c_str(), std::min((int) str.length(), (int) MAX_COLUMN_BOUNDARY));
+        }
+        break;
 
         case WriteEngine::WR_FLOAT:
         {
@@ -701,13 +697,12 @@ void WriteEngineWrapper::convertValue(const CalpontSystemCatalog::ColType& cscCo
             case WriteEngine::WR_CHAR :
             case WriteEngine::WR_BLOB :
             case WriteEngine::WR_TEXT :
-                curStr = boost::any_cast<string>(data);
-
-                if ((int) curStr.length() > MAX_COLUMN_BOUNDARY)
-                    curStr = curStr.substr(0, MAX_COLUMN_BOUNDARY);
-
-                memcpy((char*)valArray + pos * MAX_COLUMN_BOUNDARY, curStr.c_str(), curStr.length());
-                break;
+            {
+                const string& str = boost::any_cast<const string&>(data);
+                memcpy((char*)valArray + pos * MAX_COLUMN_BOUNDARY, str.c_str(),
+                       std::min((int) str.length(), (int) MAX_COLUMN_BOUNDARY));
+            }
+            break;
 
 //            case WriteEngine::WR_LONG :   ((long*)valArray)[pos] = boost::any_cast<long>(curTuple.data);
 //                                          break;